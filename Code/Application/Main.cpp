@@ -1,14 +1,18 @@
 #include "VulkanHelper.hpp"
+#include "VulkanTextureRegistry.hpp"
 #include "Stats.hpp"
 
 #include <Core/Array.hpp>
 #include <Core/Log.hpp>
+#include <Core/TrackingAllocator.hpp>
 #include <Core/Input.hpp>
 #include <Core/Win32_Input.hpp>
 #include <Core/Time.hpp>
 
 #include <Core/Image.hpp>
 #include <Core/ImageLoader.hpp>
+#include <Core/ImageLoadQueue.hpp>
+#include <Core/ImageCache.hpp>
 
 #include <Core/Math.hpp>
 #include <Core/Color.hpp>
@@ -1599,7 +1603,12 @@ ApplicationEntryPoint(HINSTANCE ProcessHandle)
   HasConsole = !!GetWindowRect(GetConsoleWindow(), &InitialConsoleRect);
 
   mallocator Mallocator{};
-  allocator_interface& Allocator = Mallocator;
+  tracking_allocator MainAllocator{ Mallocator, "Main" };
+
+  // Images are loaded and cached on worker threads, which is fine since
+  // tracking allocators are thread-safe as long as their base allocator is.
+  tracking_allocator ImageAllocator{ Mallocator, "Image" };
+  allocator_interface& Allocator = MainAllocator;
   allocator_interface* AllocatorPtr = &Allocator;
 
   log_data Log{};
@@ -1612,17 +1621,40 @@ ApplicationEntryPoint(HINSTANCE ProcessHandle)
   GlobalLog = &Log;
   Defer [=](){ GlobalLog = nullptr; };
 
+  Defer [](){ TrackingLogReportAll(GlobalLog); };
+
   image_loader_registry* ImageLoaderRegistry = CreateImageLoaderRegistry(Allocator);
   Defer [&](){ DestroyImageLoaderRegistry(Allocator, ImageLoaderRegistry); };
 
+  // The built-in loaders are linked into Core, so no module is looked up here.
+  RegisterBuiltinImageLoaders(*ImageLoaderRegistry);
+
+  // Processed images are kept next to the executable, so later runs skip
+  // decoding and processing them.
+  arc_string ImageCacheDirectory;
+  ImageCacheDirectory += ThisExeDir();
+  ImageCacheDirectory += "/ImageCache";
+  image_cache* ImageCache = CreateImageCache(ImageAllocator, Slice(ImageCacheDirectory));
+  Defer [&](){ DestroyImageCache(ImageAllocator, ImageCache); };
+
+  image_load_queue* ImageLoadQueue = CreateImageLoadQueue(ImageAllocator);
+  Defer [&](){ DestroyImageLoadQueue(ImageAllocator, ImageLoadQueue); };
+
+  // Start loading the kitten right away so it decodes while Vulkan is set up.
+  arc_string KittenImageFilePath = DataPath("Kitten_DXT1_Mipmaps.dds");
+  auto KittenImageLoaderFactory = GetImageLoaderFactoryByFileContent(*ImageLoaderRegistry, Slice(KittenImageFilePath));
+  if(KittenImageLoaderFactory == nullptr)
+  {
+    auto KittenImageFileExtension = AsConst(FindFileExtension(Slice(KittenImageFilePath)));
+    KittenImageLoaderFactory = GetImageLoaderFactoryByFileExtension(*ImageLoaderRegistry, KittenImageFileExtension);
+  }
+  if(KittenImageLoaderFactory)
   {
-    auto ImageLoaderModule = RegisterImageLoaderModule(*ImageLoaderRegistry,
-                                                       "DDS"_S,
-                                                       "Core.dll"_S,
-                                                       "CreateImageLoader_DDS"_S,
-                                                       "DestroyImageLoader_DDS"_S);
-    if(ImageLoaderModule)
-      AssociateImageLoaderModuleWithFileExtension(*ImageLoaderModule, ".dds"_S);
+    // The kitten is streamed in, so only read the parts of the file that are uploaded.
+    image_load_options KittenLoadOptions{};
+    KittenLoadOptions.PrefetchData = false;
+    KittenLoadOptions.Cache = ImageCache;
+    ImageLoadQueueSubmit(*ImageLoadQueue, Slice(KittenImageFilePath), *KittenImageLoaderFactory, KittenLoadOptions);
   }
 
   {
@@ -1874,6 +1906,28 @@ ApplicationEntryPoint(HINSTANCE ProcessHandle)
       Cam.RotationSpeed = 3;
     }
 
+    //
+    // Texture sharing
+    //
+    // Scene objects that show the same image use the same texture, so it is
+    // only uploaded once.
+    //
+    vulkan_texture_registry* TextureRegistry = VulkanCreateTextureRegistry(ImageAllocator, Vulkan.Device);
+    Defer [&](){ VulkanDestroyTextureRegistry(ImageAllocator, TextureRegistry); };
+
+    // Kitten 1 shows what is rendered to RenderTarget2.
+    vulkan_texture2d RenderTargetTexture{};
+
+    //
+    // Texture streaming
+    //
+    // Textures start out with only their smallest mip levels, the rest is
+    // uploaded over the following frames.
+    //
+    vulkan_texture_streamer TextureStreamer{};
+    VulkanInitTextureStreamer(Vulkan, TextureStreamer, 256 * 1024);
+    Defer [&](){ VulkanFinalizeTextureStreamer(Vulkan, TextureStreamer); };
+
     //
     // Add scene objects
     //
@@ -1901,11 +1955,8 @@ ApplicationEntryPoint(HINSTANCE ProcessHandle)
                                            &TextureUploadCommandBuffer);
       };
 
-      arc_string KittenImageFilePath = DataPath("Kitten_DXT1_Mipmaps.dds");
-      auto KittenImageFileExtension = AsConst(FindFileExtension(Slice(KittenImageFilePath)));
-      auto KittenImageLoaderFactory = GetImageLoaderFactoryByFileExtension(*ImageLoaderRegistry, KittenImageFileExtension);
       image KittenImage{};
-      Init(KittenImage, Allocator);
+      Init(KittenImage, ImageAllocator);
       Defer [&](){ Finalize(KittenImage); };
 
 
@@ -1917,20 +1968,20 @@ ApplicationEntryPoint(HINSTANCE ProcessHandle)
 
         if(KittenImageLoaderFactory)
         {
-          auto ImageLoader = CreateImageLoader(*KittenImageLoaderFactory);
-          Assert(ImageLoader);
+          image_load_result Result{};
+          Init(Result.Image, ImageAllocator);
+          Defer [&](){ Finalize(Result.Image); };
 
-          if(LoadImageFromFile(*ImageLoader, KittenImage, Slice(KittenImageFilePath)))
+          if(ImageLoadQueueWait(*ImageLoadQueue, Result) && Result.Success)
           {
             LogInfo("Loaded image file: %s", StrPtr(KittenImageFilePath));
+            Copy(KittenImage, Result.Image);
           }
           else
           {
             LogWarning("Failed to load image file: %s", StrPtr(KittenImageFilePath));
             UseFallbackImage = true;
           }
-
-          DestroyImageLoader(*KittenImageLoaderFactory, ImageLoader);
         }
         else
         {
@@ -1953,18 +2004,20 @@ ApplicationEntryPoint(HINSTANCE ProcessHandle)
         // TODO: Cleanup
 
         Kitten->Transform.Translation = Vec3(0, 0, 2);
+        Kitten->Texture = &RenderTargetTexture;
 
         #if 0
-        Copy(Kitten->Texture.Image, KittenImage);
+        Init(*Kitten->Texture, ImageAllocator);
+        Copy(Kitten->Texture->Image, KittenImage);
         VulkanUploadTexture(Vulkan,
                             TextureUploadCommandBuffer,
-                            Kitten->Texture);
+                            *Kitten->Texture);
         #else
-        Kitten->Texture.ImageViewHandle = Vulkan.RenderTarget2.ImageView;
-        Kitten->Texture.ImageHandle = Vulkan.RenderTarget2.Image;
-        Kitten->Texture.ImageFormat = Vulkan.RenderTarget2.ImageFormat;
-        Kitten->Texture.ImageTiling = VK_IMAGE_TILING_OPTIMAL;
-        Kitten->Texture.ImageLayout = VK_IMAGE_LAYOUT_GENERAL; // TODO: Get the proper layout?
+        Kitten->Texture->ImageViewHandle = Vulkan.RenderTarget2.ImageView;
+        Kitten->Texture->ImageHandle = Vulkan.RenderTarget2.Image;
+        Kitten->Texture->ImageFormat = Vulkan.RenderTarget2.ImageFormat;
+        Kitten->Texture->ImageTiling = VK_IMAGE_TILING_OPTIMAL;
+        Kitten->Texture->ImageLayout = VK_IMAGE_LAYOUT_GENERAL; // TODO: Get the proper layout?
 
         //
         // Create sampler.
@@ -1987,7 +2040,7 @@ ApplicationEntryPoint(HINSTANCE ProcessHandle)
         VulkanVerify(Vulkan.Device.vkCreateSampler(Vulkan.Device.DeviceHandle,
                                                    &SamplerCreateInfo,
                                                    nullptr,
-                                                   &Kitten->Texture.SamplerHandle));
+                                                   &Kitten->Texture->SamplerHandle));
         #endif
 
         VulkanSetQuadGeometry(Vulkan, Kitten->VertexBuffer, Kitten->IndexBuffer);
@@ -2003,10 +2056,10 @@ ApplicationEntryPoint(HINSTANCE ProcessHandle)
 
         Kitten->Transform.Translation = Vec3(0.5f, 2, 1);
 
-        Copy(Kitten->Texture.Image, KittenImage);
-        VulkanUploadTexture(Vulkan,
-                            TextureUploadCommandBuffer,
-                            Kitten->Texture);
+        bool IsNewTexture;
+        Kitten->Texture = VulkanAcquireTexture(*TextureRegistry, KittenImage, vulkan_texture_sampling{}, IsNewTexture);
+        if(IsNewTexture)
+          VulkanStreamTexture(Vulkan, TextureStreamer, *Kitten->Texture);
 
         VulkanSetBoxGeometry(Vulkan, Kitten->VertexBuffer, Kitten->IndexBuffer);
       }
@@ -2023,10 +2076,11 @@ ApplicationEntryPoint(HINSTANCE ProcessHandle)
         Kitten->Transform.Scale = Vec3(2, 2, 2);
         Kitten->Transform.Rotation = Quaternion(UpVector3, Degrees(30)) * Quaternion(RightVector3, Degrees(45));
 
-        Copy(Kitten->Texture.Image, KittenImage);
-        VulkanUploadTexture(Vulkan,
-                            TextureUploadCommandBuffer,
-                            Kitten->Texture);
+        // Same image as Kitten 2, so this only shares its texture.
+        bool IsNewTexture;
+        Kitten->Texture = VulkanAcquireTexture(*TextureRegistry, KittenImage, vulkan_texture_sampling{}, IsNewTexture);
+        if(IsNewTexture)
+          VulkanStreamTexture(Vulkan, TextureStreamer, *Kitten->Texture);
 
         VulkanSetBoxGeometry(Vulkan, Kitten->VertexBuffer, Kitten->IndexBuffer);
       }
@@ -2194,6 +2248,20 @@ ApplicationEntryPoint(HINSTANCE ProcessHandle)
       }
 
 
+      //
+      // Stream in textures
+      //
+      if(VulkanUpdateTextureStreamer(Vulkan, TextureStreamer))
+      {
+        VulkanBuildDrawCommands(Vulkan,
+                                Slice(Vulkan.DrawCommandBuffers),
+                                Slice(Vulkan.Framebuffers),
+                                color::Gray,
+                                Vulkan.DepthStencilValue,
+                                0);
+      }
+
+
       //
       // Handle resize requests
       //
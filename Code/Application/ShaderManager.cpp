@@ -1,5 +1,6 @@
 #include "ShaderManager.hpp"
 
+#include <Core/FileMapping.hpp>
 #include <Core/Log.hpp>
 
 #include <ShaderCompiler/ShaderCompiler.hpp>
@@ -9,6 +10,8 @@
 struct compiled_shader
 {
   arc_string Id;
+  /// The cfg document points into this, so it is a copy of the file rather
+  /// than a mapping of it, which would keep the file from being edited.
   arc_string CfgSource;
   cfg_document Cfg{};
   glsl_shader GlslVertexShader;
@@ -38,6 +41,7 @@ DestroyCompiledShader(allocator_interface& Allocator, compiled_shader* CompiledS
   Finalize(CompiledShader->SpirvVertexShader);
   Finalize(CompiledShader->GlslVertexShader);
   Finalize(CompiledShader->Cfg);
+  MemDestruct(1, CompiledShader);
   Deallocate(Allocator, CompiledShader);
 }
 
@@ -75,46 +79,6 @@ auto
   Delete(Allocator, Manager);
 }
 
-// TODO: This function is duplicated in a lot of places.
-//       Maybe put it in the Core?
-#include <cstdio>
-
-static bool
-ReadFileContentIntoArray(char const* FileName, array<uint8>* Array)
-{
-  Clear(*Array);
-
-  auto File = std::fopen(FileName, "rb");
-  if(File == nullptr)
-    return false;
-
-  Defer [File](){ std::fclose(File); };
-
-  size_t const ChunkSize = KiB(4);
-
-  while(true)
-  {
-    auto NewSlice = ExpandBy(*Array, ChunkSize);
-    auto const NumBytesRead = std::fread(NewSlice.Ptr, 1, ChunkSize, File);
-    auto const Delta = ChunkSize - NumBytesRead;
-
-    if(std::feof(File))
-    {
-      // Correct the internal array value in case we didn't exactly read a
-      // ChunkSize worth of bytes last time.
-      Array->Num -= Delta;
-
-      return true;
-    }
-
-    if(Delta > 0)
-    {
-      LogError("Didn't reach the end of file but failed to read any more bytes: %s", FileName);
-      return false;
-    }
-  }
-}
-
 static compiled_shader*
 LoadAndCompileShader(shader_manager& ShaderManager, slice<char const> FileName)
 {
@@ -122,20 +86,25 @@ LoadAndCompileShader(shader_manager& ShaderManager, slice<char const> FileName)
   arc_string FileNameString{ FileName };
   auto InputFilePath = AsConst(Slice(FileNameString));
 
-  temp_allocator Allocator{};
+  auto CompiledShader = CreateCompiledShader(*ShaderManager.Allocator);
+  CompiledShader->Id = InputFilePath;
 
-  array<uint8> Content{ Allocator };
-  if(!ReadFileContentIntoArray(InputFilePath.Ptr, &Content))
-  {
-    LogError("Failed to read file: %s", InputFilePath.Ptr);
-    return nullptr;
-  }
+  // Only the shader manager keeps successfully loaded shaders.
+  bool IsLoaded = false;
+  Defer [&](){ if(!IsLoaded) DestroyCompiledShader(*ShaderManager.Allocator, CompiledShader); };
 
-  auto CompiledShader = CreateCompiledShader(Allocator);
-  CompiledShader->Id = InputFilePath;
+  {
+    file_mapping CfgFile{};
+    if(!FileMappingOpen(CfgFile, InputFilePath))
+    {
+      LogError("Failed to read file: %s", InputFilePath.Ptr);
+      return nullptr;
+    }
 
-  // Copy over the source to ensure it lives as long as the document itself.
-  CompiledShader->CfgSource = SliceReinterpret<char const>(Slice(Content));
+    // The mapping is only needed to make the copy.
+    CompiledShader->CfgSource = SliceReinterpret<char const>(CfgFile.Data);
+    FileMappingClose(CfgFile);
+  }
 
   {
     // TODO: Supply the GlobalLog here as soon as the cfg parser code is more robust.
@@ -209,6 +178,7 @@ LoadAndCompileShader(shader_manager& ShaderManager, slice<char const> FileName)
   }
 
   ShaderManager.CompiledShaders += CompiledShader;
+  IsLoaded = true;
 
   return CompiledShader;
 }
@@ -2,7 +2,10 @@
 
 #include <Core/Log.hpp>
 #include <Core/Image.hpp>
+#include <Core/ImageBlockCompression.hpp>
+#include <Core/ImageConversion.hpp>
 #include <Core/ImageLoader.hpp>
+#include <Core/ImageMipmaps.hpp>
 #include <Core/Time.hpp>
 
 void
@@ -73,6 +76,9 @@ vulkan_scene_object::PrepareForDrawing(vulkan& Vulkan)
   //
   // Create UboModel
   //
+
+  // Keep the buffer when preparing again, e.g. after the texture got new mip levels.
+  if(this->UboModel.BufferHandle == nullptr)
   {
     VulkanCreateShaderBuffer(Vulkan, this->UboModel, is_read_only_for_shader::Yes);
   }
@@ -104,11 +110,12 @@ vulkan_scene_object::PrepareForDrawing(vulkan& Vulkan)
   //
   // Update the texture and sampler in use by the shader.
   //
+  Assert(this->Texture);
   auto TextureDescriptor = InitStruct<VkDescriptorImageInfo>();
   {
-    TextureDescriptor.sampler = this->Texture.SamplerHandle;
-    TextureDescriptor.imageView = this->Texture.ImageViewHandle;
-    TextureDescriptor.imageLayout = this->Texture.ImageLayout;
+    TextureDescriptor.sampler = this->Texture->SamplerHandle;
+    TextureDescriptor.imageView = this->Texture->ImageViewHandle;
+    TextureDescriptor.imageLayout = this->Texture->ImageLayout;
   }
 
   {
@@ -1668,8 +1675,39 @@ auto
     case image_format::R8G8B8A8_UINT:       return VK_FORMAT_R8G8B8A8_UINT;
     case image_format::R8G8B8A8_SINT:       return VK_FORMAT_R8G8B8A8_SINT;
 
+    case image_format::R16G16B16A16_FLOAT:  return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case image_format::R16G16B16A16_UNORM:  return VK_FORMAT_R16G16B16A16_UNORM;
+    case image_format::R16G16B16A16_SNORM:  return VK_FORMAT_R16G16B16A16_SNORM;
+
     case image_format::R32G32B32A32_FLOAT:  return VK_FORMAT_R32G32B32A32_SFLOAT;
 
+    //
+    // Formats with fewer channels
+    //
+    case image_format::R32G32B32_FLOAT:     return VK_FORMAT_R32G32B32_SFLOAT;
+    case image_format::R32G32_FLOAT:        return VK_FORMAT_R32G32_SFLOAT;
+    case image_format::R32_FLOAT:           return VK_FORMAT_R32_SFLOAT;
+    case image_format::R16G16_FLOAT:        return VK_FORMAT_R16G16_SFLOAT;
+    case image_format::R16G16_UNORM:        return VK_FORMAT_R16G16_UNORM;
+    case image_format::R16G16_SNORM:        return VK_FORMAT_R16G16_SNORM;
+    case image_format::R16_FLOAT:           return VK_FORMAT_R16_SFLOAT;
+    case image_format::R16_UNORM:           return VK_FORMAT_R16_UNORM;
+    case image_format::R16_SNORM:           return VK_FORMAT_R16_SNORM;
+    case image_format::R8G8_UNORM:          return VK_FORMAT_R8G8_UNORM;
+    case image_format::R8G8_SNORM:          return VK_FORMAT_R8G8_SNORM;
+    case image_format::R8_UNORM:            return VK_FORMAT_R8_UNORM;
+    case image_format::R8_SNORM:            return VK_FORMAT_R8_SNORM;
+
+    //
+    // Packed formats
+    //
+    // Vulkan names the channels from the most significant bit down.
+    case image_format::R10G10B10A2_UNORM:   return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+    case image_format::R11G11B10_FLOAT:     return VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+    case image_format::R9G9B9E5_SHAREDEXP:  return VK_FORMAT_E5B9G9R9_UFLOAT_PACK32;
+    case image_format::B5G6R5_UNORM:        return VK_FORMAT_R5G6B5_UNORM_PACK16;
+    case image_format::B5G5R5A1_UNORM:      return VK_FORMAT_A1R5G5B5_UNORM_PACK16;
+
     //
     // BGRA formats
     //
@@ -1952,7 +1990,6 @@ auto
 
   SceneObject->IsDirty = true;
   SceneObject->Name = Name;
-  Init(SceneObject->Texture, Allocator);
 
   SceneObject->Foo = &Vulkan.SceneObjectsFoo;
 
@@ -2038,6 +2075,92 @@ auto
   // TODO: See VulkanDestroySceneObject
 }
 
+/// Unlike VulkanIsImageCompatibleWithGpu(), only checks the format and doesn't log anything.
+static bool
+VulkanCanSampleFormat(vulkan_gpu const& Gpu, image_format Format)
+{
+  VkFormat const VulkanFormat = ImageFormatToVulkan(Format);
+  if(VulkanFormat == VK_FORMAT_UNDEFINED)
+    return false;
+
+  VkFormatProperties FormatProperties;
+  Gpu.Vulkan->vkGetPhysicalDeviceFormatProperties(Gpu.GpuHandle, VulkanFormat, &FormatProperties);
+  return (FormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+/// The formats to convert an image to if the device can't sample its own, best first.
+static slice<image_format const>
+ConversionCandidates(image_format Format)
+{
+  static image_format const Srgb[] = {
+    image_format::R8G8B8A8_UNORM_SRGB, image_format::B8G8R8A8_UNORM_SRGB,
+    image_format::R16G16B16A16_FLOAT, image_format::R32G32B32A32_FLOAT,
+  };
+  static image_format const LowPrecision[] = {
+    image_format::R8G8B8A8_UNORM, image_format::B8G8R8A8_UNORM,
+    image_format::R16G16B16A16_FLOAT, image_format::R32G32B32A32_FLOAT,
+  };
+  static image_format const HighPrecision[] = {
+    image_format::R16G16B16A16_FLOAT, image_format::R32G32B32A32_FLOAT,
+    image_format::R16G16B16A16_UNORM, image_format::R8G8B8A8_UNORM,
+  };
+
+  switch(Format)
+  {
+    case image_format::R8G8B8A8_UNORM_SRGB:
+    case image_format::B8G8R8A8_UNORM_SRGB:
+    case image_format::B8G8R8X8_UNORM_SRGB:
+      return Slice(Srgb);
+
+    case image_format::R32G32B32_FLOAT:
+    case image_format::R32G32_FLOAT:
+    case image_format::R32_FLOAT:
+    case image_format::R16G16B16A16_UNORM:
+    case image_format::R16G16B16A16_SNORM:
+    case image_format::R16G16_FLOAT:
+    case image_format::R16G16_UNORM:
+    case image_format::R16G16_SNORM:
+    case image_format::R16_FLOAT:
+    case image_format::R16_UNORM:
+    case image_format::R16_SNORM:
+    case image_format::R10G10B10A2_UNORM:
+    case image_format::R11G11B10_FLOAT:
+    case image_format::R9G9B9E5_SHAREDEXP:
+      return Slice(HighPrecision);
+
+    default:
+      return Slice(LowPrecision);
+  }
+}
+
+static void
+VulkanCreateTextureSampler(vulkan& Vulkan, vulkan_texture2d& Texture, float MaxLod)
+{
+  auto const& Device = Vulkan.Device;
+
+  auto const& Sampling = Texture.Sampling;
+
+  auto SamplerCreateInfo = InitStruct<VkSamplerCreateInfo>();
+  {
+    SamplerCreateInfo.magFilter = Sampling.Filter;
+    SamplerCreateInfo.minFilter = Sampling.Filter;
+    SamplerCreateInfo.mipmapMode = Sampling.MipmapMode;
+    SamplerCreateInfo.addressModeU = Sampling.AddressMode;
+    SamplerCreateInfo.addressModeV = Sampling.AddressMode;
+    SamplerCreateInfo.addressModeW = Sampling.AddressMode;
+    SamplerCreateInfo.anisotropyEnable = Sampling.MaxAnisotropy > 1 ? VK_TRUE : VK_FALSE;
+    SamplerCreateInfo.maxLod = MaxLod;
+    SamplerCreateInfo.maxAnisotropy = Sampling.MaxAnisotropy;
+    SamplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
+    SamplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    SamplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+  }
+  VulkanVerify(Device.vkCreateSampler(Device.DeviceHandle,
+                                      &SamplerCreateInfo,
+                                      nullptr,
+                                      &Texture.SamplerHandle));
+}
+
 auto
 ::VulkanUploadTexture(vulkan&                    Vulkan,
                       VkCommandBuffer            CommandBuffer,
@@ -2049,6 +2172,57 @@ auto
   auto const& Device = Vulkan.Device;
   auto const DeviceHandle = Device.DeviceHandle;
 
+  // Decode block compressed images on the CPU if the device can't sample them.
+  if(ImageDecompressedFormat(Texture.Image.Format) != image_format::UNKNOWN &&
+     !VulkanIsImageCompatibleWithGpu(Vulkan.Gpu, Texture.Image))
+  {
+    LogWarning("%s is not supported by the device. Decompressing the image on the CPU.",
+               ImageFormatName(Texture.Image.Format));
+
+    image Decompressed{};
+    Init(Decompressed, *Texture.Image.InternalSubImages.Allocator);
+    Defer [&](){ Finalize(Decompressed); };
+
+    if(!ImageDecompress(Decompressed, Texture.Image))
+      return false;
+
+    Copy(Texture.Image, Decompressed);
+  }
+
+  // Convert images the device can't sample into a format it can.
+  if(ImageFormatIsConvertible(Texture.Image.Format) &&
+     !VulkanCanSampleFormat(Vulkan.Gpu, Texture.Image.Format))
+  {
+    image_format Format = image_format::UNKNOWN;
+    for(auto Candidate : ConversionCandidates(Texture.Image.Format))
+    {
+      if(VulkanCanSampleFormat(Vulkan.Gpu, Candidate))
+      {
+        Format = Candidate;
+        break;
+      }
+    }
+
+    if(Format == image_format::UNKNOWN)
+    {
+      LogError("%s is not supported by the device and there is no format to convert it to.",
+               ImageFormatName(Texture.Image.Format));
+      return false;
+    }
+
+    LogWarning("%s is not supported by the device. Converting the image to %s on the CPU.",
+               ImageFormatName(Texture.Image.Format), ImageFormatName(Format));
+
+    image Converted{};
+    Init(Converted, *Texture.Image.InternalSubImages.Allocator);
+    Defer [&](){ Finalize(Converted); };
+
+    if(!ImageConvert(Converted, Texture.Image, Format))
+      return false;
+
+    Copy(Texture.Image, Converted);
+  }
+
   // Check for compatibility.
   Assert(VulkanIsImageCompatibleWithGpu(Vulkan.Gpu, Texture.Image));
 
@@ -2096,6 +2270,20 @@ auto
     }
   }
 
+  // Textures without mips alias badly when minified. Only the optimal tiling
+  // path uploads more than one level.
+  if(UseOptimalTiling && Texture.Image.NumMipLevels == 1 &&
+     ImageFullMipChainLength(Texture.Image) > 1 &&
+     ImageCanGenerateMipmaps(Texture.Image.Format))
+  {
+    image Mipmapped{};
+    Init(Mipmapped, *Texture.Image.InternalSubImages.Allocator);
+    Defer [&](){ Finalize(Mipmapped); };
+
+    if(ImageGenerateMipmaps(Mipmapped, Texture.Image, image_mip_filter::Kaiser))
+      Copy(Texture.Image, Mipmapped);
+  }
+
   //
   // Image creation
   //
@@ -2143,7 +2331,7 @@ auto
 
         MemCopy(ImageDataSize(Texture.Image),
                 Reinterpret<uint8*>(RawData),
-                ImageDataPointer<uint8 const>(Texture.Image));
+                ImageDataPointer<uint8>(AsConst(Texture.Image)));
 
         Device.vkUnmapMemory(DeviceHandle, StagingMemory);
       }
@@ -2301,7 +2489,7 @@ auto
 
         MemCopy(ImageDataSize(Texture.Image),
                 Reinterpret<uint8*>(MappedData),
-                ImageDataPointer<uint8 const>(Texture.Image));
+                ImageDataPointer<uint8>(AsConst(Texture.Image)));
 
         Device.vkUnmapMemory(DeviceHandle, Texture.MemoryHandle);
       }
@@ -2329,30 +2517,7 @@ auto
   //
   // Create sampler.
   //
-  {
-    auto SamplerCreateInfo = InitStruct<VkSamplerCreateInfo>();
-    {
-      SamplerCreateInfo.magFilter = VK_FILTER_LINEAR;
-      SamplerCreateInfo.minFilter = VK_FILTER_LINEAR;
-      SamplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-      SamplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-      SamplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-      SamplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-      SamplerCreateInfo.anisotropyEnable = VK_TRUE;
-      if(UseOptimalTiling)
-      {
-        SamplerCreateInfo.maxLod = Cast<float>(Texture.Image.NumMipLevels);
-      }
-      SamplerCreateInfo.maxAnisotropy = 8;
-      SamplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
-      SamplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-      SamplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
-    }
-    VulkanVerify(Device.vkCreateSampler(DeviceHandle,
-                                        &SamplerCreateInfo,
-                                        nullptr,
-                                        &Texture.SamplerHandle));
-  }
+  VulkanCreateTextureSampler(Vulkan, Texture, UseOptimalTiling ? Cast<float>(Texture.Image.NumMipLevels) : 0.0f);
 
   //
   // Create image view
@@ -2382,6 +2547,415 @@ auto
   return true;
 }
 
+
+//
+// Texture Streaming
+//
+
+/// The number of bytes the levels [FirstLevel, EndLevel) take up. They are
+/// stored next to each other, largest first.
+static size_t
+MipLevelRangeSize(image const& Image, uint32 FirstLevel, uint32 EndLevel)
+{
+  return ImageDataOffSet(Image, EndLevel - 1) + ImageMipLevelSize(Image, EndLevel - 1) - ImageDataOffSet(Image, FirstLevel);
+}
+
+/// Copy offsets within the staging buffer have to be aligned to the texel block size.
+static size_t
+AlignStagingOffset(size_t Offset)
+{
+  size_t const Alignment = 16;
+  return (Offset + Alignment - 1) & ~(Alignment - 1);
+}
+
+static void
+EnsureStagingSize(vulkan& Vulkan, vulkan_texture_streamer& Streamer, size_t Size)
+{
+  if(Streamer.StagingSize >= Size)
+    return;
+
+  auto const& Device = Vulkan.Device;
+  auto const DeviceHandle = Device.DeviceHandle;
+
+  if(Streamer.StagingBuffer)
+  {
+    Device.vkUnmapMemory(DeviceHandle, Streamer.StagingMemory);
+    Device.vkFreeMemory(DeviceHandle, Streamer.StagingMemory, nullptr);
+    Device.vkDestroyBuffer(DeviceHandle, Streamer.StagingBuffer, nullptr);
+  }
+
+  auto BufferCreateInfo = InitStruct<VkBufferCreateInfo>();
+  BufferCreateInfo.size = Size;
+  BufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  BufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  VulkanVerify(Device.vkCreateBuffer(DeviceHandle, &BufferCreateInfo, nullptr, &Streamer.StagingBuffer));
+
+  auto MemoryRequirements = InitStruct<VkMemoryRequirements>();
+  Device.vkGetBufferMemoryRequirements(DeviceHandle, Streamer.StagingBuffer, &MemoryRequirements);
+
+  auto MemoryAllocateInfo = InitStruct<VkMemoryAllocateInfo>();
+  MemoryAllocateInfo.allocationSize = MemoryRequirements.size;
+  MemoryAllocateInfo.memoryTypeIndex =
+    VulkanDetermineMemoryTypeIndex(Vulkan.Gpu.MemoryProperties,
+                                   MemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+  VulkanVerify(Device.vkAllocateMemory(DeviceHandle, &MemoryAllocateInfo, nullptr, &Streamer.StagingMemory));
+  VulkanVerify(Device.vkBindBufferMemory(DeviceHandle, Streamer.StagingBuffer, Streamer.StagingMemory, 0));
+
+  void* RawData{};
+  VulkanVerify(Device.vkMapMemory(DeviceHandle, Streamer.StagingMemory, 0, VK_WHOLE_SIZE, 0, &RawData));
+  Streamer.StagingData = Reinterpret<uint8*>(RawData);
+  Streamer.StagingSize = Size;
+}
+
+/// Copies the levels [FirstLevel, EndLevel) of the texture into the staging
+/// buffer at \a Offset and records their upload.
+///
+/// Only the copied part of the image data is read, so the larger levels of a
+/// memory mapped file aren't paged in before they are needed.
+static void
+RecordMipLevelUpload(vulkan& Vulkan, vulkan_texture_streamer& Streamer, size_t Offset,
+                     vulkan_texture2d& Texture, uint32 FirstLevel, uint32 EndLevel)
+{
+  auto const& Device = Vulkan.Device;
+  auto const& Image = Texture.Image;
+
+  size_t const FirstOffset = ImageDataOffSet(Image, FirstLevel);
+  MemCopy(MipLevelRangeSize(Image, FirstLevel, EndLevel),
+          Streamer.StagingData + Offset,
+          ImageDataPointer<uint8>(Image) + FirstOffset);
+
+  temp_allocator Allocator{};
+  array<VkBufferImageCopy> BufferCopyRegions{ Allocator };
+  for(uint32 MipLevel = FirstLevel; MipLevel < EndLevel; ++MipLevel)
+  {
+    VkBufferImageCopy BufferCopyRegion = InitStruct<VkBufferImageCopy>();
+    BufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    BufferCopyRegion.imageSubresource.mipLevel = MipLevel;
+    BufferCopyRegion.imageSubresource.baseArrayLayer = 0;
+    BufferCopyRegion.imageSubresource.layerCount = 1;
+    BufferCopyRegion.imageExtent.width = ImageWidth(Image, MipLevel);
+    BufferCopyRegion.imageExtent.height = ImageHeight(Image, MipLevel);
+    BufferCopyRegion.imageExtent.depth = 1;
+    BufferCopyRegion.bufferOffset = Offset + ImageDataOffSet(Image, MipLevel) - FirstOffset;
+
+    Expand(BufferCopyRegions) = BufferCopyRegion;
+  }
+
+  // The levels that aren't resident yet have never been used, so their
+  // content can be discarded.
+  VkImageSubresourceRange const SubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, FirstLevel, EndLevel - FirstLevel, 0, 1 };
+  VulkanSetImageLayout(Device, Streamer.CommandBuffer,
+                       Texture.ImageHandle,
+                       SubresourceRange,
+                       VK_IMAGE_LAYOUT_UNDEFINED,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+  Device.vkCmdCopyBufferToImage(Streamer.CommandBuffer,
+                                Streamer.StagingBuffer,
+                                Texture.ImageHandle,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                Convert<uint32>(BufferCopyRegions.Num),
+                                BufferCopyRegions.Ptr);
+
+  VulkanSetImageLayout(Device, Streamer.CommandBuffer,
+                       Texture.ImageHandle,
+                       SubresourceRange,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       Texture.ImageLayout);
+}
+
+/// Creates a view of the resident mip levels of the texture, replacing the old one.
+static void
+VulkanCreateResidentImageView(vulkan& Vulkan, vulkan_texture2d& Texture)
+{
+  auto const& Device = Vulkan.Device;
+
+  if(Texture.ImageViewHandle)
+    Device.vkDestroyImageView(Device.DeviceHandle, Texture.ImageViewHandle, nullptr);
+
+  auto ImageViewCreateInfo = InitStruct<VkImageViewCreateInfo>();
+  {
+    ImageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    ImageViewCreateInfo.format = Texture.ImageFormat;
+    ImageViewCreateInfo.components = VkComponentMapping{ VK_COMPONENT_SWIZZLE_R,
+                                                         VK_COMPONENT_SWIZZLE_G,
+                                                         VK_COMPONENT_SWIZZLE_B,
+                                                         VK_COMPONENT_SWIZZLE_A };
+    ImageViewCreateInfo.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT,
+                                                                    Texture.ResidentMipLevel,
+                                                                    Texture.Image.NumMipLevels - Texture.ResidentMipLevel,
+                                                                    0, 1 };
+    ImageViewCreateInfo.image = Texture.ImageHandle;
+  }
+  VulkanVerify(Device.vkCreateImageView(Device.DeviceHandle,
+                                        &ImageViewCreateInfo,
+                                        nullptr,
+                                        &Texture.ImageViewHandle));
+}
+
+static void
+BeginUpload(vulkan& Vulkan, vulkan_texture_streamer& Streamer)
+{
+  Assert(!Streamer.IsUploading);
+
+  auto CommandBufferBeginInfo = InitStruct<VkCommandBufferBeginInfo>();
+  VulkanVerify(Vulkan.Device.vkBeginCommandBuffer(Streamer.CommandBuffer, &CommandBufferBeginInfo));
+}
+
+static void
+SubmitUpload(vulkan& Vulkan, vulkan_texture_streamer& Streamer)
+{
+  auto const& Device = Vulkan.Device;
+
+  VulkanVerify(Device.vkEndCommandBuffer(Streamer.CommandBuffer));
+
+  auto SubmitInfo = InitStruct<VkSubmitInfo>();
+  SubmitInfo.commandBufferCount = 1;
+  SubmitInfo.pCommandBuffers = &Streamer.CommandBuffer;
+  VulkanVerify(Device.vkQueueSubmit(Vulkan.Queue, 1, &SubmitInfo, Streamer.UploadFence));
+
+  Streamer.IsUploading = true;
+}
+
+/// Makes the uploaded levels visible to the shaders once the device is done with them.
+///
+/// \param NumUpdated Set to the number of textures that got new levels.
+///
+/// \return \c false if the upload is still running and \a Wait is \c false.
+static bool
+FinishUpload(vulkan& Vulkan, vulkan_texture_streamer& Streamer, bool Wait, size_t* NumUpdated = nullptr)
+{
+  auto const& Device = Vulkan.Device;
+  auto const DeviceHandle = Device.DeviceHandle;
+
+  if(!Streamer.IsUploading)
+    return true;
+
+  if(Wait)
+  {
+    auto FenceTimeOut = Seconds(100);
+    VulkanVerify(Device.vkWaitForFences(DeviceHandle, 1, &Streamer.UploadFence, VK_TRUE, Convert<uint64>(DurationAsNanoseconds(FenceTimeOut))));
+  }
+  else if(Device.vkGetFenceStatus(DeviceHandle, Streamer.UploadFence) == VK_NOT_READY)
+  {
+    return false;
+  }
+
+  VulkanVerify(Device.vkResetFences(DeviceHandle, 1, &Streamer.UploadFence));
+  Streamer.IsUploading = false;
+
+  for(size_t Index = 0; Index < Streamer.Textures.Num; ++Index)
+  {
+    auto& Texture = *Streamer.Textures[Index];
+    if(Texture.ResidentMipLevel == Streamer.UploadedMipLevels[Index])
+      continue;
+
+    // The queue is idle between frames, so the old view isn't in use anymore.
+    Texture.ResidentMipLevel = Streamer.UploadedMipLevels[Index];
+    VulkanCreateResidentImageView(Vulkan, Texture);
+
+    // Textures may be shared, so every scene object that uses this one needs the new view.
+    for(auto SceneObject : Slice(Vulkan.SceneObjects))
+    {
+      if(SceneObject->Texture == &Texture)
+        SceneObject->IsDirty = true;
+    }
+
+    if(NumUpdated)
+      ++*NumUpdated;
+  }
+
+  for(size_t Index = Streamer.Textures.Num; Index > 0; --Index)
+  {
+    if(Streamer.Textures[Index - 1]->ResidentMipLevel == 0)
+    {
+      RemoveAt(Streamer.Textures, Index - 1);
+      RemoveAt(Streamer.UploadedMipLevels, Index - 1);
+    }
+  }
+
+  return true;
+}
+
+auto
+::VulkanInitTextureStreamer(vulkan& Vulkan, vulkan_texture_streamer& Streamer, size_t FrameBudget)
+  -> void
+{
+  auto const& Device = Vulkan.Device;
+  auto const DeviceHandle = Device.DeviceHandle;
+
+  Streamer.FrameBudget = FrameBudget;
+
+  auto CommandBufferInfo = InitStruct<VkCommandBufferAllocateInfo>();
+  CommandBufferInfo.commandPool = Vulkan.CommandPool;
+  CommandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  CommandBufferInfo.commandBufferCount = 1;
+  VulkanVerify(Device.vkAllocateCommandBuffers(DeviceHandle, &CommandBufferInfo, &Streamer.CommandBuffer));
+
+  auto FenceCreateInfo = InitStruct<VkFenceCreateInfo>();
+  VulkanVerify(Device.vkCreateFence(DeviceHandle, &FenceCreateInfo, nullptr, &Streamer.UploadFence));
+
+  EnsureStagingSize(Vulkan, Streamer, FrameBudget);
+}
+
+auto
+::VulkanFinalizeTextureStreamer(vulkan& Vulkan, vulkan_texture_streamer& Streamer)
+  -> void
+{
+  auto const& Device = Vulkan.Device;
+  auto const DeviceHandle = Device.DeviceHandle;
+
+  FinishUpload(Vulkan, Streamer, true);
+
+  if(Streamer.StagingBuffer)
+  {
+    Device.vkUnmapMemory(DeviceHandle, Streamer.StagingMemory);
+    Device.vkFreeMemory(DeviceHandle, Streamer.StagingMemory, nullptr);
+    Device.vkDestroyBuffer(DeviceHandle, Streamer.StagingBuffer, nullptr);
+  }
+
+  Device.vkDestroyFence(DeviceHandle, Streamer.UploadFence, nullptr);
+  Device.vkFreeCommandBuffers(DeviceHandle, Vulkan.CommandPool, 1, &Streamer.CommandBuffer);
+
+  Reset(Streamer.UploadedMipLevels);
+  Reset(Streamer.Textures);
+}
+
+auto
+::VulkanStreamTexture(vulkan&                  Vulkan,
+                      vulkan_texture_streamer& Streamer,
+                      vulkan_texture2d&        Texture)
+  -> bool
+{
+  auto const& Device = Vulkan.Device;
+  auto const DeviceHandle = Device.DeviceHandle;
+
+  auto const& Image = Texture.Image;
+
+  // The streamer's command buffer is used in any case.
+  FinishUpload(Vulkan, Streamer, true);
+
+  bool const CanStream = Image.NumMipLevels > 1 &&
+                         Image.Depth == 1 && Image.NumFaces == 1 && Image.NumArrayIndices == 1 &&
+                         VulkanCanSampleFormat(Vulkan.Gpu, Image.Format);
+  if(!CanStream)
+    return VulkanUploadTexture(Vulkan, Streamer.CommandBuffer, Texture);
+
+  Texture.ImageFormat = ImageFormatToVulkan(Image.Format);
+  Texture.ImageTiling = VK_IMAGE_TILING_OPTIMAL;
+  Texture.ImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  //
+  // Create the image with room for all levels.
+  //
+  {
+    auto ImageCreateInfo = InitStruct<VkImageCreateInfo>();
+    {
+      ImageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+      ImageCreateInfo.format = Texture.ImageFormat;
+      ImageCreateInfo.mipLevels = Image.NumMipLevels;
+      ImageCreateInfo.arrayLayers = 1;
+      ImageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+      ImageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+      ImageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+      ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      ImageCreateInfo.extent = { Image.Width, Image.Height, 1 };
+      ImageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    }
+    VulkanVerify(Device.vkCreateImage(DeviceHandle, &ImageCreateInfo, nullptr, &Texture.ImageHandle));
+
+    auto MemoryRequirements = InitStruct<VkMemoryRequirements>();
+    Device.vkGetImageMemoryRequirements(DeviceHandle, Texture.ImageHandle, &MemoryRequirements);
+
+    auto MemoryAllocateInfo = InitStruct<VkMemoryAllocateInfo>();
+    MemoryAllocateInfo.allocationSize = MemoryRequirements.size;
+    MemoryAllocateInfo.memoryTypeIndex = VulkanDetermineMemoryTypeIndex(Vulkan.Gpu.MemoryProperties, MemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VulkanVerify(Device.vkAllocateMemory(DeviceHandle, &MemoryAllocateInfo, nullptr, &Texture.MemoryHandle));
+    VulkanVerify(Device.vkBindImageMemory(DeviceHandle, Texture.ImageHandle, Texture.MemoryHandle, 0));
+  }
+
+  //
+  // Upload the mip tail and wait for it, so the texture can be drawn right away.
+  //
+  uint32 const TailLevel = ImageMipTailLevel(Image, Streamer.FrameBudget);
+  EnsureStagingSize(Vulkan, Streamer, MipLevelRangeSize(Image, TailLevel, Image.NumMipLevels));
+
+  BeginUpload(Vulkan, Streamer);
+  RecordMipLevelUpload(Vulkan, Streamer, 0, Texture, TailLevel, Image.NumMipLevels);
+  SubmitUpload(Vulkan, Streamer);
+  FinishUpload(Vulkan, Streamer, true);
+
+  Texture.ResidentMipLevel = TailLevel;
+  VulkanCreateResidentImageView(Vulkan, Texture);
+  VulkanCreateTextureSampler(Vulkan, Texture, Cast<float>(Image.NumMipLevels));
+
+  LogInfo("Streaming %ux%u texture: %u of %u mip levels are resident.",
+          Image.Width, Image.Height, Image.NumMipLevels - TailLevel, Image.NumMipLevels);
+
+  if(TailLevel > 0)
+  {
+    Expand(Streamer.Textures) = &Texture;
+    Expand(Streamer.UploadedMipLevels) = TailLevel;
+  }
+
+  return true;
+}
+
+auto
+::VulkanUpdateTextureStreamer(vulkan& Vulkan, vulkan_texture_streamer& Streamer)
+  -> bool
+{
+  size_t NumUpdated = 0;
+  if(!FinishUpload(Vulkan, Streamer, false, &NumUpdated))
+    return false;
+
+  bool const HasNewLevels = NumUpdated > 0;
+  if(Streamer.Textures.Num == 0)
+    return HasNewLevels;
+
+  //
+  // Gather the next levels of as many textures as fit into the budget.
+  //
+  size_t NumBytes = 0;
+  size_t NumScheduled = 0;
+  for(size_t Index = 0; Index < Streamer.Textures.Num; ++Index)
+  {
+    auto const& Texture = *Streamer.Textures[Index];
+
+    size_t const Offset = AlignStagingOffset(NumBytes);
+    size_t const Budget = Streamer.FrameBudget > Offset ? Streamer.FrameBudget - Offset : 0;
+    uint32 const NextLevel = ImageNextStreamedMipLevel(Texture.Image, Texture.ResidentMipLevel, Budget);
+    size_t const Size = MipLevelRangeSize(Texture.Image, NextLevel, Texture.ResidentMipLevel);
+
+    // Only the first texture may exceed the budget.
+    if(NumScheduled > 0 && Offset + Size > Streamer.FrameBudget)
+      break;
+
+    Streamer.UploadedMipLevels[Index] = NextLevel;
+    NumBytes = Offset + Size;
+    ++NumScheduled;
+  }
+
+  EnsureStagingSize(Vulkan, Streamer, NumBytes);
+
+  BeginUpload(Vulkan, Streamer);
+  NumBytes = 0;
+  for(size_t Index = 0; Index < NumScheduled; ++Index)
+  {
+    auto& Texture = *Streamer.Textures[Index];
+    uint32 const NextLevel = Streamer.UploadedMipLevels[Index];
+
+    size_t const Offset = AlignStagingOffset(NumBytes);
+    RecordMipLevelUpload(Vulkan, Streamer, Offset, Texture, NextLevel, Texture.ResidentMipLevel);
+    NumBytes = Offset + MipLevelRangeSize(Texture.Image, NextLevel, Texture.ResidentMipLevel);
+  }
+  SubmitUpload(Vulkan, Streamer);
+
+  return HasNewLevels;
+}
+
+
 auto
 ::VulkanSetQuadGeometry(vulkan& Vulkan,
                         vertex_buffer& VertexBuffer,
@@ -1,3 +1,4 @@
+#pragma once
 
 #include <Backbone.hpp>
 
@@ -58,8 +59,19 @@ struct vulkan_shader_buffer : public vulkan_shader_buffer_header
   DataType Data;
 };
 
+/// How a texture is sampled. Textures only share a sampler if this matches.
+struct vulkan_texture_sampling
+{
+  VkFilter Filter = VK_FILTER_LINEAR;
+  VkSamplerMipmapMode MipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  VkSamplerAddressMode AddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  float MaxAnisotropy = 8;
+};
+
 struct vulkan_texture2d
 {
+  vulkan_texture_sampling Sampling;
+
   VkSampler SamplerHandle;
   VkImageView ImageViewHandle;
   VkImageTiling ImageTiling;
@@ -69,6 +81,10 @@ struct vulkan_texture2d
 
   VkDeviceMemory MemoryHandle;
 
+  /// The largest mip level that is on the device. Only larger than 0 while
+  /// the texture is streamed in. \see VulkanStreamTexture
+  uint32 ResidentMipLevel;
+
   image Image;
 };
 
@@ -143,7 +159,9 @@ struct vulkan_scene_object : public vulkan_renderable
 
   vertex_buffer VertexBuffer{};
   index_buffer IndexBuffer{};
-  vulkan_texture2d Texture{};
+
+  /// May be shared with other scene objects. \see vulkan_texture_registry
+  vulkan_texture2d* Texture{};
 
   ubo_model UboModel{};
 
@@ -334,6 +352,57 @@ VulkanUploadTexture(
   VkImageUsageFlags          ImageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT
 );
 
+/// Uploads the mip levels of textures over several frames, smallest levels first.
+struct vulkan_texture_streamer
+{
+  /// The number of bytes to upload per frame. A single mip level that is
+  /// larger is still uploaded in one go.
+  size_t FrameBudget;
+
+  VkCommandBuffer CommandBuffer;
+  VkFence UploadFence;
+  bool IsUploading;
+
+  VkBuffer StagingBuffer;
+  VkDeviceMemory StagingMemory;
+  size_t StagingSize;
+
+  /// StagingMemory stays mapped for as long as it exists.
+  uint8* StagingData;
+
+  /// The textures that aren't fully resident yet.
+  array<vulkan_texture2d*> Textures;
+
+  /// For each of the Textures, the resident mip level once the current upload is done.
+  array<uint32> UploadedMipLevels;
+};
+
+void
+VulkanInitTextureStreamer(vulkan& Vulkan, vulkan_texture_streamer& Streamer, size_t FrameBudget);
+
+void
+VulkanFinalizeTextureStreamer(vulkan& Vulkan, vulkan_texture_streamer& Streamer);
+
+/// Creates \a Texture with only its mip tail on the device, so it can be
+/// drawn right away. The remaining levels are uploaded by
+/// VulkanUpdateTextureStreamer().
+///
+/// The texture is uploaded with VulkanUploadTexture() instead if it has
+/// only one mip level or the device can't sample its format directly.
+bool
+VulkanStreamTexture(vulkan&                  Vulkan,
+                    vulkan_texture_streamer& Streamer,
+                    vulkan_texture2d&        Texture);
+
+/// Call once per frame while the queue is idle. Finishes the last upload if
+/// the device is done with it and starts the next one. The scene objects
+/// that use a texture with new mip levels are marked dirty.
+///
+/// \return Whether any texture got new mip levels, in which case the draw
+///         commands have to be built again.
+bool
+VulkanUpdateTextureStreamer(vulkan& Vulkan, vulkan_texture_streamer& Streamer);
+
 void
 VulkanSetQuadGeometry(vulkan&        Vulkan,
                       vertex_buffer& VertexBuffer,
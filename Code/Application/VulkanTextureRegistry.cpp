@@ -0,0 +1,193 @@
+#include "VulkanTextureRegistry.hpp"
+
+#include <Core/Dictionary.hpp>
+#include <Core/Hash.hpp>
+#include <Core/Log.hpp>
+
+
+namespace
+{
+  struct texture_key
+  {
+    uint64 ContentHash;
+    image_header Header;
+    vulkan_texture_sampling Sampling;
+  };
+
+  bool
+  operator==(texture_key const& A, texture_key const& B)
+  {
+    return A.ContentHash == B.ContentHash &&
+           A.Header.Format == B.Header.Format &&
+           A.Header.Width == B.Header.Width &&
+           A.Header.Height == B.Header.Height &&
+           A.Header.Depth == B.Header.Depth &&
+           A.Header.NumMipLevels == B.Header.NumMipLevels &&
+           A.Header.NumFaces == B.Header.NumFaces &&
+           A.Header.NumArrayIndices == B.Header.NumArrayIndices &&
+           A.Sampling.Filter == B.Sampling.Filter &&
+           A.Sampling.MipmapMode == B.Sampling.MipmapMode &&
+           A.Sampling.AddressMode == B.Sampling.AddressMode &&
+           A.Sampling.MaxAnisotropy == B.Sampling.MaxAnisotropy;
+  }
+
+  uint32
+  DictionaryHash(texture_key const& Key)
+  {
+    return DictionaryHashInteger(Key.ContentHash);
+  }
+
+  struct texture_entry
+  {
+    vulkan_texture2d Texture;
+    texture_key Key;
+    uint32 NumReferences;
+  };
+}
+
+struct vulkan_texture_registry
+{
+  allocator_interface* Allocator;
+  vulkan_device const* Device;
+
+  /// The entries are allocated one by one, so the textures don't move.
+  dictionary<texture_key, texture_entry*> Entries;
+};
+
+auto
+::VulkanCreateTextureRegistry(allocator_interface& Allocator, vulkan_device const& Device)
+  -> vulkan_texture_registry*
+{
+  auto Registry = New<vulkan_texture_registry>(Allocator);
+  if(Registry)
+  {
+    Registry->Allocator = &Allocator;
+    Registry->Device = &Device;
+    Init(&Registry->Entries, &Allocator);
+  }
+
+  return Registry;
+}
+
+static void
+DestroyTextureEntry(vulkan_texture_registry& Registry, texture_entry* Entry)
+{
+  auto const& Device = *Registry.Device;
+  auto const DeviceHandle = Device.DeviceHandle;
+  auto& Texture = Entry->Texture;
+
+  if(Texture.SamplerHandle)
+    Device.vkDestroySampler(DeviceHandle, Texture.SamplerHandle, nullptr);
+  if(Texture.ImageViewHandle)
+    Device.vkDestroyImageView(DeviceHandle, Texture.ImageViewHandle, nullptr);
+  if(Texture.ImageHandle)
+    Device.vkDestroyImage(DeviceHandle, Texture.ImageHandle, nullptr);
+  if(Texture.MemoryHandle)
+    Device.vkFreeMemory(DeviceHandle, Texture.MemoryHandle, nullptr);
+
+  Finalize(Texture.Image);
+  Delete(*Registry.Allocator, Entry);
+}
+
+auto
+::VulkanDestroyTextureRegistry(allocator_interface& Allocator, vulkan_texture_registry* Registry)
+  -> void
+{
+  if(Registry == nullptr)
+    return;
+
+  for(auto Entry : Values(&Registry->Entries))
+    DestroyTextureEntry(*Registry, Entry);
+
+  Finalize(&Registry->Entries);
+  Delete(Allocator, Registry);
+}
+
+static texture_entry*
+FindTextureEntry(vulkan_texture_registry& Registry, vulkan_texture2d* Texture)
+{
+  // Only looked up to change the reference count, so a linear search over the
+  // distinct textures is fine.
+  for(auto Entry : Values(&Registry.Entries))
+  {
+    if(&Entry->Texture == Texture)
+      return Entry;
+  }
+
+  return nullptr;
+}
+
+auto
+::VulkanAcquireTexture(vulkan_texture_registry&       Registry,
+                       image const&                   Image,
+                       vulkan_texture_sampling const& Sampling,
+                       bool&                          IsNew)
+  -> vulkan_texture2d*
+{
+  texture_key Key{};
+  Key.Header = Image;
+  Key.Sampling = Sampling;
+  Key.ContentHash = HashXxh64(Slice<void const>(ImageDataSize(Image), ImageData(Image).Ptr));
+
+  auto Slot = GetOrCreate(&Registry.Entries, Key);
+  if(*Slot)
+  {
+    auto Entry = *Slot;
+    ++Entry->NumReferences;
+    IsNew = false;
+
+    LogInfo("Sharing a %ux%u texture that is already on the device.", Image.Width, Image.Height);
+    return &Entry->Texture;
+  }
+
+  auto Entry = New<texture_entry>(*Registry.Allocator);
+  Entry->Key = Key;
+  Entry->NumReferences = 1;
+  Entry->Texture.Sampling = Sampling;
+  Init(Entry->Texture.Image, *Registry.Allocator);
+  Copy(Entry->Texture.Image, Image);
+
+  *Slot = Entry;
+  IsNew = true;
+  return &Entry->Texture;
+}
+
+auto
+::VulkanAddTextureReference(vulkan_texture_registry& Registry, vulkan_texture2d* Texture)
+  -> void
+{
+  auto Entry = FindTextureEntry(Registry, Texture);
+  if(Entry == nullptr)
+  {
+    LogError("The texture does not belong to this registry.");
+    return;
+  }
+
+  ++Entry->NumReferences;
+}
+
+auto
+::VulkanReleaseTexture(vulkan_texture_registry& Registry, vulkan_texture2d* Texture)
+  -> void
+{
+  auto Entry = FindTextureEntry(Registry, Texture);
+  if(Entry == nullptr)
+  {
+    LogError("The texture does not belong to this registry.");
+    return;
+  }
+
+  Assert(Entry->NumReferences > 0);
+  if(--Entry->NumReferences > 0)
+    return;
+
+  Remove(&Registry.Entries, Entry->Key);
+  DestroyTextureEntry(Registry, Entry);
+}
+
+auto
+::VulkanNumTextures(vulkan_texture_registry const& Registry)
+  -> size_t
+{
+  return Registry.Entries.Num;
+}
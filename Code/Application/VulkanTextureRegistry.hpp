@@ -0,0 +1,46 @@
+#pragma once
+
+#include "VulkanHelper.hpp"
+
+
+/// Shares textures between everything that uses the same image with the same
+/// sampling, so identical pixel data is only uploaded to the device once.
+///
+/// Textures are found by a hash of the image data. The registry owns them and
+/// destroys their device objects when the last reference is released.
+struct vulkan_texture_registry;
+
+vulkan_texture_registry*
+VulkanCreateTextureRegistry(allocator_interface& Allocator, vulkan_device const& Device);
+
+/// \brief Destroys the registry and all textures that are still referenced.
+///
+/// The device must not use any of them anymore.
+void
+VulkanDestroyTextureRegistry(allocator_interface& Allocator, vulkan_texture_registry* Registry);
+
+/// \brief Gets the texture for \a Image and adds a reference to it.
+///
+/// \param IsNew Set to \c true if there was no such texture yet. The new
+///              texture holds a copy of \a Image but has nothing on the
+///              device, so the caller has to upload it, e.g. with
+///              VulkanUploadTexture().
+vulkan_texture2d*
+VulkanAcquireTexture(vulkan_texture_registry&       Registry,
+                     image const&                   Image,
+                     vulkan_texture_sampling const& Sampling,
+                     bool&                          IsNew);
+
+/// \brief Adds a reference to a texture that was acquired before.
+void
+VulkanAddTextureReference(vulkan_texture_registry& Registry, vulkan_texture2d* Texture);
+
+/// \brief Releases a reference. The last one destroys the texture.
+///
+/// The device must not use the texture anymore.
+void
+VulkanReleaseTexture(vulkan_texture_registry& Registry, vulkan_texture2d* Texture);
+
+/// \brief The number of distinct textures in the registry.
+size_t
+VulkanNumTextures(vulkan_texture_registry const& Registry);
@@ -9,6 +9,7 @@ auto
 {
   Document.Allocator = &Allocator;
   Document.Nodes.Allocator = &Allocator;
+  Document.NodePool.BaseAllocator = &Allocator;
   Reserve(Document.Nodes, 32);
   Document.Root = CfgCreateNode(Document);
 }
@@ -17,11 +18,16 @@ auto
 ::Finalize(cfg_document& Document)
   -> void
 {
+  // Note: Not using CfgDestroyNode here because it would remove the node
+  // from the array we're iterating over.
   for(auto Node : Slice(Document.Nodes))
   {
-    CfgDestroyNode(Document, Node);
+    MemDestruct(1, Node);
   }
   Reset(Document.Nodes);
+
+  // Release all nodes at once.
+  PoolReleaseMemory(Document.NodePool);
 }
 
 auto
@@ -39,11 +45,11 @@ auto
 ::CfgCreateNode(cfg_document& Document)
   -> cfg_node*
 {
-  auto Node = Allocate<cfg_node>(*Document.Allocator);
+  auto Node = Allocate<cfg_node>(Document.NodePool);
   MemConstruct(1, Node);
   Node->Document = &Document;
-  Node->Values.Allocator = Document.Allocator;
-  Node->Attributes.Allocator = Document.Allocator;
+  Node->Values.InlineAllocator.FallbackAllocator = Document.Allocator;
+  Node->Attributes.InlineAllocator.FallbackAllocator = Document.Allocator;
   Document.Nodes += Node;
   return Node;
 }
@@ -58,7 +64,7 @@ auto
   if(RemoveFirst(Document.Nodes, Node))
   {
     MemDestruct(1, Node);
-    Deallocate(*Document.Allocator, Node);
+    Deallocate(Document.NodePool, Node);
   }
   else
   {
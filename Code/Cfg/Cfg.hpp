@@ -4,6 +4,7 @@
 
 #include <Core/Allocator.hpp>
 #include <Core/Array.hpp>
+#include <Core/InlineArray.hpp>
 
 
 struct cfg_document;
@@ -58,8 +59,9 @@ struct cfg_node
 
   cfg_identifier Name;
 
-  array<cfg_literal> Values;
-  array<cfg_attribute> Attributes;
+  // Most nodes only have one or two of these.
+  inline_array<cfg_literal, 2> Values;
+  inline_array<cfg_attribute, 2> Attributes;
 };
 
 // TODO: Memory management overhaul in cfg_documents.
@@ -72,6 +74,9 @@ struct cfg_document
   /// Will be automatically destoryed when the document gets finalized.
   array<cfg_node*> Nodes;
 
+  /// The nodes themselves live in here.
+  pool_allocator NodePool;
+
   /// The root node of this document.
   ///
   /// The node itself does not contain any data, it merely serves as access
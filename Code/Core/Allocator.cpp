@@ -3,12 +3,17 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#if !defined(BB_Platform_Windows)
+  #include <sys/mman.h>
+  #include <unistd.h>
+  #if defined(__GLIBC__)
+    #include <malloc.h>
+  #endif
+#endif
+
 // TODO: %I in printf is MS-specific!
 // See here: https://msdn.microsoft.com/en-us/library/tcxf1dw6.aspx
 
-// TODO: Move this somewhere central. Maybe on the commandline?
-#define PLATFORM_WINDOWS 1
-
 #if defined(DEBUG)
 
 auto
@@ -23,15 +28,147 @@ auto
 }
 #endif
 
+/// Lives right in front of every pointer handed out by the mallocator.
+struct mallocator_header
+{
+  /// The pointer obtained from the system.
+  void* Block;
+
+  /// For mapped blocks, the number of bytes mapped. For all other blocks,
+  /// the number of bytes available after the user pointer.
+  size_t BlockSize;
+
+  /// The number of bytes requested by the user.
+  size_t Size;
+
+  bool IsMapped;
+};
+
+static size_t
+RoundUpTo(size_t Value, size_t Multiple)
+{
+  return ((Value + Multiple - 1) / Multiple) * Multiple;
+}
+
+static mallocator_header*
+GetMallocatorHeader(void* Ptr)
+{
+  return Reinterpret<mallocator_header*>(Ptr) - 1;
+}
+
+#if defined(BB_Platform_Windows)
+
+/// Large blocks are aligned to this, like the mappings on POSIX platforms.
+static size_t const WindowsPageSize = 4096;
+
+static void*
+WindowsAllocate(size_t NumBytes, size_t Alignment)
+{
+  auto const HeaderSpace = RoundUpTo(sizeof(mallocator_header), Alignment);
+
+  auto Block = _aligned_malloc(HeaderSpace + NumBytes, Alignment);
+  if(Block == nullptr)
+    return nullptr;
+
+  auto Ptr = Reinterpret<uint8*>(Block) + HeaderSpace;
+  auto Header = GetMallocatorHeader(Ptr);
+  Header->Block = Block;
+  Header->BlockSize = _aligned_msize(Block, Alignment, 0) - HeaderSpace;
+  Header->Size = NumBytes;
+  Header->IsMapped = false;
+  return Ptr;
+}
+
+#else
+
+static size_t
+PageSize()
+{
+  static size_t const Result = size_t(sysconf(_SC_PAGESIZE));
+  return Result;
+}
+
+/// Transparent huge pages only back the parts of a mapping that are aligned to this.
+static size_t const HugePageSize = ToBytes(MiB(2));
+
+static void*
+PosixAllocateMapped(size_t NumBytes, size_t Alignment)
+{
+  bool const UseHugePages = NumBytes >= ToBytes(MALLOCATOR_HUGE_PAGE_THRESHOLD);
+  if(UseHugePages)
+    Alignment = Max(Alignment, HugePageSize);
+
+  // The header gets its own page(s) so the user pointer is page-aligned.
+  // mmap only guarantees page alignment, so larger alignments need room to
+  // move the user pointer up.
+  auto const HeaderSpace = RoundUpTo(sizeof(mallocator_header), PageSize());
+  auto const AlignmentSpace = Alignment > PageSize() ? Alignment - PageSize() : 0;
+  auto const MappedSize = RoundUpTo(HeaderSpace + AlignmentSpace + NumBytes, PageSize());
+
+  auto Block = mmap(nullptr, MappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(Block == MAP_FAILED)
+    return nullptr;
+
+  auto const BlockAddress = Reinterpret<size_t>(Block);
+  auto Ptr = Reinterpret<uint8*>(RoundUpTo(BlockAddress + HeaderSpace, Alignment));
+
+  #if defined(MADV_HUGEPAGE)
+    if(UseHugePages)
+    {
+      // Only whole huge pages, starting at the aligned user pointer.
+      auto const HintSize = (BlockAddress + MappedSize - Reinterpret<size_t>(Ptr)) / HugePageSize * HugePageSize;
+      if(HintSize > 0)
+        madvise(Ptr, HintSize, MADV_HUGEPAGE);
+    }
+  #endif
+
+  auto Header = GetMallocatorHeader(Ptr);
+  Header->Block = Block;
+  Header->BlockSize = MappedSize;
+  Header->Size = NumBytes;
+  Header->IsMapped = true;
+  return Ptr;
+}
+
+static void*
+PosixAllocate(size_t NumBytes, size_t Alignment)
+{
+  Alignment = Max(Alignment, sizeof(void*));
+  auto const HeaderSpace = RoundUpTo(sizeof(mallocator_header), Alignment);
+
+  void* Block = nullptr;
+  if(posix_memalign(&Block, Alignment, HeaderSpace + NumBytes) != 0)
+    return nullptr;
+
+  auto Ptr = Reinterpret<uint8*>(Block) + HeaderSpace;
+  auto Header = GetMallocatorHeader(Ptr);
+  Header->Block = Block;
+  #if defined(__GLIBC__)
+    Header->BlockSize = malloc_usable_size(Block) - HeaderSpace;
+  #else
+    Header->BlockSize = NumBytes;
+  #endif
+  Header->Size = NumBytes;
+  Header->IsMapped = false;
+  return Ptr;
+}
+
+#endif
+
 void*
 mallocator::Allocate(memory_size Size, size_t Alignment)
 {
   Alignment = CheckedAlignment(Alignment);
-  #if PLATFORM_WINDOWS
-    auto Ptr = _aligned_malloc(ToBytes(Size), Alignment);
+  #if defined(BB_Platform_Windows)
+    if(Size >= MALLOCATOR_MMAP_THRESHOLD)
+      Alignment = Max(Alignment, WindowsPageSize);
+    auto Ptr = WindowsAllocate(ToBytes(Size), Alignment);
   #else
-    Assert(!"Not implemented");
-    void* Ptr = nullptr;
+    void* Ptr;
+    if(Size >= MALLOCATOR_MMAP_THRESHOLD)
+      Ptr = PosixAllocateMapped(ToBytes(Size), Alignment);
+    else
+      Ptr = PosixAllocate(ToBytes(Size), Alignment);
   #endif
 
   // printf("mallocator: Allocated 0x%Ix with %.03fKiB (%.03fMiB)\n", Reinterpret<size_t>(Ptr), ToKiB(Size), ToMiB(Size));
@@ -43,25 +180,514 @@ mallocator::Deallocate(void* Memory)
 {
   // printf("mallocator: Deallocating 0x%Ix\n", Reinterpret<size_t>(Memory));
 
-  #if PLATFORM_WINDOWS
-    _aligned_free(Memory);
+  if(Memory == nullptr)
+    return;
+
+  auto Header = GetMallocatorHeader(Memory);
+  #if defined(BB_Platform_Windows)
+    _aligned_free(Header->Block);
+  #else
+    if(Header->IsMapped)
+      munmap(Header->Block, Header->BlockSize);
+    else
+      free(Header->Block);
+  #endif
+}
+
+bool
+mallocator::Resize(void* Ptr, memory_size NewSize)
+{
+  if(Ptr == nullptr || NewSize == 0)
+    return false;
+
+  auto Header = GetMallocatorHeader(Ptr);
+  auto const NumBytes = ToBytes(NewSize);
+
+  if(!Header->IsMapped)
+  {
+    if(NumBytes > Header->BlockSize)
+      return false;
+
+    Header->Size = NumBytes;
+    return true;
+  }
+
+  #if defined(BB_Platform_Windows)
+    // There are no mapped blocks on Windows.
+    return false;
   #else
-    Assert(!"Not implemented");
+    auto const HeaderSpace = size_t(Reinterpret<uint8*>(Ptr) - Reinterpret<uint8*>(Header->Block));
+    auto const NewMappedSize = RoundUpTo(HeaderSpace + NumBytes, PageSize());
+    if(NewMappedSize > Header->BlockSize)
+    {
+      #if defined(MREMAP_MAYMOVE)
+        // Without MREMAP_MAYMOVE this either grows the mapping in place or fails.
+        if(mremap(Header->Block, Header->BlockSize, NewMappedSize, 0) == MAP_FAILED)
+          return false;
+
+        Header->BlockSize = NewMappedSize;
+      #else
+        return false;
+      #endif
+    }
+
+    Header->Size = NumBytes;
+    return true;
   #endif
 }
 
 memory_size
 mallocator::AllocationSize(void* Ptr)
 {
-  #if PLATFORM_WINDOWS
-    // TODO: Test if this is valid for stuff allocated with _aligned_malloc.
-    return Bytes(_msize(Ptr));
-  #else
-    Assert(!"Not implemented");
+  if(Ptr == nullptr)
     return Bytes(0);
-  #endif
+
+  return Bytes(GetMallocatorHeader(Ptr)->Size);
+}
+
+//
+// Arena Allocator
+//
+
+using arena_block = arena_allocator::block;
+
+static uint8*
+BlockData(arena_block* Block)
+{
+  return Reinterpret<uint8*>(Block + 1);
+}
+
+static size_t
+AlignOffset(uint8* Base, size_t Offset, size_t Alignment)
+{
+  auto const Address = Reinterpret<size_t>(Base) + Offset;
+  auto const AlignedAddress = (Address + (Alignment - 1)) & ~(Alignment - 1);
+  return Offset + (AlignedAddress - Address);
+}
+
+/// Makes a block with at least \a MinCapacity bytes the current one, either
+/// by reusing a free block or by allocating a new one.
+static arena_block*
+PushBlock(arena_allocator& Arena, size_t MinCapacity)
+{
+  arena_block* Block = nullptr;
+
+  // Reuse the first free block that is big enough.
+  for(arena_block** Link = &Arena.FreeBlocks; *Link; Link = &(*Link)->Previous)
+  {
+    if((*Link)->Capacity >= MinCapacity)
+    {
+      Block = *Link;
+      *Link = Block->Previous;
+      break;
+    }
+  }
+
+  if(Block == nullptr)
+  {
+    Assert(Arena.BaseAllocator);
+    auto const Capacity = Max(ToBytes(Arena.BlockSize), MinCapacity);
+    auto Memory = Arena.BaseAllocator->Allocate(Bytes(sizeof(arena_block) + Capacity), GlobalDefaultAlignment);
+    if(Memory == nullptr)
+      return nullptr;
+
+    Block = Reinterpret<arena_block*>(Memory);
+    Block->Capacity = Capacity;
+  }
+
+  Block->Used = 0;
+  Block->Previous = Arena.CurrentBlock;
+  Arena.CurrentBlock = Block;
+
+  return Block;
+}
+
+arena_allocator::arena_allocator(allocator_interface& BaseAllocator, memory_size BlockSize)
+  : BaseAllocator(&BaseAllocator)
+  , BlockSize(BlockSize)
+{
+}
+
+arena_allocator::~arena_allocator()
+{
+  ArenaReleaseMemory(*this);
 }
 
+void*
+arena_allocator::Allocate(memory_size Size, size_t Alignment)
+{
+  Alignment = CheckedAlignment(Alignment);
+  auto const NumBytes = ToBytes(Size);
+
+  auto Block = this->CurrentBlock;
+  size_t Offset = 0;
+  if(Block)
+    Offset = AlignOffset(BlockData(Block), Block->Used, Alignment);
+
+  if(Block == nullptr || Offset + NumBytes > Block->Capacity)
+  {
+    // The block header is padded to GlobalDefaultAlignment, so we only have
+    // to reserve extra space for bigger alignments.
+    auto const Padding = Alignment > GlobalDefaultAlignment ? Alignment : 0;
+    Block = PushBlock(*this, NumBytes + Padding);
+    if(Block == nullptr)
+      return nullptr;
+
+    Offset = AlignOffset(BlockData(Block), 0, Alignment);
+  }
+
+  Block->Used = Offset + NumBytes;
+  this->LastAllocation = BlockData(Block) + Offset;
+  return this->LastAllocation;
+}
+
+void
+arena_allocator::Deallocate(void* Memory)
+{
+  if(Memory == nullptr || Memory != this->LastAllocation)
+    return;
+
+  auto Block = this->CurrentBlock;
+  Block->Used = Reinterpret<uint8*>(Memory) - BlockData(Block);
+  this->LastAllocation = nullptr;
+}
+
+bool
+arena_allocator::Resize(void* Ptr, memory_size NewSize)
+{
+  if(Ptr == nullptr || Ptr != this->LastAllocation)
+    return false;
+
+  auto Block = this->CurrentBlock;
+  auto const Offset = size_t(Reinterpret<uint8*>(Ptr) - BlockData(Block));
+  auto const NewUsed = Offset + ToBytes(NewSize);
+  if(NewUsed > Block->Capacity)
+    return false;
+
+  Block->Used = NewUsed;
+  return true;
+}
+
+memory_size
+arena_allocator::AllocationSize(void* Ptr)
+{
+  if(Ptr == nullptr || Ptr != this->LastAllocation)
+    return Bytes(0);
+
+  auto Block = this->CurrentBlock;
+  return Bytes(Block->Used - (Reinterpret<uint8*>(Ptr) - BlockData(Block)));
+}
+
+auto
+::ArenaGetMarker(arena_allocator& Arena)
+  -> arena_marker
+{
+  // Seal everything allocated so far so it can't be resized past the marker.
+  Arena.LastAllocation = nullptr;
+
+  arena_marker Marker;
+  Marker.Block = Arena.CurrentBlock;
+  Marker.Used = Arena.CurrentBlock ? Arena.CurrentBlock->Used : 0;
+  return Marker;
+}
+
+auto
+::ArenaRewind(arena_allocator& Arena, arena_marker Marker)
+  -> void
+{
+  while(Arena.CurrentBlock && Arena.CurrentBlock != Marker.Block)
+  {
+    auto Block = Arena.CurrentBlock;
+    Arena.CurrentBlock = Block->Previous;
+
+    Block->Previous = Arena.FreeBlocks;
+    Arena.FreeBlocks = Block;
+  }
+
+  // If this fails, the marker was not obtained from this arena or the arena
+  // was already rewound past it.
+  Assert(Arena.CurrentBlock == Marker.Block);
+
+  if(Arena.CurrentBlock)
+  {
+    Assert(Marker.Used <= Arena.CurrentBlock->Used);
+    Arena.CurrentBlock->Used = Marker.Used;
+  }
+
+  Arena.LastAllocation = nullptr;
+}
+
+auto
+::ArenaReset(arena_allocator& Arena)
+  -> void
+{
+  ArenaRewind(Arena, arena_marker{});
+}
+
+auto
+::ArenaReleaseMemory(arena_allocator& Arena)
+  -> void
+{
+  ArenaReset(Arena);
+
+  while(Arena.FreeBlocks)
+  {
+    auto Block = Arena.FreeBlocks;
+    Arena.FreeBlocks = Block->Previous;
+    Arena.BaseAllocator->Deallocate(Block);
+  }
+}
+
+auto
+::ArenaOwns(arena_allocator const& Arena, void const* Ptr)
+  -> bool
+{
+  auto const Address = Reinterpret<uint8 const*>(Ptr);
+  for(auto Block = Arena.CurrentBlock; Block; Block = Block->Previous)
+  {
+    auto const Data = BlockData(Block);
+    if(Address >= Data && Address < Data + Block->Used)
+      return true;
+  }
+
+  return false;
+}
+
+
+//
+// Pool Allocator
+//
+
+static size_t
+PoolBlockSize(size_t SizeClass)
+{
+  // Multiples of the cache line size, growing by roughly 1.5x.
+  static size_t const NumCacheLines[pool_allocator::NumSizeClasses] = { 1, 2, 3, 4, 6, 8, 12, 16, 24, 32 };
+  return NumCacheLines[SizeClass] * CACHE_LINE_SIZE;
+}
+
+/// \return pool_allocator::NumSizeClasses if there is no size class that can hold \a NumBytes.
+static size_t
+PoolSizeClass(size_t NumBytes)
+{
+  size_t SizeClass = 0;
+  while(SizeClass < pool_allocator::NumSizeClasses && PoolBlockSize(SizeClass) < NumBytes)
+    ++SizeClass;
+  return SizeClass;
+}
+
+/// Binary search for the slab that contains \a Ptr.
+static pool_allocator::slab*
+PoolFindSlab(pool_allocator const& Pool, void const* Ptr, size_t* OutInsertIndex = nullptr)
+{
+  auto const Address = Reinterpret<size_t>(Ptr);
+
+  // Find the first slab that starts after Address.
+  size_t Low = 0;
+  size_t High = Pool.NumSlabs;
+  while(Low < High)
+  {
+    auto const Mid = Low + (High - Low) / 2;
+    if(Reinterpret<size_t>(Pool.Slabs[Mid].Memory) <= Address) Low = Mid + 1;
+    else                                                        High = Mid;
+  }
+
+  if(OutInsertIndex)
+    *OutInsertIndex = Low;
+
+  if(Low == 0)
+    return nullptr;
+
+  auto Slab = &Pool.Slabs[Low - 1];
+  if(Address - Reinterpret<size_t>(Slab->Memory) >= ToBytes(Pool.SlabSize))
+    return nullptr;
+
+  return Slab;
+}
+
+static bool
+PoolAddSlab(pool_allocator& Pool, size_t SizeClass)
+{
+  auto const SlabBytes = ToBytes(Pool.SlabSize);
+
+  if(Pool.NumSlabs == Pool.SlabCapacity)
+  {
+    auto const NewCapacity = Max(size_t(16), 2 * Pool.SlabCapacity);
+    auto NewSlabs = SliceAllocate<pool_allocator::slab>(*Pool.BaseAllocator, NewCapacity);
+    if(!NewSlabs)
+      return false;
+
+    if(Pool.Slabs)
+    {
+      MemCopy(Pool.NumSlabs, NewSlabs.Ptr, Pool.Slabs);
+      Pool.BaseAllocator->Deallocate(Pool.Slabs);
+    }
+
+    Pool.Slabs = NewSlabs.Ptr;
+    Pool.SlabCapacity = NewCapacity;
+  }
+
+  auto Memory = Pool.BaseAllocator->Allocate(Pool.SlabSize, CACHE_LINE_SIZE);
+  if(Memory == nullptr)
+    return false;
+
+  size_t InsertIndex = 0;
+  auto ExistingSlab = PoolFindSlab(Pool, Memory, &InsertIndex);
+  Assert(ExistingSlab == nullptr);
+
+  MemMove(Pool.NumSlabs - InsertIndex, Pool.Slabs + InsertIndex + 1, Pool.Slabs + InsertIndex);
+  Pool.Slabs[InsertIndex].Memory = Memory;
+  Pool.Slabs[InsertIndex].SizeClass = SizeClass;
+  ++Pool.NumSlabs;
+
+  // Thread all blocks of the new slab onto the free list, in address order.
+  auto const BlockSize = PoolBlockSize(SizeClass);
+  auto const NumBlocks = SlabBytes / BlockSize;
+  auto SlabData = Reinterpret<uint8*>(Memory);
+  for(size_t BlockIndex = NumBlocks; BlockIndex > 0; --BlockIndex)
+  {
+    auto Block = Reinterpret<pool_allocator::free_block*>(SlabData + (BlockIndex - 1) * BlockSize);
+    Block->Next = Pool.FreeLists[SizeClass];
+    Pool.FreeLists[SizeClass] = Block;
+  }
+
+  auto& Stats = Pool.Stats[SizeClass];
+  Stats.BlockSize = BlockSize;
+  Stats.NumSlabs += 1;
+  Stats.NumBlocks += NumBlocks;
+
+  return true;
+}
+
+pool_allocator::pool_allocator(allocator_interface& BaseAllocator, memory_size SlabSize)
+  : BaseAllocator(&BaseAllocator)
+  , SlabSize(SlabSize)
+{
+}
+
+pool_allocator::~pool_allocator()
+{
+  PoolReleaseMemory(*this);
+}
+
+void*
+pool_allocator::Allocate(memory_size Size, size_t Alignment)
+{
+  Assert(this->BaseAllocator);
+  Assert(ToBytes(this->SlabSize) >= PoolBlockSize(NumSizeClasses - 1));
+
+  Alignment = CheckedAlignment(Alignment);
+  auto const SizeClass = PoolSizeClass(ToBytes(Size));
+
+  if(SizeClass == NumSizeClasses || Alignment > CACHE_LINE_SIZE)
+  {
+    auto Ptr = this->BaseAllocator->Allocate(Size, Alignment);
+    if(Ptr)
+      ++this->NumLargeAllocations;
+    return Ptr;
+  }
+
+  if(this->FreeLists[SizeClass] == nullptr && !PoolAddSlab(*this, SizeClass))
+    return nullptr;
+
+  auto Block = this->FreeLists[SizeClass];
+  this->FreeLists[SizeClass] = Block->Next;
+  ++this->Stats[SizeClass].NumUsedBlocks;
+
+  return Block;
+}
+
+void
+pool_allocator::Deallocate(void* Memory)
+{
+  if(Memory == nullptr)
+    return;
+
+  auto Slab = PoolFindSlab(*this, Memory);
+  if(Slab == nullptr)
+  {
+    Assert(this->NumLargeAllocations > 0);
+    --this->NumLargeAllocations;
+    this->BaseAllocator->Deallocate(Memory);
+    return;
+  }
+
+  auto const SizeClass = Slab->SizeClass;
+  auto Block = Reinterpret<free_block*>(Memory);
+  Block->Next = this->FreeLists[SizeClass];
+  this->FreeLists[SizeClass] = Block;
+
+  Assert(this->Stats[SizeClass].NumUsedBlocks > 0);
+  --this->Stats[SizeClass].NumUsedBlocks;
+}
+
+bool
+pool_allocator::Resize(void* Ptr, memory_size NewSize)
+{
+  if(Ptr == nullptr)
+    return false;
+
+  auto Slab = PoolFindSlab(*this, Ptr);
+  if(Slab == nullptr)
+    return this->BaseAllocator->Resize(Ptr, NewSize);
+
+  return ToBytes(NewSize) <= PoolBlockSize(Slab->SizeClass);
+}
+
+memory_size
+pool_allocator::AllocationSize(void* Ptr)
+{
+  if(Ptr == nullptr)
+    return Bytes(0);
+
+  auto Slab = PoolFindSlab(*this, Ptr);
+  if(Slab == nullptr)
+    return this->BaseAllocator->AllocationSize(Ptr);
+
+  return Bytes(PoolBlockSize(Slab->SizeClass));
+}
+
+auto
+::PoolGetStats(pool_allocator const& Pool)
+  -> pool_size_class_stats
+{
+  pool_size_class_stats Result{};
+  for(auto& Stats : Pool.Stats)
+  {
+    Result.BlockSize = Max(Result.BlockSize, Stats.BlockSize);
+    Result.NumSlabs += Stats.NumSlabs;
+    Result.NumBlocks += Stats.NumBlocks;
+    Result.NumUsedBlocks += Stats.NumUsedBlocks;
+  }
+  return Result;
+}
+
+auto
+::PoolReleaseMemory(pool_allocator& Pool)
+  -> void
+{
+  for(size_t SlabIndex = 0; SlabIndex < Pool.NumSlabs; ++SlabIndex)
+  {
+    Pool.BaseAllocator->Deallocate(Pool.Slabs[SlabIndex].Memory);
+  }
+
+  if(Pool.Slabs)
+    Pool.BaseAllocator->Deallocate(Pool.Slabs);
+
+  Pool.Slabs = nullptr;
+  Pool.NumSlabs = 0;
+  Pool.SlabCapacity = 0;
+
+  for(size_t SizeClass = 0; SizeClass < pool_allocator::NumSizeClasses; ++SizeClass)
+  {
+    Pool.FreeLists[SizeClass] = nullptr;
+    Pool.Stats[SizeClass] = {};
+  }
+}
+
+//
+// Temp Allocator
+//
 
 static allocator_interface*
 GetGlobalTempAllocator()
@@ -70,30 +696,75 @@ GetGlobalTempAllocator()
   return &GlobalTempAllocator;
 }
 
+static arena_allocator*
+GetThreadTempArena()
+{
+  static thread_local arena_allocator ThreadTempArena{ *GetGlobalTempAllocator() };
+  return &ThreadTempArena;
+}
+
+/// The innermost temp_allocator alive on this thread.
+static thread_local temp_allocator* ThreadInnermostTempAllocator{};
+
 temp_allocator::temp_allocator()
+  : Arena(GetThreadTempArena())
+  , Marker(ArenaGetMarker(*this->Arena))
+  , Parent(ThreadInnermostTempAllocator)
 {
-  // Nothing to do here yet.
+  ThreadInnermostTempAllocator = this;
 }
 
 temp_allocator::~temp_allocator()
 {
-  // Nothing to do here yet.
+  // temp_allocators have to be destroyed in reverse order of creation.
+  Assert(ThreadInnermostTempAllocator == this);
+
+  ArenaRewind(*this->Arena, this->Marker);
+  ThreadInnermostTempAllocator = this->Parent;
 }
 
 void*
 temp_allocator::Allocate(memory_size Size, size_t Alignment)
 {
-  return GetGlobalTempAllocator()->Allocate(Size, Alignment);
+  // Allocating from the arena while a nested temp_allocator is alive would
+  // hand out memory that gets released when the nested one is destroyed.
+  if(ThreadInnermostTempAllocator != this)
+    return GetGlobalTempAllocator()->Allocate(Size, Alignment);
+
+  return this->Arena->Allocate(Size, Alignment);
 }
 
 void
 temp_allocator::Deallocate(void* Ptr)
 {
-  GetGlobalTempAllocator()->Deallocate(Ptr);
+  if(Ptr == nullptr)
+    return;
+
+  if(ArenaOwns(*this->Arena, Ptr))
+  {
+    if(ThreadInnermostTempAllocator == this)
+      this->Arena->Deallocate(Ptr);
+  }
+  else
+  {
+    GetGlobalTempAllocator()->Deallocate(Ptr);
+  }
 }
 
 bool
 temp_allocator::Resize(void* Ptr, memory_size NewSize)
 {
-  return GetGlobalTempAllocator()->Resize(Ptr, NewSize);
+  if(ThreadInnermostTempAllocator != this)
+    return false;
+
+  return this->Arena->Resize(Ptr, NewSize);
+}
+
+memory_size
+temp_allocator::AllocationSize(void* Ptr)
+{
+  if(ArenaOwns(*this->Arena, Ptr))
+    return this->Arena->AllocationSize(Ptr);
+
+  return GetGlobalTempAllocator()->AllocationSize(Ptr);
 }
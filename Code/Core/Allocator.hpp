@@ -37,12 +37,27 @@ public:
   virtual memory_size AllocationSize(void* Ptr) { return Bytes(0); }
 };
 
-/// \note This allocator does not support resizing.
+#if !defined(MALLOCATOR_MMAP_THRESHOLD)
+  #define MALLOCATOR_MMAP_THRESHOLD MiB(1)
+#endif
+
+#if !defined(MALLOCATOR_HUGE_PAGE_THRESHOLD)
+  #define MALLOCATOR_HUGE_PAGE_THRESHOLD MiB(2)
+#endif
+
+/// Allocates from the system heap.
+///
+/// Allocations of at least MALLOCATOR_MMAP_THRESHOLD bytes are page-aligned.
+/// On POSIX platforms they are anonymous memory mappings, and mappings of at
+/// least MALLOCATOR_HUGE_PAGE_THRESHOLD bytes are aligned to 2 MiB and hinted
+/// to use transparent huge pages. Resizing succeeds when the allocation has
+/// enough room left or when the mapping can be grown in-place.
 class CORE_API mallocator : public allocator_interface
 {
 public:
   virtual void* Allocate(memory_size Size, size_t Alignment) override;
   virtual void Deallocate(void* Memory) override;
+  virtual bool Resize(void* Ptr, memory_size NewSize) override;
   virtual memory_size AllocationSize(void* Ptr) override;
 };
 
@@ -94,13 +109,210 @@ Delete(allocator_interface& Allocator, T* Ptr)
   Deallocate(Allocator, Ptr);
 }
 
+
+//
+// Arena Allocator
+//
+
+#if !defined(ARENA_DEFAULT_BLOCK_SIZE)
+  #define ARENA_DEFAULT_BLOCK_SIZE MiB(1)
+#endif
+
+/// A position within an arena that can be rewound to.
+/// \see ArenaGetMarker()
+/// \see ArenaRewind()
+struct arena_marker
+{
+  void* Block;
+  size_t Used;
+};
+
+/// A linear (bump) allocator that carves its allocations out of big blocks
+/// it obtains from a base allocator.
+///
+/// Only the most recent allocation can be deallocated or resized in-place.
+/// Everything else is released in one go by rewinding to a marker or
+/// resetting the arena. Blocks released that way are kept around for reuse
+/// until the arena is destroyed or ArenaReleaseMemory() is called.
+class CORE_API arena_allocator : public allocator_interface
+{
+public:
+  /// Aligned so the data following it starts at GlobalDefaultAlignment.
+  struct alignas(GlobalDefaultAlignment) block
+  {
+    block* Previous;
+    size_t Capacity; // Number of usable bytes following this header.
+    size_t Used;
+  };
+
+  allocator_interface* BaseAllocator{};
+  memory_size BlockSize = ARENA_DEFAULT_BLOCK_SIZE;
+
+  block* CurrentBlock{};
+  block* FreeBlocks{};
+  void* LastAllocation{};
+
+  arena_allocator() = default;
+  arena_allocator(allocator_interface& BaseAllocator, memory_size BlockSize = ARENA_DEFAULT_BLOCK_SIZE);
+  arena_allocator(arena_allocator const&) = delete; // No copy
+  virtual ~arena_allocator();
+
+  virtual void* Allocate(memory_size Size, size_t Alignment) override;
+
+  /// \note Only has an effect on the most recent allocation.
+  virtual void Deallocate(void* Memory) override;
+
+  /// Grows or shrinks the most recent allocation in-place.
+  virtual bool Resize(void* Ptr, memory_size NewSize) override;
+
+  /// \note Only known for the most recent allocation. Returns 0 otherwise.
+  virtual memory_size AllocationSize(void* Ptr) override;
+};
+
+/// \note The most recent allocation can no longer be resized in-place or
+///       deallocated individually after this.
+CORE_API
+arena_marker
+ArenaGetMarker(arena_allocator& Arena);
+
+/// Releases all allocations made after \a Marker was obtained.
+CORE_API
+void
+ArenaRewind(arena_allocator& Arena, arena_marker Marker);
+
+/// Releases all allocations but keeps the blocks around for reuse.
+CORE_API
+void
+ArenaReset(arena_allocator& Arena);
+
+/// Releases all allocations and returns all blocks to the base allocator.
+CORE_API
+void
+ArenaReleaseMemory(arena_allocator& Arena);
+
+/// Whether \a Ptr points into memory currently in use by \a Arena.
+CORE_API
+bool
+ArenaOwns(arena_allocator const& Arena, void const* Ptr);
+
+/// Rewinds the given arena to where it was when this object was created.
+struct scoped_arena_marker
+{
+  arena_allocator& Arena;
+  arena_marker Marker;
+
+  scoped_arena_marker(arena_allocator& Arena) : Arena(Arena), Marker(ArenaGetMarker(Arena)) {}
+  scoped_arena_marker(scoped_arena_marker const&) = delete; // No copy
+  ~scoped_arena_marker() { ArenaRewind(Arena, Marker); }
+};
+
+
+//
+// Pool Allocator
+//
+
+#if !defined(CACHE_LINE_SIZE)
+  #define CACHE_LINE_SIZE 64
+#endif
+
+#if !defined(POOL_DEFAULT_SLAB_SIZE)
+  #define POOL_DEFAULT_SLAB_SIZE KiB(64)
+#endif
+
+struct pool_size_class_stats
+{
+  size_t BlockSize;
+  size_t NumSlabs;
+  size_t NumBlocks;
+  size_t NumUsedBlocks;
+};
+
+/// Hands out fixed-size blocks from slabs it obtains from a base allocator.
+///
+/// Blocks are grouped into size classes that are multiples of the cache line
+/// size and every block is aligned to a cache line. Each size
+/// class keeps its own free list, so allocating and deallocating a block is
+/// O(1) as long as no new slab is needed. Requests that are too big for the
+/// largest size class or need a bigger alignment are forwarded to the base
+/// allocator.
+///
+/// Slabs are only returned to the base allocator when the pool is destroyed
+/// or PoolReleaseMemory() is called.
+///
+/// \note Not thread-safe.
+class CORE_API pool_allocator : public allocator_interface
+{
+public:
+  enum { NumSizeClasses = 10 }; // CACHE_LINE_SIZE * { 1, 2, 3, 4, 6, 8, 12, 16, 24, 32 }
+
+  struct free_block
+  {
+    free_block* Next;
+  };
+
+  struct slab
+  {
+    void* Memory;
+    size_t SizeClass;
+  };
+
+  allocator_interface* BaseAllocator{};
+  memory_size SlabSize = POOL_DEFAULT_SLAB_SIZE;
+
+  free_block* FreeLists[NumSizeClasses]{};
+  pool_size_class_stats Stats[NumSizeClasses]{};
+
+  /// All slabs, sorted by address.
+  slab* Slabs{};
+  size_t NumSlabs{};
+  size_t SlabCapacity{};
+
+  /// Number of live allocations that were forwarded to the base allocator.
+  size_t NumLargeAllocations{};
+
+  pool_allocator() = default;
+  pool_allocator(allocator_interface& BaseAllocator, memory_size SlabSize = POOL_DEFAULT_SLAB_SIZE);
+  pool_allocator(pool_allocator const&) = delete; // No copy
+  virtual ~pool_allocator();
+
+  virtual void* Allocate(memory_size Size, size_t Alignment) override;
+  virtual void Deallocate(void* Memory) override;
+
+  /// Succeeds as long as \a NewSize fits into the block \a Ptr lives in.
+  virtual bool Resize(void* Ptr, memory_size NewSize) override;
+  virtual memory_size AllocationSize(void* Ptr) override;
+};
+
+/// Accumulated stats of all size classes of \a Pool.
+CORE_API
+pool_size_class_stats
+PoolGetStats(pool_allocator const& Pool);
+
+/// Returns all slabs to the base allocator.
+///
+/// \note All blocks handed out by \a Pool become invalid.
+CORE_API
+void
+PoolReleaseMemory(pool_allocator& Pool);
+
+
 /// An allocator wrapper that is intended to be used only for a short period
 /// of time in the scope it was created.
 ///
+/// Allocations are served from an arena that is local to the current thread
+/// and everything is released at once when the temp_allocator goes out of
+/// scope, so it must only be used on the thread that created it. When
+/// several temp_allocators are nested, only the innermost one uses the arena;
+/// the outer ones fall back to the heap until the inner ones are gone.
+///
 /// \note The dereference operator (\c operator*) is overloaded to retrieve a
 ///       reference to an allocator interface (\c allocator_interface&).
 struct CORE_API temp_allocator : public allocator_interface
 {
+  arena_allocator* Arena;
+  arena_marker Marker;
+  temp_allocator* Parent;
+
   temp_allocator();
   temp_allocator(temp_allocator const&) = delete; // No copy
   virtual ~temp_allocator();
@@ -108,4 +320,5 @@ struct CORE_API temp_allocator : public allocator_interface
   virtual void* Allocate(memory_size Size, size_t Alignment) override;
   virtual void Deallocate(void* Memory) override;
   virtual bool Resize(void* Ptr, memory_size NewSize) override;
+  virtual memory_size AllocationSize(void* Ptr) override;
 };
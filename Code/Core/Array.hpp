@@ -30,6 +30,7 @@ struct array
   size_t Num{};
   T* Ptr{};
   bool CanGrow = true;
+  container_growth Growth = container_growth::Double;
 
 
   array() = default;
@@ -57,6 +58,9 @@ struct array
   operator[](IndexType Index) const;
 };
 
+/// An array only points to memory outside of itself.
+template<typename T> struct impl_is_trivially_relocatable<array<T>> { static constexpr bool Value = true; };
+
 
 //
 // Array operations
@@ -114,7 +118,8 @@ Reserve(array<T>& Array, size_t MinBytesToReserve)
                                              Array.Ptr, Array.Num,
                                              Array.Capacity,
                                              MinBytesToReserve,
-                                             ARRAY_MINIMUM_CAPACITY);
+                                             ARRAY_MINIMUM_CAPACITY,
+                                             Array.Growth);
 
   // Update array members.
   Array.Ptr = NewAllocatedMemory.Ptr;
@@ -288,6 +293,8 @@ array<T>::array(array&& ToMove)
   , Capacity(ToMove.Capacity)
   , Num(ToMove.Num)
   , Ptr(ToMove.Ptr)
+  , CanGrow(ToMove.CanGrow)
+  , Growth(ToMove.Growth)
 {
   ToMove.Capacity = 0;
   ToMove.Num = 0;
@@ -304,8 +311,7 @@ template<typename T>
 void
 array<T>::operator=(array&& ToMove)
 {
-  // TODO: Is Ptr check enough? Think of Num etc.
-  if(this->Ptr != ToMove.Ptr)
+  if(this != &ToMove)
   {
     Reset(*this);
 
@@ -314,6 +320,8 @@ array<T>::operator=(array&& ToMove)
     this->Capacity = ToMove.Capacity;
     this->Num = ToMove.Num;
     this->Ptr = ToMove.Ptr;
+    this->CanGrow = ToMove.CanGrow;
+    this->Growth = ToMove.Growth;
 
     // Clear other data.
     ToMove.Capacity = 0;
@@ -4,6 +4,56 @@
 #include "Allocator.hpp"
 
 
+/// Whether objects of type T may be moved to another address with a plain
+/// byte-copy, without calling the move ctor and dtor. POD types always are.
+///
+/// Specialize this for types that only hold pointers to memory they don't
+/// point into themselves, e.g. array<T>.
+template<typename T> struct impl_is_trivially_relocatable { static constexpr bool Value = IsPOD<T>(); };
+
+template<typename T>
+constexpr bool
+IsTriviallyRelocatable() { return impl_is_trivially_relocatable<T>::Value; }
+
+
+/// How a container computes its new capacity when it runs out of space.
+enum class container_growth : uint8
+{
+  /// Double the capacity. Amortized O(1) appends.
+  Double,
+
+  /// Grow by 50%. Amortized O(1) appends with less memory overhead.
+  OneAndAHalf,
+
+  /// Reserve exactly what was requested. For containers that are filled
+  /// with large chunks at once, e.g. image data.
+  Exact,
+};
+
+/// \return The new capacity for a container with \a CurrentCapacity
+///         that needs to hold at least \a MinNumToReserve elements.
+inline size_t
+ContainerGrowCapacity(container_growth Growth,
+                      size_t CurrentCapacity,
+                      size_t MinNumToReserve,
+                      size_t MinimumCapacity)
+{
+  if(Growth == container_growth::Exact)
+    return MinNumToReserve;
+
+  size_t NewCapacity = Max(CurrentCapacity, MinimumCapacity);
+  while(NewCapacity < MinNumToReserve)
+  {
+    switch(Growth)
+    {
+      case container_growth::OneAndAHalf: NewCapacity += Max(NewCapacity / 2, size_t(1)); break;
+      default:                            NewCapacity *= 2;                               break;
+    }
+  }
+
+  return NewCapacity;
+}
+
 /// \return Slice containing the new Ptr and Capacity.
 template<typename T>
 slice<T>
@@ -12,17 +62,15 @@ ContainerReserve(allocator_interface& Allocator,
                  size_t CurrentNum,
                  size_t CurrentCapacity,
                  size_t MinNumToReserve,
-                 size_t MinimumCapacity)
+                 size_t MinimumCapacity,
+                 container_growth Growth = container_growth::Double)
 {
-  // TODO: Replace with something like NextMultipleOf(Max(MinNumToReserve, MinimumCapacity), MinimumCapacity)
-  size_t NumToReserve = MinimumCapacity;
-  while(NumToReserve < MinNumToReserve)
-    NumToReserve *= 2;
-
-  if(CurrentCapacity >= NumToReserve)
+  if(CurrentCapacity >= MinNumToReserve)
     return Slice(CurrentCapacity, Ptr);
 
-  if(Allocator.Resize(Ptr, NumToReserve * SizeOf<T>()))
+  size_t const NumToReserve = ContainerGrowCapacity(Growth, CurrentCapacity, MinNumToReserve, MinimumCapacity);
+
+  if(Ptr && Allocator.Resize(Ptr, NumToReserve * SizeOf<T>()))
   {
     return Slice(NumToReserve, Ptr);
   }
@@ -36,13 +84,20 @@ ContainerReserve(allocator_interface& Allocator,
 
   if(OldUsedMemory)
   {
-    // Move from the old memory.
-    SliceMoveConstruct(NewUsedMemory, OldUsedMemory);
+    if(IsTriviallyRelocatable<T>())
+    {
+      // The old objects are considered dead once their bytes are copied over.
+      MemCopyBytes(CurrentNum * SizeOf<T>(), NewUsedMemory.Ptr, OldUsedMemory.Ptr);
+    }
+    else
+    {
+      // Note: This destructs the old elements.
+      SliceMoveConstruct(NewUsedMemory, OldUsedMemory);
+    }
+  }
 
-    // Destruct and free the old memory.
-    SliceDestruct(OldUsedMemory);
+  if(OldAllocatedMemory)
     SliceDeallocate(Allocator, OldAllocatedMemory);
-  }
 
   return NewAllocatedMemory;
 }
@@ -9,6 +9,22 @@
 
 constexpr size_t DictionaryMinimumCapacity = 16;
 
+struct dictionary_slot
+{
+  uint32 Hash;
+
+  /// Index into the key and value arrays or DictionaryEmptySlot.
+  uint32 Index;
+};
+
+constexpr uint32 DictionaryEmptySlot = 0xFFFFFFFF;
+
+/// Keys and values are stored densely in two parallel arrays, so \c Keys()
+/// and \c Values() are plain slices. An open-addressing table with robin hood
+/// probing maps key hashes to indices into these arrays.
+///
+/// \note Removing a key moves the last key-value pair into the gap, so the
+///       order of pairs is only stable as long as nothing is removed.
 template<typename K, typename V>
 struct dictionary
 {
@@ -20,8 +36,197 @@ struct dictionary
   size_t Capacity;
   K* KeysPtr;
   V* ValuesPtr;
+
+  /// Power of two or 0.
+  size_t NumSlots;
+  dictionary_slot* Slots;
+};
+
+
+//
+// Hashing
+//
+// To make a type usable as a dictionary key, provide an overload of
+// DictionaryHash for it. Keys that compare equal with operator== must have
+// the same hash, even if their types differ (e.g. arc_string and
+// slice<char const>).
+//
+
+class arc_string;
+
+inline uint32
+DictionaryHashInteger(uint64 Value)
+{
+  // Finalizer of MurmurHash3.
+  Value ^= Value >> 33;
+  Value *= 0xff51afd7ed558ccdULL;
+  Value ^= Value >> 33;
+  Value *= 0xc4ceb9fe1a85ec53ULL;
+  Value ^= Value >> 33;
+  return uint32(Value);
+}
+
+/// FNV-1a
+inline uint32
+DictionaryHashBytes(memory_size Size, void const* Data)
+{
+  auto Bytes = Reinterpret<uint8 const*>(Data);
+  uint32 Hash = 2166136261u;
+  for(size_t Index = 0; Index < ToBytes(Size); ++Index)
+  {
+    Hash ^= Bytes[Index];
+    Hash *= 16777619u;
+  }
+  return Hash;
+}
+
+template<typename T, bool IsEnum = __is_enum(T)>
+struct impl_dictionary_hash
+{
+  static uint32 Do(T const& Value) { return DictionaryHashBytes(SizeOf<T>(), &Value); }
+};
+
+template<typename T>
+struct impl_dictionary_hash<T, true>
+{
+  static uint32 Do(T Value) { return DictionaryHashInteger(uint64(Value)); }
 };
 
+/// Fallback for PODs and enums.
+template<typename T>
+uint32
+DictionaryHash(T const& Value)
+{
+  static_assert(IsPOD<T>(), "Please provide an overload of DictionaryHash for this type.");
+  return impl_dictionary_hash<T>::Do(Value);
+}
+
+inline uint32 DictionaryHash(uint8  Value) { return DictionaryHashInteger(uint64(Value)); }
+inline uint32 DictionaryHash( int8  Value) { return DictionaryHashInteger(uint64(Value)); }
+inline uint32 DictionaryHash(uint16 Value) { return DictionaryHashInteger(uint64(Value)); }
+inline uint32 DictionaryHash( int16 Value) { return DictionaryHashInteger(uint64(Value)); }
+inline uint32 DictionaryHash(uint32 Value) { return DictionaryHashInteger(uint64(Value)); }
+inline uint32 DictionaryHash( int32 Value) { return DictionaryHashInteger(uint64(Value)); }
+inline uint32 DictionaryHash(uint64 Value) { return DictionaryHashInteger(uint64(Value)); }
+inline uint32 DictionaryHash( int64 Value) { return DictionaryHashInteger(uint64(Value)); }
+
+inline uint32 DictionaryHash(slice<char const> String) { return DictionaryHashBytes(Bytes(String.Num), String.Ptr); }
+inline uint32 DictionaryHash(slice<char> String)       { return DictionaryHash(AsConst(String)); }
+inline uint32 DictionaryHash(char const* String)       { return DictionaryHash(SliceFromString(String)); }
+
+CORE_API uint32 DictionaryHash(arc_string const& String);
+
+
+//
+// Internals
+//
+
+/// The distance of the slot at \a SlotIndex from the slot its hash prefers.
+inline size_t
+DictionaryProbeDistance(size_t NumSlots, uint32 Hash, size_t SlotIndex)
+{
+  return (SlotIndex - (Hash & (NumSlots - 1))) & (NumSlots - 1);
+}
+
+/// Inserts an entry into the slot table, assuming there is at least one free slot.
+inline void
+DictionaryInsertSlot(size_t NumSlots, dictionary_slot* Slots, dictionary_slot Entry)
+{
+  auto const Mask = NumSlots - 1;
+  size_t Distance = 0;
+  for(size_t SlotIndex = Entry.Hash & Mask; ; SlotIndex = (SlotIndex + 1) & Mask, ++Distance)
+  {
+    auto& Slot = Slots[SlotIndex];
+    if(Slot.Index == DictionaryEmptySlot)
+    {
+      Slot = Entry;
+      return;
+    }
+
+    // Robin hood: Take from the rich (entries close to their preferred slot)
+    // and give to the poor.
+    auto const SlotDistance = DictionaryProbeDistance(NumSlots, Slot.Hash, SlotIndex);
+    if(SlotDistance < Distance)
+    {
+      Swap(Slot, Entry);
+      Distance = SlotDistance;
+    }
+  }
+}
+
+/// Removes the entry at \a SlotIndex by shifting the following entries back.
+inline void
+DictionaryRemoveSlot(size_t NumSlots, dictionary_slot* Slots, size_t SlotIndex)
+{
+  auto const Mask = NumSlots - 1;
+  while(true)
+  {
+    auto const NextIndex = (SlotIndex + 1) & Mask;
+    auto& Next = Slots[NextIndex];
+    if(Next.Index == DictionaryEmptySlot || DictionaryProbeDistance(NumSlots, Next.Hash, NextIndex) == 0)
+      break;
+
+    Slots[SlotIndex] = Next;
+    SlotIndex = NextIndex;
+  }
+
+  Slots[SlotIndex].Index = DictionaryEmptySlot;
+}
+
+/// \return The index into the slot table or INVALID_INDEX.
+template<typename K, typename V, typename IndexType>
+size_t
+DictionaryFindSlot(dictionary<K, V> const* Dict, IndexType const& Key, uint32 Hash)
+{
+  if(Dict->NumSlots == 0)
+    return INVALID_INDEX;
+
+  auto const Slots = Dict->Slots;
+  auto const Mask = Dict->NumSlots - 1;
+  size_t Distance = 0;
+  for(size_t SlotIndex = Hash & Mask; ; SlotIndex = (SlotIndex + 1) & Mask, ++Distance)
+  {
+    auto const& Slot = Slots[SlotIndex];
+    if(Slot.Index == DictionaryEmptySlot)
+      return INVALID_INDEX;
+
+    // The key would have displaced this entry if it were in here.
+    if(DictionaryProbeDistance(Dict->NumSlots, Slot.Hash, SlotIndex) < Distance)
+      return INVALID_INDEX;
+
+    if(Slot.Hash == Hash && Dict->KeysPtr[Slot.Index] == Key)
+      return SlotIndex;
+  }
+}
+
+template<typename K, typename V>
+void
+DictionaryRehash(dictionary<K, V>* Dict, size_t NewNumSlots)
+{
+  Assert(IsPowerOfTwo(NewNumSlots));
+
+  auto NewSlots = SliceAllocate<dictionary_slot>(*Dict->Allocator, NewNumSlots);
+  MemSetBytes(NewNumSlots * SizeOf<dictionary_slot>(), NewSlots.Ptr, 0xFF);
+
+  auto OldSlots = Slice(Dict->NumSlots, Dict->Slots);
+  for(auto& Slot : OldSlots)
+  {
+    if(Slot.Index != DictionaryEmptySlot)
+      DictionaryInsertSlot(NewNumSlots, NewSlots.Ptr, Slot);
+  }
+
+  if(OldSlots)
+    SliceDeallocate(*Dict->Allocator, OldSlots);
+
+  Dict->NumSlots = NewNumSlots;
+  Dict->Slots = NewSlots.Ptr;
+}
+
+
+//
+// API
+//
+
 template<typename K, typename V>
 void
 Init(dictionary<K, V>* Dict, allocator_interface* Allocator)
@@ -38,6 +243,7 @@ Clear(dictionary<K, V>* Dict)
     SliceDestruct(Keys(Dict));
     SliceDestruct(Values(Dict));
     Dict->Num = 0;
+    MemSetBytes(Dict->NumSlots * SizeOf<dictionary_slot>(), Dict->Slots, 0xFF);
   }
 }
 
@@ -52,19 +258,36 @@ Finalize(dictionary<K, V>* Dict)
     Dict->Allocator->Deallocate(Dict->ValuesPtr);
     Dict->Capacity = 0;
   }
+
+  if(Dict->NumSlots)
+  {
+    Dict->Allocator->Deallocate(Dict->Slots);
+    Dict->NumSlots = 0;
+    Dict->Slots = nullptr;
+  }
 }
 
 template<typename K, typename V>
 void
 Reserve(dictionary<K, V>* Dict, size_t MinElementsToReserve)
 {
-  if(Dict->Capacity >= MinElementsToReserve)
-    return;
-
   // TODO: Default allocator for dictionary?
   if(Dict->Allocator == nullptr)
     return;
 
+  // Keep the load factor of the slot table at or below 7/8.
+  if(MinElementsToReserve * 8 > Dict->NumSlots * 7)
+  {
+    size_t NewNumSlots = Max(Dict->NumSlots, DictionaryMinimumCapacity);
+    while(MinElementsToReserve * 8 > NewNumSlots * 7)
+      NewNumSlots *= 2;
+
+    DictionaryRehash(Dict, NewNumSlots);
+  }
+
+  if(Dict->Capacity >= MinElementsToReserve)
+    return;
+
   auto NewKeys = ContainerReserve(*Dict->Allocator,
                                   Dict->KeysPtr, Dict->Num,
                                   Dict->Capacity,
@@ -117,33 +340,34 @@ template<typename K, typename V, typename IndexType>
 V*
 Get(dictionary<K, V>* Dict, IndexType KeyIndex)
 {
-  auto ArrayIndex = SliceCountUntil(AsConst(Keys(Dict)), KeyIndex);
-  if(ArrayIndex == INVALID_INDEX)
+  auto SlotIndex = DictionaryFindSlot(Dict, KeyIndex, DictionaryHash(KeyIndex));
+  if(SlotIndex == INVALID_INDEX)
     return nullptr;
-  return &Values(Dict)[ArrayIndex];
+  return &Dict->ValuesPtr[Dict->Slots[SlotIndex].Index];
 }
 
 template<typename K, typename V, typename IndexType>
 V const*
 Get(dictionary<K, V> const* Dict, IndexType KeyIndex)
 {
-  auto ArrayIndex = SliceCountUntil(Keys(Dict), KeyIndex);
-  if(ArrayIndex == INVALID_INDEX)
+  auto SlotIndex = DictionaryFindSlot(Dict, KeyIndex, DictionaryHash(KeyIndex));
+  if(SlotIndex == INVALID_INDEX)
     return nullptr;
-  return &Values(Dict)[ArrayIndex];
+  return &Dict->ValuesPtr[Dict->Slots[SlotIndex].Index];
 }
 
 template<typename K, typename V, typename IndexType>
 V*
 GetOrCreate(dictionary<K, V>* Dict, IndexType KeyIndex)
 {
-  auto ArrayIndex = SliceCountUntil(AsConst(Keys(Dict)), KeyIndex);
-  if(ArrayIndex != INVALID_INDEX)
-    return &Values(Dict)[ArrayIndex];
+  auto const Hash = DictionaryHash(KeyIndex);
+  auto SlotIndex = DictionaryFindSlot(Dict, KeyIndex, Hash);
+  if(SlotIndex != INVALID_INDEX)
+    return &Dict->ValuesPtr[Dict->Slots[SlotIndex].Index];
 
   Reserve(Dict, Dict->Num + 1);
 
-  ArrayIndex = Dict->Num++;
+  auto ArrayIndex = Dict->Num++;
 
   auto NewKeyPtr = Dict->KeysPtr + ArrayIndex;
   MemConstruct(1, NewKeyPtr, KeyIndex);
@@ -151,6 +375,9 @@ GetOrCreate(dictionary<K, V>* Dict, IndexType KeyIndex)
   auto NewValuePtr = Dict->ValuesPtr + ArrayIndex;
   MemConstruct(1, NewValuePtr);
 
+  Assert(DictionaryHash(*NewKeyPtr) == Hash);
+  DictionaryInsertSlot(Dict->NumSlots, Dict->Slots, { Hash, Cast<uint32>(ArrayIndex) });
+
   return NewValuePtr;
 }
 
@@ -158,12 +385,29 @@ template<typename K, typename V, typename IndexType>
 bool
 Remove(dictionary<K, V>* Dict, IndexType KeyIndex)
 {
-  auto ArrayIndex = SliceCountUntil(AsConst(Keys(Dict)), KeyIndex);
-  if(ArrayIndex == INVALID_INDEX)
+  auto SlotIndex = DictionaryFindSlot(Dict, KeyIndex, DictionaryHash(KeyIndex));
+  if(SlotIndex == INVALID_INDEX)
     return false;
 
-  auto NewKeys   = ContainerRemoveAt(Keys(Dict),   ArrayIndex);
-  auto NewValues = ContainerRemoveAt(Values(Dict), ArrayIndex);
+  auto const Slots = Dict->Slots;
+  auto const ArrayIndex = Slots[SlotIndex].Index;
+  DictionaryRemoveSlot(Dict->NumSlots, Slots, SlotIndex);
+
+  // Fill the gap with the last pair.
+  auto const LastIndex = Dict->Num - 1;
+  if(ArrayIndex != LastIndex)
+  {
+    auto& LastKey = Dict->KeysPtr[LastIndex];
+    auto LastSlotIndex = DictionaryFindSlot(Dict, LastKey, DictionaryHash(LastKey));
+    Assert(LastSlotIndex != INVALID_INDEX);
+    Slots[LastSlotIndex].Index = ArrayIndex;
+
+    Dict->KeysPtr[ArrayIndex] = Move(LastKey);
+    Dict->ValuesPtr[ArrayIndex] = Move(Dict->ValuesPtr[LastIndex]);
+  }
+
+  MemDestruct(1, Dict->KeysPtr + LastIndex);
+  MemDestruct(1, Dict->ValuesPtr + LastIndex);
   --Dict->Num;
   return true;
 }
@@ -0,0 +1,151 @@
+#include "FileMapping.hpp"
+#include "Log.hpp"
+#include "String.hpp"
+
+#if defined(BB_Platform_Windows)
+  #include <Windows.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+
+#if defined(BB_Platform_Windows)
+
+auto
+::FileMappingOpen(file_mapping& Mapping, slice<char const> FileName)
+  -> bool
+{
+  FileMappingClose(Mapping);
+
+  // Make a copy of FileName to ensure it's zero terminated.
+  arc_string SzFileName{ FileName };
+
+  auto File = CreateFileA(StrPtr(SzFileName), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if(File == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER FileSize;
+  if(!GetFileSizeEx(File, &FileSize))
+  {
+    CloseHandle(File);
+    return false;
+  }
+
+  Mapping.FileHandle = File;
+
+  // Mapping an empty file fails, but there's nothing to map anyway.
+  if(FileSize.QuadPart == 0)
+    return true;
+
+  Mapping.MappingHandle = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if(Mapping.MappingHandle == nullptr)
+  {
+    Win32LogErrorCode(GetLastError());
+    FileMappingClose(Mapping);
+    return false;
+  }
+
+  auto View = MapViewOfFile(Mapping.MappingHandle, FILE_MAP_READ, 0, 0, 0);
+  if(View == nullptr)
+  {
+    Win32LogErrorCode(GetLastError());
+    FileMappingClose(Mapping);
+    return false;
+  }
+
+  Mapping.Data = Slice(size_t(FileSize.QuadPart), Reinterpret<void const*>(View));
+  return true;
+}
+
+auto
+::FileMappingClose(file_mapping& Mapping)
+  -> void
+{
+  if(Mapping.Data.Num)
+    UnmapViewOfFile(Mapping.Data.Ptr);
+
+  if(Mapping.MappingHandle)
+    CloseHandle(Mapping.MappingHandle);
+
+  if(Mapping.FileHandle)
+    CloseHandle(Mapping.FileHandle);
+
+  Mapping = {};
+}
+
+auto
+::FileMappingIsOpen(file_mapping const& Mapping)
+  -> bool
+{
+  return Mapping.FileHandle != nullptr;
+}
+
+#else
+
+auto
+::FileMappingOpen(file_mapping& Mapping, slice<char const> FileName)
+  -> bool
+{
+  FileMappingClose(Mapping);
+
+  // Make a copy of FileName to ensure it's zero terminated.
+  arc_string SzFileName{ FileName };
+
+  auto const FileDescriptor = open(StrPtr(SzFileName), O_RDONLY | O_CLOEXEC);
+  if(FileDescriptor < 0)
+    return false;
+
+  struct stat FileStatus;
+  if(fstat(FileDescriptor, &FileStatus) != 0)
+  {
+    close(FileDescriptor);
+    return false;
+  }
+
+  Mapping.FileDescriptor = FileDescriptor;
+
+  // Mapping an empty file fails, but there's nothing to map anyway.
+  if(FileStatus.st_size == 0)
+    return true;
+
+  auto const NumBytes = size_t(FileStatus.st_size);
+  auto View = mmap(nullptr, NumBytes, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+  if(View == MAP_FAILED)
+  {
+    LogError("Failed to map file: %s", StrPtr(SzFileName));
+    FileMappingClose(Mapping);
+    return false;
+  }
+
+  // Loaders usually read the content from front to back.
+  madvise(View, NumBytes, MADV_SEQUENTIAL);
+
+  Mapping.Data = Slice(NumBytes, Reinterpret<void const*>(View));
+  return true;
+}
+
+auto
+::FileMappingClose(file_mapping& Mapping)
+  -> void
+{
+  if(Mapping.Data.Num)
+    munmap(const_cast<void*>(Mapping.Data.Ptr), Mapping.Data.Num);
+
+  if(Mapping.FileDescriptor >= 0)
+    close(Mapping.FileDescriptor);
+
+  Mapping = {};
+}
+
+auto
+::FileMappingIsOpen(file_mapping const& Mapping)
+  -> bool
+{
+  return Mapping.FileDescriptor >= 0;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+
+#include <Backbone.hpp>
+
+
+/// A read-only view of a whole file.
+///
+/// The content is served directly from the OS page cache, so no heap memory
+/// is needed for it, no matter how big the file is.
+///
+/// \note The file must not be modified while it is mapped.
+struct file_mapping
+{
+  /// The content of the file. Valid until FileMappingClose() is called.
+  slice<void const> Data{};
+
+  #if defined(BB_Platform_Windows)
+    void* FileHandle{};
+    void* MappingHandle{};
+  #else
+    int FileDescriptor = -1;
+  #endif
+};
+
+/// Maps the file with the given name into memory.
+///
+/// An empty file results in a successful mapping with empty Data.
+///
+/// \return \c false if the file could not be opened or mapped.
+CORE_API
+bool
+FileMappingOpen(file_mapping& Mapping, slice<char const> FileName);
+
+/// Unmaps the file. Does nothing if the mapping isn't open.
+CORE_API
+void
+FileMappingClose(file_mapping& Mapping);
+
+CORE_API
+bool
+FileMappingIsOpen(file_mapping const& Mapping);
@@ -0,0 +1,100 @@
+#include "Hash.hpp"
+
+
+static uint64 const Xxh64Prime1 = 11400714785074694791ull;
+static uint64 const Xxh64Prime2 = 14029467366897019727ull;
+static uint64 const Xxh64Prime3 = 1609587929392839161ull;
+static uint64 const Xxh64Prime4 = 9650029242287828579ull;
+static uint64 const Xxh64Prime5 = 2870177450012600261ull;
+
+static uint64
+RotateLeft(uint64 Value, uint32 Amount)
+{
+  return (Value << Amount) | (Value >> (64 - Amount));
+}
+
+static uint64
+Read64(uint8 const* Data)
+{
+  uint64 Result = 0;
+  for(uint32 Index = 0; Index < 8; ++Index)
+    Result |= uint64(Data[Index]) << (8 * Index);
+  return Result;
+}
+
+static uint32
+Read32(uint8 const* Data)
+{
+  return uint32(Data[0]) | uint32(Data[1]) << 8 | uint32(Data[2]) << 16 | uint32(Data[3]) << 24;
+}
+
+static uint64
+Xxh64Round(uint64 Accumulator, uint64 Input)
+{
+  Accumulator += Input * Xxh64Prime2;
+  Accumulator = RotateLeft(Accumulator, 31);
+  return Accumulator * Xxh64Prime1;
+}
+
+static uint64
+Xxh64Merge(uint64 Hash, uint64 Accumulator)
+{
+  Hash ^= Xxh64Round(0, Accumulator);
+  return Hash * Xxh64Prime1 + Xxh64Prime4;
+}
+
+auto
+::HashXxh64(slice<void const> Data, uint64 Seed)
+  -> uint64
+{
+  auto Ptr = Reinterpret<uint8 const*>(Data.Ptr);
+  auto const End = Ptr + Data.Num;
+  uint64 Hash;
+
+  if(Data.Num >= 32)
+  {
+    uint64 Lanes[4] = { Seed + Xxh64Prime1 + Xxh64Prime2, Seed + Xxh64Prime2, Seed, Seed - Xxh64Prime1 };
+    for(; Ptr + 32 <= End; Ptr += 32)
+    {
+      for(uint32 Lane = 0; Lane < 4; ++Lane)
+        Lanes[Lane] = Xxh64Round(Lanes[Lane], Read64(Ptr + 8 * Lane));
+    }
+
+    Hash = RotateLeft(Lanes[0], 1) + RotateLeft(Lanes[1], 7) + RotateLeft(Lanes[2], 12) + RotateLeft(Lanes[3], 18);
+    for(uint32 Lane = 0; Lane < 4; ++Lane)
+      Hash = Xxh64Merge(Hash, Lanes[Lane]);
+  }
+  else
+  {
+    Hash = Seed + Xxh64Prime5;
+  }
+
+  Hash += Data.Num;
+
+  for(; Ptr + 8 <= End; Ptr += 8)
+  {
+    Hash ^= Xxh64Round(0, Read64(Ptr));
+    Hash = RotateLeft(Hash, 27) * Xxh64Prime1 + Xxh64Prime4;
+  }
+
+  if(Ptr + 4 <= End)
+  {
+    Hash ^= uint64(Read32(Ptr)) * Xxh64Prime1;
+    Hash = RotateLeft(Hash, 23) * Xxh64Prime2 + Xxh64Prime3;
+    Ptr += 4;
+  }
+
+  for(; Ptr < End; ++Ptr)
+  {
+    Hash ^= *Ptr * Xxh64Prime5;
+    Hash = RotateLeft(Hash, 11) * Xxh64Prime1;
+  }
+
+  // Avalanche
+  Hash ^= Hash >> 33;
+  Hash *= Xxh64Prime2;
+  Hash ^= Hash >> 29;
+  Hash *= Xxh64Prime3;
+  Hash ^= Hash >> 32;
+  return Hash;
+}
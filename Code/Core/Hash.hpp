@@ -0,0 +1,14 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+
+#include <Backbone.hpp>
+
+
+/// \brief The 64 bit xxHash (XXH64) of \a Data.
+///
+/// Fast enough to hash whole files and stable across runs and platforms, so
+/// the result can be stored on disk. Not meant for security purposes.
+CORE_API
+uint64
+HashXxh64(slice<void const> Data, uint64 Seed = 0);
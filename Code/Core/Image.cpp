@@ -1,5 +1,6 @@
 #include "Image.hpp"
 
+#include "ImageConversion.hpp"
 #include "Log.hpp"
 #include "Color.hpp"
 
@@ -46,18 +47,44 @@ image::sub_image*
   return &Image.InternalSubImages[Index];
 }
 
+auto
+::ImageExternalStorageAddRef(image_external_storage* Storage)
+  -> void
+{
+  if(Storage)
+    RefCountAddRef(Storage->RefCount);
+}
+
+auto
+::ImageExternalStorageReleaseRef(image_external_storage* Storage)
+  -> void
+{
+  if(Storage && RefCountReleaseRef(Storage->RefCount))
+    Storage->Release(Storage);
+}
+
+static void
+ImageReleaseExternalData(image& Image)
+{
+  ImageExternalStorageReleaseRef(Image.ExternalStorage);
+  Image.ExternalStorage = nullptr;
+  Image.ExternalData = {};
+}
+
 auto
 ::Init(image& Image, allocator_interface& Allocator)
   -> void
 {
   Image.InternalSubImages.Allocator = &Allocator;
   Image.Data.Allocator = &Allocator;
+  Image.Data.Growth = container_growth::Exact;
 }
 
 auto
 ::Finalize(image& Image)
   -> void
 {
+  ImageReleaseExternalData(Image);
   Reset(Image.Data);
   Reset(Image.InternalSubImages);
 }
@@ -70,10 +97,23 @@ auto
   MemCopy<image_header>(1, &Target, &Source);
 
   Clear(Target.InternalSubImages);
-  Clear(Target.Data);
+  Reset(Target.Data);
+  ImageReleaseExternalData(Target);
 
   Target.InternalSubImages += Slice(Source.InternalSubImages);
-  Target.Data += Slice(Source.Data);
+
+  if(ImageIsBorrowed(Source))
+  {
+    // Borrow from the same memory instead of copying it.
+    ImageExternalStorageAddRef(Source.ExternalStorage);
+    Target.ExternalStorage = Source.ExternalStorage;
+    Target.ExternalData = Source.ExternalData;
+  }
+  else
+  {
+    // The data is only copied once one of the images writes to it.
+    Target.Data = Source.Data;
+  }
 }
 
 auto
@@ -106,14 +146,45 @@ auto
 ::ImageDataSize(image const& Image)
   -> uint32
 {
-  if(Image.Data.Num < 16)
+  if(ImageIsBorrowed(Image))
+    return Convert<uint32>(Image.ExternalData.Num);
+
+  auto const NumBytes = AsConst(Image).Data.Num();
+  if(NumBytes < 16)
     return 0;
-  return Convert<uint32>(Image.Data.Num - 16);
+  return Convert<uint32>(NumBytes - 16);
 }
 
 auto
-::ImageAllocateData(image& Image)
-  -> void
+::ImageIsBorrowed(image const& Image)
+  -> bool
+{
+  return Image.ExternalData.Ptr != nullptr;
+}
+
+auto
+::ImageData(image const& Image)
+  -> slice<uint8 const>
+{
+  if(ImageIsBorrowed(Image))
+    return Image.ExternalData;
+
+  return Slice(Image.Data);
+}
+
+auto
+::ImageData(image& Image)
+  -> slice<uint8>
+{
+  ImageEnsureUniqueData(Image);
+  return Slice(Image.Data);
+}
+
+/// Computes the sub-image offsets and pitches.
+///
+/// \return The number of bytes required for all sub-images.
+static uint32
+ImageComputeLayout(image& Image)
 {
   const auto NumSubImages = Image.NumMipLevels * Image.NumFaces * Image.NumArrayIndices;
   SetNum(Image.InternalSubImages, NumSubImages);
@@ -150,9 +221,61 @@ auto
     }
   }
 
+  return Convert<uint32>(DataSize);
+}
+
+auto
+::ImageAllocateData(image& Image)
+  -> void
+{
+  ImageReleaseExternalData(Image);
+
+  // Don't bother copying data that is about to be replaced.
+  if(!IsUnique(Image.Data))
+    Reset(Image.Data);
+
+  auto const DataSize = ImageComputeLayout(Image);
   SetNum(Image.Data, DataSize + 16);
 }
 
+auto
+::ImageBorrowData(image& Image, slice<void const> Memory, image_external_storage* Storage)
+  -> bool
+{
+  auto const DataSize = ImageComputeLayout(Image);
+  if(Memory.Num < DataSize)
+  {
+    LogError("Not enough memory to borrow for the image: %zu / %u bytes.", Memory.Num, DataSize);
+    return false;
+  }
+
+  // Take the reference first in case Storage is the one we're already borrowing from.
+  ImageExternalStorageAddRef(Storage);
+  ImageReleaseExternalData(Image);
+  Reset(Image.Data);
+
+  Image.ExternalStorage = Storage;
+  Image.ExternalData = Slice(SliceReinterpret<uint8 const>(Memory), 0, DataSize);
+  return true;
+}
+
+auto
+::ImageEnsureUniqueData(image& Image)
+  -> void
+{
+  if(!ImageIsBorrowed(Image))
+  {
+    EnsureUnique(Image.Data);
+    return;
+  }
+
+  auto const ExternalData = Image.ExternalData;
+  SetNum(Image.Data, ExternalData.Num + 16);
+  SliceCopy(Slice(Image.Data), ExternalData);
+
+  ImageReleaseExternalData(Image);
+}
+
 auto
 ::ImageRowPitch(image const& Image, uint32 MipLevel)
   -> uint32
@@ -180,53 +303,25 @@ auto
   return ImageInternalSubImage(Image, MipLevel, Face, ArrayIndex)->DataOffset;
 }
 
-static bool
-IsSupportedSolidColorFormat(image_format Format)
-{
-  switch(Format)
-  {
-    default:                               return false;
-    case image_format::R32G32B32A32_FLOAT: return true;
-  }
-}
-
-static void
-ColorToPixel(color_linear const& Color, image_format Format, slice<float> OutPixelData)
-{
-  BoundsCheck(OutPixelData.Num >= 4);
-
-  switch(Format)
-  {
-    default: SliceSet(OutPixelData, 0.0f); return;
-    case image_format::R32G32B32A32_FLOAT: SliceCopy(OutPixelData, AsConst(Slice(Color.Data))); return;
-  }
-}
-
 auto
 ::ImageSetAsSolidColor(image& Image, color_linear const& Color, image_format Format)
   -> bool
 {
-  if(!IsSupportedSolidColorFormat(Format))
+  if(!ImageFormatIsConvertible(Format))
   {
     LogError("Unsupported image format for use as solid color: %s", ImageFormatName(Format));
     return false;
   }
   Image.Format = Format;
 
-  fixed_block<4, float> Pixel;
-  ColorToPixel(Color, Format, Slice(Pixel));
-
   Image.Width  = 2;
   Image.Height = 2;
   ImageAllocateData(Image);
-  float* DestPtr = ImageDataPointer<float>(Image);
 
-  auto const NumPixels = Image.Width * Image.Height;
-  for(size_t PixelIndex = 0; PixelIndex < NumPixels; ++PixelIndex)
-  {
-    MemCopy<float>(4, DestPtr, &Pixel[0]);
-    DestPtr += 4;
-  }
+  float const Pixels[8] = { Color.Data[0], Color.Data[1], Color.Data[2], Color.Data[3],
+                            Color.Data[0], Color.Data[1], Color.Data[2], Color.Data[3] };
+  for(uint32 Y = 0; Y < Image.Height; ++Y)
+    ImageEncodeRow(Format, Pixels, Image.Width, ImagePixelPointer<uint8>(Image, 0, 0, 0, 0, Y, 0));
 
   return true;
 }
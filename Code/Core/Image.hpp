@@ -2,10 +2,35 @@
 
 #include "CoreAPI.hpp"
 #include "Array.hpp"
+#include "SharedArray.hpp"
 #include "ImageHeader.hpp"
+#include "Log.hpp"
+#include "RefCount.hpp"
 
 #include <Backbone.hpp>
 
+/// \brief Lifetime token for memory that images borrow instead of copying it.
+///
+/// Whoever provides the memory creates the token with a reference count of 1
+/// and releases that reference with ImageExternalStorageReleaseRef() once it is
+/// done. Every image borrowing the memory holds another reference, so the
+/// memory stays valid until the last of them lets go of it.
+struct image_external_storage
+{
+  ref_count RefCount;
+
+  /// Called when the last reference is released. Frees the memory and the token itself.
+  void (*Release)(image_external_storage* Storage);
+};
+
+CORE_API
+void
+ImageExternalStorageAddRef(image_external_storage* Storage);
+
+CORE_API
+void
+ImageExternalStorageReleaseRef(image_external_storage* Storage);
+
 /// \brief A class containing image data and associated meta data.
 ///
 /// This class is a lightweight container for image data and the description required for interpreting the data,
@@ -24,7 +49,14 @@ struct image : public image_header
   };
 
   array<sub_image> InternalSubImages;
-  array<uint8> Data;
+
+  /// Shared between copies of the image until one of them writes to it.
+  shared_array<uint8> Data;
+
+  /// If set, the image data is not stored in Data but borrowed from memory
+  /// the image doesn't own. \see ImageBorrowData()
+  slice<uint8 const> ExternalData{};
+  image_external_storage* ExternalStorage{};
 };
 
 CORE_API
@@ -51,6 +83,24 @@ CORE_API
 uint32
 ImageDataSize(image const& Image);
 
+/// \brief Whether the image data is borrowed from external memory.
+CORE_API
+bool
+ImageIsBorrowed(image const& Image);
+
+/// \brief Read-only access to the image data, regardless of where it is stored.
+CORE_API
+slice<uint8 const>
+ImageData(image const& Image);
+
+/// \brief Write access to the image data.
+///
+/// If the data is borrowed or shared with other images, it is copied into
+/// the image first.
+CORE_API
+slice<uint8>
+ImageData(image& Image);
+
 
 /// \brief Allocates the storage space required for the configured number of sub-images.
 ///
@@ -60,6 +110,29 @@ CORE_API
 void
 ImageAllocateData(image& Image);
 
+/// \brief Uses \a Memory as the image data instead of allocating storage for it.
+///
+/// Like ImageAllocateData(), call this after setting the dimensions and number
+/// of sub-images. The sub-image offsets are computed relative to the beginning
+/// of \a Memory, so the data must be laid out just like ImageAllocateData()
+/// would lay it out.
+///
+/// The image holds a reference to \a Storage until it is finalized or gets
+/// its own data. If \a Storage is \c nullptr, the caller must keep \a Memory
+/// alive for as long as the image uses it.
+///
+/// \return \c false if \a Memory is too small for the image.
+CORE_API
+bool
+ImageBorrowData(image& Image, slice<void const> Memory, image_external_storage* Storage);
+
+/// \brief Makes sure the image has its own copy of the data before writing to it.
+///
+/// Borrowed data and data that is shared with other images is copied.
+CORE_API
+void
+ImageEnsureUniqueData(image& Image);
+
 /// \brief Returns the offset in bytes between two subsequent rows of the given mip level.
 ///
 /// This function is only valid to use when the image format is a linear pixel format.
@@ -90,28 +163,30 @@ template<typename T>
 T const*
 ImageDataPointer(image const& Image)
 {
-  return Reinterpret<T const*>(&Image.Data[0]);
+  return Reinterpret<T const*>(ImageData(Image).Ptr);
 }
 
+/// \note Copies borrowed or shared data into the image. Use the const version for reading.
 template<typename T>
 T*
 ImageDataPointer(image& Image)
 {
-  return const_cast<T*>(ImageDataPointer<T>(*AsPtrToConst(&Image)));
+  return Reinterpret<T*>(ImageData(Image).Ptr);
 }
 
 template<typename T>
 T const*
 ImageSubImagePointer(image const& Image, uint32 MipLevel, uint32 Face, uint32 ArrayIndex)
 {
-  return Reinterpret<T const*>(&Image.Data[ImageInternalSubImage(MipLevel, Face, ArrayIndex)->DataOffset]);
+  return Reinterpret<T const*>(&ImageData(Image)[ImageInternalSubImage(Image, MipLevel, Face, ArrayIndex)->DataOffset]);
 }
 
 template<typename T>
 T*
 ImageSubImagePointer(image& Image, uint32 MipLevel, uint32 Face, uint32 ArrayIndex)
 {
-  return const_cast<T*>(ImageSubImagePointer<T>(AsPtrToConst(Image), MipLevel, Face, ArrayIndex));
+  ImageEnsureUniqueData(Image);
+  return const_cast<T*>(ImageSubImagePointer<T>(AsConst(Image), MipLevel, Face, ArrayIndex));
 }
 
 template<typename T>
@@ -124,7 +199,7 @@ ImagePixelPointer(image const& Image, uint32 MipLevel, uint32 Face, uint32 Array
     Assert(false);
   }
   BoundsCheck(X < Image.Width);
-  BoundsCheck(Y < Image.Heighth);
+  BoundsCheck(Y < Image.Height);
   BoundsCheck(Z < Image.Depth);
 
   uint8 const* Ptr = ImageSubImagePointer<uint8>(Image, MipLevel, Face, ArrayIndex);
@@ -140,7 +215,8 @@ template<typename T>
 T*
 ImagePixelPointer(image& Image, uint32 MipLevel, uint32 Face, uint32 ArrayIndex, uint32 X, uint32 Y, uint32 Z)
 {
-  return const_cast<T*>(ImagePixelPointer<T>(AsPtrToConst(Image), MipLevel, Face, ArrayIndex, X, Y, Z));
+  ImageEnsureUniqueData(Image);
+  return const_cast<T*>(ImagePixelPointer<T>(AsConst(Image), MipLevel, Face, ArrayIndex, X, Y, Z));
 }
 
 
@@ -170,7 +246,8 @@ template<typename T>
 T*
 ImageBlockPointer(image& Image, uint32 MipLevel, uint32 Face, uint32 ArrayIndex, uint32 BlockX, uint32 BlockY, uint32 Z)
 {
-  return const_cast<T*>(ImageBlockPointer<T>(AsPtrToConst(Image), MipLevel, Face, ArrayIndex, BlockX, BlockY, Z));
+  ImageEnsureUniqueData(Image);
+  return const_cast<T*>(ImageBlockPointer<T>(AsConst(Image), MipLevel, Face, ArrayIndex, BlockX, BlockY, Z));
 }
 
 //
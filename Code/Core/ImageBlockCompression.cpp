@@ -0,0 +1,1645 @@
+#include "ImageBlockCompression.hpp"
+#include "Parallel.hpp"
+
+#include "Log.hpp"
+
+// Whether to compile the SIMD code paths. SSE2 is always available on x64,
+// AVX2 is detected at runtime.
+#if !defined(IMAGE_BLOCK_COMPRESSION_SIMD)
+  #if defined(_M_X64) || defined(__x86_64__)
+    #define IMAGE_BLOCK_COMPRESSION_SIMD 1
+  #else
+    #define IMAGE_BLOCK_COMPRESSION_SIMD 0
+  #endif
+#endif
+
+// The number of rows of blocks that are encoded or decoded as one unit of work.
+#if !defined(IMAGE_BLOCK_ROWS_PER_JOB)
+  #define IMAGE_BLOCK_ROWS_PER_JOB 16
+#endif
+
+#if IMAGE_BLOCK_COMPRESSION_SIMD
+  #include <immintrin.h>
+
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+    #define TARGET_AVX2
+  #else
+    #define TARGET_AVX2 __attribute__((target("avx2")))
+  #endif
+#endif
+
+
+//
+// Block Layout
+//
+
+enum class bc_kind
+{
+  BC1, // Color only, with an optional 1-bit alpha.
+  BC2, // Explicit 4-bit alpha, followed by a BC1 color block.
+  BC3, // Interpolated alpha, followed by a BC1 color block.
+};
+
+template<bc_kind Kind> struct bc_layout;
+
+template<> struct bc_layout<bc_kind::BC1>
+{
+  static constexpr uint32 BlockSize = 8;
+  static constexpr uint32 ColorOffset = 0;
+
+  // Only standalone BC1 blocks support the 3-color mode. BC2 and BC3 always
+  // interpolate 4 colors.
+  static constexpr bool AllowThreeColorMode = true;
+};
+
+template<> struct bc_layout<bc_kind::BC2>
+{
+  static constexpr uint32 BlockSize = 16;
+  static constexpr uint32 ColorOffset = 8;
+  static constexpr bool AllowThreeColorMode = false;
+};
+
+template<> struct bc_layout<bc_kind::BC3>
+{
+  static constexpr uint32 BlockSize = 16;
+  static constexpr uint32 ColorOffset = 8;
+  static constexpr bool AllowThreeColorMode = false;
+};
+
+static uint32
+Load32(uint8 const* Ptr)
+{
+  uint32 Result;
+  MemCopyBytes(Bytes(4), &Result, Ptr);
+  return Result;
+}
+
+static uint64
+Load64(uint8 const* Ptr)
+{
+  uint64 Result;
+  MemCopyBytes(Bytes(8), &Result, Ptr);
+  return Result;
+}
+
+
+//
+// Scalar Reference
+//
+
+static uint32 Expand5(uint32 Value) { return (Value << 3) | (Value >> 2); }
+static uint32 Expand6(uint32 Value) { return (Value << 2) | (Value >> 4); }
+
+static uint32
+PackRGBA(uint32 R, uint32 G, uint32 B, uint32 A)
+{
+  return R | (G << 8) | (B << 16) | (A << 24);
+}
+
+/// \param Endpoints The two 565 colors of a color block, the first one in the lower 16 bits.
+static void
+ColorPaletteScalar(uint32 Endpoints, bool AllowThreeColorMode, uint32 (&Palette)[4])
+{
+  uint32 const C0 = Endpoints & 0xFFFF;
+  uint32 const C1 = Endpoints >> 16;
+
+  uint32 const R0 = Expand5(C0 >> 11);
+  uint32 const G0 = Expand6((C0 >> 5) & 63);
+  uint32 const B0 = Expand5(C0 & 31);
+
+  uint32 const R1 = Expand5(C1 >> 11);
+  uint32 const G1 = Expand6((C1 >> 5) & 63);
+  uint32 const B1 = Expand5(C1 & 31);
+
+  Palette[0] = PackRGBA(R0, G0, B0, 255);
+  Palette[1] = PackRGBA(R1, G1, B1, 255);
+
+  if(C0 > C1 || !AllowThreeColorMode)
+  {
+    Palette[2] = PackRGBA((2 * R0 + R1 + 1) / 3, (2 * G0 + G1 + 1) / 3, (2 * B0 + B1 + 1) / 3, 255);
+    Palette[3] = PackRGBA((R0 + 2 * R1 + 1) / 3, (G0 + 2 * G1 + 1) / 3, (B0 + 2 * B1 + 1) / 3, 255);
+  }
+  else
+  {
+    Palette[2] = PackRGBA((R0 + R1 + 1) / 2, (G0 + G1 + 1) / 2, (B0 + B1 + 1) / 2, 255);
+    Palette[3] = 0; // Transparent black.
+  }
+}
+
+static void
+AlphaPaletteScalar(uint32 A0, uint32 A1, uint32 (&Palette)[8])
+{
+  Palette[0] = A0;
+  Palette[1] = A1;
+
+  if(A0 > A1)
+  {
+    for(uint32 Index = 1; Index < 7; ++Index)
+      Palette[Index + 1] = ((7 - Index) * A0 + Index * A1 + 3) / 7;
+  }
+  else
+  {
+    for(uint32 Index = 1; Index < 5; ++Index)
+      Palette[Index + 1] = ((5 - Index) * A0 + Index * A1 + 2) / 5;
+    Palette[6] = 0;
+    Palette[7] = 255;
+  }
+}
+
+/// Computes the alpha of all 16 pixels of a block, already shifted into the alpha byte.
+template<bc_kind Kind>
+static void
+BlockAlphaScalar(uint8 const* Block, uint32 (&Alpha)[16])
+{
+  if(Kind == bc_kind::BC2)
+  {
+    uint64 const Bits = Load64(Block);
+    for(uint32 Index = 0; Index < 16; ++Index)
+      Alpha[Index] = uint32((Bits >> (4 * Index)) & 15) * 17 << 24;
+  }
+  else if(Kind == bc_kind::BC3)
+  {
+    uint32 Palette[8];
+    AlphaPaletteScalar(Block[0], Block[1], Palette);
+
+    uint64 const Bits = Load64(Block) >> 16;
+    for(uint32 Index = 0; Index < 16; ++Index)
+      Alpha[Index] = Palette[(Bits >> (3 * Index)) & 7] << 24;
+  }
+}
+
+template<bc_kind Kind>
+static void
+DecodeBlockScalar(uint8 const* Block, uint32* Pixels, size_t Pitch)
+{
+  using layout = bc_layout<Kind>;
+
+  uint32 Palette[4];
+  ColorPaletteScalar(Load32(Block + layout::ColorOffset), layout::AllowThreeColorMode, Palette);
+  uint32 const Indices = Load32(Block + layout::ColorOffset + 4);
+
+  uint32 Alpha[16];
+  BlockAlphaScalar<Kind>(Block, Alpha);
+
+  for(uint32 Y = 0; Y < 4; ++Y)
+  {
+    for(uint32 X = 0; X < 4; ++X)
+    {
+      uint32 const Index = 4 * Y + X;
+      uint32 Pixel = Palette[(Indices >> (2 * Index)) & 3];
+      if(Kind != bc_kind::BC1)
+        Pixel = (Pixel & 0x00FFFFFF) | Alpha[Index];
+      Pixels[Y * Pitch + X] = Pixel;
+    }
+  }
+}
+
+/// Decodes a row of blocks into 4 rows of pixels, \a Pitch pixels apart.
+using decode_block_row = void (*)(uint8 const* Blocks, uint32 NumBlocks, uint32* Pixels, size_t Pitch);
+
+template<bc_kind Kind>
+static void
+DecodeBlockRowScalar(uint8 const* Blocks, uint32 NumBlocks, uint32* Pixels, size_t Pitch)
+{
+  for(uint32 BlockIndex = 0; BlockIndex < NumBlocks; ++BlockIndex)
+    DecodeBlockScalar<Kind>(Blocks + BlockIndex * bc_layout<Kind>::BlockSize, Pixels + 4 * BlockIndex, Pitch);
+}
+
+
+#if IMAGE_BLOCK_COMPRESSION_SIMD
+
+//
+// SSE2
+//
+
+static __m128i
+Select(__m128i Mask, __m128i A, __m128i B)
+{
+  return _mm_or_si128(_mm_and_si128(Mask, A), _mm_andnot_si128(Mask, B));
+}
+
+/// Divides 32-bit lanes holding values below 2^16 by 3.
+static __m128i
+Div3(__m128i Value)
+{
+  return _mm_srli_epi32(_mm_mulhi_epu16(Value, _mm_set1_epi32(0xAAAB)), 1);
+}
+
+static __m128i Expand5(__m128i Value) { return _mm_or_si128(_mm_slli_epi32(Value, 3), _mm_srli_epi32(Value, 2)); }
+static __m128i Expand6(__m128i Value) { return _mm_or_si128(_mm_slli_epi32(Value, 2), _mm_srli_epi32(Value, 4)); }
+
+static __m128i
+PackRGB(__m128i R, __m128i G, __m128i B)
+{
+  auto const Alpha = _mm_set1_epi32(int(0xFF000000));
+  return _mm_or_si128(_mm_or_si128(R, _mm_slli_epi32(G, 8)), _mm_or_si128(_mm_slli_epi32(B, 16), Alpha));
+}
+
+/// Computes the color palettes of 4 blocks at once, one block per lane.
+static void
+ColorPalettesSSE2(__m128i Endpoints, bool AllowThreeColorMode, __m128i (&Palette)[4])
+{
+  auto const C0 = _mm_and_si128(Endpoints, _mm_set1_epi32(0xFFFF));
+  auto const C1 = _mm_srli_epi32(Endpoints, 16);
+  auto const Mask5 = _mm_set1_epi32(31);
+  auto const Mask6 = _mm_set1_epi32(63);
+  auto const One = _mm_set1_epi32(1);
+
+  auto const R0 = Expand5(_mm_srli_epi32(C0, 11));
+  auto const G0 = Expand6(_mm_and_si128(_mm_srli_epi32(C0, 5), Mask6));
+  auto const B0 = Expand5(_mm_and_si128(C0, Mask5));
+
+  auto const R1 = Expand5(_mm_srli_epi32(C1, 11));
+  auto const G1 = Expand6(_mm_and_si128(_mm_srli_epi32(C1, 5), Mask6));
+  auto const B1 = Expand5(_mm_and_si128(C1, Mask5));
+
+  Palette[0] = PackRGB(R0, G0, B0);
+  Palette[1] = PackRGB(R1, G1, B1);
+
+  // (2 * A + B + 1) / 3
+  #define THIRD(A, B) Div3(_mm_add_epi32(_mm_add_epi32(_mm_add_epi32(A, A), B), One))
+  Palette[2] = PackRGB(THIRD(R0, R1), THIRD(G0, G1), THIRD(B0, B1));
+  Palette[3] = PackRGB(THIRD(R1, R0), THIRD(G1, G0), THIRD(B1, B0));
+  #undef THIRD
+
+  if(AllowThreeColorMode)
+  {
+    #define HALF(A, B) _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(A, B), One), 1)
+    auto const Half = PackRGB(HALF(R0, R1), HALF(G0, G1), HALF(B0, B1));
+    #undef HALF
+
+    auto const IsFourColorMode = _mm_cmpgt_epi32(C0, C1);
+    Palette[2] = Select(IsFourColorMode, Palette[2], Half);
+    Palette[3] = _mm_and_si128(IsFourColorMode, Palette[3]);
+  }
+}
+
+/// Expands the 4-bit alpha values of a BC2 block into the alpha byte of each pixel, one row per vector.
+static void
+ExplicitAlphaSSE2(uint8 const* Block, __m128i (&Alpha)[4])
+{
+  auto const Zero = _mm_setzero_si128();
+  auto const LowNibbles = _mm_set1_epi8(0x0F);
+
+  auto const Packed = _mm_loadl_epi64(Reinterpret<__m128i const*>(Block));
+  auto const Even = _mm_and_si128(Packed, LowNibbles);
+  auto const Odd = _mm_and_si128(_mm_srli_epi16(Packed, 4), LowNibbles);
+
+  // All 16 values in pixel order, multiplied by 17 to fill the whole byte.
+  auto Values = _mm_unpacklo_epi8(Even, Odd);
+  Values = _mm_or_si128(Values, _mm_slli_epi16(Values, 4));
+
+  auto const Lower = _mm_unpacklo_epi8(Zero, Values);
+  auto const Upper = _mm_unpackhi_epi8(Zero, Values);
+  Alpha[0] = _mm_unpacklo_epi16(Zero, Lower);
+  Alpha[1] = _mm_unpackhi_epi16(Zero, Lower);
+  Alpha[2] = _mm_unpacklo_epi16(Zero, Upper);
+  Alpha[3] = _mm_unpackhi_epi16(Zero, Upper);
+}
+
+template<bc_kind Kind>
+static void
+DecodeBlockRowSSE2(uint8 const* Blocks, uint32 NumBlocks, uint32* Pixels, size_t Pitch)
+{
+  using layout = bc_layout<Kind>;
+  uint32 const Lanes = 4;
+
+  // Lane N picks the lower or upper bit of the index of pixel N in a row.
+  auto const LowerBits = _mm_setr_epi32(1, 4, 16, 64);
+  auto const UpperBits = _mm_setr_epi32(2, 8, 32, 128);
+  auto const ColorMask = _mm_set1_epi32(0x00FFFFFF);
+
+  for(uint32 First = 0; First < NumBlocks; First += Lanes)
+  {
+    uint32 const NumInChunk = Min(NumBlocks - First, Lanes);
+    uint8 const* Chunk = Blocks + First * layout::BlockSize;
+
+    alignas(16) uint32 Endpoints[Lanes]{};
+    for(uint32 Lane = 0; Lane < NumInChunk; ++Lane)
+      Endpoints[Lane] = Load32(Chunk + Lane * layout::BlockSize + layout::ColorOffset);
+
+    __m128i Palettes[4];
+    ColorPalettesSSE2(_mm_load_si128(Reinterpret<__m128i const*>(Endpoints)), layout::AllowThreeColorMode, Palettes);
+
+    alignas(16) uint32 Palette[4][Lanes];
+    for(uint32 Entry = 0; Entry < 4; ++Entry)
+      _mm_store_si128(Reinterpret<__m128i*>(Palette[Entry]), Palettes[Entry]);
+
+    for(uint32 Lane = 0; Lane < NumInChunk; ++Lane)
+    {
+      uint8 const* Block = Chunk + Lane * layout::BlockSize;
+      uint32 const Indices = Load32(Block + layout::ColorOffset + 4);
+
+      auto const P0 = _mm_set1_epi32(int(Palette[0][Lane]));
+      auto const P1 = _mm_set1_epi32(int(Palette[1][Lane]));
+      auto const P2 = _mm_set1_epi32(int(Palette[2][Lane]));
+      auto const P3 = _mm_set1_epi32(int(Palette[3][Lane]));
+
+      __m128i Alpha[4];
+      if(Kind == bc_kind::BC2)
+      {
+        ExplicitAlphaSSE2(Block, Alpha);
+      }
+      else if(Kind == bc_kind::BC3)
+      {
+        // Selecting from 8 values isn't worth it without variable shifts and permutes.
+        alignas(16) uint32 ScalarAlpha[16];
+        BlockAlphaScalar<Kind>(Block, ScalarAlpha);
+        for(uint32 Y = 0; Y < 4; ++Y)
+          Alpha[Y] = _mm_load_si128(Reinterpret<__m128i const*>(&ScalarAlpha[4 * Y]));
+      }
+
+      uint32* Target = Pixels + 4 * (First + Lane);
+      for(uint32 Y = 0; Y < 4; ++Y)
+      {
+        auto const Bits = _mm_set1_epi32(int((Indices >> (8 * Y)) & 0xFF));
+        auto const Lower = _mm_cmpeq_epi32(_mm_and_si128(Bits, LowerBits), LowerBits);
+        auto const Upper = _mm_cmpeq_epi32(_mm_and_si128(Bits, UpperBits), UpperBits);
+
+        auto Row = Select(Upper, Select(Lower, P3, P2), Select(Lower, P1, P0));
+        if(Kind != bc_kind::BC1)
+          Row = _mm_or_si128(_mm_and_si128(Row, ColorMask), Alpha[Y]);
+
+        _mm_storeu_si128(Reinterpret<__m128i*>(Target + Y * Pitch), Row);
+      }
+    }
+  }
+}
+
+
+//
+// AVX2
+//
+
+TARGET_AVX2 static __m256i
+Select(__m256i Mask, __m256i A, __m256i B)
+{
+  return _mm256_blendv_epi8(B, A, Mask);
+}
+
+TARGET_AVX2 static __m256i
+Div3(__m256i Value)
+{
+  return _mm256_srli_epi32(_mm256_mulhi_epu16(Value, _mm256_set1_epi32(0xAAAB)), 1);
+}
+
+TARGET_AVX2 static __m256i Expand5(__m256i Value) { return _mm256_or_si256(_mm256_slli_epi32(Value, 3), _mm256_srli_epi32(Value, 2)); }
+TARGET_AVX2 static __m256i Expand6(__m256i Value) { return _mm256_or_si256(_mm256_slli_epi32(Value, 2), _mm256_srli_epi32(Value, 4)); }
+
+TARGET_AVX2 static __m256i
+PackRGB(__m256i R, __m256i G, __m256i B)
+{
+  auto const Alpha = _mm256_set1_epi32(int(0xFF000000));
+  return _mm256_or_si256(_mm256_or_si256(R, _mm256_slli_epi32(G, 8)), _mm256_or_si256(_mm256_slli_epi32(B, 16), Alpha));
+}
+
+/// Computes the color palettes of 8 blocks at once, one block per lane.
+TARGET_AVX2 static void
+ColorPalettesAVX2(__m256i Endpoints, bool AllowThreeColorMode, __m256i (&Palette)[4])
+{
+  auto const C0 = _mm256_and_si256(Endpoints, _mm256_set1_epi32(0xFFFF));
+  auto const C1 = _mm256_srli_epi32(Endpoints, 16);
+  auto const Mask5 = _mm256_set1_epi32(31);
+  auto const Mask6 = _mm256_set1_epi32(63);
+  auto const One = _mm256_set1_epi32(1);
+
+  auto const R0 = Expand5(_mm256_srli_epi32(C0, 11));
+  auto const G0 = Expand6(_mm256_and_si256(_mm256_srli_epi32(C0, 5), Mask6));
+  auto const B0 = Expand5(_mm256_and_si256(C0, Mask5));
+
+  auto const R1 = Expand5(_mm256_srli_epi32(C1, 11));
+  auto const G1 = Expand6(_mm256_and_si256(_mm256_srli_epi32(C1, 5), Mask6));
+  auto const B1 = Expand5(_mm256_and_si256(C1, Mask5));
+
+  Palette[0] = PackRGB(R0, G0, B0);
+  Palette[1] = PackRGB(R1, G1, B1);
+
+  #define THIRD(A, B) Div3(_mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(A, A), B), One))
+  Palette[2] = PackRGB(THIRD(R0, R1), THIRD(G0, G1), THIRD(B0, B1));
+  Palette[3] = PackRGB(THIRD(R1, R0), THIRD(G1, G0), THIRD(B1, B0));
+  #undef THIRD
+
+  if(AllowThreeColorMode)
+  {
+    #define HALF(A, B) _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(A, B), One), 1)
+    auto const Half = PackRGB(HALF(R0, R1), HALF(G0, G1), HALF(B0, B1));
+    #undef HALF
+
+    auto const IsFourColorMode = _mm256_cmpgt_epi32(C0, C1);
+    Palette[2] = Select(IsFourColorMode, Palette[2], Half);
+    Palette[3] = _mm256_and_si256(IsFourColorMode, Palette[3]);
+  }
+}
+
+/// Computes the alpha of a BC3 block, two rows per vector.
+TARGET_AVX2 static void
+InterpolatedAlphaAVX2(uint8 const* Block, __m256i (&Alpha)[2])
+{
+  auto const A0 = _mm256_set1_epi32(Block[0]);
+  auto const A1 = _mm256_set1_epi32(Block[1]);
+
+  // Same as AlphaPaletteScalar(), using multiplications instead of the divisions.
+  __m256i Palette;
+  if(Block[0] > Block[1])
+  {
+    auto const W0 = _mm256_setr_epi32(7, 0, 6, 5, 4, 3, 2, 1);
+    auto const W1 = _mm256_setr_epi32(0, 7, 1, 2, 3, 4, 5, 6);
+    auto const Sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(W0, A0), _mm256_mullo_epi32(W1, A1)), _mm256_set1_epi32(3));
+    Palette = _mm256_srli_epi32(_mm256_mullo_epi32(Sum, _mm256_set1_epi32(9363)), 16);
+  }
+  else
+  {
+    auto const W0 = _mm256_setr_epi32(5, 0, 4, 3, 2, 1, 0, 0);
+    auto const W1 = _mm256_setr_epi32(0, 5, 1, 2, 3, 4, 0, 0);
+    auto const Sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(W0, A0), _mm256_mullo_epi32(W1, A1)), _mm256_set1_epi32(2));
+    Palette = _mm256_srli_epi32(_mm256_mullo_epi32(Sum, _mm256_set1_epi32(13108)), 16);
+    Palette = _mm256_or_si256(Palette, _mm256_setr_epi32(0, 0, 0, 0, 0, 0, 0, 255));
+  }
+  Palette = _mm256_slli_epi32(Palette, 24);
+
+  uint64 const Bits = Load64(Block) >> 16;
+  auto const Shifts = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+  auto const IndexMask = _mm256_set1_epi32(7);
+  auto const Lower = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(int(Bits & 0xFFFFFF)), Shifts), IndexMask);
+  auto const Upper = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(int(Bits >> 24)), Shifts), IndexMask);
+
+  Alpha[0] = _mm256_permutevar8x32_epi32(Palette, Lower);
+  Alpha[1] = _mm256_permutevar8x32_epi32(Palette, Upper);
+}
+
+TARGET_AVX2 static __m256i
+Combine(__m128i Lower, __m128i Upper)
+{
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(Lower), Upper, 1);
+}
+
+template<bc_kind Kind>
+TARGET_AVX2 static void
+DecodeBlockRowAVX2(uint8 const* Blocks, uint32 NumBlocks, uint32* Pixels, size_t Pitch)
+{
+  using layout = bc_layout<Kind>;
+  uint32 const Lanes = 8;
+
+  auto const Shifts = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+  auto const IndexMask = _mm256_set1_epi32(3);
+  auto const ColorMask = _mm256_set1_epi32(0x00FFFFFF);
+
+  for(uint32 First = 0; First < NumBlocks; First += Lanes)
+  {
+    uint32 const NumInChunk = Min(NumBlocks - First, Lanes);
+    uint8 const* Chunk = Blocks + First * layout::BlockSize;
+
+    alignas(32) uint32 Endpoints[Lanes]{};
+    for(uint32 Lane = 0; Lane < NumInChunk; ++Lane)
+      Endpoints[Lane] = Load32(Chunk + Lane * layout::BlockSize + layout::ColorOffset);
+
+    __m256i Palettes[4];
+    ColorPalettesAVX2(_mm256_load_si256(Reinterpret<__m256i const*>(Endpoints)), layout::AllowThreeColorMode, Palettes);
+
+    alignas(32) uint32 Palette[4][Lanes];
+    for(uint32 Entry = 0; Entry < 4; ++Entry)
+      _mm256_store_si256(Reinterpret<__m256i*>(Palette[Entry]), Palettes[Entry]);
+
+    for(uint32 Lane = 0; Lane < NumInChunk; ++Lane)
+    {
+      uint8 const* Block = Chunk + Lane * layout::BlockSize;
+      uint32 const Indices = Load32(Block + layout::ColorOffset + 4);
+
+      auto const BlockPalette = _mm256_broadcastsi128_si256(_mm_setr_epi32(int(Palette[0][Lane]), int(Palette[1][Lane]),
+                                                                           int(Palette[2][Lane]), int(Palette[3][Lane])));
+
+      // Two rows of pixels per vector.
+      __m256i Rows[2];
+      Rows[0] = _mm256_permutevar8x32_epi32(BlockPalette, _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(int(Indices & 0xFFFF)), Shifts), IndexMask));
+      Rows[1] = _mm256_permutevar8x32_epi32(BlockPalette, _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(int(Indices >> 16)), Shifts), IndexMask));
+
+      if(Kind != bc_kind::BC1)
+      {
+        __m256i Alpha[2];
+        if(Kind == bc_kind::BC2)
+        {
+          __m128i ExplicitAlpha[4];
+          ExplicitAlphaSSE2(Block, ExplicitAlpha);
+          Alpha[0] = Combine(ExplicitAlpha[0], ExplicitAlpha[1]);
+          Alpha[1] = Combine(ExplicitAlpha[2], ExplicitAlpha[3]);
+        }
+        else
+        {
+          InterpolatedAlphaAVX2(Block, Alpha);
+        }
+
+        Rows[0] = _mm256_or_si256(_mm256_and_si256(Rows[0], ColorMask), Alpha[0]);
+        Rows[1] = _mm256_or_si256(_mm256_and_si256(Rows[1], ColorMask), Alpha[1]);
+      }
+
+      uint32* Target = Pixels + 4 * (First + Lane);
+      _mm_storeu_si128(Reinterpret<__m128i*>(Target + 0 * Pitch), _mm256_castsi256_si128(Rows[0]));
+      _mm_storeu_si128(Reinterpret<__m128i*>(Target + 1 * Pitch), _mm256_extracti128_si256(Rows[0], 1));
+      _mm_storeu_si128(Reinterpret<__m128i*>(Target + 2 * Pitch), _mm256_castsi256_si128(Rows[1]));
+      _mm_storeu_si128(Reinterpret<__m128i*>(Target + 3 * Pitch), _mm256_extracti128_si256(Rows[1], 1));
+    }
+  }
+}
+
+static bool
+CpuSupportsAVX2()
+{
+  #if defined(_MSC_VER)
+    int Info[4];
+    __cpuid(Info, 0);
+    if(Info[0] < 7)
+      return false;
+
+    // The OS must save the YMM registers as well.
+    __cpuid(Info, 1);
+    bool const HasOSXSAVE = (Info[2] & (1 << 27)) != 0;
+    bool const HasAVX = (Info[2] & (1 << 28)) != 0;
+    if(!HasOSXSAVE || !HasAVX || (_xgetbv(0) & 6) != 6)
+      return false;
+
+    __cpuidex(Info, 7, 0);
+    return (Info[1] & (1 << 5)) != 0;
+  #else
+    return __builtin_cpu_supports("avx2");
+  #endif
+}
+
+#endif // IMAGE_BLOCK_COMPRESSION_SIMD
+
+
+//
+// Encoding
+//
+
+namespace
+{
+  /// The pixels of a block, one array per channel (R, G, B, A) with values in [0, 255].
+  struct block_pixels
+  {
+    alignas(16) float Channel[4][16];
+  };
+
+  /// Up to 16 colors to choose from, as (R, G, B, A) in [0, 255].
+  struct block_palette
+  {
+    float Entry[16][4];
+    uint32 Num;
+  };
+}
+
+static void
+UnpackBlockPixels(uint32 const* Pixels, block_pixels& Block)
+{
+  for(uint32 Index = 0; Index < 16; ++Index)
+  {
+    for(uint32 Channel = 0; Channel < 4; ++Channel)
+      Block.Channel[Channel][Index] = float((Pixels[Index] >> (8 * Channel)) & 0xFF);
+  }
+}
+
+/// \brief Picks the closest palette entry for every pixel.
+///
+/// \param ChannelWeights How much each channel contributes to the error.
+/// \param PixelWeights How much each pixel contributes to the returned error.
+///
+/// \return The weighted sum of the squared errors of all pixels.
+static float
+SelectIndices(block_pixels const& Block, block_palette const& Palette,
+              float const (&ChannelWeights)[4], float const (&PixelWeights)[16],
+              uint8 (&Indices)[16])
+{
+  float TotalError = 0;
+
+  #if IMAGE_BLOCK_COMPRESSION_SIMD
+    // 4 pixels at a time.
+    for(uint32 First = 0; First < 16; First += 4)
+    {
+      __m128 Pixels[4];
+      for(uint32 Channel = 0; Channel < 4; ++Channel)
+        Pixels[Channel] = _mm_load_ps(&Block.Channel[Channel][First]);
+
+      auto BestError = _mm_set1_ps(3.0e38f);
+      auto BestIndex = _mm_setzero_si128();
+      for(uint32 EntryIndex = 0; EntryIndex < Palette.Num; ++EntryIndex)
+      {
+        auto Error = _mm_setzero_ps();
+        for(uint32 Channel = 0; Channel < 4; ++Channel)
+        {
+          auto const Difference = _mm_sub_ps(Pixels[Channel], _mm_set1_ps(Palette.Entry[EntryIndex][Channel]));
+          Error = _mm_add_ps(Error, _mm_mul_ps(_mm_mul_ps(Difference, Difference), _mm_set1_ps(ChannelWeights[Channel])));
+        }
+
+        auto const IsBetter = _mm_castps_si128(_mm_cmplt_ps(Error, BestError));
+        BestError = _mm_min_ps(Error, BestError);
+        BestIndex = Select(IsBetter, _mm_set1_epi32(int(EntryIndex)), BestIndex);
+      }
+
+      alignas(16) float Errors[4];
+      alignas(16) uint32 Best[4];
+      _mm_store_ps(Errors, _mm_mul_ps(BestError, _mm_loadu_ps(&PixelWeights[First])));
+      _mm_store_si128(Reinterpret<__m128i*>(Best), BestIndex);
+
+      for(uint32 Lane = 0; Lane < 4; ++Lane)
+      {
+        Indices[First + Lane] = uint8(Best[Lane]);
+        TotalError += Errors[Lane];
+      }
+    }
+  #else
+    for(uint32 PixelIndex = 0; PixelIndex < 16; ++PixelIndex)
+    {
+      float BestError = 3.0e38f;
+      uint32 BestIndex = 0;
+      for(uint32 EntryIndex = 0; EntryIndex < Palette.Num; ++EntryIndex)
+      {
+        float Error = 0;
+        for(uint32 Channel = 0; Channel < 4; ++Channel)
+        {
+          float const Difference = Block.Channel[Channel][PixelIndex] - Palette.Entry[EntryIndex][Channel];
+          Error += Difference * Difference * ChannelWeights[Channel];
+        }
+
+        if(Error < BestError)
+        {
+          BestError = Error;
+          BestIndex = EntryIndex;
+        }
+      }
+
+      Indices[PixelIndex] = uint8(BestIndex);
+      TotalError += BestError * PixelWeights[PixelIndex];
+    }
+  #endif
+
+  return TotalError;
+}
+
+/// \brief Finds two endpoints spanning the colors of a block.
+///
+/// Fast quality uses the corners of the bounding box, High quality the
+/// extent of the colors along their principal axis.
+static void
+FindEndpoints(block_pixels const& Block, uint32 NumChannels, float const (&PixelWeights)[16],
+              block_encoder_quality Quality, float (&Endpoint0)[4], float (&Endpoint1)[4])
+{
+  float Mean[4]{};
+  float Minimum[4] = { 255, 255, 255, 255 };
+  float Maximum[4]{};
+  float WeightSum = 0;
+
+  for(uint32 Index = 0; Index < 16; ++Index)
+  {
+    if(PixelWeights[Index] == 0)
+      continue;
+
+    WeightSum += 1;
+    for(uint32 Channel = 0; Channel < NumChannels; ++Channel)
+    {
+      float const Value = Block.Channel[Channel][Index];
+      Mean[Channel] += Value;
+      Minimum[Channel] = Min(Minimum[Channel], Value);
+      Maximum[Channel] = Max(Maximum[Channel], Value);
+    }
+  }
+
+  for(uint32 Channel = 0; Channel < 4; ++Channel)
+  {
+    Endpoint0[Channel] = 0;
+    Endpoint1[Channel] = 0;
+  }
+
+  if(WeightSum == 0)
+    return;
+
+  for(uint32 Channel = 0; Channel < NumChannels; ++Channel)
+    Mean[Channel] /= WeightSum;
+
+  float Covariance[4][4]{};
+  for(uint32 Index = 0; Index < 16; ++Index)
+  {
+    if(PixelWeights[Index] == 0)
+      continue;
+
+    for(uint32 Row = 0; Row < NumChannels; ++Row)
+    {
+      for(uint32 Column = 0; Column < NumChannels; ++Column)
+        Covariance[Row][Column] += (Block.Channel[Row][Index] - Mean[Row]) * (Block.Channel[Column][Index] - Mean[Column]);
+    }
+  }
+
+  if(Quality == block_encoder_quality::Fast)
+  {
+    // Use the diagonal of the bounding box that correlates with the channel
+    // spanning the largest range, inset a little to reduce the error at the
+    // extremes.
+    uint32 Major = 0;
+    for(uint32 Channel = 1; Channel < NumChannels; ++Channel)
+    {
+      if(Maximum[Channel] - Minimum[Channel] > Maximum[Major] - Minimum[Major])
+        Major = Channel;
+    }
+
+    for(uint32 Channel = 0; Channel < NumChannels; ++Channel)
+    {
+      float const Inset = (Maximum[Channel] - Minimum[Channel]) / 16.0f;
+      float Low = Minimum[Channel] + Inset;
+      float High = Maximum[Channel] - Inset;
+      if(Covariance[Major][Channel] < 0)
+        Swap(Low, High);
+
+      Endpoint0[Channel] = High;
+      Endpoint1[Channel] = Low;
+    }
+    return;
+  }
+
+  // Power iteration, starting from the diagonal of the bounding box.
+  float Axis[4]{};
+  for(uint32 Channel = 0; Channel < NumChannels; ++Channel)
+    Axis[Channel] = Maximum[Channel] - Minimum[Channel];
+
+  for(uint32 Iteration = 0; Iteration < 8; ++Iteration)
+  {
+    float Next[4]{};
+    float Length = 0;
+    for(uint32 Row = 0; Row < NumChannels; ++Row)
+    {
+      for(uint32 Column = 0; Column < NumChannels; ++Column)
+        Next[Row] += Covariance[Row][Column] * Axis[Column];
+      Length = Max(Length, Abs(Next[Row]));
+    }
+
+    // All pixels have the same color.
+    if(Length == 0)
+      break;
+
+    for(uint32 Channel = 0; Channel < NumChannels; ++Channel)
+      Axis[Channel] = Next[Channel] / Length;
+  }
+
+  float AxisLengthSquared = 0;
+  for(uint32 Channel = 0; Channel < NumChannels; ++Channel)
+    AxisLengthSquared += Axis[Channel] * Axis[Channel];
+
+  float MinProjection = 0;
+  float MaxProjection = 0;
+  if(AxisLengthSquared > 0)
+  {
+    MinProjection = 3.0e38f;
+    MaxProjection = -3.0e38f;
+    for(uint32 Index = 0; Index < 16; ++Index)
+    {
+      if(PixelWeights[Index] == 0)
+        continue;
+
+      float Projection = 0;
+      for(uint32 Channel = 0; Channel < NumChannels; ++Channel)
+        Projection += (Block.Channel[Channel][Index] - Mean[Channel]) * Axis[Channel];
+      Projection /= AxisLengthSquared;
+
+      MinProjection = Min(MinProjection, Projection);
+      MaxProjection = Max(MaxProjection, Projection);
+    }
+  }
+
+  for(uint32 Channel = 0; Channel < NumChannels; ++Channel)
+  {
+    Endpoint0[Channel] = Clamp(Mean[Channel] + Axis[Channel] * MaxProjection, 0.0f, 255.0f);
+    Endpoint1[Channel] = Clamp(Mean[Channel] + Axis[Channel] * MinProjection, 0.0f, 255.0f);
+  }
+}
+
+/// \brief Solves for the endpoints that best reproduce the pixels with the given interpolation weights.
+///
+/// \param Weights Per pixel, how far its color lies between Endpoint0 (0) and Endpoint1 (1).
+///
+/// \return \c false if the system is degenerate, e.g. because all pixels use the same weight.
+static bool
+RefineEndpoints(block_pixels const& Block, uint32 NumChannels, float const (&PixelWeights)[16],
+                float const (&Weights)[16], float (&Endpoint0)[4], float (&Endpoint1)[4])
+{
+  float A = 0;
+  float B = 0;
+  float C = 0;
+  float D0[4]{};
+  float D1[4]{};
+
+  for(uint32 Index = 0; Index < 16; ++Index)
+  {
+    if(PixelWeights[Index] == 0)
+      continue;
+
+    float const T = Weights[Index];
+    A += (1 - T) * (1 - T);
+    B += (1 - T) * T;
+    C += T * T;
+    for(uint32 Channel = 0; Channel < NumChannels; ++Channel)
+    {
+      D0[Channel] += (1 - T) * Block.Channel[Channel][Index];
+      D1[Channel] += T * Block.Channel[Channel][Index];
+    }
+  }
+
+  float const Determinant = A * C - B * B;
+  if(Abs(Determinant) < 1e-6f)
+    return false;
+
+  for(uint32 Channel = 0; Channel < NumChannels; ++Channel)
+  {
+    Endpoint0[Channel] = Clamp((C * D0[Channel] - B * D1[Channel]) / Determinant, 0.0f, 255.0f);
+    Endpoint1[Channel] = Clamp((A * D1[Channel] - B * D0[Channel]) / Determinant, 0.0f, 255.0f);
+  }
+
+  return true;
+}
+
+static uint32
+QuantizeTo565(float const (&Color)[4])
+{
+  uint32 const R = uint32(Color[0] * 31.0f / 255.0f + 0.5f);
+  uint32 const G = uint32(Color[1] * 63.0f / 255.0f + 0.5f);
+  uint32 const B = uint32(Color[2] * 31.0f / 255.0f + 0.5f);
+  return (R << 11) | (G << 5) | B;
+}
+
+static void
+UnpackPalette(uint32 const* Colors, uint32 Num, block_palette& Palette)
+{
+  Palette.Num = Num;
+  for(uint32 EntryIndex = 0; EntryIndex < Num; ++EntryIndex)
+  {
+    for(uint32 Channel = 0; Channel < 4; ++Channel)
+      Palette.Entry[EntryIndex][Channel] = float((Colors[EntryIndex] >> (8 * Channel)) & 0xFF);
+  }
+}
+
+namespace
+{
+  struct color_block
+  {
+    uint32 Endpoints;
+    uint32 Indices;
+  };
+}
+
+/// Quantizes the endpoints and picks the indices. The palette is exactly the one the decoder computes.
+static float
+EvaluateColorBlock(block_pixels const& Block, float const (&PixelWeights)[16], bool UseTransparency,
+                   float const (&Endpoint0)[4], float const (&Endpoint1)[4],
+                   color_block& Result, uint8 (&Indices)[16])
+{
+  uint32 C0 = QuantizeTo565(Endpoint0);
+  uint32 C1 = QuantizeTo565(Endpoint1);
+
+  // The order of the endpoints selects the mode: C0 > C1 for 4 colors, C0 <= C1 for 3 colors and transparency.
+  if(UseTransparency ? C0 > C1 : C0 < C1)
+    Swap(C0, C1);
+
+  Result.Endpoints = C0 | (C1 << 16);
+
+  uint32 Colors[4];
+  ColorPaletteScalar(Result.Endpoints, UseTransparency, Colors);
+
+  block_palette Palette;
+  UnpackPalette(Colors, UseTransparency ? 3 : 4, Palette);
+
+  float const ChannelWeights[4] = { 1, 1, 1, 0 };
+  float const Error = SelectIndices(Block, Palette, ChannelWeights, PixelWeights, Indices);
+
+  Result.Indices = 0;
+  for(uint32 Index = 0; Index < 16; ++Index)
+  {
+    if(UseTransparency && PixelWeights[Index] == 0)
+      Indices[Index] = 3;
+    Result.Indices |= uint32(Indices[Index]) << (2 * Index);
+  }
+
+  return Error;
+}
+
+static void
+EncodeColorBlock(block_pixels const& Block, bool AllowTransparency, block_encoder_quality Quality, uint8* Output)
+{
+  // Only BC1 can encode transparent pixels, which are excluded from the color fit.
+  float PixelWeights[16];
+  bool UseTransparency = false;
+  for(uint32 Index = 0; Index < 16; ++Index)
+  {
+    bool const IsTransparent = AllowTransparency && Block.Channel[3][Index] < 128.0f;
+    PixelWeights[Index] = IsTransparent ? 0.0f : 1.0f;
+    UseTransparency |= IsTransparent;
+  }
+
+  float Endpoint0[4];
+  float Endpoint1[4];
+  FindEndpoints(Block, 3, PixelWeights, Quality, Endpoint0, Endpoint1);
+
+  color_block Best;
+  uint8 Indices[16];
+  float BestError = EvaluateColorBlock(Block, PixelWeights, UseTransparency, Endpoint0, Endpoint1, Best, Indices);
+
+  if(Quality == block_encoder_quality::High)
+  {
+    // The weight of each palette entry between the first and second endpoint.
+    float const FourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    float const ThreeColorWeights[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+    auto const& EntryWeights = UseTransparency ? ThreeColorWeights : FourColorWeights;
+
+    for(uint32 Iteration = 0; Iteration < 2 && BestError > 0; ++Iteration)
+    {
+      float Weights[16];
+      for(uint32 Index = 0; Index < 16; ++Index)
+        Weights[Index] = EntryWeights[Indices[Index]];
+
+      // The evaluated endpoints might have been swapped.
+      uint32 Colors[4];
+      ColorPaletteScalar(Best.Endpoints, UseTransparency, Colors);
+      for(uint32 Channel = 0; Channel < 3; ++Channel)
+      {
+        Endpoint0[Channel] = float((Colors[0] >> (8 * Channel)) & 0xFF);
+        Endpoint1[Channel] = float((Colors[1] >> (8 * Channel)) & 0xFF);
+      }
+
+      if(!RefineEndpoints(Block, 3, PixelWeights, Weights, Endpoint0, Endpoint1))
+        break;
+
+      color_block Candidate;
+      uint8 CandidateIndices[16];
+      float const Error = EvaluateColorBlock(Block, PixelWeights, UseTransparency, Endpoint0, Endpoint1, Candidate, CandidateIndices);
+      if(Error >= BestError)
+        break;
+
+      BestError = Error;
+      Best = Candidate;
+      MemCopyBytes(Bytes(16), Indices, CandidateIndices);
+    }
+  }
+
+  MemCopyBytes(Bytes(4), Output, &Best.Endpoints);
+  MemCopyBytes(Bytes(4), Output + 4, &Best.Indices);
+}
+
+static float
+EvaluateAlphaBlock(block_pixels const& Block, uint32 A0, uint32 A1, uint64& Indices)
+{
+  uint32 Palette[8];
+  AlphaPaletteScalar(A0, A1, Palette);
+
+  float TotalError = 0;
+  Indices = 0;
+  for(uint32 Index = 0; Index < 16; ++Index)
+  {
+    float BestError = 3.0e38f;
+    uint64 BestIndex = 0;
+    for(uint32 EntryIndex = 0; EntryIndex < 8; ++EntryIndex)
+    {
+      float const Difference = Block.Channel[3][Index] - float(Palette[EntryIndex]);
+      if(Difference * Difference < BestError)
+      {
+        BestError = Difference * Difference;
+        BestIndex = EntryIndex;
+      }
+    }
+
+    TotalError += BestError;
+    Indices |= BestIndex << (3 * Index);
+  }
+
+  return TotalError;
+}
+
+static void
+EncodeAlphaBlock(block_pixels const& Block, block_encoder_quality Quality, uint8* Output)
+{
+  uint32 Minimum = 255;
+  uint32 Maximum = 0;
+
+  // The extremes besides 0 and 255, which the 6-value mode gets for free.
+  uint32 InnerMinimum = 255;
+  uint32 InnerMaximum = 0;
+
+  for(uint32 Index = 0; Index < 16; ++Index)
+  {
+    auto const Value = uint32(Block.Channel[3][Index]);
+    Minimum = Min(Minimum, Value);
+    Maximum = Max(Maximum, Value);
+    if(Value != 0 && Value != 255)
+    {
+      InnerMinimum = Min(InnerMinimum, Value);
+      InnerMaximum = Max(InnerMaximum, Value);
+    }
+  }
+
+  // 8 values when A0 > A1.
+  uint32 A0 = Maximum;
+  uint32 A1 = Minimum;
+  uint64 Indices;
+  float const Error = EvaluateAlphaBlock(Block, A0, A1, Indices);
+
+  if(Quality == block_encoder_quality::High && Error > 0 && InnerMinimum <= InnerMaximum)
+  {
+    // 6 values between A0 <= A1, plus 0 and 255.
+    uint64 OtherIndices;
+    if(EvaluateAlphaBlock(Block, InnerMinimum, InnerMaximum, OtherIndices) < Error)
+    {
+      A0 = InnerMinimum;
+      A1 = InnerMaximum;
+      Indices = OtherIndices;
+    }
+  }
+
+  uint64 const Bits = A0 | (A1 << 8) | (Indices << 16);
+  MemCopyBytes(Bytes(8), Output, &Bits);
+}
+
+//
+// BC7
+//
+// Only mode 6 is used: a single pair of RGBA endpoints with 7 bits per
+// channel plus a shared lowest bit per endpoint, and 4-bit indices. It is
+// the most flexible mode for a single subset and handles alpha as well.
+//
+
+static uint32 const Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+namespace
+{
+  struct bc7_endpoints
+  {
+    uint32 Value[2][4]; // 7 bits per channel.
+    uint32 PBit[2];
+  };
+}
+
+/// Finds the 7-bit values closest to \a Color with the given shared lowest bit.
+static float
+QuantizeBc7Endpoint(float const (&Color)[4], uint32 PBit, uint32 (&Result)[4])
+{
+  float Error = 0;
+  for(uint32 Channel = 0; Channel < 4; ++Channel)
+  {
+    auto const Value = Clamp(int((Color[Channel] - float(PBit)) / 2.0f + 0.5f), 0, 127);
+    Result[Channel] = uint32(Value);
+
+    float const Difference = float((Value << 1) | PBit) - Color[Channel];
+    Error += Difference * Difference;
+  }
+  return Error;
+}
+
+static float
+EvaluateBc7Block(block_pixels const& Block, bc7_endpoints const& Endpoints, uint8 (&Indices)[16])
+{
+  block_palette Palette;
+  Palette.Num = 16;
+  for(uint32 EntryIndex = 0; EntryIndex < 16; ++EntryIndex)
+  {
+    uint32 const Weight = Bc7Weights4[EntryIndex];
+    for(uint32 Channel = 0; Channel < 4; ++Channel)
+    {
+      uint32 const E0 = (Endpoints.Value[0][Channel] << 1) | Endpoints.PBit[0];
+      uint32 const E1 = (Endpoints.Value[1][Channel] << 1) | Endpoints.PBit[1];
+      Palette.Entry[EntryIndex][Channel] = float(((64 - Weight) * E0 + Weight * E1 + 32) >> 6);
+    }
+  }
+
+  float const ChannelWeights[4] = { 1, 1, 1, 1 };
+  float const PixelWeights[16] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+  return SelectIndices(Block, Palette, ChannelWeights, PixelWeights, Indices);
+}
+
+static float
+QuantizeAndEvaluateBc7Block(block_pixels const& Block, block_encoder_quality Quality,
+                            float const (&Endpoint0)[4], float const (&Endpoint1)[4],
+                            bc7_endpoints& Result, uint8 (&Indices)[16])
+{
+  if(Quality == block_encoder_quality::Fast)
+  {
+    // Pick the shared bit that fits each endpoint best on its own.
+    for(uint32 Endpoint = 0; Endpoint < 2; ++Endpoint)
+    {
+      auto const& Color = Endpoint == 0 ? Endpoint0 : Endpoint1;
+      uint32 Values[2][4];
+      float const Error0 = QuantizeBc7Endpoint(Color, 0, Values[0]);
+      float const Error1 = QuantizeBc7Endpoint(Color, 1, Values[1]);
+      Result.PBit[Endpoint] = Error1 < Error0 ? 1 : 0;
+      MemCopyBytes(Bytes(sizeof(Values[0])), Result.Value[Endpoint], Values[Result.PBit[Endpoint]]);
+    }
+    return EvaluateBc7Block(Block, Result, Indices);
+  }
+
+  // Try all combinations of shared bits.
+  float BestError = 3.0e38f;
+  for(uint32 Combination = 0; Combination < 4; ++Combination)
+  {
+    bc7_endpoints Candidate;
+    Candidate.PBit[0] = Combination & 1;
+    Candidate.PBit[1] = Combination >> 1;
+    QuantizeBc7Endpoint(Endpoint0, Candidate.PBit[0], Candidate.Value[0]);
+    QuantizeBc7Endpoint(Endpoint1, Candidate.PBit[1], Candidate.Value[1]);
+
+    uint8 CandidateIndices[16];
+    float const Error = EvaluateBc7Block(Block, Candidate, CandidateIndices);
+    if(Error < BestError)
+    {
+      BestError = Error;
+      Result = Candidate;
+      MemCopyBytes(Bytes(16), Indices, CandidateIndices);
+    }
+  }
+  return BestError;
+}
+
+namespace
+{
+  struct bit_writer
+  {
+    uint64 Bits[2];
+    uint32 Position;
+  };
+}
+
+static void
+WriteBits(bit_writer& Writer, uint64 Value, uint32 NumBits)
+{
+  for(uint32 Bit = 0; Bit < NumBits; ++Bit, ++Writer.Position)
+  {
+    uint64 const BitValue = (Value >> Bit) & 1;
+    Writer.Bits[Writer.Position / 64] |= BitValue << (Writer.Position % 64);
+  }
+}
+
+static void
+EncodeBc7Block(block_pixels const& Block, block_encoder_quality Quality, uint8* Output)
+{
+  float const PixelWeights[16] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+
+  float Endpoint0[4];
+  float Endpoint1[4];
+  FindEndpoints(Block, 4, PixelWeights, Quality, Endpoint0, Endpoint1);
+
+  bc7_endpoints Best;
+  uint8 Indices[16];
+  float BestError = QuantizeAndEvaluateBc7Block(Block, Quality, Endpoint0, Endpoint1, Best, Indices);
+
+  if(Quality == block_encoder_quality::High)
+  {
+    for(uint32 Iteration = 0; Iteration < 2 && BestError > 0; ++Iteration)
+    {
+      float Weights[16];
+      for(uint32 Index = 0; Index < 16; ++Index)
+        Weights[Index] = float(Bc7Weights4[Indices[Index]]) / 64.0f;
+
+      if(!RefineEndpoints(Block, 4, PixelWeights, Weights, Endpoint0, Endpoint1))
+        break;
+
+      bc7_endpoints Candidate;
+      uint8 CandidateIndices[16];
+      float const Error = QuantizeAndEvaluateBc7Block(Block, Quality, Endpoint0, Endpoint1, Candidate, CandidateIndices);
+      if(Error >= BestError)
+        break;
+
+      BestError = Error;
+      Best = Candidate;
+      MemCopyBytes(Bytes(16), Indices, CandidateIndices);
+    }
+  }
+
+  // The highest bit of the first index is implicitly 0.
+  if(Indices[0] & 8)
+  {
+    for(uint32 Channel = 0; Channel < 4; ++Channel)
+      Swap(Best.Value[0][Channel], Best.Value[1][Channel]);
+    Swap(Best.PBit[0], Best.PBit[1]);
+    for(auto& Index : Indices)
+      Index = uint8(15 - Index);
+  }
+
+  bit_writer Writer{};
+  WriteBits(Writer, 1 << 6, 7); // Mode 6
+  for(uint32 Channel = 0; Channel < 4; ++Channel)
+  {
+    WriteBits(Writer, Best.Value[0][Channel], 7);
+    WriteBits(Writer, Best.Value[1][Channel], 7);
+  }
+  WriteBits(Writer, Best.PBit[0], 1);
+  WriteBits(Writer, Best.PBit[1], 1);
+
+  WriteBits(Writer, Indices[0], 3);
+  for(uint32 Index = 1; Index < 16; ++Index)
+    WriteBits(Writer, Indices[Index], 4);
+
+  Assert(Writer.Position == 128);
+  MemCopyBytes(Bytes(16), Output, Writer.Bits);
+}
+
+
+//
+// Public API
+//
+
+auto
+::BlockDecoderIsSupported(block_decoder Decoder)
+  -> bool
+{
+  switch(Decoder)
+  {
+    case block_decoder::Auto:
+    case block_decoder::Scalar:
+      return true;
+    #if IMAGE_BLOCK_COMPRESSION_SIMD
+    case block_decoder::SSE2:
+      return true;
+    case block_decoder::AVX2:
+    {
+      static bool const IsSupported = CpuSupportsAVX2();
+      return IsSupported;
+    }
+    #endif
+    default:
+      return false;
+  }
+}
+
+auto
+::BlockDecodeBC1(void const* Block, uint32* Pixels)
+  -> void
+{
+  DecodeBlockScalar<bc_kind::BC1>(Reinterpret<uint8 const*>(Block), Pixels, 4);
+}
+
+auto
+::BlockDecodeBC2(void const* Block, uint32* Pixels)
+  -> void
+{
+  DecodeBlockScalar<bc_kind::BC2>(Reinterpret<uint8 const*>(Block), Pixels, 4);
+}
+
+auto
+::BlockDecodeBC3(void const* Block, uint32* Pixels)
+  -> void
+{
+  DecodeBlockScalar<bc_kind::BC3>(Reinterpret<uint8 const*>(Block), Pixels, 4);
+}
+
+auto
+::ImageDecompressedFormat(image_format Format)
+  -> image_format
+{
+  switch(Format)
+  {
+    case image_format::BC1_UNORM:
+    case image_format::BC2_UNORM:
+    case image_format::BC3_UNORM:
+      return image_format::R8G8B8A8_UNORM;
+    case image_format::BC1_UNORM_SRGB:
+    case image_format::BC2_UNORM_SRGB:
+    case image_format::BC3_UNORM_SRGB:
+      return image_format::R8G8B8A8_UNORM_SRGB;
+    default:
+      return image_format::UNKNOWN;
+  }
+}
+
+template<bc_kind Kind>
+static decode_block_row
+SelectBlockRowDecoder(block_decoder Decoder)
+{
+  switch(Decoder)
+  {
+    #if IMAGE_BLOCK_COMPRESSION_SIMD
+    case block_decoder::SSE2: return &DecodeBlockRowSSE2<Kind>;
+    case block_decoder::AVX2: return &DecodeBlockRowAVX2<Kind>;
+    #endif
+    default:                  return &DecodeBlockRowScalar<Kind>;
+  }
+}
+
+namespace
+{
+  /// A range of block rows of a single depth slice of a sub-image.
+  struct block_row_job
+  {
+    uint32 MipLevel;
+    uint32 Face;
+    uint32 ArrayIndex;
+    uint32 Z;
+    uint32 FirstBlockRow;
+    uint32 NumBlockRows;
+  };
+}
+
+/// Splits all sub-images of an image with the given header into ranges of block rows.
+static void
+GatherBlockRowJobs(image_header const& Header, array<block_row_job>& Jobs)
+{
+  for(uint32 ArrayIndex = 0; ArrayIndex < Header.NumArrayIndices; ++ArrayIndex)
+  {
+    for(uint32 Face = 0; Face < Header.NumFaces; ++Face)
+    {
+      for(uint32 MipLevel = 0; MipLevel < Header.NumMipLevels; ++MipLevel)
+      {
+        uint32 const NumBlockRows = (ImageHeight(Header, MipLevel) + 3) / 4;
+        for(uint32 Z = 0; Z < ImageDepth(Header, MipLevel); ++Z)
+        {
+          for(uint32 BlockRow = 0; BlockRow < NumBlockRows; BlockRow += IMAGE_BLOCK_ROWS_PER_JOB)
+          {
+            auto& Job = Expand(Jobs);
+            Job.MipLevel = MipLevel;
+            Job.Face = Face;
+            Job.ArrayIndex = ArrayIndex;
+            Job.Z = Z;
+            Job.FirstBlockRow = BlockRow;
+            Job.NumBlockRows = Min(NumBlockRows - BlockRow, uint32(IMAGE_BLOCK_ROWS_PER_JOB));
+          }
+        }
+      }
+    }
+  }
+}
+
+static void
+RunDecompressJob(block_row_job const& Job, decode_block_row Decode, uint32 BlockSize,
+                 image const& Source, image const& Target, uint8* TargetData)
+{
+  uint32 const Width = ImageWidth(Source, Job.MipLevel);
+  uint32 const Height = ImageHeight(Source, Job.MipLevel);
+  uint32 const NumBlocksX = ImageNumBlocksX(Source, Job.MipLevel);
+  size_t const BlockRowSize = NumBlocksX * BlockSize;
+
+  uint8 const* SourceRow = ImageData(Source).Ptr
+                         + ImageDataOffSet(Source, Job.MipLevel, Job.Face, Job.ArrayIndex)
+                         + Job.Z * ImageDepthPitch(Source, Job.MipLevel)
+                         + Job.FirstBlockRow * BlockRowSize;
+
+  uint8* TargetSlice = TargetData
+                     + ImageDataOffSet(Target, Job.MipLevel, Job.Face, Job.ArrayIndex)
+                     + Job.Z * ImageDepthPitch(Target, Job.MipLevel);
+  size_t const TargetPitch = ImageRowPitch(Target, Job.MipLevel) / 4;
+
+  // Blocks sticking out of the image are decoded here first.
+  array<uint32> Scratch{};
+  Defer [&](){ Reset(Scratch); };
+
+  for(uint32 BlockRow = Job.FirstBlockRow; BlockRow < Job.FirstBlockRow + Job.NumBlockRows; ++BlockRow)
+  {
+    uint32 const Y = 4 * BlockRow;
+    uint32* TargetRow = Reinterpret<uint32*>(TargetSlice) + Y * TargetPitch;
+
+    if(Width % 4 == 0 && Y + 4 <= Height)
+    {
+      Decode(SourceRow, NumBlocksX, TargetRow, TargetPitch);
+    }
+    else
+    {
+      size_t const ScratchPitch = 4 * NumBlocksX;
+      SetNum(Scratch, 4 * ScratchPitch);
+      Decode(SourceRow, NumBlocksX, Scratch.Ptr, ScratchPitch);
+
+      uint32 const NumRows = Min(Height - Y, 4u);
+      for(uint32 Row = 0; Row < NumRows; ++Row)
+        MemCopyBytes(Bytes(4 * Width), TargetRow + Row * TargetPitch, Scratch.Ptr + Row * ScratchPitch);
+    }
+
+    SourceRow += BlockRowSize;
+  }
+}
+
+auto
+::ImageDecompress(image& Target, image const& Source, block_decoder Decoder, uint32 NumThreads)
+  -> bool
+{
+  Assert(&Target != &Source);
+
+  auto const TargetFormat = ImageDecompressedFormat(Source.Format);
+  if(TargetFormat == image_format::UNKNOWN)
+  {
+    LogError("Images of format %s can't be decompressed.", ImageFormatName(Source.Format));
+    return false;
+  }
+
+  if(!BlockDecoderIsSupported(Decoder))
+  {
+    LogError("The requested block decoder is not supported on this machine.");
+    return false;
+  }
+
+  if(Decoder == block_decoder::Auto)
+  {
+    Decoder = BlockDecoderIsSupported(block_decoder::AVX2) ? block_decoder::AVX2 :
+              BlockDecoderIsSupported(block_decoder::SSE2) ? block_decoder::SSE2 :
+                                                             block_decoder::Scalar;
+  }
+
+  if(ImageDataSize(Source) == 0)
+  {
+    LogError("The source image has no data.");
+    return false;
+  }
+
+  decode_block_row Decode{};
+  uint32 BlockSize{};
+  switch(Source.Format)
+  {
+    case image_format::BC1_UNORM:
+    case image_format::BC1_UNORM_SRGB:
+      Decode = SelectBlockRowDecoder<bc_kind::BC1>(Decoder);
+      BlockSize = bc_layout<bc_kind::BC1>::BlockSize;
+      break;
+    case image_format::BC2_UNORM:
+    case image_format::BC2_UNORM_SRGB:
+      Decode = SelectBlockRowDecoder<bc_kind::BC2>(Decoder);
+      BlockSize = bc_layout<bc_kind::BC2>::BlockSize;
+      break;
+    default:
+      Decode = SelectBlockRowDecoder<bc_kind::BC3>(Decoder);
+      BlockSize = bc_layout<bc_kind::BC3>::BlockSize;
+      break;
+  }
+
+  static_cast<image_header&>(Target) = Source;
+  Target.Format = TargetFormat;
+  ImageAllocateData(Target);
+  uint8* TargetData = ImageData(Target).Ptr;
+
+  array<block_row_job> Jobs{};
+  Defer [&](){ Reset(Jobs); };
+  GatherBlockRowJobs(Source, Jobs);
+
+  ParallelFor(Jobs.Num, [&](size_t JobIndex)
+  {
+    RunDecompressJob(Jobs[JobIndex], Decode, BlockSize, Source, Target, TargetData);
+  }, NumThreads);
+
+  return true;
+}
+
+auto
+::BlockEncodeBC1(uint32 const* Pixels, void* Block, block_encoder_quality Quality)
+  -> void
+{
+  block_pixels Unpacked;
+  UnpackBlockPixels(Pixels, Unpacked);
+  EncodeColorBlock(Unpacked, true, Quality, Reinterpret<uint8*>(Block));
+}
+
+auto
+::BlockEncodeBC3(uint32 const* Pixels, void* Block, block_encoder_quality Quality)
+  -> void
+{
+  block_pixels Unpacked;
+  UnpackBlockPixels(Pixels, Unpacked);
+  EncodeAlphaBlock(Unpacked, Quality, Reinterpret<uint8*>(Block));
+  EncodeColorBlock(Unpacked, false, Quality, Reinterpret<uint8*>(Block) + 8);
+}
+
+auto
+::BlockEncodeBC7(uint32 const* Pixels, void* Block, block_encoder_quality Quality)
+  -> void
+{
+  block_pixels Unpacked;
+  UnpackBlockPixels(Pixels, Unpacked);
+  EncodeBc7Block(Unpacked, Quality, Reinterpret<uint8*>(Block));
+}
+
+using encode_block = void (*)(uint32 const* Pixels, void* Block, block_encoder_quality Quality);
+
+/// Reads a pixel of an uncompressed image as R8G8B8A8.
+using fetch_pixel = uint32 (*)(uint8 const* Pixel);
+
+static uint32
+FetchR8G8B8A8(uint8 const* Pixel)
+{
+  return Load32(Pixel);
+}
+
+static uint32
+FetchB8G8R8A8(uint8 const* Pixel)
+{
+  return PackRGBA(Pixel[2], Pixel[1], Pixel[0], Pixel[3]);
+}
+
+static uint32
+FetchR32G32B32A32(uint8 const* Pixel)
+{
+  float Color[4];
+  MemCopyBytes(Bytes(sizeof(Color)), Color, Pixel);
+
+  uint32 Channels[4];
+  for(uint32 Channel = 0; Channel < 4; ++Channel)
+    Channels[Channel] = uint32(Clamp(Color[Channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+  return PackRGBA(Channels[0], Channels[1], Channels[2], Channels[3]);
+}
+
+static void
+RunCompressJob(block_row_job const& Job, encode_block Encode, fetch_pixel Fetch, block_encoder_quality Quality,
+               image const& Source, image const& Target, uint8* TargetData)
+{
+  uint32 const Width = ImageWidth(Source, Job.MipLevel);
+  uint32 const Height = ImageHeight(Source, Job.MipLevel);
+  uint32 const NumBlocksX = ImageNumBlocksX(Target, Job.MipLevel);
+  uint32 const BlockSize = 2 * ImageFormatBitsPerPixel(Target.Format);
+  uint32 const BytesPerPixel = ImageFormatBitsPerPixel(Source.Format) / 8;
+  size_t const SourcePitch = ImageRowPitch(Source, Job.MipLevel);
+
+  uint8 const* SourceSlice = ImageData(Source).Ptr
+                           + ImageDataOffSet(Source, Job.MipLevel, Job.Face, Job.ArrayIndex)
+                           + Job.Z * ImageDepthPitch(Source, Job.MipLevel);
+
+  uint8* TargetBlock = TargetData
+                     + ImageDataOffSet(Target, Job.MipLevel, Job.Face, Job.ArrayIndex)
+                     + Job.Z * ImageDepthPitch(Target, Job.MipLevel)
+                     + Job.FirstBlockRow * NumBlocksX * BlockSize;
+
+  for(uint32 BlockY = Job.FirstBlockRow; BlockY < Job.FirstBlockRow + Job.NumBlockRows; ++BlockY)
+  {
+    for(uint32 BlockX = 0; BlockX < NumBlocksX; ++BlockX)
+    {
+      // Pixels outside of the image repeat the last row or column.
+      uint32 Pixels[16];
+      for(uint32 Y = 0; Y < 4; ++Y)
+      {
+        uint32 const SourceY = Min(4 * BlockY + Y, Height - 1);
+        for(uint32 X = 0; X < 4; ++X)
+        {
+          uint32 const SourceX = Min(4 * BlockX + X, Width - 1);
+          Pixels[4 * Y + X] = Fetch(SourceSlice + SourceY * SourcePitch + SourceX * BytesPerPixel);
+        }
+      }
+
+      Encode(Pixels, TargetBlock, Quality);
+      TargetBlock += BlockSize;
+    }
+  }
+}
+
+auto
+::ImageCompress(image& Target, image const& Source, image_format Format,
+                block_encoder_quality Quality, uint32 NumThreads)
+  -> bool
+{
+  Assert(&Target != &Source);
+
+  encode_block Encode{};
+  switch(Format)
+  {
+    case image_format::BC1_UNORM:
+    case image_format::BC1_UNORM_SRGB:
+      Encode = &BlockEncodeBC1;
+      break;
+    case image_format::BC3_UNORM:
+    case image_format::BC3_UNORM_SRGB:
+      Encode = &BlockEncodeBC3;
+      break;
+    case image_format::BC7_UNORM:
+    case image_format::BC7_UNORM_SRGB:
+      Encode = &BlockEncodeBC7;
+      break;
+    default:
+      LogError("Compressing images to %s is not supported.", ImageFormatName(Format));
+      return false;
+  }
+
+  fetch_pixel Fetch{};
+  switch(Source.Format)
+  {
+    case image_format::R8G8B8A8_UNORM:
+    case image_format::R8G8B8A8_UNORM_SRGB:
+      Fetch = &FetchR8G8B8A8;
+      break;
+    case image_format::B8G8R8A8_UNORM:
+    case image_format::B8G8R8A8_UNORM_SRGB:
+      Fetch = &FetchB8G8R8A8;
+      break;
+    case image_format::R32G32B32A32_FLOAT:
+      Fetch = &FetchR32G32B32A32;
+      break;
+    default:
+      LogError("Compressing images of format %s is not supported.", ImageFormatName(Source.Format));
+      return false;
+  }
+
+  if(ImageDataSize(Source) == 0)
+  {
+    LogError("The source image has no data.");
+    return false;
+  }
+
+  static_cast<image_header&>(Target) = Source;
+  Target.Format = Format;
+  ImageAllocateData(Target);
+  uint8* TargetData = ImageData(Target).Ptr;
+
+  array<block_row_job> Jobs{};
+  Defer [&](){ Reset(Jobs); };
+  GatherBlockRowJobs(Target, Jobs);
+
+  ParallelFor(Jobs.Num, [&](size_t JobIndex)
+  {
+    RunCompressJob(Jobs[JobIndex], Encode, Fetch, Quality, Source, Target, TargetData);
+  }, NumThreads);
+
+  return true;
+}
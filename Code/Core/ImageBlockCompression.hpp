@@ -0,0 +1,110 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+#include "Image.hpp"
+
+#include <Backbone.hpp>
+
+
+/// The implementations available for decoding compressed blocks.
+///
+/// All of them produce exactly the same results.
+enum class block_decoder
+{
+  /// The fastest one the CPU supports.
+  Auto,
+
+  /// Reference implementation, one block at a time.
+  Scalar,
+
+  /// 4 blocks per iteration.
+  SSE2,
+
+  /// 8 blocks per iteration.
+  AVX2,
+};
+
+CORE_API
+bool
+BlockDecoderIsSupported(block_decoder Decoder);
+
+/// Decodes a single BC1 block (8 bytes) into 4x4 R8G8B8A8 pixels, row by row.
+CORE_API
+void
+BlockDecodeBC1(void const* Block, uint32* Pixels);
+
+/// Decodes a single BC2 block (16 bytes) into 4x4 R8G8B8A8 pixels, row by row.
+CORE_API
+void
+BlockDecodeBC2(void const* Block, uint32* Pixels);
+
+/// Decodes a single BC3 block (16 bytes) into 4x4 R8G8B8A8 pixels, row by row.
+CORE_API
+void
+BlockDecodeBC3(void const* Block, uint32* Pixels);
+
+/// \brief The format ImageDecompress() produces for images of the given format.
+///
+/// \return image_format::UNKNOWN if images of this format can't be decompressed.
+CORE_API
+image_format
+ImageDecompressedFormat(image_format Format);
+
+/// \brief Decompresses all sub-images of a BC1, BC2 or BC3 image into R8G8B8A8.
+///
+/// The result is UNORM or SRGB, just like the source. The work is split
+/// across mip levels, faces, array indices and rows of blocks and runs on up
+/// to \a NumThreads threads (0 picks the number of hardware threads).
+///
+/// \return \c false if the format of \a Source isn't supported.
+CORE_API
+bool
+ImageDecompress(image& Target, image const& Source,
+                block_decoder Decoder = block_decoder::Auto,
+                uint32 NumThreads = 0);
+
+
+/// Trades encoding speed for quality.
+enum class block_encoder_quality
+{
+  /// Endpoints from the bounding box of the colors.
+  Fast,
+
+  /// Endpoints along the principal axis of the colors, refined with least squares.
+  High,
+};
+
+/// \brief Encodes 4x4 R8G8B8A8 pixels, row by row, into a BC1 block (8 bytes).
+///
+/// Pixels with an alpha below 128 become transparent.
+CORE_API
+void
+BlockEncodeBC1(uint32 const* Pixels, void* Block, block_encoder_quality Quality = block_encoder_quality::Fast);
+
+/// Encodes 4x4 R8G8B8A8 pixels, row by row, into a BC3 block (16 bytes).
+CORE_API
+void
+BlockEncodeBC3(uint32 const* Pixels, void* Block, block_encoder_quality Quality = block_encoder_quality::Fast);
+
+/// \brief Encodes 4x4 R8G8B8A8 pixels, row by row, into a BC7 block (16 bytes).
+///
+/// \note Only mode 6 is used, which has a single pair of RGBA endpoints.
+CORE_API
+void
+BlockEncodeBC7(uint32 const* Pixels, void* Block, block_encoder_quality Quality = block_encoder_quality::Fast);
+
+/// \brief Compresses all sub-images of an uncompressed image into BC1, BC3 or BC7.
+///
+/// \a Source must be R8G8B8A8, B8G8R8A8 (UNORM or SRGB) or R32G32B32A32_FLOAT,
+/// in which case the values are clamped to [0, 1]. The color space is not
+/// converted, so pass an SRGB \a Format for SRGB data.
+///
+/// The work is split into rows of blocks and runs on up to \a NumThreads
+/// threads (0 picks the number of hardware threads).
+///
+/// \return \c false if either format isn't supported.
+CORE_API
+bool
+ImageCompress(image& Target, image const& Source, image_format Format,
+              block_encoder_quality Quality = block_encoder_quality::Fast,
+              uint32 NumThreads = 0);
@@ -0,0 +1,526 @@
+#include "ImageCache.hpp"
+#include "ImageLoader.hpp"
+#include "Dictionary.hpp"
+#include "FileMapping.hpp"
+#include "Hash.hpp"
+#include "Log.hpp"
+#include "String.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+#if defined(BB_Platform_Windows)
+  #include <Windows.h>
+#else
+  #include <sys/stat.h>
+  #include <errno.h>
+#endif
+
+
+/// Bump this whenever processing changes its results, to invalidate all
+/// existing entries.
+#define IMAGE_CACHE_VERSION 1
+
+static uint32 const ImageCacheFileMagic = 0x43495856;  // "VXIC"
+static uint32 const ImageCacheIndexMagic = 0x49495856; // "VXII"
+
+namespace
+{
+  /// The header of an entry file. The image data follows right after it.
+  struct image_cache_file_header
+  {
+    uint32 Magic;
+    uint32 Version;
+    uint64 Key;
+
+    uint32 Format;
+    uint32 Width;
+    uint32 Height;
+    uint32 Depth;
+    uint32 NumMipLevels;
+    uint32 NumFaces;
+    uint32 NumArrayIndices;
+    uint32 Reserved;
+
+    uint64 DataSize;
+
+    /// Keeps the image data aligned to 64 bytes within the file.
+    uint8 Padding[8];
+  };
+
+  static_assert(sizeof(image_cache_file_header) == 64, "Unexpected size of the cache file header.");
+
+  struct image_cache_index_header
+  {
+    uint32 Magic;
+    uint32 Version;
+    uint64 NumEntries;
+  };
+
+  /// What the index knows about a source file processed with certain options.
+  struct image_cache_index_entry
+  {
+    uint64 SourceSize;
+    uint64 SourceTime;
+    uint64 Key;
+  };
+
+  struct image_cache_index_record
+  {
+    uint64 Name;
+    image_cache_index_entry Entry;
+  };
+
+  /// The options that change the result of processing, without padding, so
+  /// they can be hashed as they are.
+  struct image_cache_options
+  {
+    uint32 Version;
+    uint32 ConvertTo;
+    uint32 GenerateMipmaps;
+    uint32 MipFilter;
+  };
+
+  /// Reads and writes entry files.
+  class image_loader_cache_file : public image_loader_interface
+  {
+  public:
+    uint64 Key{};
+
+    virtual bool LoadImageFromData(slice<void const> RawImageData, image& ResultImage) override;
+    virtual bool BorrowImageFromData(slice<void const> RawImageData, image_external_storage* Storage, image& ResultImage) override;
+    virtual bool WriteImageToArray(image& Image, array<uint8>& RawImageData) override;
+    virtual bool WriteImageToStream(image const& Image, image_output_stream& Stream) override;
+  };
+}
+
+struct image_cache
+{
+  allocator_interface* Allocator;
+  arc_string Directory;
+
+  std::mutex Mutex;
+
+  /// Maps the hash of a source file name and its options to what is known about it.
+  dictionary<uint64, image_cache_index_entry> Index;
+  bool IsIndexDirty;
+
+  /// Makes the names of temporary files unique.
+  std::atomic<uint32> NextTempFileIndex;
+};
+
+
+//
+// Platform
+//
+
+#if defined(BB_Platform_Windows)
+
+static bool
+GetFileSizeAndTime(arc_string const& FileName, uint64& Size, uint64& Time)
+{
+  WIN32_FILE_ATTRIBUTE_DATA Attributes;
+  if(!GetFileAttributesExA(StrPtr(FileName), GetFileExInfoStandard, &Attributes))
+    return false;
+
+  Size = uint64(Attributes.nFileSizeHigh) << 32 | Attributes.nFileSizeLow;
+  Time = uint64(Attributes.ftLastWriteTime.dwHighDateTime) << 32 | Attributes.ftLastWriteTime.dwLowDateTime;
+  return true;
+}
+
+static bool
+EnsureDirectoryExists(arc_string const& Directory)
+{
+  return CreateDirectoryA(StrPtr(Directory), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+static bool
+ReplaceCacheFile(arc_string const& From, arc_string const& To)
+{
+  return MoveFileExA(StrPtr(From), StrPtr(To), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+#else
+
+static bool
+GetFileSizeAndTime(arc_string const& FileName, uint64& Size, uint64& Time)
+{
+  struct stat FileStatus;
+  if(stat(StrPtr(FileName), &FileStatus) != 0)
+    return false;
+
+  Size = uint64(FileStatus.st_size);
+  Time = uint64(FileStatus.st_mtim.tv_sec) * 1000000000ull + uint64(FileStatus.st_mtim.tv_nsec);
+  return true;
+}
+
+static bool
+EnsureDirectoryExists(arc_string const& Directory)
+{
+  return mkdir(StrPtr(Directory), 0755) == 0 || errno == EEXIST;
+}
+
+static bool
+ReplaceCacheFile(arc_string const& From, arc_string const& To)
+{
+  return std::rename(StrPtr(From), StrPtr(To)) == 0;
+}
+
+#endif
+
+
+//
+// Entry Files
+//
+
+auto
+image_loader_cache_file::BorrowImageFromData(slice<void const> RawImageData, image_external_storage* Storage, image& ResultImage)
+  -> bool
+{
+  image_cache_file_header Header;
+  if(RawImageData.Num < sizeof(Header))
+    return false;
+  MemCopy(sizeof(Header), Reinterpret<uint8*>(&Header), Reinterpret<uint8 const*>(RawImageData.Ptr));
+
+  if(Header.Magic != ImageCacheFileMagic || Header.Version != IMAGE_CACHE_VERSION || Header.Key != this->Key)
+    return false;
+
+  if(Header.Format == 0 || Header.Format >= uint32(image_format::NUM) || Header.DataSize != RawImageData.Num - sizeof(Header))
+    return false;
+
+  ResultImage.Format = image_format(Header.Format);
+  ResultImage.Width = Header.Width;
+  ResultImage.Height = Header.Height;
+  ResultImage.Depth = Header.Depth;
+  ResultImage.NumMipLevels = Header.NumMipLevels;
+  ResultImage.NumFaces = Header.NumFaces;
+  ResultImage.NumArrayIndices = Header.NumArrayIndices;
+
+  auto const Data = Slice(SliceReinterpret<uint8 const>(RawImageData), sizeof(Header), RawImageData.Num);
+  if(Storage)
+    return ImageBorrowData(ResultImage, SliceReinterpret<void const>(Data), Storage) && ImageDataSize(ResultImage) == Data.Num;
+
+  ImageAllocateData(ResultImage);
+  if(ImageDataSize(ResultImage) != Data.Num)
+    return false;
+
+  SliceCopy(Slice(ImageData(ResultImage), 0, Data.Num), Data);
+  return true;
+}
+
+auto
+image_loader_cache_file::LoadImageFromData(slice<void const> RawImageData, image& ResultImage)
+  -> bool
+{
+  return BorrowImageFromData(RawImageData, nullptr, ResultImage);
+}
+
+auto
+image_loader_cache_file::WriteImageToStream(image const& Image, image_output_stream& Stream)
+  -> bool
+{
+  image_cache_file_header Header{};
+  Header.Magic = ImageCacheFileMagic;
+  Header.Version = IMAGE_CACHE_VERSION;
+  Header.Key = this->Key;
+  Header.Format = uint32(Image.Format);
+  Header.Width = Image.Width;
+  Header.Height = Image.Height;
+  Header.Depth = Image.Depth;
+  Header.NumMipLevels = Image.NumMipLevels;
+  Header.NumFaces = Image.NumFaces;
+  Header.NumArrayIndices = Image.NumArrayIndices;
+
+  // Owned image data has some padding at the end that isn't stored.
+  Header.DataSize = ImageDataSize(Image);
+
+  return Stream.Write(Slice<void const>(sizeof(Header), &Header)) &&
+         Stream.Write(Slice<void const>(size_t(Header.DataSize), ImageData(Image).Ptr));
+}
+
+auto
+image_loader_cache_file::WriteImageToArray(image& Image, array<uint8>& RawImageData)
+  -> bool
+{
+  Clear(RawImageData);
+  image_output_stream_array Stream{ RawImageData };
+  return WriteImageToStream(Image, Stream);
+}
+
+static arc_string
+EntryFileName(image_cache const& Cache, uint64 Key)
+{
+  char Name[32];
+  std::snprintf(Name, sizeof(Name), "/%016llx.image", (unsigned long long)Key);
+  return Cache.Directory + Name;
+}
+
+static arc_string
+IndexFileName(image_cache const& Cache)
+{
+  return Cache.Directory + "/Index.bin";
+}
+
+/// Writes to a temporary file first, so that nobody ever sees half a file.
+static bool
+WriteFileAtomically(image_cache& Cache, image_loader_interface& Writer, image const& Image, arc_string const& FileName)
+{
+  char Suffix[32];
+  std::snprintf(Suffix, sizeof(Suffix), ".%u.tmp", Cache.NextTempFileIndex++);
+  auto const TempFileName = FileName + Suffix;
+
+  if(!WriteImageToFile(Writer, Image, Slice(TempFileName)))
+  {
+    std::remove(StrPtr(TempFileName));
+    return false;
+  }
+
+  if(!ReplaceCacheFile(TempFileName, FileName))
+  {
+    std::remove(StrPtr(TempFileName));
+    return false;
+  }
+
+  return true;
+}
+
+
+//
+// Index
+//
+
+static uint64
+HashOptions(image_load_options const& Options)
+{
+  image_cache_options CacheOptions{};
+  CacheOptions.Version = IMAGE_CACHE_VERSION;
+  CacheOptions.ConvertTo = uint32(Options.ConvertTo);
+  CacheOptions.GenerateMipmaps = Options.GenerateMipmaps ? 1 : 0;
+  CacheOptions.MipFilter = Options.GenerateMipmaps ? uint32(Options.MipFilter) : 0;
+  return HashXxh64(Slice<void const>(sizeof(CacheOptions), &CacheOptions));
+}
+
+static void
+LoadIndex(image_cache& Cache)
+{
+  file_mapping File{};
+  if(!FileMappingOpen(File, Slice(IndexFileName(Cache))))
+    return;
+  Defer [&](){ FileMappingClose(File); };
+
+  auto const Data = SliceReinterpret<uint8 const>(File.Data);
+
+  image_cache_index_header Header;
+  if(Data.Num < sizeof(Header))
+    return;
+  MemCopy(sizeof(Header), Reinterpret<uint8*>(&Header), Data.Ptr);
+
+  if(Header.Magic != ImageCacheIndexMagic || Header.Version != IMAGE_CACHE_VERSION ||
+     Header.NumEntries > (Data.Num - sizeof(Header)) / sizeof(image_cache_index_record))
+  {
+    LogWarning("Ignoring invalid image cache index.");
+    return;
+  }
+
+  Reserve(&Cache.Index, size_t(Header.NumEntries));
+  for(size_t Index = 0; Index < Header.NumEntries; ++Index)
+  {
+    image_cache_index_record Record;
+    MemCopy(sizeof(Record), Reinterpret<uint8*>(&Record), Data.Ptr + sizeof(Header) + Index * sizeof(Record));
+    *GetOrCreate(&Cache.Index, Record.Name) = Record.Entry;
+  }
+}
+
+/// Serializes the index. Expects the cache to be locked.
+static bool
+WriteIndex(image_cache& Cache)
+{
+  auto const FileName = IndexFileName(Cache);
+  auto const TempFileName = FileName + ".tmp";
+
+  FILE* File = std::fopen(StrPtr(TempFileName), "wb");
+  if(File == nullptr)
+    return false;
+
+  image_cache_index_header Header{};
+  Header.Magic = ImageCacheIndexMagic;
+  Header.Version = IMAGE_CACHE_VERSION;
+  Header.NumEntries = Cache.Index.Num;
+  bool Success = std::fwrite(&Header, sizeof(Header), 1, File) == 1;
+
+  auto const Names = Keys(&Cache.Index);
+  auto const Entries = Values(&Cache.Index);
+  for(size_t Index = 0; Success && Index < Names.Num; ++Index)
+  {
+    image_cache_index_record const Record{ Names[Index], Entries[Index] };
+    Success = std::fwrite(&Record, sizeof(Record), 1, File) == 1;
+  }
+
+  Success = std::fclose(File) == 0 && Success;
+  if(!Success || !ReplaceCacheFile(TempFileName, FileName))
+  {
+    std::remove(StrPtr(TempFileName));
+    LogError("Failed to write the image cache index: %s", StrPtr(FileName));
+    return false;
+  }
+
+  return true;
+}
+
+static bool
+LoadEntry(image_cache const& Cache, uint64 Key, image& Image)
+{
+  image_loader_cache_file Reader{};
+  Reader.Key = Key;
+  return LoadImageFromFile(Reader, Image, Slice(EntryFileName(Cache, Key)));
+}
+
+/// Whether any source file in the index refers to the entry. Cache.Mutex must be locked.
+static bool
+IsEntryInUse(image_cache& Cache, uint64 Key)
+{
+  for(auto const& Entry : Values(&Cache.Index))
+  {
+    if(Entry.Key == Key)
+      return true;
+  }
+
+  return false;
+}
+
+
+//
+// Public API
+//
+
+auto
+::CreateImageCache(allocator_interface& Allocator, slice<char const> Directory)
+  -> image_cache*
+{
+  auto Cache = New<image_cache>(Allocator);
+  Cache->Allocator = &Allocator;
+  Cache->Directory = Directory;
+  Init(&Cache->Index, &Allocator);
+
+  if(!EnsureDirectoryExists(Cache->Directory))
+  {
+    LogError("Failed to create the image cache directory: %s", StrPtr(Cache->Directory));
+    DestroyImageCache(Allocator, Cache);
+    return nullptr;
+  }
+
+  LoadIndex(*Cache);
+  return Cache;
+}
+
+auto
+::DestroyImageCache(allocator_interface& Allocator, image_cache* Cache)
+  -> void
+{
+  if(Cache == nullptr)
+    return;
+
+  ImageCacheSaveIndex(*Cache);
+  Finalize(&Cache->Index);
+  Delete(Allocator, Cache);
+}
+
+auto
+::ImageCacheSaveIndex(image_cache& Cache)
+  -> bool
+{
+  std::lock_guard<std::mutex> Lock(Cache.Mutex);
+  if(!Cache.IsIndexDirty)
+    return true;
+
+  if(!WriteIndex(Cache))
+    return false;
+
+  Cache.IsIndexDirty = false;
+  return true;
+}
+
+auto
+::ImageCacheLookup(image_cache& Cache,
+                   slice<char const> SourceFileName,
+                   image_load_options const& Options,
+                   image& Image,
+                   image_cache_key& Key)
+  -> bool
+{
+  Key = {};
+
+  arc_string SzSourceFileName{ SourceFileName };
+  image_cache_index_entry Current{};
+  if(!GetFileSizeAndTime(SzSourceFileName, Current.SourceSize, Current.SourceTime))
+    return false;
+
+  auto const OptionsHash = HashOptions(Options);
+  auto const Name = HashXxh64(Slice<void const>(SourceFileName.Num, SourceFileName.Ptr), OptionsHash);
+
+  // Trust the key of the last run if the file looks the same.
+  {
+    std::lock_guard<std::mutex> Lock(Cache.Mutex);
+    auto Known = Get(&Cache.Index, Name);
+    if(Known && Known->SourceSize == Current.SourceSize && Known->SourceTime == Current.SourceTime)
+      Key.Value = Known->Key;
+  }
+
+  if(Key.Value != 0 && LoadEntry(Cache, Key.Value, Image))
+    return true;
+
+  file_mapping Source{};
+  if(!FileMappingOpen(Source, SourceFileName))
+    return false;
+  Current.Key = HashXxh64(Source.Data, OptionsHash);
+  FileMappingClose(Source);
+
+  {
+    std::lock_guard<std::mutex> Lock(Cache.Mutex);
+    auto Entry = GetOrCreate(&Cache.Index, Name);
+    uint64 const OutdatedKey = Entry->Key != Current.Key ? Entry->Key : 0;
+    *Entry = Current;
+    Cache.IsIndexDirty = true;
+
+    // The source has changed, so it doesn't need its old version anymore.
+    // Other sources with the same content as before may still use it.
+    if(OutdatedKey != 0 && !IsEntryInUse(Cache, OutdatedKey))
+      std::remove(StrPtr(EntryFileName(Cache, OutdatedKey)));
+  }
+
+  Key.Value = Current.Key;
+  return LoadEntry(Cache, Key.Value, Image);
+}
+
+auto
+::ImageCacheStore(image_cache& Cache, image_cache_key Key, image const& Image)
+  -> bool
+{
+  if(Key.Value == 0)
+    return false;
+
+  image_loader_cache_file Writer{};
+  Writer.Key = Key.Value;
+  if(!WriteFileAtomically(Cache, Writer, Image, EntryFileName(Cache, Key.Value)))
+  {
+    LogWarning("Failed to write image cache entry %016llx.", (unsigned long long)Key.Value);
+    return false;
+  }
+
+  return true;
+}
+
+auto
+::ImageCacheClear(image_cache& Cache)
+  -> void
+{
+  std::lock_guard<std::mutex> Lock(Cache.Mutex);
+
+  for(auto const& Entry : Values(&Cache.Index))
+    std::remove(StrPtr(EntryFileName(Cache, Entry.Key)));
+
+  Clear(&Cache.Index);
+  Cache.IsIndexDirty = false;
+  std::remove(StrPtr(IndexFileName(Cache)));
+}
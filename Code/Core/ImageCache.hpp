@@ -0,0 +1,73 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+#include "Image.hpp"
+#include "ImageLoadQueue.hpp"
+
+#include <Backbone.hpp>
+
+
+/// A persistent on-disk cache of processed images.
+///
+/// Every entry is a file that holds the image data in the layout of
+/// image::InternalSubImages, so a hit needs no decoding or processing and the
+/// image borrows its data straight from the mapped file.
+///
+/// Entries are keyed by a hash of the source file content and the options
+/// that change the result of processing. An index file remembers the size and
+/// modification time of the source files that were hashed, so unchanged files
+/// are not read again on the next run.
+///
+/// All functions are thread-safe.
+struct image_cache;
+
+/// Identifies the processed version of a source file.
+struct image_cache_key { uint64 Value; };
+
+/// \brief Opens the cache in \a Directory, creating the directory if needed.
+///
+/// The index grows from \a Allocator on whatever thread looks images up, so
+/// it has to be thread-safe, like mallocator or a tracking_allocator on top of it.
+///
+/// \return \c nullptr if the directory can't be created.
+CORE_API
+image_cache*
+CreateImageCache(allocator_interface& Allocator, slice<char const> Directory);
+
+/// \brief Saves the index and closes the cache.
+///
+/// Images that borrow data from the cache stay valid.
+CORE_API
+void
+DestroyImageCache(allocator_interface& Allocator, image_cache* Cache);
+
+/// \brief Writes the index to disk if it has changed.
+CORE_API
+bool
+ImageCacheSaveIndex(image_cache& Cache);
+
+/// \brief Looks for the processed version of \a SourceFileName.
+///
+/// \param Key Receives the key of the source file, also on a miss, to pass it
+///            on to ImageCacheStore() once the image has been processed.
+///
+/// \return \c true if \a Image was loaded from the cache.
+CORE_API
+bool
+ImageCacheLookup(image_cache& Cache,
+                 slice<char const> SourceFileName,
+                 image_load_options const& Options,
+                 image& Image,
+                 image_cache_key& Key);
+
+/// \brief Adds a processed image to the cache.
+///
+/// \param Key As returned by ImageCacheLookup().
+CORE_API
+bool
+ImageCacheStore(image_cache& Cache, image_cache_key Key, image const& Image);
+
+/// \brief Deletes all entries the index knows of and the index itself.
+CORE_API
+void
+ImageCacheClear(image_cache& Cache);
@@ -0,0 +1,1154 @@
+#include "ImageConversion.hpp"
+#include "Parallel.hpp"
+
+#include "Color.hpp"
+#include "Log.hpp"
+
+#include <cmath>
+
+// Whether to compile the SSE2 code paths, which are always available on x64.
+#if !defined(IMAGE_CONVERSION_SIMD)
+  #if defined(_M_X64) || defined(__x86_64__)
+    #define IMAGE_CONVERSION_SIMD 1
+  #else
+    #define IMAGE_CONVERSION_SIMD 0
+  #endif
+#endif
+
+// The number of rows that are converted as one unit of work.
+#if !defined(IMAGE_CONVERSION_ROWS_PER_JOB)
+  #define IMAGE_CONVERSION_ROWS_PER_JOB 64
+#endif
+
+#if IMAGE_CONVERSION_SIMD
+  #include <emmintrin.h>
+#endif
+
+// The sRGB encoding table needs enough entries so that no entry spans more
+// than one sRGB value, which is the case near 0 where the curve is steepest.
+#define SRGB_ENCODE_TABLE_SIZE 4096
+
+
+//
+// Channel Conversions
+//
+
+namespace
+{
+  union float_bits
+  {
+    float Float;
+    uint32 Bits;
+  };
+
+  struct conversion_tables
+  {
+    float UNorm8ToFloat[256];
+    float SrgbToLinear[256];
+
+    // The linear values half way between two subsequent sRGB values.
+    float SrgbThresholds[255];
+
+    // The sRGB values of evenly spaced linear values.
+    uint8 SrgbFromLinear[SRGB_ENCODE_TABLE_SIZE];
+
+    // Conversions between 8 bit values without going through floats.
+    uint8 LinearToSrgb8[256];
+    uint8 SrgbToLinear8[256];
+  };
+}
+
+static float
+BitsToFloat(uint32 Bits)
+{
+  float_bits Value;
+  Value.Bits = Bits;
+  return Value.Float;
+}
+
+static uint32
+FloatToBits(float Float)
+{
+  float_bits Value;
+  Value.Float = Float;
+  return Value.Bits;
+}
+
+static uint32
+EncodeUNorm(float Value, uint32 MaxValue)
+{
+  // Also maps NaN to 0.
+  Value = Value > 0.0f ? Min(Value, 1.0f) : 0.0f;
+  return uint32(Value * MaxValue + 0.5f);
+}
+
+static float
+DecodeSNorm(int32 Value, int32 MaxValue)
+{
+  // Both the minimum and the one above it are -1.
+  return Max(float(Value) / MaxValue, -1.0f);
+}
+
+static int32
+EncodeSNorm(float Value, int32 MaxValue)
+{
+  if(Value != Value)
+    return 0;
+
+  float const Scaled = Clamp(Value, -1.0f, 1.0f) * MaxValue;
+  return int32(Scaled + (Scaled < 0.0f ? -0.5f : 0.5f));
+}
+
+/// \brief Decodes an unsigned float with a 5 bit exponent.
+///
+/// That is the magnitude of a half float and the channels of R11G11B10_FLOAT.
+static float
+DecodeSmallFloat(uint32 Bits, uint32 MantissaBits)
+{
+  uint32 const Exponent = Bits >> MantissaBits;
+  uint32 const Mantissa = Bits & ((1u << MantissaBits) - 1);
+
+  // Denormal, scaled by 2^(-14 - MantissaBits).
+  if(Exponent == 0)
+    return float(Mantissa) * BitsToFloat((127 - 14 - MantissaBits) << 23);
+
+  // Infinity or NaN.
+  if(Exponent == 31)
+    return BitsToFloat(0x7F800000 | (Mantissa << (23 - MantissaBits)));
+
+  return BitsToFloat(((Exponent - 15 + 127) << 23) | (Mantissa << (23 - MantissaBits)));
+}
+
+/// \brief Encodes the magnitude of \a Value as an unsigned float with a 5 bit exponent.
+///
+/// Rounds to the nearest even value, too large values become infinity.
+static uint32
+EncodeSmallFloat(float Value, uint32 MantissaBits)
+{
+  uint32 const Bits = FloatToBits(Value) & 0x7FFFFFFF;
+  uint32 const Infinity = 31u << MantissaBits;
+
+  if(Bits > 0x7F800000)
+    return Infinity | (1u << (MantissaBits - 1));
+
+  // 2^16 and above.
+  if(Bits >= 0x47800000)
+    return Infinity;
+
+  int32 const Exponent = int32(Bits >> 23) - 127 + 15;
+  uint32 Mantissa = Bits & 0x7FFFFF;
+  uint32 Shift = 23 - MantissaBits;
+  uint32 Result = 0;
+
+  if(Exponent > 0)
+  {
+    Result = uint32(Exponent) << MantissaBits;
+  }
+  else
+  {
+    // Denormal, including the implicit leading bit.
+    Shift += uint32(1 - Exponent);
+    if(Shift > 24)
+      return 0;
+    Mantissa |= 0x800000;
+  }
+
+  // Rounding up may carry into the exponent, which is just what we want.
+  uint32 const Remainder = Mantissa & ((1u << Shift) - 1);
+  uint32 const Half = 1u << (Shift - 1);
+  Result += Mantissa >> Shift;
+  if(Remainder > Half || (Remainder == Half && (Result & 1)))
+    ++Result;
+
+  return Result;
+}
+
+static float
+HalfToFloat(uint16 Half)
+{
+  float const Magnitude = DecodeSmallFloat(Half & 0x7FFF, 10);
+  return (Half & 0x8000) ? -Magnitude : Magnitude;
+}
+
+static uint16
+FloatToHalf(float Value)
+{
+  uint32 const Sign = (FloatToBits(Value) >> 16) & 0x8000;
+  return uint16(Sign | EncodeSmallFloat(Value, 10));
+}
+
+/// \note Initialized on first use, which is thread-safe.
+static conversion_tables const&
+ConversionTables()
+{
+  static conversion_tables const Tables = []()
+  {
+    conversion_tables Result;
+    for(uint32 Index = 0; Index < 256; ++Index)
+    {
+      Result.UNorm8ToFloat[Index] = Index / 255.0f;
+      Result.SrgbToLinear[Index] = FromGammaToLinear(Result.UNorm8ToFloat[Index]);
+    }
+
+    for(uint32 Index = 0; Index < 255; ++Index)
+      Result.SrgbThresholds[Index] = FromGammaToLinear((Index + 0.5f) / 255.0f);
+
+    uint32 Value = 0;
+    for(uint32 Index = 0; Index < SRGB_ENCODE_TABLE_SIZE; ++Index)
+    {
+      float const Linear = float(Index) / (SRGB_ENCODE_TABLE_SIZE - 1);
+      while(Value < 255 && Result.SrgbThresholds[Value] <= Linear)
+        ++Value;
+      Result.SrgbFromLinear[Index] = uint8(Value);
+    }
+
+    return Result;
+  }();
+  return Tables;
+}
+
+/// Same as FloatToUNorm<uint8>(FromLinearToGamma(Value)), without the Pow().
+static uint8
+EncodeSrgb(conversion_tables const& Tables, float Value)
+{
+  // Also maps NaN to 0.
+  Value = Value > 0.0f ? Min(Value, 1.0f) : 0.0f;
+
+  // The table is exact at the start of each bucket, and a bucket contains
+  // at most one threshold.
+  uint32 Result = Tables.SrgbFromLinear[uint32(Value * (SRGB_ENCODE_TABLE_SIZE - 1))];
+  while(Result < 255 && Tables.SrgbThresholds[Result] <= Value)
+    ++Result;
+  return uint8(Result);
+}
+
+/// The 8 bit conversion tables depend on EncodeSrgb(), so they are filled separately.
+static conversion_tables const&
+ConversionTables8()
+{
+  static conversion_tables const Tables = []()
+  {
+    conversion_tables Result = ConversionTables();
+    for(uint32 Index = 0; Index < 256; ++Index)
+    {
+      Result.LinearToSrgb8[Index] = EncodeSrgb(Result, Result.UNorm8ToFloat[Index]);
+      Result.SrgbToLinear8[Index] = uint8(EncodeUNorm(Result.SrgbToLinear[Index], 255));
+    }
+    return Result;
+  }();
+  return Tables;
+}
+
+
+//
+// Format Codecs
+//
+
+enum class channel_type
+{
+  UNorm8,
+  SNorm8,
+  UNorm16,
+  SNorm16,
+  Float16,
+  Float32,
+};
+
+enum class codec_kind
+{
+  /// Every channel has the same type and is byte aligned.
+  Plain,
+
+  /// UNORM channels packed into the bits of 16 or 32 bit integers.
+  PackedUNorm,
+
+  R11G11B10,
+  R9G9B9E5,
+};
+
+/// Marks a channel in memory that is ignored, like the X in B8G8R8X8.
+static uint8 const PaddingChannel = 4;
+
+namespace
+{
+  struct format_codec
+  {
+    codec_kind Kind;
+    uint32 BytesPerPixel;
+
+    //
+    // Plain formats
+    //
+
+    channel_type Type;
+    uint32 NumChannels;
+
+    /// The RGBA component of each channel in memory.
+    uint8 Swizzle[4];
+
+    /// Whether the RGB components are stored with the sRGB curve.
+    bool IsSRGB;
+
+    //
+    // Packed formats
+    //
+
+    /// The number of bits and the position of each RGBA component. 0 bits if it is missing.
+    uint8 Bits[4];
+    uint8 Shifts[4];
+  };
+}
+
+static format_codec
+PlainCodec(channel_type Type, uint32 NumChannels, uint8 const (&Swizzle)[4], bool IsSRGB = false)
+{
+  uint32 const ChannelSize = Type == channel_type::Float32 ? 4 :
+                             Type == channel_type::UNorm8 || Type == channel_type::SNorm8 ? 1 : 2;
+
+  format_codec Result{};
+  Result.Kind = codec_kind::Plain;
+  Result.BytesPerPixel = NumChannels * ChannelSize;
+  Result.Type = Type;
+  Result.NumChannels = NumChannels;
+  for(uint32 Channel = 0; Channel < 4; ++Channel)
+    Result.Swizzle[Channel] = Swizzle[Channel];
+  Result.IsSRGB = IsSRGB;
+  return Result;
+}
+
+static format_codec
+PackedCodec(uint32 BytesPerPixel, uint8 const (&Bits)[4], uint8 const (&Shifts)[4])
+{
+  format_codec Result{};
+  Result.Kind = codec_kind::PackedUNorm;
+  Result.BytesPerPixel = BytesPerPixel;
+  for(uint32 Component = 0; Component < 4; ++Component)
+  {
+    Result.Bits[Component] = Bits[Component];
+    Result.Shifts[Component] = Shifts[Component];
+  }
+  return Result;
+}
+
+static format_codec
+SpecialCodec(codec_kind Kind)
+{
+  format_codec Result{};
+  Result.Kind = Kind;
+  Result.BytesPerPixel = 4;
+  return Result;
+}
+
+static bool
+GetFormatCodec(image_format Format, format_codec& Result)
+{
+  uint8 const R[4]    = { 0, PaddingChannel, PaddingChannel, PaddingChannel };
+  uint8 const RG[4]   = { 0, 1, PaddingChannel, PaddingChannel };
+  uint8 const RGB[4]  = { 0, 1, 2, PaddingChannel };
+  uint8 const RGBA[4] = { 0, 1, 2, 3 };
+  uint8 const BGR[4]  = { 2, 1, 0, PaddingChannel };
+  uint8 const BGRA[4] = { 2, 1, 0, 3 };
+  uint8 const BGRX[4] = { 2, 1, 0, PaddingChannel };
+  uint8 const A[4]    = { 3, PaddingChannel, PaddingChannel, PaddingChannel };
+
+  switch(Format)
+  {
+    case image_format::R32G32B32A32_FLOAT:  Result = PlainCodec(channel_type::Float32, 4, RGBA);       return true;
+    case image_format::R32G32B32_FLOAT:     Result = PlainCodec(channel_type::Float32, 3, RGB);        return true;
+    case image_format::R32G32_FLOAT:        Result = PlainCodec(channel_type::Float32, 2, RG);         return true;
+    case image_format::R32_FLOAT:           Result = PlainCodec(channel_type::Float32, 1, R);          return true;
+
+    case image_format::R16G16B16A16_FLOAT:  Result = PlainCodec(channel_type::Float16, 4, RGBA);       return true;
+    case image_format::R16G16B16A16_UNORM:  Result = PlainCodec(channel_type::UNorm16, 4, RGBA);       return true;
+    case image_format::R16G16B16A16_SNORM:  Result = PlainCodec(channel_type::SNorm16, 4, RGBA);       return true;
+    case image_format::R16G16_FLOAT:        Result = PlainCodec(channel_type::Float16, 2, RG);         return true;
+    case image_format::R16G16_UNORM:        Result = PlainCodec(channel_type::UNorm16, 2, RG);         return true;
+    case image_format::R16G16_SNORM:        Result = PlainCodec(channel_type::SNorm16, 2, RG);         return true;
+    case image_format::R16_FLOAT:           Result = PlainCodec(channel_type::Float16, 1, R);          return true;
+    case image_format::R16_UNORM:           Result = PlainCodec(channel_type::UNorm16, 1, R);          return true;
+    case image_format::R16_SNORM:           Result = PlainCodec(channel_type::SNorm16, 1, R);          return true;
+
+    case image_format::R8G8B8A8_UNORM:      Result = PlainCodec(channel_type::UNorm8,  4, RGBA);       return true;
+    case image_format::R8G8B8A8_UNORM_SRGB: Result = PlainCodec(channel_type::UNorm8,  4, RGBA, true); return true;
+    case image_format::R8G8B8A8_SNORM:      Result = PlainCodec(channel_type::SNorm8,  4, RGBA);       return true;
+    case image_format::B8G8R8A8_UNORM:      Result = PlainCodec(channel_type::UNorm8,  4, BGRA);       return true;
+    case image_format::B8G8R8A8_UNORM_SRGB: Result = PlainCodec(channel_type::UNorm8,  4, BGRA, true); return true;
+    case image_format::B8G8R8X8_UNORM:      Result = PlainCodec(channel_type::UNorm8,  4, BGRX);       return true;
+    case image_format::B8G8R8X8_UNORM_SRGB: Result = PlainCodec(channel_type::UNorm8,  4, BGRX, true); return true;
+    case image_format::B8G8R8_UNORM:        Result = PlainCodec(channel_type::UNorm8,  3, BGR);        return true;
+    case image_format::R8G8_UNORM:          Result = PlainCodec(channel_type::UNorm8,  2, RG);         return true;
+    case image_format::R8G8_SNORM:          Result = PlainCodec(channel_type::SNorm8,  2, RG);         return true;
+    case image_format::R8_UNORM:            Result = PlainCodec(channel_type::UNorm8,  1, R);          return true;
+    case image_format::R8_SNORM:            Result = PlainCodec(channel_type::SNorm8,  1, R);          return true;
+    case image_format::A8_UNORM:            Result = PlainCodec(channel_type::UNorm8,  1, A);          return true;
+
+    //                                                               R   G   B   A          R   G   B   A
+    case image_format::R10G10B10A2_UNORM:   Result = PackedCodec(4, { 10, 10, 10, 2 },  {  0, 10, 20, 30 }); return true;
+    case image_format::B5G6R5_UNORM:        Result = PackedCodec(2, {  5,  6,  5, 0 },  { 11,  5,  0,  0 }); return true;
+    case image_format::B5G5R5A1_UNORM:      Result = PackedCodec(2, {  5,  5,  5, 1 },  { 10,  5,  0, 15 }); return true;
+    case image_format::B4G4R4A4_UNORM:      Result = PackedCodec(2, {  4,  4,  4, 4 },  {  8,  4,  0, 12 }); return true;
+
+    case image_format::R11G11B10_FLOAT:     Result = SpecialCodec(codec_kind::R11G11B10); return true;
+    case image_format::R9G9B9E5_SHAREDEXP:  Result = SpecialCodec(codec_kind::R9G9B9E5);  return true;
+
+    default: return false;
+  }
+}
+
+template<channel_type Type> struct channel_traits;
+
+template<> struct channel_traits<channel_type::UNorm8>
+{
+  using storage = uint8;
+  static float Decode(uint8 Value) { return Value / 255.0f; }
+  static uint8 Encode(float Value) { return uint8(EncodeUNorm(Value, 255)); }
+};
+
+template<> struct channel_traits<channel_type::SNorm8>
+{
+  using storage = int8;
+  static float Decode(int8 Value) { return DecodeSNorm(Value, 127); }
+  static int8 Encode(float Value) { return int8(EncodeSNorm(Value, 127)); }
+};
+
+template<> struct channel_traits<channel_type::UNorm16>
+{
+  using storage = uint16;
+  static float Decode(uint16 Value) { return Value / 65535.0f; }
+  static uint16 Encode(float Value) { return uint16(EncodeUNorm(Value, 65535)); }
+};
+
+template<> struct channel_traits<channel_type::SNorm16>
+{
+  using storage = int16;
+  static float Decode(int16 Value) { return DecodeSNorm(Value, 32767); }
+  static int16 Encode(float Value) { return int16(EncodeSNorm(Value, 32767)); }
+};
+
+template<> struct channel_traits<channel_type::Float16>
+{
+  using storage = uint16;
+  static float Decode(uint16 Value) { return HalfToFloat(Value); }
+  static uint16 Encode(float Value) { return FloatToHalf(Value); }
+};
+
+template<> struct channel_traits<channel_type::Float32>
+{
+  using storage = float;
+  static float Decode(float Value) { return Value; }
+  static float Encode(float Value) { return Value; }
+};
+
+#if IMAGE_CONVERSION_SIMD
+/// Converts the halfs in the lower 16 bits of each lane, the same way HalfToFloat() does.
+static __m128
+HalfToFloatSSE2(__m128i Halfs)
+{
+  __m128i const MaskNoSign = _mm_set1_epi32(0x7FFF);
+  __m128 const Magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+  __m128i const WasInfNaN = _mm_set1_epi32(0x7BFF);
+  __m128i const ExponentInfNaN = _mm_set1_epi32(255 << 23);
+
+  // Shift exponent and mantissa into place and fix the exponent bias with a
+  // multiplication, which also normalizes denormals.
+  __m128i const ExponentMantissa = _mm_and_si128(MaskNoSign, Halfs);
+  __m128i const Sign = _mm_slli_epi32(_mm_xor_si128(Halfs, ExponentMantissa), 16);
+  __m128 const Scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(ExponentMantissa, 13)), Magic);
+
+  __m128i const IsInfNaN = _mm_cmpgt_epi32(ExponentMantissa, WasInfNaN);
+  __m128i const InfNaN = _mm_and_si128(IsInfNaN, ExponentInfNaN);
+
+  return _mm_or_ps(Scaled, _mm_castsi128_ps(_mm_or_si128(Sign, InfNaN)));
+}
+
+/// \brief Converts 4 floats to halfs the same way FloatToHalf() does.
+///
+/// The halfs end up in the lower 16 bits of each lane, sign extended so
+/// that _mm_packs_epi32() keeps them intact.
+static __m128i
+FloatToHalfSSE2(__m128 Floats)
+{
+  __m128i const Infinity = _mm_set1_epi32(0x7C00);
+  __m128i const QuietNaNBit = _mm_set1_epi32(0x200);
+
+  // Everything from 2^16 up becomes infinity, everything below 2^-14 is denormal.
+  __m128i const MinInfinity = _mm_set1_epi32((127 + 16) << 23);
+  __m128i const MinNormal = _mm_set1_epi32((127 - 14) << 23);
+
+  // Adding this aligns denormals at the bottom of the mantissa, rounding them to nearest even.
+  __m128i const DenormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+
+  // Fixes the exponent bias and rounds up from half way, except for the ties of even values.
+  __m128i const NormalBias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+
+  __m128 const SignMask = _mm_castsi128_ps(_mm_set1_epi32(int(0x80000000u)));
+  __m128 const Sign = _mm_and_ps(SignMask, Floats);
+  __m128 const Magnitude = _mm_xor_ps(Floats, Sign);
+  __m128i const MagnitudeBits = _mm_castps_si128(Magnitude);
+
+  __m128i const IsNaN = _mm_castps_si128(_mm_cmpunord_ps(Magnitude, Magnitude));
+  __m128i const IsFinite = _mm_cmpgt_epi32(MinInfinity, MagnitudeBits);
+  __m128i const InfNaN = _mm_or_si128(Infinity, _mm_and_si128(IsNaN, QuietNaNBit));
+
+  __m128i const IsDenormal = _mm_cmpgt_epi32(MinNormal, MagnitudeBits);
+  __m128i const Denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(Magnitude, _mm_castsi128_ps(DenormalMagic))), DenormalMagic);
+
+  __m128i const MantissaIsOdd = _mm_srai_epi32(_mm_slli_epi32(MagnitudeBits, 31 - 13), 31);
+  __m128i const Normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(MagnitudeBits, NormalBias), MantissaIsOdd), 13);
+
+  __m128i const Finite = _mm_or_si128(_mm_and_si128(IsDenormal, Denormal), _mm_andnot_si128(IsDenormal, Normal));
+  __m128i const Result = _mm_or_si128(_mm_and_si128(IsFinite, Finite), _mm_andnot_si128(IsFinite, InfNaN));
+
+  return _mm_or_si128(Result, _mm_srai_epi32(_mm_castps_si128(Sign), 16));
+}
+#endif
+
+template<channel_type Type>
+static void
+DecodePlainRow(format_codec const& Codec, uint8 const* Row, uint32 Width, float* Pixels)
+{
+  using traits = channel_traits<Type>;
+  auto Channels = Reinterpret<typename traits::storage const*>(Row);
+  uint32 X = 0;
+
+  #if IMAGE_CONVERSION_SIMD
+  bool const IsRGBA = Codec.NumChannels == 4 && Codec.Swizzle[0] == 0 && Codec.Swizzle[3] == 3;
+  if(Type == channel_type::Float32 && IsRGBA)
+  {
+    MemCopyBytes(Bytes(Width * 4 * sizeof(float)), Pixels, Row);
+    return;
+  }
+
+  if(Type == channel_type::Float16 && IsRGBA)
+  {
+    __m128i const Zero = _mm_setzero_si128();
+    for(; X < Width; ++X)
+    {
+      __m128i const Halfs = _mm_loadl_epi64(Reinterpret<__m128i const*>(Channels + 4 * X));
+      _mm_storeu_ps(Pixels + 4 * X, HalfToFloatSSE2(_mm_unpacklo_epi16(Halfs, Zero)));
+    }
+    return;
+  }
+  #endif
+
+  for(; X < Width; ++X)
+  {
+    float* Pixel = Pixels + 4 * X;
+    Pixel[0] = 0.0f;
+    Pixel[1] = 0.0f;
+    Pixel[2] = 0.0f;
+    Pixel[3] = 1.0f;
+
+    for(uint32 Channel = 0; Channel < Codec.NumChannels; ++Channel)
+    {
+      uint32 const Component = Codec.Swizzle[Channel];
+      if(Component != PaddingChannel)
+        Pixel[Component] = traits::Decode(Channels[X * Codec.NumChannels + Channel]);
+    }
+  }
+}
+
+template<channel_type Type>
+static void
+EncodePlainRow(format_codec const& Codec, float const* Pixels, uint32 Width, uint8* Row)
+{
+  using traits = channel_traits<Type>;
+  auto Channels = Reinterpret<typename traits::storage*>(Row);
+
+  uint32 X = 0;
+
+  #if IMAGE_CONVERSION_SIMD
+  bool const IsRGBA = Codec.NumChannels == 4 && Codec.Swizzle[0] == 0 && Codec.Swizzle[3] == 3;
+  if(Type == channel_type::Float32 && IsRGBA)
+  {
+    MemCopyBytes(Bytes(Width * 4 * sizeof(float)), Row, Pixels);
+    return;
+  }
+
+  if(Type == channel_type::Float16 && IsRGBA)
+  {
+    for(; X + 2 <= Width; X += 2)
+    {
+      __m128i const First = FloatToHalfSSE2(_mm_loadu_ps(Pixels + 4 * X));
+      __m128i const Second = FloatToHalfSSE2(_mm_loadu_ps(Pixels + 4 * X + 4));
+      _mm_storeu_si128(Reinterpret<__m128i*>(Channels + 4 * X), _mm_packs_epi32(First, Second));
+    }
+  }
+  #endif
+
+  for(; X < Width; ++X)
+  {
+    for(uint32 Channel = 0; Channel < Codec.NumChannels; ++Channel)
+    {
+      uint32 const Component = Codec.Swizzle[Channel];
+      float const Value = Component == PaddingChannel ? 1.0f : Pixels[4 * X + Component];
+      Channels[X * Codec.NumChannels + Channel] = traits::Encode(Value);
+    }
+  }
+}
+
+/// UNORM8 formats come with sRGB and BGRA variants and are by far the most common, so they get their own.
+template<>
+void
+DecodePlainRow<channel_type::UNorm8>(format_codec const& Codec, uint8 const* Row, uint32 Width, float* Pixels)
+{
+  auto const& Tables = ConversionTables();
+  uint32 X = 0;
+
+  #if IMAGE_CONVERSION_SIMD
+  if(Codec.NumChannels == 4 && !Codec.IsSRGB && Codec.Swizzle[1] == 1 && Codec.Swizzle[3] == 3)
+  {
+    bool const SwapRB = Codec.Swizzle[0] == 2;
+    __m128 const Scale = _mm_set1_ps(255.0f);
+    __m128i const Zero = _mm_setzero_si128();
+
+    for(; X + 4 <= Width; X += 4)
+    {
+      __m128i const Packed = _mm_loadu_si128(Reinterpret<__m128i const*>(Row + 4 * X));
+      __m128i const Low = _mm_unpacklo_epi8(Packed, Zero);
+      __m128i const High = _mm_unpackhi_epi8(Packed, Zero);
+      __m128i const Channels[4] = {
+        _mm_unpacklo_epi16(Low, Zero), _mm_unpackhi_epi16(Low, Zero),
+        _mm_unpacklo_epi16(High, Zero), _mm_unpackhi_epi16(High, Zero),
+      };
+
+      for(uint32 Index = 0; Index < 4; ++Index)
+      {
+        // Divide instead of multiplying with the reciprocal to get the same results as the tables.
+        __m128 Pixel = _mm_div_ps(_mm_cvtepi32_ps(Channels[Index]), Scale);
+        if(SwapRB)
+          Pixel = _mm_shuffle_ps(Pixel, Pixel, _MM_SHUFFLE(3, 0, 1, 2));
+        _mm_storeu_ps(Pixels + 4 * (X + Index), Pixel);
+      }
+    }
+  }
+  #endif
+
+  float const* ComponentTables[4];
+  for(uint32 Component = 0; Component < 4; ++Component)
+    ComponentTables[Component] = Codec.IsSRGB && Component < 3 ? Tables.SrgbToLinear : Tables.UNorm8ToFloat;
+
+  for(; X < Width; ++X)
+  {
+    float* Pixel = Pixels + 4 * X;
+    Pixel[0] = 0.0f;
+    Pixel[1] = 0.0f;
+    Pixel[2] = 0.0f;
+    Pixel[3] = 1.0f;
+
+    for(uint32 Channel = 0; Channel < Codec.NumChannels; ++Channel)
+    {
+      uint32 const Component = Codec.Swizzle[Channel];
+      if(Component != PaddingChannel)
+        Pixel[Component] = ComponentTables[Component][Row[X * Codec.NumChannels + Channel]];
+    }
+  }
+}
+
+template<>
+void
+EncodePlainRow<channel_type::UNorm8>(format_codec const& Codec, float const* Pixels, uint32 Width, uint8* Row)
+{
+  auto const& Tables = ConversionTables();
+  uint32 X = 0;
+
+  #if IMAGE_CONVERSION_SIMD
+  if(Codec.NumChannels == 4 && !Codec.IsSRGB && Codec.Swizzle[1] == 1 && Codec.Swizzle[3] == 3)
+  {
+    bool const SwapRB = Codec.Swizzle[0] == 2;
+    __m128 const Scale = _mm_set1_ps(255.0f);
+    __m128 const Half = _mm_set1_ps(0.5f);
+    __m128 const Zero = _mm_setzero_ps();
+
+    for(; X + 4 <= Width; X += 4)
+    {
+      __m128i Channels[4];
+      for(uint32 Index = 0; Index < 4; ++Index)
+      {
+        __m128 Pixel = _mm_loadu_ps(Pixels + 4 * (X + Index));
+        if(SwapRB)
+          Pixel = _mm_shuffle_ps(Pixel, Pixel, _MM_SHUFFLE(3, 0, 1, 2));
+
+        // The same as EncodeUNorm(), max() with the second operand being 0 also maps NaN to 0.
+        Pixel = _mm_min_ps(_mm_max_ps(Pixel, Zero), _mm_set1_ps(1.0f));
+        Channels[Index] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(Pixel, Scale), Half));
+      }
+
+      __m128i const Low = _mm_packs_epi32(Channels[0], Channels[1]);
+      __m128i const High = _mm_packs_epi32(Channels[2], Channels[3]);
+      _mm_storeu_si128(Reinterpret<__m128i*>(Row + 4 * X), _mm_packus_epi16(Low, High));
+    }
+  }
+  #endif
+
+  for(; X < Width; ++X)
+  {
+    for(uint32 Channel = 0; Channel < Codec.NumChannels; ++Channel)
+    {
+      uint32 const Component = Codec.Swizzle[Channel];
+      uint8& Value = Row[X * Codec.NumChannels + Channel];
+      if(Component == PaddingChannel)
+        Value = 255;
+      else if(Codec.IsSRGB && Component < 3)
+        Value = EncodeSrgb(Tables, Pixels[4 * X + Component]);
+      else
+        Value = uint8(EncodeUNorm(Pixels[4 * X + Component], 255));
+    }
+  }
+}
+
+static void
+DecodePackedUNormRow(format_codec const& Codec, uint8 const* Row, uint32 Width, float* Pixels)
+{
+  for(uint32 X = 0; X < Width; ++X)
+  {
+    uint32 const Value = Codec.BytesPerPixel == 2 ? Reinterpret<uint16 const*>(Row)[X] : Reinterpret<uint32 const*>(Row)[X];
+    for(uint32 Component = 0; Component < 4; ++Component)
+    {
+      if(Codec.Bits[Component] == 0)
+      {
+        Pixels[4 * X + Component] = Component == 3 ? 1.0f : 0.0f;
+      }
+      else
+      {
+        uint32 const MaxValue = (1u << Codec.Bits[Component]) - 1;
+        Pixels[4 * X + Component] = float((Value >> Codec.Shifts[Component]) & MaxValue) / MaxValue;
+      }
+    }
+  }
+}
+
+static void
+EncodePackedUNormRow(format_codec const& Codec, float const* Pixels, uint32 Width, uint8* Row)
+{
+  for(uint32 X = 0; X < Width; ++X)
+  {
+    uint32 Value = 0;
+    for(uint32 Component = 0; Component < 4; ++Component)
+    {
+      if(Codec.Bits[Component] != 0)
+      {
+        uint32 const MaxValue = (1u << Codec.Bits[Component]) - 1;
+        Value |= EncodeUNorm(Pixels[4 * X + Component], MaxValue) << Codec.Shifts[Component];
+      }
+    }
+
+    if(Codec.BytesPerPixel == 2)
+      Reinterpret<uint16*>(Row)[X] = uint16(Value);
+    else
+      Reinterpret<uint32*>(Row)[X] = Value;
+  }
+}
+
+static void
+DecodeR11G11B10Row(format_codec const& Codec, uint8 const* Row, uint32 Width, float* Pixels)
+{
+  auto Values = Reinterpret<uint32 const*>(Row);
+  for(uint32 X = 0; X < Width; ++X)
+  {
+    Pixels[4 * X + 0] = DecodeSmallFloat( Values[X]        & 0x7FF, 6);
+    Pixels[4 * X + 1] = DecodeSmallFloat((Values[X] >> 11) & 0x7FF, 6);
+    Pixels[4 * X + 2] = DecodeSmallFloat((Values[X] >> 22) & 0x3FF, 5);
+    Pixels[4 * X + 3] = 1.0f;
+  }
+}
+
+static void
+EncodeR11G11B10Row(format_codec const& Codec, float const* Pixels, uint32 Width, uint8* Row)
+{
+  // There is no sign bit.
+  auto Positive = [](float Value){ return Value < 0.0f ? 0.0f : Value; };
+
+  auto Values = Reinterpret<uint32*>(Row);
+  for(uint32 X = 0; X < Width; ++X)
+  {
+    Values[X] = (EncodeSmallFloat(Positive(Pixels[4 * X + 0]), 6)      ) |
+                (EncodeSmallFloat(Positive(Pixels[4 * X + 1]), 6) << 11) |
+                (EncodeSmallFloat(Positive(Pixels[4 * X + 2]), 5) << 22);
+  }
+}
+
+static void
+DecodeR9G9B9E5Row(format_codec const& Codec, uint8 const* Row, uint32 Width, float* Pixels)
+{
+  auto Values = Reinterpret<uint32 const*>(Row);
+  for(uint32 X = 0; X < Width; ++X)
+  {
+    // 2^(Exponent - Bias - MantissaBits)
+    float const Scale = BitsToFloat(((Values[X] >> 27) - 15 - 9 + 127) << 23);
+    Pixels[4 * X + 0] = float( Values[X]        & 0x1FF) * Scale;
+    Pixels[4 * X + 1] = float((Values[X] >>  9) & 0x1FF) * Scale;
+    Pixels[4 * X + 2] = float((Values[X] >> 18) & 0x1FF) * Scale;
+    Pixels[4 * X + 3] = 1.0f;
+  }
+}
+
+static void
+EncodeR9G9B9E5Row(format_codec const& Codec, float const* Pixels, uint32 Width, uint8* Row)
+{
+  // (2^9 - 1) / 2^9 * 2^(31 - 15)
+  float const MaxValue = 65408.0f;
+
+  auto Values = Reinterpret<uint32*>(Row);
+  for(uint32 X = 0; X < Width; ++X)
+  {
+    // Also maps NaN to 0.
+    float Color[3];
+    for(uint32 Component = 0; Component < 3; ++Component)
+    {
+      float const Value = Pixels[4 * X + Component];
+      Color[Component] = Value > 0.0f ? Min(Value, MaxValue) : 0.0f;
+    }
+
+    float const MaxComponent = Max(Max(Color[0], Color[1]), Color[2]);
+    if(MaxComponent == 0.0f)
+    {
+      Values[X] = 0;
+      continue;
+    }
+
+    // The shared exponent as in the specification of EXT_texture_shared_exponent.
+    int FloorLog2;
+    std::frexp(MaxComponent, &FloorLog2);
+    FloorLog2 -= 1;
+
+    int Exponent = Max(-16, FloorLog2) + 1 + 15;
+    float Scale = std::ldexp(1.0f, Exponent - 15 - 9);
+    if(uint32(MaxComponent / Scale + 0.5f) == 512)
+    {
+      ++Exponent;
+      Scale *= 2.0f;
+    }
+
+    uint32 Result = uint32(Exponent) << 27;
+    for(uint32 Component = 0; Component < 3; ++Component)
+      Result |= uint32(Color[Component] / Scale + 0.5f) << (9 * Component);
+    Values[X] = Result;
+  }
+}
+
+using decode_row = void (*)(format_codec const& Codec, uint8 const* Row, uint32 Width, float* Pixels);
+using encode_row = void (*)(format_codec const& Codec, float const* Pixels, uint32 Width, uint8* Row);
+
+static decode_row
+SelectRowDecoder(format_codec const& Codec)
+{
+  switch(Codec.Kind)
+  {
+    case codec_kind::PackedUNorm: return &DecodePackedUNormRow;
+    case codec_kind::R11G11B10:   return &DecodeR11G11B10Row;
+    case codec_kind::R9G9B9E5:    return &DecodeR9G9B9E5Row;
+    default: break;
+  }
+
+  switch(Codec.Type)
+  {
+    case channel_type::UNorm8:  return &DecodePlainRow<channel_type::UNorm8>;
+    case channel_type::SNorm8:  return &DecodePlainRow<channel_type::SNorm8>;
+    case channel_type::UNorm16: return &DecodePlainRow<channel_type::UNorm16>;
+    case channel_type::SNorm16: return &DecodePlainRow<channel_type::SNorm16>;
+    case channel_type::Float16: return &DecodePlainRow<channel_type::Float16>;
+    default:                    return &DecodePlainRow<channel_type::Float32>;
+  }
+}
+
+static encode_row
+SelectRowEncoder(format_codec const& Codec)
+{
+  switch(Codec.Kind)
+  {
+    case codec_kind::PackedUNorm: return &EncodePackedUNormRow;
+    case codec_kind::R11G11B10:   return &EncodeR11G11B10Row;
+    case codec_kind::R9G9B9E5:    return &EncodeR9G9B9E5Row;
+    default: break;
+  }
+
+  switch(Codec.Type)
+  {
+    case channel_type::UNorm8:  return &EncodePlainRow<channel_type::UNorm8>;
+    case channel_type::SNorm8:  return &EncodePlainRow<channel_type::SNorm8>;
+    case channel_type::UNorm16: return &EncodePlainRow<channel_type::UNorm16>;
+    case channel_type::SNorm16: return &EncodePlainRow<channel_type::SNorm16>;
+    case channel_type::Float16: return &EncodePlainRow<channel_type::Float16>;
+    default:                    return &EncodePlainRow<channel_type::Float32>;
+  }
+}
+
+
+//
+// Direct Conversions
+//
+
+// Conversions between the 8 bit RGBA and BGRA formats don't need to go
+// through floats. There is one kernel for every combination of the
+// template parameters, picked by SelectDirectRowConverter().
+
+enum class srgb_conversion
+{
+  None,
+  ToSrgb,
+  ToLinear,
+};
+
+using convert_row = void (*)(uint8 const* Source, uint32 Width, uint8* Target);
+
+template<bool SwapRB, bool ForceOpaque, srgb_conversion Conversion>
+static void
+ConvertRow8888(uint8 const* Source, uint32 Width, uint8* Target)
+{
+  uint32 X = 0;
+
+  #if IMAGE_CONVERSION_SIMD
+  if(Conversion == srgb_conversion::None)
+  {
+    __m128i const GreenAlpha = _mm_set1_epi32(int(0xFF00FF00u));
+    __m128i const Alpha = _mm_set1_epi32(int(0xFF000000u));
+
+    for(; X + 4 <= Width; X += 4)
+    {
+      __m128i Pixels = _mm_loadu_si128(Reinterpret<__m128i const*>(Source + 4 * X));
+      if(SwapRB)
+      {
+        __m128i const RedBlue = _mm_andnot_si128(GreenAlpha, Pixels);
+        __m128i const BlueRed = _mm_or_si128(_mm_slli_epi32(RedBlue, 16), _mm_srli_epi32(RedBlue, 16));
+        Pixels = _mm_or_si128(_mm_and_si128(Pixels, GreenAlpha), BlueRed);
+      }
+      if(ForceOpaque)
+        Pixels = _mm_or_si128(Pixels, Alpha);
+      _mm_storeu_si128(Reinterpret<__m128i*>(Target + 4 * X), Pixels);
+    }
+  }
+  #endif
+
+  auto const& Tables = ConversionTables8();
+  uint8 const* ColorTable = Conversion == srgb_conversion::ToSrgb   ? Tables.LinearToSrgb8 :
+                            Conversion == srgb_conversion::ToLinear ? Tables.SrgbToLinear8 : nullptr;
+
+  for(; X < Width; ++X)
+  {
+    uint8 const* In = Source + 4 * X;
+    uint8* Out = Target + 4 * X;
+
+    uint8 Color[3] = { In[SwapRB ? 2 : 0], In[1], In[SwapRB ? 0 : 2] };
+    for(uint32 Component = 0; Component < 3; ++Component)
+      Out[Component] = ColorTable ? ColorTable[Color[Component]] : Color[Component];
+    Out[3] = ForceOpaque ? 255 : In[3];
+  }
+}
+
+static bool
+IsFormat8888(image_format Format, bool& IsBGR, bool& IsSRGB, bool& HasAlpha)
+{
+  switch(Format)
+  {
+    case image_format::R8G8B8A8_UNORM:      IsBGR = false; IsSRGB = false; HasAlpha = true;  return true;
+    case image_format::R8G8B8A8_UNORM_SRGB: IsBGR = false; IsSRGB = true;  HasAlpha = true;  return true;
+    case image_format::B8G8R8A8_UNORM:      IsBGR = true;  IsSRGB = false; HasAlpha = true;  return true;
+    case image_format::B8G8R8A8_UNORM_SRGB: IsBGR = true;  IsSRGB = true;  HasAlpha = true;  return true;
+    case image_format::B8G8R8X8_UNORM:      IsBGR = true;  IsSRGB = false; HasAlpha = false; return true;
+    case image_format::B8G8R8X8_UNORM_SRGB: IsBGR = true;  IsSRGB = true;  HasAlpha = false; return true;
+    default:                                return false;
+  }
+}
+
+/// \return \c nullptr if there is no direct conversion between the formats.
+static convert_row
+SelectDirectRowConverter(image_format SourceFormat, image_format TargetFormat)
+{
+  bool SourceIsBGR, SourceIsSRGB, SourceHasAlpha;
+  bool TargetIsBGR, TargetIsSRGB, TargetHasAlpha;
+  if(!IsFormat8888(SourceFormat, SourceIsBGR, SourceIsSRGB, SourceHasAlpha) ||
+     !IsFormat8888(TargetFormat, TargetIsBGR, TargetIsSRGB, TargetHasAlpha))
+  {
+    return nullptr;
+  }
+
+  using c = srgb_conversion;
+  static convert_row const Kernels[2][2][3] = {
+    { { &ConvertRow8888<false, false, c::None>, &ConvertRow8888<false, false, c::ToSrgb>, &ConvertRow8888<false, false, c::ToLinear> },
+      { &ConvertRow8888<false, true,  c::None>, &ConvertRow8888<false, true,  c::ToSrgb>, &ConvertRow8888<false, true,  c::ToLinear> } },
+    { { &ConvertRow8888<true,  false, c::None>, &ConvertRow8888<true,  false, c::ToSrgb>, &ConvertRow8888<true,  false, c::ToLinear> },
+      { &ConvertRow8888<true,  true,  c::None>, &ConvertRow8888<true,  true,  c::ToSrgb>, &ConvertRow8888<true,  true,  c::ToLinear> } },
+  };
+
+  bool const SwapRB = SourceIsBGR != TargetIsBGR;
+  // Padding is always written as 255, like the conversions through floats do.
+  bool const ForceOpaque = !SourceHasAlpha || !TargetHasAlpha;
+  auto const Conversion = SourceIsSRGB == TargetIsSRGB ? c::None :
+                          TargetIsSRGB                 ? c::ToSrgb : c::ToLinear;
+
+  return Kernels[SwapRB][ForceOpaque][int(Conversion)];
+}
+
+
+//
+// Image Conversion
+//
+
+namespace
+{
+  /// A range of rows of a single depth slice of a sub-image.
+  struct conversion_row_job
+  {
+    uint32 MipLevel;
+    uint32 Face;
+    uint32 ArrayIndex;
+    uint32 Z;
+    uint32 FirstRow;
+    uint32 NumRows;
+  };
+}
+
+static void
+GatherConversionRowJobs(image_header const& Header, array<conversion_row_job>& Jobs)
+{
+  for(uint32 ArrayIndex = 0; ArrayIndex < Header.NumArrayIndices; ++ArrayIndex)
+  {
+    for(uint32 Face = 0; Face < Header.NumFaces; ++Face)
+    {
+      for(uint32 MipLevel = 0; MipLevel < Header.NumMipLevels; ++MipLevel)
+      {
+        uint32 const Height = ImageHeight(Header, MipLevel);
+        for(uint32 Z = 0; Z < ImageDepth(Header, MipLevel); ++Z)
+        {
+          for(uint32 Row = 0; Row < Height; Row += IMAGE_CONVERSION_ROWS_PER_JOB)
+          {
+            auto& Job = Expand(Jobs);
+            Job.MipLevel = MipLevel;
+            Job.Face = Face;
+            Job.ArrayIndex = ArrayIndex;
+            Job.Z = Z;
+            Job.FirstRow = Row;
+            Job.NumRows = Min(Height - Row, uint32(IMAGE_CONVERSION_ROWS_PER_JOB));
+          }
+        }
+      }
+    }
+  }
+}
+
+static void
+RunConversionJob(conversion_row_job const& Job, image const& Source, image const& Target, uint8* TargetData)
+{
+  uint32 const Width = ImageWidth(Source, Job.MipLevel);
+  uint32 const SourcePitch = ImageRowPitch(Source, Job.MipLevel);
+  uint32 const TargetPitch = ImageRowPitch(Target, Job.MipLevel);
+
+  uint8 const* SourceRow = ImageData(Source).Ptr
+                         + ImageDataOffSet(Source, Job.MipLevel, Job.Face, Job.ArrayIndex)
+                         + Job.Z * ImageDepthPitch(Source, Job.MipLevel)
+                         + Job.FirstRow * SourcePitch;
+  uint8* TargetRow = TargetData
+                   + ImageDataOffSet(Target, Job.MipLevel, Job.Face, Job.ArrayIndex)
+                   + Job.Z * ImageDepthPitch(Target, Job.MipLevel)
+                   + Job.FirstRow * TargetPitch;
+
+  if(Source.Format == Target.Format)
+  {
+    MemCopyBytes(Bytes(Job.NumRows * SourcePitch), TargetRow, SourceRow);
+    return;
+  }
+
+  if(auto Convert = SelectDirectRowConverter(Source.Format, Target.Format))
+  {
+    for(uint32 Row = 0; Row < Job.NumRows; ++Row)
+      Convert(SourceRow + Row * SourcePitch, Width, TargetRow + Row * TargetPitch);
+    return;
+  }
+
+  format_codec SourceCodec, TargetCodec;
+  GetFormatCodec(Source.Format, SourceCodec);
+  GetFormatCodec(Target.Format, TargetCodec);
+  auto const Decode = SelectRowDecoder(SourceCodec);
+  auto const Encode = SelectRowEncoder(TargetCodec);
+
+  array<float> Pixels{};
+  Defer [&](){ Reset(Pixels); };
+  SetNum(Pixels, Width * 4);
+
+  for(uint32 Row = 0; Row < Job.NumRows; ++Row)
+  {
+    Decode(SourceCodec, SourceRow + Row * SourcePitch, Width, Pixels.Ptr);
+    Encode(TargetCodec, Pixels.Ptr, Width, TargetRow + Row * TargetPitch);
+  }
+}
+
+
+//
+// Public API
+//
+
+auto
+::ImageFormatIsConvertible(image_format Format)
+  -> bool
+{
+  format_codec Unused;
+  return GetFormatCodec(Format, Unused);
+}
+
+auto
+::ImageDecodeRow(image_format Format, void const* Row, uint32 Width, float* Pixels)
+  -> bool
+{
+  format_codec Codec;
+  if(!GetFormatCodec(Format, Codec))
+    return false;
+
+  SelectRowDecoder(Codec)(Codec, Reinterpret<uint8 const*>(Row), Width, Pixels);
+  return true;
+}
+
+auto
+::ImageEncodeRow(image_format Format, float const* Pixels, uint32 Width, void* Row)
+  -> bool
+{
+  format_codec Codec;
+  if(!GetFormatCodec(Format, Codec))
+    return false;
+
+  SelectRowEncoder(Codec)(Codec, Pixels, Width, Reinterpret<uint8*>(Row));
+  return true;
+}
+
+auto
+::ImageCanConvert(image_format Source, image_format Target)
+  -> bool
+{
+  return ImageFormatIsConvertible(Source) && ImageFormatIsConvertible(Target);
+}
+
+auto
+::ImageConvert(image& Target, image const& Source, image_format Format, uint32 NumThreads)
+  -> bool
+{
+  Assert(&Target != &Source);
+
+  if(!ImageCanConvert(Source.Format, Format))
+  {
+    LogError("Converting images from %s to %s is not supported.",
+             ImageFormatName(Source.Format), ImageFormatName(Format));
+    return false;
+  }
+
+  if(ImageDataSize(Source) == 0)
+  {
+    LogError("The source image has no data.");
+    return false;
+  }
+
+  static_cast<image_header&>(Target) = Source;
+  Target.Format = Format;
+  ImageAllocateData(Target);
+  uint8* TargetData = ImageData(Target).Ptr;
+
+  array<conversion_row_job> Jobs{};
+  Defer [&](){ Reset(Jobs); };
+  GatherConversionRowJobs(Target, Jobs);
+
+  ParallelFor(Jobs.Num, [&](size_t JobIndex)
+  {
+    RunConversionJob(Jobs[JobIndex], Source, Target, TargetData);
+  }, NumThreads);
+
+  return true;
+}
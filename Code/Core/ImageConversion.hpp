@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+#include "Image.hpp"
+
+#include <Backbone.hpp>
+
+
+/// \brief Whether pixels of the given format can be converted to and from linear floats.
+///
+/// These are the linear 8, 16 and 32 bit UNORM, SNORM and FLOAT formats,
+/// including their SRGB and BGR variants, and the packed formats
+/// R10G10B10A2_UNORM, R11G11B10_FLOAT, R9G9B9E5_SHAREDEXP, B5G6R5_UNORM,
+/// B5G5R5A1_UNORM and B4G4R4A4_UNORM.
+CORE_API
+bool
+ImageFormatIsConvertible(image_format Format);
+
+/// \brief Converts a row of \a Width pixels to linear RGBA floats, 4 per pixel.
+///
+/// SRGB values are linearized. Missing color channels become 0 and a missing
+/// alpha channel becomes 1.
+///
+/// \return \c false if the format isn't convertible.
+CORE_API
+bool
+ImageDecodeRow(image_format Format, void const* Row, uint32 Width, float* Pixels);
+
+/// \brief Converts a row of \a Width linear RGBA pixels, 4 floats each, to the given format.
+///
+/// Values that don't fit into the format are clamped. Channels the format
+/// doesn't have are dropped.
+///
+/// \return \c false if the format isn't convertible.
+CORE_API
+bool
+ImageEncodeRow(image_format Format, float const* Pixels, uint32 Width, void* Row);
+
+/// \brief Whether ImageConvert() supports converting from \a Source to \a Target.
+CORE_API
+bool
+ImageCanConvert(image_format Source, image_format Target);
+
+/// \brief Converts all sub-images of \a Source into \a Format.
+///
+/// Conversions between 8 bit RGBA and BGRA formats use dedicated kernels.
+/// All others go through linear floats, one row at a time. The work is split
+/// into rows and runs on up to \a NumThreads threads (0 picks the number of
+/// hardware threads).
+///
+/// \return \c false if either format isn't convertible.
+CORE_API
+bool
+ImageConvert(image& Target, image const& Source, image_format Format, uint32 NumThreads = 0);
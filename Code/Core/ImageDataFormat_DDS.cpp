@@ -140,9 +140,10 @@ ConsumeAndReadInto(slice<void const>* Data, T& Result)
   return true;
 }
 
-auto
-image_loader_dds::LoadImageFromData(slice<void const> RawImageData, image& ResultImage)
-  -> bool
+/// If \a Storage is given, the image borrows its data from \a RawImageData
+/// instead of copying it.
+static bool
+LoadDds(slice<void const> RawImageData, image& ResultImage, image_external_storage* Storage)
 {
   if(!RawImageData)
     return false;
@@ -217,7 +218,7 @@ image_loader_dds::LoadImageFromData(slice<void const> RawImageData, image& Resul
   {
     if(FileHeader.Ddspf.FourCC == DdsDxt10FourCc)
     {
-      if(ConsumeAndReadInto(&RawImageData, HeaderDxt10))
+      if(!ConsumeAndReadInto(&RawImageData, HeaderDxt10))
       {
         LogError("Failed to read file header.");
         return false;
@@ -267,7 +268,7 @@ image_loader_dds::LoadImageFromData(slice<void const> RawImageData, image& Resul
     return false;
   }
 
-  if(HasMipMaps)
+  if(HasMipMaps && FileHeader.MipMapCount > 0)
   {
     ResultImage.NumMipLevels = FileHeader.MipMapCount;
   }
@@ -288,7 +289,29 @@ image_loader_dds::LoadImageFromData(slice<void const> RawImageData, image& Resul
     ResultImage.Depth = FileHeader.Depth;
   }
 
-  ImageAllocateData(ResultImage);
+  if(IsDxt10)
+  {
+    if(HeaderDxt10.MiscFlag & dds_resource_misc_flags::TEXTURECUBE)
+      ResultImage.NumFaces = 6;
+
+    if(HeaderDxt10.ResourceDimension == dds_resource_dimension::TEXTURE3D)
+      ResultImage.Depth = Max(FileHeader.Depth, 1u);
+
+    ResultImage.NumArrayIndices = Max(HeaderDxt10.ArraySize, 1u);
+  }
+
+  if(Storage)
+  {
+    if(!ImageBorrowData(ResultImage, RawImageData, Storage))
+    {
+      LogError("Failed to read image data.");
+      return false;
+    }
+  }
+  else
+  {
+    ImageAllocateData(ResultImage);
+  }
 
   // If pitch is specified, it must match the computed value
   if(HasPitch && ImageRowPitch(ResultImage, 0) != FileHeader.PitchOrLinearSize)
@@ -297,6 +320,9 @@ image_loader_dds::LoadImageFromData(slice<void const> RawImageData, image& Resul
     return false;
   }
 
+  if(Storage)
+    return true;
+
   uint32 DataSize = ImageDataSize(ResultImage);
 
   if(!ConsumeAndReadInto(&RawImageData, Slice(DataSize, ImageDataPointer<void>(ResultImage))))
@@ -309,11 +335,239 @@ image_loader_dds::LoadImageFromData(slice<void const> RawImageData, image& Resul
 
 }
 
+auto
+image_loader_dds::LoadImageFromData(slice<void const> RawImageData, image& ResultImage)
+  -> bool
+{
+  return LoadDds(RawImageData, ResultImage, nullptr);
+}
+
+auto
+image_loader_dds::BorrowImageFromData(slice<void const> RawImageData, image_external_storage* Storage, image& ResultImage)
+  -> bool
+{
+  Assert(Storage);
+  return LoadDds(RawImageData, ResultImage, Storage);
+}
+
+/// Whether the format can be described without the DX10 header extension.
+static bool
+CanUseLegacyPixelFormat(image const& Image, dds_pixel_format& PixelFormat)
+{
+  if(Image.NumArrayIndices > 1)
+    return false;
+
+  auto const FourCc = ImageFormatToFourCc(Image.Format);
+  if(FourCc != 0)
+  {
+    PixelFormat.Flags = ddpf_flags::FOURCC;
+    PixelFormat.FourCC = FourCc;
+    return true;
+  }
+
+  if(ImageFormatType(Image.Format) != image_format_type::LINEAR)
+    return false;
+
+  PixelFormat.RGBBitCount = ImageFormatBitsPerPixel(Image.Format);
+  PixelFormat.RBitMask = ImageFormatRedMask(Image.Format);
+  PixelFormat.GBitMask = ImageFormatGreenMask(Image.Format);
+  PixelFormat.BBitMask = ImageFormatBlueMask(Image.Format);
+  PixelFormat.ABitMask = ImageFormatAlphaMask(Image.Format);
+
+  // Several formats share the same masks (e.g. UNORM and SRGB), so only use
+  // them if the reader would come up with the same format again.
+  auto const Roundtrip = ImageFormatFromPixelMask(PixelFormat.RBitMask, PixelFormat.GBitMask,
+                                                  PixelFormat.BBitMask, PixelFormat.ABitMask,
+                                                  PixelFormat.RGBBitCount);
+  if(Roundtrip != Image.Format)
+    return false;
+
+  PixelFormat.Flags = ddpf_flags::RGB;
+  if(PixelFormat.ABitMask)
+    PixelFormat.Flags |= ddpf_flags::ALPHAPIXELS;
+
+  return true;
+}
+
+static bool
+MakeDdsHeaders(image const& Image, dds_header& FileHeader, dds_header_dxt10& HeaderDxt10, bool& IsDxt10)
+{
+  FileHeader = {};
+  HeaderDxt10 = {};
+
+  auto const IsCompressed = ImageFormatType(Image.Format) == image_format_type::BLOCK_COMPRESSED;
+  auto const IsCubeMap = Image.NumFaces == 6;
+  auto const IsVolume = Image.Depth > 1;
+
+  if(Image.NumFaces != 1 && !IsCubeMap)
+  {
+    LogError("DDS files can only store either 1 or 6 faces, not %u.", Image.NumFaces);
+    return false;
+  }
+
+  if(IsCubeMap && IsVolume)
+  {
+    LogError("DDS files can't store volume cubemaps.");
+    return false;
+  }
+
+  FileHeader.Magic = DdsMagic;
+  FileHeader.Size = 124;
+  FileHeader.Flags = ddsd_flags::CAPS | ddsd_flags::HEIGHT | ddsd_flags::WIDTH | ddsd_flags::PIXELFORMAT;
+  FileHeader.Width = Image.Width;
+  FileHeader.Height = Image.Height;
+  FileHeader.Ddspf.Size = 32;
+  FileHeader.Caps = dds_caps::TEXTURE;
+
+  if(IsCompressed)
+  {
+    FileHeader.Flags |= ddsd_flags::LINEARSIZE;
+    FileHeader.PitchOrLinearSize = ImageDepthPitch(Image, 0);
+  }
+  else
+  {
+    FileHeader.Flags |= ddsd_flags::PITCH;
+    FileHeader.PitchOrLinearSize = ImageRowPitch(Image, 0);
+  }
+
+  if(Image.NumMipLevels > 1)
+  {
+    FileHeader.Flags |= ddsd_flags::MIPMAPCOUNT;
+    FileHeader.MipMapCount = Image.NumMipLevels;
+    FileHeader.Caps |= dds_caps::MIPMAP | dds_caps::COMPLEX;
+  }
+
+  if(IsCubeMap)
+  {
+    FileHeader.Caps |= dds_caps::COMPLEX;
+    FileHeader.Caps2 = dds_caps2::CUBEMAP |
+                       dds_caps2::CUBEMAP_POSITIVEX | dds_caps2::CUBEMAP_NEGATIVEX |
+                       dds_caps2::CUBEMAP_POSITIVEY | dds_caps2::CUBEMAP_NEGATIVEY |
+                       dds_caps2::CUBEMAP_POSITIVEZ | dds_caps2::CUBEMAP_NEGATIVEZ;
+  }
+  else if(IsVolume)
+  {
+    FileHeader.Flags |= ddsd_flags::DEPTH;
+    FileHeader.Depth = Image.Depth;
+    FileHeader.Caps |= dds_caps::COMPLEX;
+    FileHeader.Caps2 = dds_caps2::VOLUME;
+  }
+
+  IsDxt10 = !CanUseLegacyPixelFormat(Image, FileHeader.Ddspf);
+  if(!IsDxt10)
+    return true;
+
+  HeaderDxt10.DxgiFormat = ImageFormatToDxgiFormat(Image.Format);
+  if(HeaderDxt10.DxgiFormat == 0)
+  {
+    LogError("The image format %s has no DXGI equivalent.", ImageFormatName(Image.Format));
+    return false;
+  }
+
+  FileHeader.Ddspf = {};
+  FileHeader.Ddspf.Size = 32;
+  FileHeader.Ddspf.Flags = ddpf_flags::FOURCC;
+  FileHeader.Ddspf.FourCC = DdsDxt10FourCc;
+
+  HeaderDxt10.ResourceDimension = IsVolume ? dds_resource_dimension::TEXTURE3D : dds_resource_dimension::TEXTURE2D;
+  HeaderDxt10.MiscFlag = IsCubeMap ? dds_resource_misc_flags::TEXTURECUBE : 0;
+  HeaderDxt10.ArraySize = Image.NumArrayIndices;
+
+  return true;
+}
+
+/// Number of bytes the sub-images occupy, without any padding of the image data.
+static size_t
+DdsPayloadSize(image const& Image)
+{
+  size_t Result = 0;
+  for(uint32 MipLevel = 0; MipLevel < Image.NumMipLevels; ++MipLevel)
+    Result += ImageDepthPitch(Image, MipLevel) * ImageDepth(Image, MipLevel);
+
+  return Result * Image.NumFaces * Image.NumArrayIndices;
+}
+
+auto
+::DdsFileSize(image const& Image)
+  -> size_t
+{
+  dds_header FileHeader;
+  dds_header_dxt10 HeaderDxt10;
+  bool IsDxt10;
+  if(!MakeDdsHeaders(Image, FileHeader, HeaderDxt10, IsDxt10))
+    return 0;
+
+  return sizeof(FileHeader) + (IsDxt10 ? sizeof(HeaderDxt10) : 0) + DdsPayloadSize(Image);
+}
+
+auto
+image_loader_dds::WriteImageToStream(image const& Image, image_output_stream& Stream)
+  -> bool
+{
+  dds_header FileHeader;
+  dds_header_dxt10 HeaderDxt10;
+  bool IsDxt10;
+  if(!MakeDdsHeaders(Image, FileHeader, HeaderDxt10, IsDxt10))
+    return false;
+
+  auto const Data = ImageData(Image);
+  if(Data.Num < DdsPayloadSize(Image))
+  {
+    LogError("The image has no data allocated.");
+    return false;
+  }
+
+  if(!Stream.Write(Slice<void const>(sizeof(FileHeader), &FileHeader)))
+    return false;
+
+  if(IsDxt10 && !Stream.Write(Slice<void const>(sizeof(HeaderDxt10), &HeaderDxt10)))
+    return false;
+
+  // The image stores its sub-images in the same order as DDS files do, so they
+  // can be passed on as they are.
+  for(uint32 ArrayIndex = 0; ArrayIndex < Image.NumArrayIndices; ++ArrayIndex)
+  {
+    for(uint32 Face = 0; Face < Image.NumFaces; ++Face)
+    {
+      for(uint32 MipLevel = 0; MipLevel < Image.NumMipLevels; ++MipLevel)
+      {
+        auto const Offset = ImageDataOffSet(Image, MipLevel, Face, ArrayIndex);
+        auto const Size = ImageDepthPitch(Image, MipLevel) * ImageDepth(Image, MipLevel);
+        if(!Stream.Write(Slice<void const>(Size, Data.Ptr + Offset)))
+        {
+          LogError("Failed to write sub-image (mip %u, face %u, array index %u).", MipLevel, Face, ArrayIndex);
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
 auto
 image_loader_dds::WriteImageToArray(image& Image, array<uint8>& RawImageData)
   -> bool
 {
-  return false;
+  auto const FileSize = DdsFileSize(Image);
+  if(FileSize == 0)
+    return false;
+
+  // Reserve exactly the file size instead of following the array's growth,
+  // but leave that as it is for the caller.
+  Clear(RawImageData);
+  auto const Growth = RawImageData.Growth;
+  RawImageData.Growth = container_growth::Exact;
+  bool const IsReserved = Reserve(RawImageData, FileSize);
+  RawImageData.Growth = Growth;
+  if(!IsReserved)
+  {
+    LogError("Not enough space for the DDS file of %zu bytes.", FileSize);
+    return false;
+  }
+
+  image_output_stream_array Stream{ RawImageData };
+  return WriteImageToStream(Image, Stream);
 }
 
 auto
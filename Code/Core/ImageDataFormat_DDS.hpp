@@ -9,9 +9,17 @@ class image_loader_dds : public image_loader_interface
 {
 public:
   virtual bool LoadImageFromData(slice<void const> RawImageData, image& ResultImage) override;
+  virtual bool BorrowImageFromData(slice<void const> RawImageData, image_external_storage* Storage, image& ResultImage) override;
   virtual bool WriteImageToArray(image& Image, array<uint8>& RawImageData) override;
+  virtual bool WriteImageToStream(image const& Image, image_output_stream& Stream) override;
 };
 
+/// The exact number of bytes image_loader_dds will write for the given image.
+///
+/// \return 0 if the image can't be stored as DDS file.
+CORE_API size_t
+DdsFileSize(image const& Image);
+
 using PFN_CreateImageLoader = image_loader_interface* (*)(allocator_interface& Allocator);
 using PFN_DestroyImageLoader = void (*)(allocator_interface& Allocator, image_loader_interface* Loader);
 
@@ -0,0 +1,462 @@
+#include "ImageDataFormat_KTX2.hpp"
+#include "Image.hpp"
+#include "ImageMipmaps.hpp"
+#include "Parallel.hpp"
+#include "ZstdDecompression.hpp"
+
+#include "Log.hpp"
+
+
+struct ktx2_header {
+  uint8  Identifier[12];
+  uint32 VkFormat;
+  uint32 TypeSize;
+  uint32 PixelWidth;
+  uint32 PixelHeight;
+  uint32 PixelDepth;
+  uint32 LayerCount;
+  uint32 FaceCount;
+  uint32 LevelCount;
+  uint32 SupercompressionScheme;
+
+  // Index
+  uint32 DfdByteOffset;
+  uint32 DfdByteLength;
+  uint32 KvdByteOffset;
+  uint32 KvdByteLength;
+  uint64 SgdByteOffset;
+  uint64 SgdByteLength;
+};
+
+static_assert(sizeof(ktx2_header) == 80, "The KTX2 header must not be padded.");
+
+struct ktx2_level_index {
+  uint64 ByteOffset;
+  uint64 ByteLength;
+  uint64 UncompressedByteLength;
+};
+
+struct ktx2_supercompression_scheme {
+  enum Enum
+  {
+    NONE      = 0,
+    BASIS_LZ  = 1,
+    ZSTANDARD = 2,
+    ZLIB      = 3,
+  };
+};
+
+static uint8 const Ktx2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+/// More levels than this can't exist for 32 bit image dimensions.
+static uint32 const Ktx2MaxLevels = 32;
+
+/// Maps the numeric value of a VkFormat to the matching image format.
+///
+/// The values are spelled out because Core doesn't depend on the Vulkan headers.
+static image_format
+ImageFormatFromVkFormat(uint32 VkFormat)
+{
+  switch(VkFormat)
+  {
+    case 4:   return image_format::B5G6R5_UNORM;        // VK_FORMAT_R5G6B5_UNORM_PACK16
+    case 8:   return image_format::B5G5R5A1_UNORM;      // VK_FORMAT_A1R5G5B5_UNORM_PACK16
+
+    case 9:   return image_format::R8_UNORM;
+    case 10:  return image_format::R8_SNORM;
+    case 13:  return image_format::R8_UINT;
+    case 14:  return image_format::R8_SINT;
+
+    case 16:  return image_format::R8G8_UNORM;
+    case 17:  return image_format::R8G8_SNORM;
+    case 20:  return image_format::R8G8_UINT;
+    case 21:  return image_format::R8G8_SINT;
+
+    case 30:  return image_format::B8G8R8_UNORM;
+
+    case 37:  return image_format::R8G8B8A8_UNORM;
+    case 38:  return image_format::R8G8B8A8_SNORM;
+    case 41:  return image_format::R8G8B8A8_UINT;
+    case 42:  return image_format::R8G8B8A8_SINT;
+    case 43:  return image_format::R8G8B8A8_UNORM_SRGB;
+    case 44:  return image_format::B8G8R8A8_UNORM;
+    case 50:  return image_format::B8G8R8A8_UNORM_SRGB;
+
+    case 64:  return image_format::R10G10B10A2_UNORM;   // VK_FORMAT_A2B10G10R10_UNORM_PACK32
+    case 68:  return image_format::R10G10B10A2_UINT;    // VK_FORMAT_A2B10G10R10_UINT_PACK32
+
+    case 70:  return image_format::R16_UNORM;
+    case 71:  return image_format::R16_SNORM;
+    case 74:  return image_format::R16_UINT;
+    case 75:  return image_format::R16_SINT;
+    case 76:  return image_format::R16_FLOAT;
+
+    case 77:  return image_format::R16G16_UNORM;
+    case 78:  return image_format::R16G16_SNORM;
+    case 81:  return image_format::R16G16_UINT;
+    case 82:  return image_format::R16G16_SINT;
+    case 83:  return image_format::R16G16_FLOAT;
+
+    case 91:  return image_format::R16G16B16A16_UNORM;
+    case 92:  return image_format::R16G16B16A16_SNORM;
+    case 95:  return image_format::R16G16B16A16_UINT;
+    case 96:  return image_format::R16G16B16A16_SINT;
+    case 97:  return image_format::R16G16B16A16_FLOAT;
+
+    case 98:  return image_format::R32_UINT;
+    case 99:  return image_format::R32_SINT;
+    case 100: return image_format::R32_FLOAT;
+    case 101: return image_format::R32G32_UINT;
+    case 102: return image_format::R32G32_SINT;
+    case 103: return image_format::R32G32_FLOAT;
+    case 104: return image_format::R32G32B32_UINT;
+    case 105: return image_format::R32G32B32_SINT;
+    case 106: return image_format::R32G32B32_FLOAT;
+    case 107: return image_format::R32G32B32A32_UINT;
+    case 108: return image_format::R32G32B32A32_SINT;
+    case 109: return image_format::R32G32B32A32_FLOAT;
+
+    case 122: return image_format::R11G11B10_FLOAT;     // VK_FORMAT_B10G11R11_UFLOAT_PACK32
+    case 123: return image_format::R9G9B9E5_SHAREDEXP;  // VK_FORMAT_E5B9G9R9_UFLOAT_PACK32
+
+    case 124: return image_format::D16_UNORM;
+    case 126: return image_format::D32_FLOAT;
+    case 129: return image_format::D24_UNORM_S8_UINT;
+
+    case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+    case 133: return image_format::BC1_UNORM;
+    case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+    case 134: return image_format::BC1_UNORM_SRGB;
+    case 135: return image_format::BC2_UNORM;
+    case 136: return image_format::BC2_UNORM_SRGB;
+    case 137: return image_format::BC3_UNORM;
+    case 138: return image_format::BC3_UNORM_SRGB;
+    case 139: return image_format::BC4_UNORM;
+    case 140: return image_format::BC4_SNORM;
+    case 141: return image_format::BC5_UNORM;
+    case 142: return image_format::BC5_SNORM;
+    case 143: return image_format::BC6H_UF16;
+    case 144: return image_format::BC6H_SF16;
+    case 145: return image_format::BC7_UNORM;
+    case 146: return image_format::BC7_UNORM_SRGB;
+
+    case 1000340000: return image_format::B4G4R4A4_UNORM; // VK_FORMAT_A4R4G4B4_UNORM_PACK16
+
+    default: break;
+  }
+
+  return image_format::UNKNOWN;
+}
+
+/// Multiplies \a Value by \a Factor, unless the result would exceed \a Limit.
+static bool
+MultiplyWithinLimit(uint64& Value, uint64 Factor, uint64 Limit)
+{
+  if(Factor != 0 && Value > Limit / Factor)
+    return false;
+
+  Value *= Factor;
+  return true;
+}
+
+/// The size of one mip level of all faces and layers, computed from the
+/// header alone so it can be checked before anything is allocated.
+///
+/// \return \c false if the level is bigger than \a Limit.
+static bool
+Ktx2LevelSize(image const& Image, uint32 Level, uint64 Limit, uint64& LevelSize)
+{
+  auto const BitsPerPixel = ImageFormatBitsPerPixel(Image.Format);
+  if(ImageFormatType(Image.Format) == image_format_type::BLOCK_COMPRESSED)
+  {
+    LevelSize = uint64(ImageNumBlocksX(Image, Level)) * 4 * 4 * BitsPerPixel / 8;
+    if(!MultiplyWithinLimit(LevelSize, ImageNumBlocksY(Image, Level), Limit))
+      return false;
+  }
+  else
+  {
+    LevelSize = uint64(ImageWidth(Image, Level)) * BitsPerPixel / 8;
+    if(!MultiplyWithinLimit(LevelSize, ImageHeight(Image, Level), Limit))
+      return false;
+  }
+
+  return MultiplyWithinLimit(LevelSize, ImageDepth(Image, Level), Limit) &&
+         MultiplyWithinLimit(LevelSize, Image.NumFaces, Limit) &&
+         MultiplyWithinLimit(LevelSize, Image.NumArrayIndices, Limit);
+}
+
+static char const*
+SupercompressionSchemeName(uint32 Scheme)
+{
+  switch(Scheme)
+  {
+    case ktx2_supercompression_scheme::BASIS_LZ: return "BasisLZ";
+    case ktx2_supercompression_scheme::ZLIB:     return "zlib";
+    default:                                     return "unknown";
+  }
+}
+
+/// If \a Storage is given, the image borrows its data from \a RawImageData
+/// instead of copying it, as long as the file is neither supercompressed nor
+/// has more than one mip level.
+static bool
+LoadKtx2(slice<void const> RawImageData, image& ResultImage, image_external_storage* Storage, uint32 NumThreads)
+{
+  if(!RawImageData)
+    return false;
+
+  auto const FileData = SliceReinterpret<uint8 const>(RawImageData);
+
+  ktx2_header FileHeader;
+  if(FileData.Num < sizeof(FileHeader))
+  {
+    LogError("Failed to read file header.");
+    return false;
+  }
+  MemCopy(sizeof(FileHeader), Reinterpret<uint8*>(&FileHeader), FileData.Ptr);
+
+  if(Slice(FileHeader.Identifier) != Slice(Ktx2Identifier))
+  {
+    LogError("The file is not a recognized KTX2 file.");
+    return false;
+  }
+
+  auto const Scheme = FileHeader.SupercompressionScheme;
+  if(Scheme != ktx2_supercompression_scheme::NONE && Scheme != ktx2_supercompression_scheme::ZSTANDARD)
+  {
+    LogError("The %s supercompression scheme (%u) is not supported.", SupercompressionSchemeName(Scheme), Scheme);
+    return false;
+  }
+
+  if(FileHeader.VkFormat == 0)
+  {
+    LogError("Formats that are only described by the data format descriptor are not supported.");
+    return false;
+  }
+
+  auto const Format = ImageFormatFromVkFormat(FileHeader.VkFormat);
+  if(Format == image_format::UNKNOWN)
+  {
+    LogError("The VkFormat %u has no equivalent image format.", FileHeader.VkFormat);
+    return false;
+  }
+
+  if(FileHeader.PixelWidth == 0)
+  {
+    LogError("The image has a width of 0.");
+    return false;
+  }
+
+  if(FileHeader.FaceCount != 1 && FileHeader.FaceCount != 6)
+  {
+    LogError("KTX2 files can only store either 1 or 6 faces, not %u.", FileHeader.FaceCount);
+    return false;
+  }
+
+  // A count of 0 means the dimension isn't used, which amounts to 1 here. A
+  // level count of 0 asks for mipmaps to be generated, which is left to the
+  // caller (see image_load_options::GenerateMipmaps).
+  ResultImage.Format = Format;
+  ResultImage.Width = FileHeader.PixelWidth;
+  ResultImage.Height = Max(FileHeader.PixelHeight, 1u);
+  ResultImage.Depth = Max(FileHeader.PixelDepth, 1u);
+  ResultImage.NumArrayIndices = Max(FileHeader.LayerCount, 1u);
+  ResultImage.NumFaces = FileHeader.FaceCount;
+  ResultImage.NumMipLevels = Max(FileHeader.LevelCount, 1u);
+
+  auto const NumLevels = ResultImage.NumMipLevels;
+  if(NumLevels > ImageFullMipChainLength(ResultImage))
+  {
+    LogError("The file has %u mip levels, but the image can have at most %u.", NumLevels, ImageFullMipChainLength(ResultImage));
+    return false;
+  }
+  Assert(NumLevels <= Ktx2MaxLevels);
+
+  ktx2_level_index Levels[Ktx2MaxLevels];
+  if(FileData.Num - sizeof(FileHeader) < NumLevels * sizeof(ktx2_level_index))
+  {
+    LogError("Failed to read the level index.");
+    return false;
+  }
+  MemCopy(NumLevels * sizeof(ktx2_level_index), Reinterpret<uint8*>(Levels), FileData.Ptr + sizeof(FileHeader));
+
+  for(uint32 Level = 0; Level < NumLevels; ++Level)
+  {
+    if(Levels[Level].ByteOffset > FileData.Num || Levels[Level].ByteLength > FileData.Num - Levels[Level].ByteOffset)
+    {
+      LogError("The data of mip level %u lies outside of the file.", Level);
+      return false;
+    }
+  }
+
+  auto const IsSupercompressed = Scheme == ktx2_supercompression_scheme::ZSTANDARD;
+
+  // The header decides how much memory is allocated, so it has to agree with
+  // the level index before anything is. Image data is addressed with 32 bit
+  // offsets, which limits the total size.
+  uint64 const MaxDataSize = uint64(IntMaxValue<int32>());
+  uint64 DataSize = 0;
+  for(uint32 Level = 0; Level < NumLevels; ++Level)
+  {
+    uint64 LevelSize;
+    if(!Ktx2LevelSize(ResultImage, Level, MaxDataSize - DataSize, LevelSize))
+    {
+      LogError("The image is too big.");
+      return false;
+    }
+    DataSize += LevelSize;
+
+    auto const StoredSize = IsSupercompressed ? Levels[Level].UncompressedByteLength : Levels[Level].ByteLength;
+    if(StoredSize != LevelSize)
+    {
+      LogError("The size of mip level %u doesn't match the expected size.", Level);
+      return false;
+    }
+
+    // KTX2 writers store each level as a single frame. Recording its size is
+    // optional, but if it is there, it has to agree as well.
+    size_t ContentSize;
+    if(IsSupercompressed &&
+       ZstdFrameContentSize(Slice<void const>(Levels[Level].ByteLength, FileData.Ptr + Levels[Level].ByteOffset), ContentSize) &&
+       ContentSize != LevelSize)
+    {
+      LogError("The compressed data of mip level %u doesn't have the expected size.", Level);
+      return false;
+    }
+  }
+
+  auto const NumChunks = ResultImage.NumFaces * ResultImage.NumArrayIndices;
+
+  // With only one level, the layout of the file matches the one of the image.
+  if(Storage && !IsSupercompressed && NumLevels == 1)
+  {
+    auto const LevelData = Slice(FileData, Levels[0].ByteOffset, Levels[0].ByteOffset + Levels[0].ByteLength);
+    if(!ImageBorrowData(ResultImage, SliceReinterpret<void const>(LevelData), Storage))
+    {
+      LogError("Failed to read image data.");
+      return false;
+    }
+
+    return true;
+  }
+
+  ImageAllocateData(ResultImage);
+  auto const TargetData = ImageData(ResultImage).Ptr;
+
+  size_t ScratchOffsets[Ktx2MaxLevels];
+  size_t ScratchSize = 0;
+  for(uint32 Level = 0; Level < NumLevels; ++Level)
+  {
+    ScratchOffsets[Level] = ScratchSize;
+    ScratchSize += ImageMipLevelSize(ResultImage, Level) * NumChunks;
+  }
+
+  // Within a level, KTX2 stores all faces of a layer next to each other, so
+  // unless there is just one of them, they have to be decompressed somewhere
+  // else first and moved to their sub-image from there.
+  array<uint8> Scratch{};
+  Defer [&](){ Reset(Scratch); };
+  if(IsSupercompressed && NumChunks > 1)
+    SetNum(Scratch, ScratchSize);
+
+  bool LevelFailed[Ktx2MaxLevels]{};
+
+  // The level index allows random access, so the levels are independent of each other.
+  ParallelFor(NumLevels, [&](size_t LevelIndex)
+  {
+    auto const Level = Convert<uint32>(LevelIndex);
+    auto const ChunkSize = ImageMipLevelSize(ResultImage, Level);
+    auto const LevelSize = ChunkSize * NumChunks;
+    uint8 const* Source = FileData.Ptr + Levels[Level].ByteOffset;
+
+    if(IsSupercompressed)
+    {
+      auto const Target = NumChunks == 1 ? TargetData + ImageDataOffSet(ResultImage, Level, 0, 0)
+                                         : Scratch.Ptr + ScratchOffsets[Level];
+      size_t NumWritten;
+      if(!ZstdDecompress(Slice<void const>(Levels[Level].ByteLength, Source), Slice(LevelSize, Target), &NumWritten) ||
+         NumWritten != LevelSize)
+      {
+        LevelFailed[Level] = true;
+        return;
+      }
+
+      if(NumChunks == 1)
+        return;
+
+      Source = Target;
+    }
+
+    for(uint32 ArrayIndex = 0; ArrayIndex < ResultImage.NumArrayIndices; ++ArrayIndex)
+    {
+      for(uint32 Face = 0; Face < ResultImage.NumFaces; ++Face)
+      {
+        auto const Chunk = ArrayIndex * ResultImage.NumFaces + Face;
+        MemCopy(ChunkSize, TargetData + ImageDataOffSet(ResultImage, Level, Face, ArrayIndex), Source + Chunk * ChunkSize);
+      }
+    }
+  }, NumThreads);
+
+  for(uint32 Level = 0; Level < NumLevels; ++Level)
+  {
+    if(LevelFailed[Level])
+    {
+      LogError("Failed to decompress mip level %u.", Level);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+auto
+image_loader_ktx2::LoadImageFromData(slice<void const> RawImageData, image& ResultImage)
+  -> bool
+{
+  return LoadKtx2(RawImageData, ResultImage, nullptr, this->NumThreads);
+}
+
+auto
+image_loader_ktx2::BorrowImageFromData(slice<void const> RawImageData, image_external_storage* Storage, image& ResultImage)
+  -> bool
+{
+  Assert(Storage);
+  return LoadKtx2(RawImageData, ResultImage, Storage, this->NumThreads);
+}
+
+auto
+image_loader_ktx2::WriteImageToArray(image& Image, array<uint8>& RawImageData)
+  -> bool
+{
+  LogError("Writing KTX2 files is not supported.");
+  return false;
+}
+
+auto
+image_loader_ktx2::SetNumThreads(uint32 NumThreads)
+  -> void
+{
+  this->NumThreads = NumThreads;
+}
+
+auto
+::CreateImageLoader_KTX2(allocator_interface& Allocator)
+  -> image_loader_interface*
+{
+  auto Loader = Allocate<image_loader_ktx2>(Allocator);
+  if(Loader)
+    MemConstruct(1, Loader);
+
+  return Loader;
+}
+
+auto
+::DestroyImageLoader_KTX2(allocator_interface& Allocator, image_loader_interface* Loader)
+  -> void
+{
+  if(Loader)
+  {
+    MemDestruct(1, Loader);
+    Deallocate(Allocator, Loader);
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+#include "ImageLoader.hpp"
+#include "Array.hpp"
+
+
+/// Reads Khronos KTX 2.0 files.
+///
+/// Files without supercompression and files supercompressed with Zstandard
+/// are supported. BasisLZ and zlib supercompression, as well as formats that
+/// are only described by the data format descriptor (vkFormat 0), are not.
+///
+/// Zstandard compressed mip levels are decompressed in parallel.
+class image_loader_ktx2 : public image_loader_interface
+{
+public:
+  /// The number of threads used to decompress mip levels. 0 uses ParallelNumThreads().
+  uint32 NumThreads = 0;
+
+  virtual bool LoadImageFromData(slice<void const> RawImageData, image& ResultImage) override;
+  virtual bool BorrowImageFromData(slice<void const> RawImageData, image_external_storage* Storage, image& ResultImage) override;
+
+  /// Writing KTX2 files is not supported.
+  virtual bool WriteImageToArray(image& Image, array<uint8>& RawImageData) override;
+
+  virtual void SetNumThreads(uint32 NumThreads) override;
+};
+
+extern "C"
+{
+  CORE_API image_loader_interface*
+  CreateImageLoader_KTX2(allocator_interface& Allocator);
+
+  CORE_API void
+  DestroyImageLoader_KTX2(allocator_interface& Allocator, image_loader_interface* Loader);
+}
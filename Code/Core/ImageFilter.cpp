@@ -0,0 +1,352 @@
+#include "ImageFilter.hpp"
+#include "Image.hpp"
+#include "ImageConversion.hpp"
+#include "Parallel.hpp"
+
+#include <cmath>
+
+// The number of target rows that are filtered as one unit of work.
+#if !defined(IMAGE_FILTER_ROWS_PER_JOB)
+  #define IMAGE_FILTER_ROWS_PER_JOB 16
+#endif
+
+// Whether to compile the SSE2 code paths, which are always available on x64.
+#if !defined(IMAGE_FILTER_SIMD)
+  #if defined(_M_X64) || defined(__x86_64__)
+    #define IMAGE_FILTER_SIMD 1
+  #else
+    #define IMAGE_FILTER_SIMD 0
+  #endif
+#endif
+
+#if IMAGE_FILTER_SIMD
+  #include <emmintrin.h>
+#endif
+
+
+auto
+::Finalize(image_filter_taps& Taps)
+  -> void
+{
+  Reset(Taps.Indices);
+  Reset(Taps.Weights);
+}
+
+auto
+::ImageBoxFilterWeight(float Begin, float End)
+  -> float
+{
+  return Max(0.0f, Min(End, 0.5f) - Max(Begin, -0.5f));
+}
+
+auto
+::ImageTentFilterWeight(float Begin, float End)
+  -> float
+{
+  return Max(0.0f, 1.0f - Abs(0.5f * (Begin + End)));
+}
+
+auto
+::ImageComputeFilterTaps(float FilterRadius, image_filter_weight const& FilterWeight,
+                         uint32 SourceSize, uint32 TargetSize,
+                         image_filter_taps& Taps)
+  -> void
+{
+  float const Scale = float(SourceSize) / float(TargetSize);
+
+  // When magnifying, the filter is measured in source pixels instead, so it
+  // still covers enough of them to interpolate in between.
+  float const FilterScale = Max(Scale, 1.0f);
+  float const Radius = FilterRadius * FilterScale;
+
+  auto FirstCandidate = [&](uint32 Target){ return int(std::floor((Target + 0.5f) * Scale - Radius)); };
+  uint32 const NumCandidates = uint32(std::ceil(2.0f * Radius)) + 1;
+
+  auto Weight = [&](uint32 Target, int Source)
+  {
+    float const Center = (Target + 0.5f) * Scale;
+    return FilterWeight((Source - Center) / FilterScale, (Source + 1 - Center) / FilterScale);
+  };
+
+  // Skip the candidates at the border that don't contribute, which matters
+  // most for the box filter.
+  array<int> FirstTaps{};
+  Defer [&](){ Reset(FirstTaps); };
+  SetNum(FirstTaps, TargetSize);
+
+  Taps.NumTaps = 1;
+  for(uint32 Target = 0; Target < TargetSize; ++Target)
+  {
+    int First = FirstCandidate(Target);
+    int Last = First + int(NumCandidates) - 1;
+    while(First < Last && Weight(Target, First) == 0.0f)
+      ++First;
+    while(Last > First && Weight(Target, Last) == 0.0f)
+      --Last;
+
+    FirstTaps[Target] = First;
+    Taps.NumTaps = Max(Taps.NumTaps, uint32(Last - First + 1));
+  }
+
+  SetNum(Taps.Indices, TargetSize * Taps.NumTaps);
+  SetNum(Taps.Weights, TargetSize * Taps.NumTaps);
+
+  for(uint32 Target = 0; Target < TargetSize; ++Target)
+  {
+    uint32* Indices = &Taps.Indices[Target * Taps.NumTaps];
+    float* Weights = &Taps.Weights[Target * Taps.NumTaps];
+
+    float Sum = 0.0f;
+    for(uint32 Tap = 0; Tap < Taps.NumTaps; ++Tap)
+    {
+      int const Source = FirstTaps[Target] + int(Tap);
+      Indices[Tap] = uint32(Clamp(Source, 0, int(SourceSize) - 1));
+      Weights[Tap] = Weight(Target, Source);
+      Sum += Weights[Tap];
+    }
+
+    for(uint32 Tap = 0; Tap < Taps.NumTaps; ++Tap)
+      Weights[Tap] /= Sum;
+  }
+}
+
+auto
+::ImageAccumulateFilterRow(float* Target, float const* Source, float Weight, size_t NumFloats)
+  -> void
+{
+  #if IMAGE_FILTER_SIMD
+  // The rows always consist of whole pixels.
+  __m128 const Weight4 = _mm_set1_ps(Weight);
+  for(size_t Index = 0; Index < NumFloats; Index += 4)
+  {
+    __m128 const Value = _mm_mul_ps(_mm_loadu_ps(Source + Index), Weight4);
+    _mm_storeu_ps(Target + Index, _mm_add_ps(_mm_loadu_ps(Target + Index), Value));
+  }
+  #else
+  for(size_t Index = 0; Index < NumFloats; ++Index)
+    Target[Index] += Weight * Source[Index];
+  #endif
+}
+
+auto
+::ImageFilterRowHorizontally(float const* Source, image_filter_taps const& Taps, uint32 TargetWidth, float* Target)
+  -> void
+{
+  for(uint32 X = 0; X < TargetWidth; ++X)
+  {
+    uint32 const* Indices = &Taps.Indices[X * Taps.NumTaps];
+    float const* Weights = &Taps.Weights[X * Taps.NumTaps];
+
+    #if IMAGE_FILTER_SIMD
+    __m128 Sum = _mm_setzero_ps();
+    for(uint32 Tap = 0; Tap < Taps.NumTaps; ++Tap)
+      Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(Source + 4 * Indices[Tap]), _mm_set1_ps(Weights[Tap])));
+    _mm_storeu_ps(Target + 4 * X, Sum);
+    #else
+    for(uint32 Channel = 0; Channel < 4; ++Channel)
+    {
+      float Sum = 0.0f;
+      for(uint32 Tap = 0; Tap < Taps.NumTaps; ++Tap)
+        Sum += Weights[Tap] * Source[4 * Indices[Tap] + Channel];
+      Target[4 * X + Channel] = Sum;
+    }
+    #endif
+  }
+}
+
+auto
+::ImagePremultiplyAlphaRow(float* Pixels, uint32 Width)
+  -> void
+{
+  #if IMAGE_FILTER_SIMD
+  __m128 const ColorMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+  for(uint32 X = 0; X < Width; ++X)
+  {
+    __m128 const Pixel = _mm_loadu_ps(Pixels + 4 * X);
+    __m128 const Alpha = _mm_shuffle_ps(Pixel, Pixel, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128 const Color = _mm_and_ps(ColorMask, _mm_mul_ps(Pixel, Alpha));
+    _mm_storeu_ps(Pixels + 4 * X, _mm_or_ps(Color, _mm_andnot_ps(ColorMask, Pixel)));
+  }
+  #else
+  for(uint32 X = 0; X < Width; ++X)
+  {
+    float* Pixel = Pixels + 4 * X;
+    Pixel[0] *= Pixel[3];
+    Pixel[1] *= Pixel[3];
+    Pixel[2] *= Pixel[3];
+  }
+  #endif
+}
+
+auto
+::ImageUnpremultiplyAlphaRow(float* Pixels, uint32 Width)
+  -> void
+{
+  #if IMAGE_FILTER_SIMD
+  __m128 const ColorMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+  __m128 const Zero = _mm_setzero_ps();
+  __m128 const One = _mm_set1_ps(1.0f);
+  for(uint32 X = 0; X < Width; ++X)
+  {
+    __m128 const Pixel = _mm_loadu_ps(Pixels + 4 * X);
+    __m128 const Alpha = _mm_shuffle_ps(Pixel, Pixel, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128 const InverseAlpha = _mm_and_ps(_mm_cmpgt_ps(Alpha, Zero), _mm_div_ps(One, Alpha));
+    __m128 const Color = _mm_and_ps(ColorMask, _mm_mul_ps(Pixel, InverseAlpha));
+    _mm_storeu_ps(Pixels + 4 * X, _mm_or_ps(Color, _mm_andnot_ps(ColorMask, Pixel)));
+  }
+  #else
+  for(uint32 X = 0; X < Width; ++X)
+  {
+    float* Pixel = Pixels + 4 * X;
+    float const InverseAlpha = Pixel[3] > 0.0f ? 1.0f / Pixel[3] : 0.0f;
+    Pixel[0] *= InverseAlpha;
+    Pixel[1] *= InverseAlpha;
+    Pixel[2] *= InverseAlpha;
+  }
+  #endif
+}
+
+
+//
+// Passes
+//
+
+namespace
+{
+  /// A range of target rows of one face of one array index.
+  struct filter_row_job
+  {
+    uint32 SubImage;
+    uint32 FirstRow;
+    uint32 NumRows;
+  };
+
+  /// The last few rows of the source image a job has decoded.
+  ///
+  /// The rows needed for one target row are a contiguous range no longer
+  /// than the number of vertical taps, and they only move down from one
+  /// target row to the next, so every row is decoded only once per job.
+  struct filter_row_cache
+  {
+    array<float> Pixels;
+    array<uint32> Rows;
+  };
+}
+
+/// Sub-images are numbered by face first, then by array index.
+static uint32
+FilterSubImageOffset(image const& Image, uint32 MipLevel, uint32 SubImage)
+{
+  uint32 const Face = SubImage % Image.NumFaces;
+  uint32 const ArrayIndex = SubImage / Image.NumFaces;
+  return ImageDataOffSet(Image, MipLevel, Face, ArrayIndex);
+}
+
+static float const*
+FilterSourceRow(image_filter_pass const& Pass, filter_row_cache& Cache, uint32 SubImage, uint32 Y)
+{
+  size_t const RowSize = size_t(Pass.SourceWidth) * 4;
+
+  if(Pass.SourceImage == nullptr)
+    return Pass.SourcePixels + (size_t(SubImage) * Pass.SourceHeight + Y) * RowSize;
+
+  uint32 const Slot = Y % Pass.TapsY.NumTaps;
+  float* Pixels = Cache.Pixels.Ptr + Slot * RowSize;
+  if(Cache.Rows[Slot] != Y)
+  {
+    auto const& Source = *Pass.SourceImage;
+    uint8 const* SourceRow = ImageData(Source).Ptr
+                           + FilterSubImageOffset(Source, 0, SubImage)
+                           + Y * ImageRowPitch(Source, 0);
+    ImageDecodeRow(Source.Format, SourceRow, Pass.SourceWidth, Pixels);
+    if(Pass.PremultiplyAlpha)
+      ImagePremultiplyAlphaRow(Pixels, Pass.SourceWidth);
+    Cache.Rows[Slot] = Y;
+  }
+  return Pixels;
+}
+
+static void
+RunFilterJob(filter_row_job const& Job, image_filter_pass const& Pass)
+{
+  auto const& Target = *Pass.TargetImage;
+
+  size_t const SourceRowSize = size_t(Pass.SourceWidth) * 4;
+  size_t const TargetRowSize = size_t(Pass.TargetWidth) * 4;
+  uint32 const TargetPitch = ImageRowPitch(Target, Pass.TargetMipLevel);
+  uint8* TargetSubImage = Pass.TargetData + FilterSubImageOffset(Target, Pass.TargetMipLevel, Job.SubImage);
+
+  // The source rows filtered vertically, before they are filtered horizontally.
+  array<float> Row{};
+  Defer [&](){ Reset(Row); };
+  SetNum(Row, SourceRowSize);
+
+  // Only needed if the filtered rows aren't stored anyway.
+  array<float> TargetRow{};
+  Defer [&](){ Reset(TargetRow); };
+  if(Pass.TargetPixels == nullptr)
+    SetNum(TargetRow, TargetRowSize);
+
+  filter_row_cache Cache{};
+  Defer [&](){ Reset(Cache.Pixels); Reset(Cache.Rows); };
+  if(Pass.SourceImage)
+  {
+    SetNum(Cache.Pixels, Pass.TapsY.NumTaps * SourceRowSize);
+    SetNum(Cache.Rows, Pass.TapsY.NumTaps);
+    SliceSet(Slice(Cache.Rows), IntMaxValue<uint32>());
+  }
+
+  for(uint32 Y = Job.FirstRow; Y < Job.FirstRow + Job.NumRows; ++Y)
+  {
+    MemSetBytes(Bytes(SourceRowSize * sizeof(float)), Row.Ptr, 0);
+
+    uint32 const* Indices = &Pass.TapsY.Indices[Y * Pass.TapsY.NumTaps];
+    float const* Weights = &Pass.TapsY.Weights[Y * Pass.TapsY.NumTaps];
+    for(uint32 Tap = 0; Tap < Pass.TapsY.NumTaps; ++Tap)
+    {
+      if(Weights[Tap] != 0.0f)
+      {
+        float const* SourceRow = FilterSourceRow(Pass, Cache, Job.SubImage, Indices[Tap]);
+        ImageAccumulateFilterRow(Row.Ptr, SourceRow, Weights[Tap], SourceRowSize);
+      }
+    }
+
+    float* Pixels = Pass.TargetPixels ? Pass.TargetPixels + (size_t(Job.SubImage) * Pass.TargetHeight + Y) * TargetRowSize
+                                      : TargetRow.Ptr;
+    ImageFilterRowHorizontally(Row.Ptr, Pass.TapsX, Pass.TargetWidth, Pixels);
+    if(Pass.PremultiplyAlpha)
+      ImageUnpremultiplyAlphaRow(Pixels, Pass.TargetWidth);
+    ImageEncodeRow(Target.Format, Pixels, Pass.TargetWidth, TargetSubImage + Y * TargetPitch);
+  }
+}
+
+auto
+::Finalize(image_filter_pass& Pass)
+  -> void
+{
+  Finalize(Pass.TapsX);
+  Finalize(Pass.TapsY);
+}
+
+auto
+::ImageRunFilterPass(image_filter_pass const& Pass, uint32 NumSubImages, uint32 NumThreads)
+  -> void
+{
+  array<filter_row_job> Jobs{};
+  Defer [&](){ Reset(Jobs); };
+  for(uint32 SubImage = 0; SubImage < NumSubImages; ++SubImage)
+  {
+    for(uint32 Row = 0; Row < Pass.TargetHeight; Row += IMAGE_FILTER_ROWS_PER_JOB)
+    {
+      auto& Job = Expand(Jobs);
+      Job.SubImage = SubImage;
+      Job.FirstRow = Row;
+      Job.NumRows = Min(Pass.TargetHeight - Row, uint32(IMAGE_FILTER_ROWS_PER_JOB));
+    }
+  }
+
+  ParallelFor(Jobs.Num, [&](size_t JobIndex)
+  {
+    RunFilterJob(Jobs[JobIndex], Pass);
+  }, NumThreads);
+}
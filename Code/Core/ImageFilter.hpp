@@ -0,0 +1,127 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+#include "Array.hpp"
+#include "Event.hpp"
+
+#include <Backbone.hpp>
+
+struct image;
+
+// Building blocks of separable filters on rows of linear RGBA floats, shared
+// by the mipmap generator and the resampler.
+
+/// \brief The weight of a source pixel covering [Begin, End).
+///
+/// Positions are relative to the center of the target pixel and measured in
+/// pixels of the target image when it is smaller than the source, or in
+/// pixels of the source image otherwise.
+using image_filter_weight = delegate<float(float Begin, float End)>;
+
+/// The source pixels that contribute to each target pixel along one axis.
+struct image_filter_taps
+{
+  /// The same for every target pixel, unused taps have a weight of 0.
+  uint32 NumTaps;
+
+  /// Already clamped to the source image.
+  array<uint32> Indices;
+
+  /// Normalized, so the weights of each target pixel add up to 1.
+  array<float> Weights;
+};
+
+CORE_API
+void
+Finalize(image_filter_taps& Taps);
+
+/// \brief The weight of a box filter with a radius of 0.5, for image_filter_weight.
+///
+/// This is the exact coverage, so uneven ratios split the pixels in between.
+CORE_API
+float
+ImageBoxFilterWeight(float Begin, float End);
+
+/// \brief The weight of a tent filter with a radius of 1, for image_filter_weight.
+CORE_API
+float
+ImageTentFilterWeight(float Begin, float End);
+
+/// \brief Computes the taps to filter \a SourceSize pixels down or up to \a TargetSize.
+///
+/// \param FilterRadius How far \a FilterWeight reaches from the center, in
+///                     the same unit as its arguments.
+CORE_API
+void
+ImageComputeFilterTaps(float FilterRadius, image_filter_weight const& FilterWeight,
+                       uint32 SourceSize, uint32 TargetSize,
+                       image_filter_taps& Taps);
+
+/// \brief Target += Weight * Source, for rows of whole RGBA pixels.
+CORE_API
+void
+ImageAccumulateFilterRow(float* Target, float const* Source, float Weight, size_t NumFloats);
+
+/// \brief Filters a row of RGBA pixels horizontally with taps from ImageComputeFilterTaps().
+CORE_API
+void
+ImageFilterRowHorizontally(float const* Source, image_filter_taps const& Taps, uint32 TargetWidth, float* Target);
+
+/// \brief Multiplies the color channels of \a Width RGBA pixels with their alpha.
+CORE_API
+void
+ImagePremultiplyAlphaRow(float* Pixels, uint32 Width);
+
+/// \brief Divides the color channels of \a Width RGBA pixels by their alpha.
+///
+/// Pixels that are fully transparent become black.
+CORE_API
+void
+ImageUnpremultiplyAlphaRow(float* Pixels, uint32 Width);
+
+/// Filters all sub-images of one image, or of one mip level, vertically and
+/// then horizontally.
+struct image_filter_pass
+{
+  uint32 SourceWidth;
+  uint32 SourceHeight;
+
+  /// The rows of the first mip level of this image are decoded as needed, so
+  /// it doesn't have to be converted up front.
+  image const* SourceImage;
+
+  /// All sub-images as linear RGBA floats, one after another. Only used if
+  /// there is no \a SourceImage.
+  float const* SourcePixels;
+
+  /// Rows decoded from \a SourceImage are premultiplied with alpha, and the
+  /// filtered rows are divided by it again before they are stored.
+  bool PremultiplyAlpha;
+
+  image const* TargetImage;
+  uint32 TargetMipLevel;
+  uint32 TargetWidth;
+  uint32 TargetHeight;
+
+  /// The data of \a TargetImage, which the filtered rows are encoded into.
+  uint8* TargetData;
+
+  /// If set, all filtered sub-images are also stored here as linear RGBA
+  /// floats, one after another, e.g. as the source of the next pass.
+  float* TargetPixels;
+
+  image_filter_taps TapsX;
+  image_filter_taps TapsY;
+};
+
+CORE_API
+void
+Finalize(image_filter_pass& Pass);
+
+/// \brief Runs \a Pass for \a NumSubImages sub-images, numbered by face first, then by array index.
+///
+/// The rows of the target are split into bands that run on up to
+/// \a NumThreads threads (0 picks the number of hardware threads).
+CORE_API
+void
+ImageRunFilterPass(image_filter_pass const& Pass, uint32 NumSubImages, uint32 NumThreads);
@@ -349,26 +349,139 @@ enum DXGI_FORMAT
   DXGI_FORMAT_FORCE_UINT = 0xffffffffUL
 };
 
+// All image formats that have an equivalent DXGI format of the same name.
+#define IMAGE_FORMATS_WITH_DXGI_EQUIVALENT(X) \
+  X(R32G32B32A32_TYPELESS) \
+  X(R32G32B32A32_FLOAT) \
+  X(R32G32B32A32_UINT) \
+  X(R32G32B32A32_SINT) \
+  X(R32G32B32_TYPELESS) \
+  X(R32G32B32_FLOAT) \
+  X(R32G32B32_UINT) \
+  X(R32G32B32_SINT) \
+  X(R16G16B16A16_TYPELESS) \
+  X(R16G16B16A16_FLOAT) \
+  X(R16G16B16A16_UNORM) \
+  X(R16G16B16A16_UINT) \
+  X(R16G16B16A16_SNORM) \
+  X(R16G16B16A16_SINT) \
+  X(R32G32_TYPELESS) \
+  X(R32G32_FLOAT) \
+  X(R32G32_UINT) \
+  X(R32G32_SINT) \
+  X(R32G8X24_TYPELESS) \
+  X(D32_FLOAT_S8X24_UINT) \
+  X(R32_FLOAT_X8X24_TYPELESS) \
+  X(X32_TYPELESS_G8X24_UINT) \
+  X(R10G10B10A2_TYPELESS) \
+  X(R10G10B10A2_UNORM) \
+  X(R10G10B10A2_UINT) \
+  X(R10G10B10_XR_BIAS_A2_UNORM) \
+  X(R11G11B10_FLOAT) \
+  X(R8G8B8A8_UNORM) \
+  X(R8G8B8A8_TYPELESS) \
+  X(R8G8B8A8_UNORM_SRGB) \
+  X(R8G8B8A8_UINT) \
+  X(R8G8B8A8_SNORM) \
+  X(R8G8B8A8_SINT) \
+  X(B8G8R8A8_UNORM) \
+  X(B8G8R8X8_UNORM) \
+  X(B8G8R8A8_TYPELESS) \
+  X(B8G8R8A8_UNORM_SRGB) \
+  X(B8G8R8X8_TYPELESS) \
+  X(B8G8R8X8_UNORM_SRGB) \
+  X(R16G16_TYPELESS) \
+  X(R16G16_FLOAT) \
+  X(R16G16_UNORM) \
+  X(R16G16_UINT) \
+  X(R16G16_SNORM) \
+  X(R16G16_SINT) \
+  X(R32_TYPELESS) \
+  X(D32_FLOAT) \
+  X(R32_FLOAT) \
+  X(R32_UINT) \
+  X(R32_SINT) \
+  X(R24G8_TYPELESS) \
+  X(D24_UNORM_S8_UINT) \
+  X(R24_UNORM_X8_TYPELESS) \
+  X(X24_TYPELESS_G8_UINT) \
+  X(R8G8_TYPELESS) \
+  X(R8G8_UNORM) \
+  X(R8G8_UINT) \
+  X(R8G8_SNORM) \
+  X(R8G8_SINT) \
+  X(B5G6R5_UNORM) \
+  X(B5G5R5A1_UNORM) \
+  X(R16_TYPELESS) \
+  X(R16_FLOAT) \
+  X(D16_UNORM) \
+  X(R16_UNORM) \
+  X(R16_UINT) \
+  X(R16_SNORM) \
+  X(R16_SINT) \
+  X(R8_TYPELESS) \
+  X(R8_UNORM) \
+  X(R8_UINT) \
+  X(R8_SNORM) \
+  X(R8_SINT) \
+  X(A8_UNORM) \
+  X(R1_UNORM) \
+  X(R9G9B9E5_SHAREDEXP) \
+  X(BC1_TYPELESS) \
+  X(BC1_UNORM) \
+  X(BC1_UNORM_SRGB) \
+  X(BC2_TYPELESS) \
+  X(BC2_UNORM) \
+  X(BC2_UNORM_SRGB) \
+  X(BC3_TYPELESS) \
+  X(BC3_UNORM) \
+  X(BC3_UNORM_SRGB) \
+  X(BC4_TYPELESS) \
+  X(BC4_UNORM) \
+  X(BC4_SNORM) \
+  X(BC5_TYPELESS) \
+  X(BC5_UNORM) \
+  X(BC5_SNORM) \
+  X(BC6H_TYPELESS) \
+  X(BC6H_UF16) \
+  X(BC6H_SF16) \
+  X(BC7_TYPELESS) \
+  X(BC7_UNORM) \
+  X(BC7_UNORM_SRGB) \
+  X(B4G4R4A4_UNORM)
+
 auto
 ::ImageFormatToDxgiFormat(image_format Format)
   -> uint32
 {
-  // Not Implemented.
-  Assert(false);
-  return 0;
+  switch(Format)
+  {
+    #define X(Name) case image_format::Name: return DXGI_FORMAT_##Name;
+    IMAGE_FORMATS_WITH_DXGI_EQUIVALENT(X)
+    #undef X
+    default: break;
+  }
+
+  return DXGI_FORMAT_UNKNOWN;
 }
 
 auto
 ::ImageFormatFromDxgiFormat(uint32 DxgiFormat)
   -> image_format
 {
-  auto Format = Cast<DXGI_FORMAT>(DxgiFormat);
+  switch(Cast<DXGI_FORMAT>(DxgiFormat))
+  {
+    #define X(Name) case DXGI_FORMAT_##Name: return image_format::Name;
+    IMAGE_FORMATS_WITH_DXGI_EQUIVALENT(X)
+    #undef X
+    default: break;
+  }
 
-  // Not Implemented.
-  Assert(false);
   return image_format::UNKNOWN;
 }
 
+#undef IMAGE_FORMATS_WITH_DXGI_EQUIVALENT
+
 #define MAKE_FOURCC(A, B, C, D) ((A) | ((B) << 8) | ((C) << 16) | ((D) << 24))
 
 auto
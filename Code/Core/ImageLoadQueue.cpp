@@ -0,0 +1,394 @@
+#include "ImageLoadQueue.hpp"
+#include "ImageCache.hpp"
+#include "ImageConversion.hpp"
+#include "ImageLoader.hpp"
+#include "Parallel.hpp"
+#include "Log.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+#if !defined(IMAGE_LOAD_QUEUE_MAX_THREADS)
+  #define IMAGE_LOAD_QUEUE_MAX_THREADS 64
+#endif
+
+// The distance between two reads when pulling borrowed image data into memory.
+#define IMAGE_LOAD_QUEUE_PAGE_SIZE 4096
+
+namespace
+{
+  struct image_load_request
+  {
+    image_load_id Id;
+    arc_string FileName;
+    image_load_options Options;
+    void* UserData;
+
+    image_loader_interface* Loader;
+
+    /// Set if Loader was created for this request.
+    image_loader_factory* Factory;
+
+    bool Success;
+    image Image;
+
+    /// The next request in the same list.
+    image_load_request* Next;
+  };
+
+  /// A singly linked FIFO list.
+  ///
+  /// Requests are linked instead of stored in an array, so moving them from
+  /// one list to another never allocates while the mutex is held.
+  struct image_load_request_list
+  {
+    image_load_request* Head;
+    image_load_request* Tail;
+  };
+}
+
+struct image_load_queue
+{
+  allocator_interface* Allocator;
+
+  std::mutex Mutex;
+
+  /// Signaled when a request is submitted or the queue shuts down.
+  std::condition_variable WorkAvailable;
+
+  /// Signaled when a request has finished.
+  std::condition_variable WorkDone;
+
+  image_load_request_list Submitted;
+  image_load_request_list Completed;
+
+  /// Requests that have been submitted but not received yet.
+  uint32 NumPending;
+
+  uint64 NextId;
+  bool Quit;
+
+  uint32 NumThreads;
+  std::thread Threads[IMAGE_LOAD_QUEUE_MAX_THREADS];
+};
+
+static void
+PushRequest(image_load_request_list& List, image_load_request* Request)
+{
+  Request->Next = nullptr;
+  if(List.Tail)
+    List.Tail->Next = Request;
+  else
+    List.Head = Request;
+  List.Tail = Request;
+}
+
+static image_load_request*
+PopRequest(image_load_request_list& List)
+{
+  auto Request = List.Head;
+  if(Request)
+  {
+    List.Head = Request->Next;
+    if(List.Head == nullptr)
+      List.Tail = nullptr;
+  }
+  return Request;
+}
+
+static void
+DestroyRequest(image_load_queue& Queue, image_load_request* Request)
+{
+  if(Request->Factory)
+    DestroyImageLoader(*Request->Factory, Request->Loader);
+
+  Finalize(Request->Image);
+  Delete(*Queue.Allocator, Request);
+}
+
+/// Reads borrowed image data once, so the page faults happen on the worker
+/// thread instead of the one that uses the image.
+static void
+TouchImageData(image const& Image)
+{
+  if(!ImageIsBorrowed(Image))
+    return;
+
+  auto Data = ImageData(Image);
+  uint8 volatile Sink = 0;
+  for(size_t Offset = 0; Offset < Data.Num; Offset += IMAGE_LOAD_QUEUE_PAGE_SIZE)
+    Sink = Sink + Data[Offset];
+}
+
+static bool
+ProcessImageLoadRequest(image_load_request& Request)
+{
+  auto& Image = Request.Image;
+  auto const& Options = Request.Options;
+
+  image_cache_key CacheKey{};
+  if(Options.Cache && ImageCacheLookup(*Options.Cache, Slice(Request.FileName), Options, Image, CacheKey))
+  {
+    if(Options.PrefetchData)
+      TouchImageData(Image);
+    return true;
+  }
+
+  if(!LoadImageFromFile(*Request.Loader, Image, Slice(Request.FileName)))
+  {
+    LogError("Failed to load image file: %s", StrPtr(Request.FileName));
+    return false;
+  }
+
+  // Each request already runs on its own thread, so the processing steps
+  // below don't need to spread out any further.
+  uint32 const NumThreads = 1;
+
+  if(Options.ConvertTo != image_format::UNKNOWN && Options.ConvertTo != Image.Format)
+  {
+    image Converted{};
+    Init(Converted, *Image.InternalSubImages.Allocator);
+    Defer [&](){ Finalize(Converted); };
+
+    if(!ImageConvert(Converted, Image, Options.ConvertTo, NumThreads))
+      return false;
+
+    Copy(Image, Converted);
+  }
+
+  if(Options.GenerateMipmaps && Image.NumMipLevels == 1 && ImageFullMipChainLength(Image) > 1)
+  {
+    if(ImageCanGenerateMipmaps(Image.Format) && Image.Depth == 1)
+    {
+      image Mipmapped{};
+      Init(Mipmapped, *Image.InternalSubImages.Allocator);
+      Defer [&](){ Finalize(Mipmapped); };
+
+      if(!ImageGenerateMipmaps(Mipmapped, Image, Options.MipFilter, 0, NumThreads))
+        return false;
+
+      Copy(Image, Mipmapped);
+    }
+    else
+    {
+      LogWarning("Unable to generate mipmaps for %s.", StrPtr(Request.FileName));
+    }
+  }
+
+  // A failure to store only costs the processing again next time.
+  if(Options.Cache)
+    ImageCacheStore(*Options.Cache, CacheKey, Image);
+
+  if(Options.PrefetchData)
+    TouchImageData(Image);
+
+  return true;
+}
+
+static void
+ImageLoadWorkerMain(image_load_queue& Queue)
+{
+  while(true)
+  {
+    image_load_request* Request;
+    {
+      std::unique_lock<std::mutex> Lock(Queue.Mutex);
+      Queue.WorkAvailable.wait(Lock, [&](){ return Queue.Quit || Queue.Submitted.Head != nullptr; });
+      if(Queue.Quit)
+        return;
+
+      Request = PopRequest(Queue.Submitted);
+    }
+
+    Request->Success = ProcessImageLoadRequest(*Request);
+    if(!Request->Success)
+    {
+      // Failed requests don't hand out half processed images.
+      Finalize(Request->Image);
+      Init(Request->Image, *Queue.Allocator);
+    }
+
+    {
+      std::lock_guard<std::mutex> Lock(Queue.Mutex);
+      PushRequest(Queue.Completed, Request);
+    }
+    Queue.WorkDone.notify_all();
+  }
+}
+
+static image_load_id
+SubmitRequest(image_load_queue& Queue, slice<char const> FileName,
+              image_loader_interface& Loader, image_loader_factory* Factory,
+              image_load_options const& Options, void* UserData)
+{
+  auto Request = New<image_load_request>(*Queue.Allocator);
+  Request->FileName = FileName;
+  Request->Options = Options;
+  Request->UserData = UserData;
+  Request->Loader = &Loader;
+  Request->Factory = Factory;
+  Init(Request->Image, *Queue.Allocator);
+
+  {
+    std::lock_guard<std::mutex> Lock(Queue.Mutex);
+    Request->Id.Value = ++Queue.NextId;
+    ++Queue.NumPending;
+    PushRequest(Queue.Submitted, Request);
+  }
+  Queue.WorkAvailable.notify_one();
+
+  return Request->Id;
+}
+
+/// Moves the content of \a Request into \a Result and destroys the request.
+static void
+ReceiveRequest(image_load_queue& Queue, image_load_request* Request, image_load_result& Result)
+{
+  Result.Id = Request->Id;
+  Result.FileName = Request->FileName;
+  Result.UserData = Request->UserData;
+  Result.Success = Request->Success;
+  Copy(Result.Image, Request->Image);
+
+  DestroyRequest(Queue, Request);
+}
+
+
+//
+// Public API
+//
+
+auto
+::CreateImageLoadQueue(allocator_interface& Allocator, uint32 NumThreads)
+  -> image_load_queue*
+{
+  if(NumThreads == 0)
+    NumThreads = ParallelNumThreads();
+
+  auto Queue = New<image_load_queue>(Allocator);
+  Queue->Allocator = &Allocator;
+  Queue->NumThreads = Min(NumThreads, uint32(IMAGE_LOAD_QUEUE_MAX_THREADS));
+
+  for(uint32 Index = 0; Index < Queue->NumThreads; ++Index)
+    Queue->Threads[Index] = std::thread(ImageLoadWorkerMain, std::ref(*Queue));
+
+  return Queue;
+}
+
+auto
+::DestroyImageLoadQueue(allocator_interface& Allocator, image_load_queue* Queue)
+  -> void
+{
+  if(Queue == nullptr)
+    return;
+
+  {
+    std::lock_guard<std::mutex> Lock(Queue->Mutex);
+    Queue->Quit = true;
+  }
+  Queue->WorkAvailable.notify_all();
+
+  for(uint32 Index = 0; Index < Queue->NumThreads; ++Index)
+    Queue->Threads[Index].join();
+
+  while(auto Request = PopRequest(Queue->Submitted))
+    DestroyRequest(*Queue, Request);
+  while(auto Request = PopRequest(Queue->Completed))
+    DestroyRequest(*Queue, Request);
+
+  Delete(Allocator, Queue);
+}
+
+auto
+::ImageLoadQueueSubmit(image_load_queue& Queue,
+                       slice<char const> FileName,
+                       image_loader_interface& Loader,
+                       image_load_options const& Options,
+                       void* UserData)
+  -> image_load_id
+{
+  return SubmitRequest(Queue, FileName, Loader, nullptr, Options, UserData);
+}
+
+auto
+::ImageLoadQueueSubmit(image_load_queue& Queue,
+                       slice<char const> FileName,
+                       image_loader_factory& Factory,
+                       image_load_options const& Options,
+                       void* UserData)
+  -> image_load_id
+{
+  auto Loader = CreateImageLoader(Factory);
+  Assert(Loader);
+
+  // Every worker already loads one image at a time, so a loader that spreads
+  // out further would start a pool of threads per worker.
+  Loader->SetNumThreads(1);
+
+  return SubmitRequest(Queue, FileName, *Loader, &Factory, Options, UserData);
+}
+
+auto
+::ImageLoadQueueNumPending(image_load_queue& Queue)
+  -> uint32
+{
+  std::lock_guard<std::mutex> Lock(Queue.Mutex);
+  return Queue.NumPending;
+}
+
+auto
+::ImageLoadQueuePoll(image_load_queue& Queue, image_load_result& Result)
+  -> bool
+{
+  image_load_request* Request;
+  {
+    std::lock_guard<std::mutex> Lock(Queue.Mutex);
+    Request = PopRequest(Queue.Completed);
+    if(Request == nullptr)
+      return false;
+
+    --Queue.NumPending;
+  }
+
+  ReceiveRequest(Queue, Request, Result);
+  return true;
+}
+
+auto
+::ImageLoadQueueWait(image_load_queue& Queue, image_load_result& Result)
+  -> bool
+{
+  image_load_request* Request;
+  {
+    std::unique_lock<std::mutex> Lock(Queue.Mutex);
+    if(Queue.NumPending == 0)
+      return false;
+
+    Queue.WorkDone.wait(Lock, [&](){ return Queue.Completed.Head != nullptr; });
+    Request = PopRequest(Queue.Completed);
+    --Queue.NumPending;
+  }
+
+  ReceiveRequest(Queue, Request, Result);
+  return true;
+}
+
+auto
+::ImageLoadQueueDispatch(image_load_queue& Queue, delegate<void(image_load_result&)> const& Callback)
+  -> uint32
+{
+  image_load_result Result{};
+  Init(Result.Image, *Queue.Allocator);
+  Defer [&](){ Finalize(Result.Image); };
+
+  uint32 NumDispatched = 0;
+  while(ImageLoadQueuePoll(Queue, Result))
+  {
+    Callback(Result);
+    ++NumDispatched;
+  }
+
+  return NumDispatched;
+}
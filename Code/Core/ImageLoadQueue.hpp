@@ -0,0 +1,137 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+#include "Image.hpp"
+#include "ImageMipmaps.hpp"
+#include "Event.hpp"
+#include "String.hpp"
+
+#include <Backbone.hpp>
+
+class image_loader_interface;
+struct image_loader_factory;
+struct image_cache;
+
+/// Loads images on worker threads and hands them back through a completion queue.
+///
+/// Requests are picked up in the order they were submitted, but may finish
+/// in any order.
+struct image_load_queue;
+
+/// Identifies a request. Never 0 for a valid request.
+struct image_load_id { uint64 Value; };
+
+/// What to do with an image on the worker thread after it is loaded.
+struct image_load_options
+{
+  /// Convert the image to this format with ImageConvert(), unless it is UNKNOWN.
+  image_format ConvertTo = image_format::UNKNOWN;
+
+  /// Generate the full mip chain if the image only has one level and its
+  /// format supports it.
+  bool GenerateMipmaps = false;
+
+  image_mip_filter MipFilter = image_mip_filter::Kaiser;
+
+  /// Read memory mapped image data on the worker thread so that it is paged
+  /// in there. Turn this off for images that are streamed in level by level,
+  /// so only the levels that are used get read.
+  bool PrefetchData = true;
+
+  /// Take the processed image from this cache if it is there, and put it
+  /// there otherwise. \see image_cache
+  image_cache* Cache = nullptr;
+};
+
+struct image_load_result
+{
+  image_load_id Id;
+  arc_string FileName;
+  void* UserData;
+
+  /// Whether loading and processing the image succeeded. If not, the image is empty.
+  bool Success;
+
+  image Image;
+};
+
+/// \brief Starts the worker threads of a new queue.
+///
+/// Images are allocated from \a Allocator on the worker threads, so it has
+/// to be thread-safe, like mallocator or a tracking_allocator on top of it.
+///
+/// \param NumThreads The number of worker threads. 0 uses ParallelNumThreads().
+CORE_API
+image_load_queue*
+CreateImageLoadQueue(allocator_interface& Allocator, uint32 NumThreads = 0);
+
+/// \brief Stops the worker threads and discards all requests that haven't been received yet.
+///
+/// Requests that are being worked on are finished first.
+CORE_API
+void
+DestroyImageLoadQueue(allocator_interface& Allocator, image_load_queue* Queue);
+
+/// \brief Submits a request to load the given file with \a Loader.
+///
+/// \a Loader is used on a worker thread and must outlive the request. It
+/// may be shared between requests if its LoadImageFromData() is thread-safe,
+/// as it is for the built-in loaders. Its number of threads is left as it
+/// is; consider setting it to 1 so the workers don't oversubscribe the CPU.
+///
+/// \param UserData Handed back as it is in the result.
+CORE_API
+image_load_id
+ImageLoadQueueSubmit(image_load_queue& Queue,
+                     slice<char const> FileName,
+                     image_loader_interface& Loader,
+                     image_load_options const& Options = {},
+                     void* UserData = nullptr);
+
+/// \brief Like the other overload, but creates a loader for the request from \a Factory.
+///
+/// The loader is limited to one thread, since the workers already load
+/// several images in parallel.
+///
+/// The loader is created on the calling thread. It is destroyed on the thread
+/// that receives the result, or in DestroyImageLoadQueue() if the result is
+/// never received. Either may differ from the submitting thread, so
+/// \a Factory has to be able to destroy loaders on any of them.
+CORE_API
+image_load_id
+ImageLoadQueueSubmit(image_load_queue& Queue,
+                     slice<char const> FileName,
+                     image_loader_factory& Factory,
+                     image_load_options const& Options = {},
+                     void* UserData = nullptr);
+
+/// The number of requests that have been submitted but whose results haven't been received yet.
+CORE_API
+uint32
+ImageLoadQueueNumPending(image_load_queue& Queue);
+
+/// \brief Takes a finished request off the completion queue without waiting.
+///
+/// \a Result.Image must be initialized. It shares the data of the loaded image.
+///
+/// \return \c false if no request has finished.
+CORE_API
+bool
+ImageLoadQueuePoll(image_load_queue& Queue, image_load_result& Result);
+
+/// \brief Like ImageLoadQueuePoll(), but blocks until a request has finished.
+///
+/// \return \c false if there are no pending requests.
+CORE_API
+bool
+ImageLoadQueueWait(image_load_queue& Queue, image_load_result& Result);
+
+/// \brief Calls \a Callback on the calling thread for every request that has finished.
+///
+/// Meant to be called once per frame. The image in the result is finalized
+/// after \a Callback returns, so keep a Copy() of it.
+///
+/// \return The number of results that were dispatched.
+CORE_API
+uint32
+ImageLoadQueueDispatch(image_load_queue& Queue, delegate<void(image_load_result&)> const& Callback);
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "ImageLoader.hpp"
+#include "ImageDataFormat_DDS.hpp"
+#include "ImageDataFormat_KTX2.hpp"
+#include "Image.hpp"
+#include "FileMapping.hpp"
 #include "Log.hpp"
 #include "String.hpp"
 
@@ -10,38 +14,72 @@
 #include <Windows.h> // TODO: Remove this dependency here.
 
 
+/// Keeps a mapped file alive while images borrow its content.
+struct mapped_image_file
+{
+  image_external_storage Storage;
+  allocator_interface* Allocator;
+  file_mapping File;
+};
+
+static void
+ReleaseMappedImageFile(image_external_storage* Storage)
+{
+  auto MappedFile = Reinterpret<mapped_image_file*>(Storage);
+  FileMappingClose(MappedFile->File);
+  Delete(*MappedFile->Allocator, MappedFile);
+}
+
 auto
 ::LoadImageFromFile(image_loader_interface& Loader, image& Image, slice<char const> FileName)
   -> bool
 {
-  temp_allocator Allocator;
+  auto& Allocator = Image.Data.Allocator ? *Image.Data.Allocator : *SharedArrayDefaultAllocator();
+
+  auto MappedFile = New<mapped_image_file>(Allocator);
+  MappedFile->Storage.Release = &ReleaseMappedImageFile;
+  MappedFile->Allocator = &Allocator;
+
+  // Whether the image borrows the file content or not, we let go of our own reference.
+  Defer [=](){ ImageExternalStorageReleaseRef(&MappedFile->Storage); };
+
+  if(!FileMappingOpen(MappedFile->File, FileName))
+    return false;
 
+  // The image data is read straight from the mapped file.
+  return Loader.BorrowImageFromData(MappedFile->File.Data, &MappedFile->Storage, Image);
+}
+
+
+auto
+::WriteImageToFile(image_loader_interface& Loader, image const& Image, slice<char const> FileName)
+  -> bool
+{
   arc_string SzFileName(FileName);
 
-  FILE* File = std::fopen(StrPtr(SzFileName), "rb");
+  FILE* File = std::fopen(StrPtr(SzFileName), "wb");
   if(File == nullptr)
     return false;
 
   Defer [=](){ std::fclose(File); };
 
-  auto const BufferMemorySize = MiB(1);
-  auto Buffer = SliceAllocate<char>(Allocator, BufferMemorySize);
-  if(!Buffer)
-    return false;
-
-  Defer [&](){ SliceDeallocate(Allocator, Buffer); };
+  image_output_stream_file Stream{ File };
+  return Loader.WriteImageToStream(Image, Stream);
+}
 
-  array<char> Content(Allocator);
-  while(!std::feof(File))
-  {
-    auto const NumBytesRead = std::fread(Buffer.Ptr, 1, Buffer.Num, File);
-    auto NewSlice = ExpandBy(Content, NumBytesRead);
-    SliceCopy(NewSlice, AsConst(Buffer));
-  }
+auto
+image_output_stream_array::Write(slice<void const> Data)
+  -> bool
+{
+  Append(*this->Array, SliceReinterpret<uint8 const>(Data));
+  return true;
+}
 
-  auto ContentSlice = Slice(Content);
-  auto RawContentSlice = SliceReinterpret<void const>(ContentSlice);
-  return Loader.LoadImageFromData(AsConst(RawContentSlice), Image);
+auto
+image_output_stream_file::Write(slice<void const> Data)
+  -> bool
+{
+  return std::fwrite(Data.Ptr, 1, Data.Num, this->File) == Data.Num;
 }
 
 
@@ -61,12 +99,56 @@ struct image_loader_module
   arc_string AssociatedFileExtension;
   HMODULE ModuleHandle = nullptr;
   image_loader_factory Factory{};
+  image_loader_registry* Registry = nullptr;
+
+  /// Data that starts with these bytes is loaded with this module.
+  uint8 Magic[IMAGE_LOADER_MAX_MAGIC_SIZE]{};
+  uint32 MagicSize = 0;
+
+  /// The next module whose magic number starts with the same byte.
+  image_loader_module* NextWithSameFirstByte = nullptr;
 };
 
 struct image_loader_registry
 {
   allocator_interface* Allocator;
   array<image_loader_module*> Modules;
+
+  /// The modules with a magic number, by its first byte. Modules with longer
+  /// magic numbers come first in each list.
+  image_loader_module* ModulesByFirstByte[256]{};
+};
+
+namespace
+{
+  /// A loader that is linked into Core.
+  struct builtin_image_loader
+  {
+    char const* Alias;
+    char const* NameOfCreateLoader;
+    char const* NameOfDestroyLoader;
+    PFN_CreateImageLoader CreateLoader;
+    PFN_DestroyImageLoader DestroyLoader;
+    char const* FileExtension;
+    uint8 Magic[IMAGE_LOADER_MAX_MAGIC_SIZE];
+    uint32 MagicSize;
+  };
+}
+
+static builtin_image_loader const BuiltinImageLoaders[] =
+{
+  {
+    "DDS", "CreateImageLoader_DDS", "DestroyImageLoader_DDS",
+    &CreateImageLoader_DDS, &DestroyImageLoader_DDS,
+    ".dds",
+    { 'D', 'D', 'S', ' ' }, 4,
+  },
+  {
+    "KTX2", "CreateImageLoader_KTX2", "DestroyImageLoader_KTX2",
+    &CreateImageLoader_KTX2, &DestroyImageLoader_KTX2,
+    ".ktx2",
+    { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' }, 12,
+  },
 };
 
 auto
@@ -119,6 +201,7 @@ auto
   NewModule->NameOfCreateLoader = NameOfCreateLoader;
   NewModule->NameOfDestroyLoader = NameOfDestroyLoader;
   NewModule->Factory.Allocator = Registry.Allocator;
+  NewModule->Registry = &Registry;
 
   Registry.Modules += NewModule;
 
@@ -152,7 +235,8 @@ auto
 static void
 EnsureImageLoaderFactoryIsReady(image_loader_module* Module)
 {
-  if(Module->ModuleHandle != nullptr)
+  // Built-in loaders don't need a module handle.
+  if(Module->ModuleHandle != nullptr || Module->Factory.CreateImageLoader != nullptr)
     return;
 
   Module->ModuleHandle = GetModuleHandle(StrPtr(Module->ModuleName));
@@ -195,6 +279,96 @@ auto
   return nullptr;
 }
 
+auto
+::RegisterBuiltinImageLoaders(image_loader_registry& Registry)
+  -> void
+{
+  for(auto const& Builtin : BuiltinImageLoaders)
+  {
+    auto Module = RegisterImageLoaderModule(Registry,
+                                            SliceFromString(Builtin.Alias),
+                                            "Core"_S,
+                                            SliceFromString(Builtin.NameOfCreateLoader),
+                                            SliceFromString(Builtin.NameOfDestroyLoader));
+    Module->Factory.CreateImageLoader = Builtin.CreateLoader;
+    Module->Factory.DestroyImageLoader = Builtin.DestroyLoader;
+    AssociateImageLoaderModuleWithFileExtension(*Module, SliceFromString(Builtin.FileExtension));
+    AssociateImageLoaderModuleWithMagic(*Module, Slice(Builtin.MagicSize, Builtin.Magic));
+  }
+}
+
+/// Takes the module out of the list of modules with the same first magic byte.
+static void
+UnlinkImageLoaderModuleMagic(image_loader_module& Module)
+{
+  if(Module.MagicSize == 0)
+    return;
+
+  auto Link = &Module.Registry->ModulesByFirstByte[Module.Magic[0]];
+  while(*Link != &Module)
+    Link = &(*Link)->NextWithSameFirstByte;
+  *Link = Module.NextWithSameFirstByte;
+
+  Module.NextWithSameFirstByte = nullptr;
+  Module.MagicSize = 0;
+}
+
+auto
+::AssociateImageLoaderModuleWithMagic(image_loader_module& Module, slice<uint8 const> Magic)
+  -> void
+{
+  Assert(Magic.Num > 0 && Magic.Num <= IMAGE_LOADER_MAX_MAGIC_SIZE);
+
+  UnlinkImageLoaderModuleMagic(Module);
+
+  SliceCopy(Slice(Magic.Num, Module.Magic), Magic);
+  Module.MagicSize = Convert<uint32>(Magic.Num);
+
+  // Keep longer magic numbers first, so that the most specific one matches.
+  auto Link = &Module.Registry->ModulesByFirstByte[Magic[0]];
+  while(*Link && (*Link)->MagicSize > Module.MagicSize)
+    Link = &(*Link)->NextWithSameFirstByte;
+  Module.NextWithSameFirstByte = *Link;
+  *Link = &Module;
+}
+
+auto
+::GetImageLoaderFactoryByData(image_loader_registry& Registry, slice<void const> Data)
+  -> image_loader_factory*
+{
+  auto const Bytes = SliceReinterpret<uint8 const>(Data);
+  if(Bytes.Num == 0)
+    return nullptr;
+
+  for(auto Module = Registry.ModulesByFirstByte[Bytes[0]]; Module; Module = Module->NextWithSameFirstByte)
+  {
+    if(Module->MagicSize <= Bytes.Num && Slice(Module->MagicSize, &Module->Magic[0]) == Slice(Bytes, 0, Module->MagicSize))
+    {
+      EnsureImageLoaderFactoryIsReady(Module);
+      return &Module->Factory;
+    }
+  }
+
+  return nullptr;
+}
+
+auto
+::GetImageLoaderFactoryByFileContent(image_loader_registry& Registry, slice<char const> FileName)
+  -> image_loader_factory*
+{
+  arc_string SzFileName(FileName);
+
+  FILE* File = std::fopen(StrPtr(SzFileName), "rb");
+  if(File == nullptr)
+    return nullptr;
+
+  uint8 Magic[IMAGE_LOADER_MAX_MAGIC_SIZE];
+  auto const NumBytesRead = std::fread(Magic, 1, sizeof(Magic), File);
+  std::fclose(File);
+
+  return GetImageLoaderFactoryByData(Registry, Slice<void const>(NumBytesRead, Magic));
+}
+
 auto
 ::CreateImageLoader(image_loader_factory& Factory)
   -> image_loader_interface*
@@ -6,13 +6,70 @@
 
 #include <Backbone.hpp>
 
+#include <cstdio>
+
 struct image;
+struct image_external_storage;
+
+/// Receives serialized image data piece by piece.
+class image_output_stream
+{
+public:
+  virtual bool Write(slice<void const> Data) = 0;
+};
+
+/// Appends everything to an array.
+///
+/// \note Reserve enough memory in the array up front to avoid reallocations.
+class CORE_API image_output_stream_array : public image_output_stream
+{
+public:
+  array<uint8>* Array{};
+
+  image_output_stream_array(array<uint8>& Array) : Array(&Array) {}
+
+  virtual bool Write(slice<void const> Data) override;
+};
+
+/// Writes directly to a file.
+class CORE_API image_output_stream_file : public image_output_stream
+{
+public:
+  FILE* File{};
+
+  image_output_stream_file(FILE* File) : File(File) {}
+
+  virtual bool Write(slice<void const> Data) override;
+};
 
 class image_loader_interface
 {
 public:
   virtual bool LoadImageFromData(slice<void const> RawImageData, image& ResultImage) = 0;
+
+  /// Like LoadImageFromData() but the image may borrow its data from
+  /// \a RawImageData instead of copying it. \a Storage keeps \a RawImageData
+  /// alive. \see ImageBorrowData()
+  ///
+  /// Loaders that need to convert the data just copy it.
+  virtual bool BorrowImageFromData(slice<void const> RawImageData, image_external_storage* Storage, image& ResultImage)
+  {
+    return LoadImageFromData(RawImageData, ResultImage);
+  }
+
   virtual bool WriteImageToArray(image& Image, array<uint8>& RawImageData) = 0;
+
+  /// Writes the image to \a Stream without building the whole file in memory first.
+  virtual bool WriteImageToStream(image const& Image, image_output_stream& Stream)
+  {
+    return false;
+  }
+
+  /// Limits the number of threads a loader that loads in parallel may use.
+  /// 0 uses ParallelNumThreads(). Loaders that don't use threads ignore this.
+  virtual void SetNumThreads(uint32 NumThreads)
+  {
+  }
 };
 
 using PFN_CreateImageLoader = image_loader_interface* (*)(allocator_interface& Allocator);
@@ -21,6 +78,14 @@ using PFN_DestroyImageLoader = void (*)(allocator_interface& Allocator, image_lo
 CORE_API bool
 LoadImageFromFile(image_loader_interface& Loader, image& Image, slice<char const> FileName);
 
+CORE_API bool
+WriteImageToFile(image_loader_interface& Loader, image const& Image, slice<char const> FileName);
+
+/// The longest magic number a file format can be recognized by.
+#if !defined(IMAGE_LOADER_MAX_MAGIC_SIZE)
+  #define IMAGE_LOADER_MAX_MAGIC_SIZE 16
+#endif
+
 struct image_loader_registry;
 struct image_loader_module;
 struct image_loader_factory;
@@ -54,6 +119,33 @@ CORE_API
 image_loader_factory*
 GetImageLoaderFactoryByFileExtension(image_loader_registry& Registry, slice<char const> FileExtension);
 
+/// \brief Registers the loaders that are linked into Core, like DDS and KTX2.
+///
+/// Their factories are ready right away, without looking up any module, and
+/// they are associated with their file extensions and magic numbers.
+CORE_API
+void
+RegisterBuiltinImageLoaders(image_loader_registry& Registry);
+
+/// \brief Makes the module the one to use for data that starts with \a Magic.
+///
+/// \a Magic can be at most IMAGE_LOADER_MAX_MAGIC_SIZE bytes long.
+CORE_API
+void
+AssociateImageLoaderModuleWithMagic(image_loader_module& Module, slice<uint8 const> Magic);
+
+/// \brief Finds the loader for \a Data by looking at its first bytes.
+///
+/// \return \c nullptr if no registered magic number matches.
+CORE_API
+image_loader_factory*
+GetImageLoaderFactoryByData(image_loader_registry& Registry, slice<void const> Data);
+
+/// \brief Like GetImageLoaderFactoryByData(), but reads the first bytes of a file.
+CORE_API
+image_loader_factory*
+GetImageLoaderFactoryByFileContent(image_loader_registry& Registry, slice<char const> FileName);
+
 CORE_API
 image_loader_interface*
 CreateImageLoader(image_loader_factory& Factory);
@@ -0,0 +1,231 @@
+#include "ImageMipmaps.hpp"
+#include "ImageConversion.hpp"
+#include "ImageFilter.hpp"
+
+#include "Log.hpp"
+
+#include <cmath>
+
+
+//
+// Filters
+//
+
+// Filter positions are measured in pixels of the smaller mip level,
+// relative to the center of the pixel being computed.
+
+static float const MipKaiserRadius = 3.0f;
+static float const MipKaiserAlpha = 4.0f;
+
+/// Zeroth order modified Bessel function of the first kind.
+static float
+BesselI0(float X)
+{
+  float Sum = 1.0f;
+  float Term = 1.0f;
+  for(uint32 K = 1; K < 32 && Term > Sum * 1e-7f; ++K)
+  {
+    float const Factor = X / (2.0f * K);
+    Term *= Factor * Factor;
+    Sum += Term;
+  }
+  return Sum;
+}
+
+static float
+MipFilterRadius(image_mip_filter Filter)
+{
+  switch(Filter)
+  {
+    case image_mip_filter::Box:      return 0.5f;
+    case image_mip_filter::Triangle: return 1.0f;
+    default:                         return MipKaiserRadius;
+  }
+}
+
+/// The weight of a source pixel covering [Begin, End).
+static float
+MipFilterWeight(image_mip_filter Filter, float Begin, float End)
+{
+  switch(Filter)
+  {
+    case image_mip_filter::Box:      return ImageBoxFilterWeight(Begin, End);
+    case image_mip_filter::Triangle: return ImageTentFilterWeight(Begin, End);
+    default:
+    {
+      float const Center = 0.5f * (Begin + End);
+      if(Abs(Center) >= MipKaiserRadius)
+        return 0.0f;
+
+      float const Pi = 3.14159265f;
+      float const Sinc = Center == 0.0f ? 1.0f : std::sin(Pi * Center) / (Pi * Center);
+      float const Ratio = Center / MipKaiserRadius;
+      return Sinc * BesselI0(MipKaiserAlpha * std::sqrt(1.0f - Ratio * Ratio)) / BesselI0(MipKaiserAlpha);
+    }
+  }
+}
+
+static void
+ComputeMipFilterTaps(image_mip_filter Filter, uint32 SourceSize, uint32 TargetSize, image_filter_taps& Taps)
+{
+  ImageComputeFilterTaps(MipFilterRadius(Filter),
+                         [Filter](float Begin, float End){ return MipFilterWeight(Filter, Begin, End); },
+                         SourceSize, TargetSize, Taps);
+}
+
+
+//
+// Public API
+//
+
+auto
+::ImageFullMipChainLength(image_header const& Header)
+  -> uint32
+{
+  uint32 Size = Max(Max(Header.Width, Header.Height), Header.Depth);
+  uint32 Result = 1;
+  while(Size > 1)
+  {
+    Size /= 2;
+    ++Result;
+  }
+  return Result;
+}
+
+auto
+::ImageCanGenerateMipmaps(image_format Format)
+  -> bool
+{
+  return ImageFormatIsConvertible(Format);
+}
+
+auto
+::ImageGenerateMipmaps(image& Target, image const& Source, image_mip_filter Filter,
+                       uint32 NumMipLevels, uint32 NumThreads)
+  -> bool
+{
+  Assert(&Target != &Source);
+
+  if(!ImageCanGenerateMipmaps(Source.Format))
+  {
+    LogError("Generating mipmaps for images of format %s is not supported.", ImageFormatName(Source.Format));
+    return false;
+  }
+
+  if(Source.Depth > 1)
+  {
+    LogError("Generating mipmaps for volume images is not supported.");
+    return false;
+  }
+
+  if(ImageDataSize(Source) == 0)
+  {
+    LogError("The source image has no data.");
+    return false;
+  }
+
+  uint32 const FullChainLength = ImageFullMipChainLength(Source);
+  if(NumMipLevels == 0 || NumMipLevels > FullChainLength)
+    NumMipLevels = FullChainLength;
+
+  static_cast<image_header&>(Target) = Source;
+  Target.NumMipLevels = NumMipLevels;
+  ImageAllocateData(Target);
+  uint8* TargetData = ImageData(Target).Ptr;
+
+  uint32 const NumSubImages = Source.NumFaces * Source.NumArrayIndices;
+
+  // The base level stays as it is.
+  for(uint32 ArrayIndex = 0; ArrayIndex < Source.NumArrayIndices; ++ArrayIndex)
+  {
+    for(uint32 Face = 0; Face < Source.NumFaces; ++Face)
+    {
+      MemCopyBytes(Bytes(ImageDepthPitch(Source, 0)),
+                   TargetData + ImageDataOffSet(Target, 0, Face, ArrayIndex),
+                   ImageData(Source).Ptr + ImageDataOffSet(Source, 0, Face, ArrayIndex));
+    }
+  }
+
+  // The linear pixels of the previous and the current level, 4 floats each.
+  allocator_interface& Allocator = *Target.InternalSubImages.Allocator;
+  array<float> Buffers[2]{ { Allocator }, { Allocator } };
+  Defer [&](){ Reset(Buffers[0]); Reset(Buffers[1]); };
+
+  // Each level is computed from the one above.
+  image_filter_pass Pass{};
+  Defer [&](){ Finalize(Pass); };
+  Pass.TargetImage = &Target;
+  Pass.TargetData = TargetData;
+
+  for(uint32 MipLevel = 1; MipLevel < NumMipLevels; ++MipLevel)
+  {
+    auto& SourceBuffer = Buffers[(MipLevel - 1) % 2];
+    auto& TargetBuffer = Buffers[MipLevel % 2];
+
+    Pass.TargetMipLevel = MipLevel;
+    Pass.SourceWidth = ImageWidth(Target, MipLevel - 1);
+    Pass.SourceHeight = ImageHeight(Target, MipLevel - 1);
+    Pass.TargetWidth = ImageWidth(Target, MipLevel);
+    Pass.TargetHeight = ImageHeight(Target, MipLevel);
+    ComputeMipFilterTaps(Filter, Pass.SourceWidth, Pass.TargetWidth, Pass.TapsX);
+    ComputeMipFilterTaps(Filter, Pass.SourceHeight, Pass.TargetHeight, Pass.TapsY);
+
+    SetNum(TargetBuffer, size_t(NumSubImages) * Pass.TargetWidth * Pass.TargetHeight * 4);
+
+    // The first pass reads the source image, which isn't converted up front
+    // so that it doesn't need 16 bytes per pixel.
+    Pass.SourceImage = MipLevel == 1 ? &Source : nullptr;
+    Pass.SourcePixels = SourceBuffer.Ptr;
+    Pass.TargetPixels = TargetBuffer.Ptr;
+
+    ImageRunFilterPass(Pass, NumSubImages, NumThreads);
+  }
+
+  return true;
+}
+
+auto
+::ImageMipLevelSize(image const& Image, uint32 MipLevel)
+  -> size_t
+{
+  return size_t(ImageDepthPitch(Image, MipLevel)) * ImageDepth(Image, MipLevel);
+}
+
+auto
+::ImageMipTailLevel(image const& Image, size_t MaxTailSize)
+  -> uint32
+{
+  Assert(Image.NumMipLevels > 0);
+
+  uint32 Result = Image.NumMipLevels - 1;
+  size_t TailSize = ImageMipLevelSize(Image, Result);
+  while(Result > 0)
+  {
+    TailSize += ImageMipLevelSize(Image, Result - 1);
+    if(TailSize > MaxTailSize)
+      break;
+
+    --Result;
+  }
+  return Result;
+}
+
+auto
+::ImageNextStreamedMipLevel(image const& Image, uint32 ResidentLevel, size_t ByteBudget)
+  -> uint32
+{
+  if(ResidentLevel == 0)
+    return 0;
+
+  uint32 Result = ResidentLevel - 1;
+  size_t Size = ImageMipLevelSize(Image, Result);
+  while(Result > 0)
+  {
+    Size += ImageMipLevelSize(Image, Result - 1);
+    if(Size > ByteBudget)
+      break;
+
+    --Result;
+  }
+  return Result;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+#include "Image.hpp"
+
+#include <Backbone.hpp>
+
+
+/// The filters that can be used to compute a mip level from the one above it.
+enum class image_mip_filter
+{
+  /// Averages the pixels covered by the smaller pixel. Fast and sharp, but aliases a little.
+  Box,
+
+  /// A tent that reaches into the neighboring pixels. Smoother than Box.
+  Triangle,
+
+  /// A sinc windowed by a Kaiser window. Keeps the most detail at the cost of slight ringing.
+  Kaiser,
+};
+
+/// \brief The number of mip levels down to a 1x1 image, including the base level.
+CORE_API
+uint32
+ImageFullMipChainLength(image_header const& Header);
+
+/// \brief Whether ImageGenerateMipmaps() supports images of the given format.
+///
+/// These are the formats ImageFormatIsConvertible() accepts, since the
+/// pixels are filtered as linear floats.
+CORE_API
+bool
+ImageCanGenerateMipmaps(image_format Format);
+
+/// \brief Creates \a Target from the first mip level of \a Source and generates the levels below it.
+///
+/// Any mip levels \a Source already has are ignored. Filtering happens in
+/// linear space, so SRGB images are linearized first and encoded again
+/// afterwards; alpha is always linear. Sizes that aren't a power of two are
+/// rounded down for each level, and the filter weights take the uneven
+/// ratio into account.
+///
+/// All faces and array indices get their own mip chain. The work for each
+/// level is split into rows and runs on up to \a NumThreads threads (0 picks
+/// the number of hardware threads).
+///
+/// \param NumMipLevels The number of levels \a Target will have, including
+///                     the base level. 0 creates the full chain.
+///
+/// \return \c false if the format isn't supported or \a Source is a volume.
+CORE_API
+bool
+ImageGenerateMipmaps(image& Target, image const& Source,
+                     image_mip_filter Filter = image_mip_filter::Box,
+                     uint32 NumMipLevels = 0,
+                     uint32 NumThreads = 0);
+
+
+//
+// Streaming
+//
+
+/// \brief The size in bytes of one mip level of the first face and array index.
+CORE_API
+size_t
+ImageMipLevelSize(image const& Image, uint32 MipLevel);
+
+/// \brief The first level of the mip tail, i.e. the smallest levels that together fit into \a MaxTailSize bytes.
+///
+/// A streamed texture starts out with only its tail resident, so it can be
+/// drawn right away. The last level is always part of the tail, even if it
+/// doesn't fit.
+CORE_API
+uint32
+ImageMipTailLevel(image const& Image, size_t MaxTailSize);
+
+/// \brief The level that is resident after streaming in the next levels within \a ByteBudget.
+///
+/// Levels are streamed from small to large, so the result is at most
+/// \a ResidentLevel. At least one level is streamed in if there is one left,
+/// even if it doesn't fit into \a ByteBudget, so every texture becomes fully
+/// resident eventually.
+///
+/// \param ResidentLevel The largest level that is resident already.
+CORE_API
+uint32
+ImageNextStreamedMipLevel(image const& Image, uint32 ResidentLevel, size_t ByteBudget);
@@ -0,0 +1,130 @@
+#include "ImageResize.hpp"
+#include "ImageConversion.hpp"
+#include "ImageFilter.hpp"
+
+#include "Log.hpp"
+
+#include <cmath>
+
+
+//
+// Filters
+//
+
+static float
+Sinc(float X)
+{
+  if(X == 0.0f)
+    return 1.0f;
+
+  float const Pi = 3.14159265f;
+  return std::sin(Pi * X) / (Pi * X);
+}
+
+static float
+ResizeFilterRadius(image_resize_filter Filter)
+{
+  switch(Filter)
+  {
+    case image_resize_filter::Box:      return 0.5f;
+    case image_resize_filter::Bilinear: return 1.0f;
+    case image_resize_filter::Lanczos3: return 3.0f;
+    default:                            return 2.0f;
+  }
+}
+
+/// The weight of a source pixel covering [Begin, End).
+static float
+ResizeFilterWeight(image_resize_filter Filter, float Begin, float End)
+{
+  float const Center = 0.5f * (Begin + End);
+  float const X = Abs(Center);
+  switch(Filter)
+  {
+    case image_resize_filter::Box:      return ImageBoxFilterWeight(Begin, End);
+    case image_resize_filter::Bilinear: return ImageTentFilterWeight(Begin, End);
+    case image_resize_filter::Lanczos3:
+    {
+      return X < 3.0f ? Sinc(Center) * Sinc(Center / 3.0f) : 0.0f;
+    }
+    default:
+    {
+      float const B = 1.0f / 3.0f;
+      float const C = 1.0f / 3.0f;
+      if(X < 1.0f)
+        return ((12 - 9 * B - 6 * C) * X * X * X + (-18 + 12 * B + 6 * C) * X * X + (6 - 2 * B)) / 6.0f;
+      if(X < 2.0f)
+        return ((-B - 6 * C) * X * X * X + (6 * B + 30 * C) * X * X + (-12 * B - 48 * C) * X + (8 * B + 24 * C)) / 6.0f;
+      return 0.0f;
+    }
+  }
+}
+
+
+//
+// Public API
+//
+
+auto
+::ImageCanResize(image_format Format)
+  -> bool
+{
+  return ImageFormatIsConvertible(Format);
+}
+
+auto
+::ImageResize(image& Target, image const& Source, uint32 Width, uint32 Height,
+              image_resize_filter Filter, image_alpha_mode AlphaMode, uint32 NumThreads)
+  -> bool
+{
+  Assert(&Target != &Source);
+
+  if(!ImageCanResize(Source.Format))
+  {
+    LogError("Resizing images of format %s is not supported.", ImageFormatName(Source.Format));
+    return false;
+  }
+
+  if(Source.Depth > 1)
+  {
+    LogError("Resizing volume images is not supported.");
+    return false;
+  }
+
+  if(Width == 0 || Height == 0)
+  {
+    LogError("Can't resize an image to %ux%u.", Width, Height);
+    return false;
+  }
+
+  if(ImageDataSize(Source) == 0)
+  {
+    LogError("The source image has no data.");
+    return false;
+  }
+
+  static_cast<image_header&>(Target) = Source;
+  Target.Width = Width;
+  Target.Height = Height;
+  Target.NumMipLevels = 1;
+  ImageAllocateData(Target);
+
+  image_filter_pass Pass{};
+  Defer [&](){ Finalize(Pass); };
+  Pass.SourceWidth = Source.Width;
+  Pass.SourceHeight = Source.Height;
+  Pass.SourceImage = &Source;
+  Pass.PremultiplyAlpha = AlphaMode == image_alpha_mode::Straight;
+  Pass.TargetImage = &Target;
+  Pass.TargetWidth = Width;
+  Pass.TargetHeight = Height;
+  Pass.TargetData = ImageData(Target).Ptr;
+
+  auto Weight = [Filter](float Begin, float End){ return ResizeFilterWeight(Filter, Begin, End); };
+  ImageComputeFilterTaps(ResizeFilterRadius(Filter), Weight, Source.Width, Width, Pass.TapsX);
+  ImageComputeFilterTaps(ResizeFilterRadius(Filter), Weight, Source.Height, Height, Pass.TapsY);
+
+  ImageRunFilterPass(Pass, Source.NumFaces * Source.NumArrayIndices, NumThreads);
+
+  return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+#include "Image.hpp"
+
+#include <Backbone.hpp>
+
+
+/// The filters ImageResize() can reconstruct the image with.
+enum class image_resize_filter
+{
+  /// Averages the source pixels under the target pixel, or under one source pixel when growing. Fast but blocky.
+  Box,
+
+  /// A tent over the neighboring pixels. Smooth, but blurs a little.
+  Bilinear,
+
+  /// A sinc windowed by a wider sinc, 3 pixels in each direction. The sharpest, but rings at hard edges.
+  Lanczos3,
+
+  /// The Mitchell-Netravali cubic with B = C = 1/3. A good balance of sharpness, blur and ringing.
+  Mitchell,
+};
+
+/// How the color channels of an image relate to its alpha channel.
+enum class image_alpha_mode
+{
+  /// The color channels aren't multiplied with alpha. They are premultiplied
+  /// for filtering, so transparent pixels don't bleed into their neighbors.
+  Straight,
+
+  /// The color channels are already multiplied with alpha, or alpha is
+  /// unused, so the pixels are filtered as they are.
+  Premultiplied,
+};
+
+/// \brief Whether ImageResize() supports images of the given format.
+///
+/// These are the formats ImageFormatIsConvertible() accepts, since the
+/// pixels are filtered as linear floats.
+CORE_API
+bool
+ImageCanResize(image_format Format);
+
+/// \brief Creates \a Target with the first mip level of \a Source resampled to \a Width x \a Height.
+///
+/// The filter is applied horizontally and vertically one after the other,
+/// with weights that are computed once per column and row. Filtering happens
+/// in linear space, so SRGB images are linearized first and encoded again
+/// afterwards. Shrinking widens the filter to cover all source pixels.
+///
+/// \a Target has a single mip level; use ImageGenerateMipmaps() to create
+/// the others. All faces and array indices are resized. The rows of the
+/// target are split into bands that run on up to \a NumThreads threads
+/// (0 picks the number of hardware threads).
+///
+/// \return \c false if the format isn't supported, \a Source is a volume or
+///         either size is 0.
+CORE_API
+bool
+ImageResize(image& Target, image const& Source, uint32 Width, uint32 Height,
+            image_resize_filter Filter = image_resize_filter::Mitchell,
+            image_alpha_mode AlphaMode = image_alpha_mode::Straight,
+            uint32 NumThreads = 0);
@@ -0,0 +1,142 @@
+#include "ImageTiling.hpp"
+
+
+auto
+::Init(image_tiles& Tiles, allocator_interface& Allocator)
+  -> void
+{
+  Tiles.Data.Allocator = &Allocator;
+}
+
+auto
+::Finalize(image_tiles& Tiles)
+  -> void
+{
+  Reset(Tiles.Data);
+}
+
+auto
+::ImageToTiles(image_tiles& Tiles, image const& Image,
+               uint32 MipLevel, uint32 Face, uint32 ArrayIndex, uint32 Z)
+  -> bool
+{
+  if(ImageFormatType(Image.Format) != image_format_type::LINEAR)
+  {
+    LogError("Only images of linear formats can be tiled, not %s.", ImageFormatName(Image.Format));
+    return false;
+  }
+
+  if(ImageFormatBitsPerPixel(Image.Format) % 8 != 0)
+  {
+    LogError("Only images with whole bytes per pixel can be tiled, not %s.", ImageFormatName(Image.Format));
+    return false;
+  }
+
+  uint32 const Width = ImageWidth(Image, MipLevel);
+  uint32 const Height = ImageHeight(Image, MipLevel);
+  size_t const PixelSize = ImageFormatBitsPerPixel(Image.Format) / 8;
+  size_t const TileRowSize = IMAGE_TILE_SIZE * PixelSize;
+  size_t const TileSize = IMAGE_TILE_SIZE * TileRowSize;
+
+  Tiles.Format = Image.Format;
+  Tiles.Width = Width;
+  Tiles.Height = Height;
+  Tiles.NumTilesX = (Width + IMAGE_TILE_SIZE - 1) / IMAGE_TILE_SIZE;
+  Tiles.NumTilesY = (Height + IMAGE_TILE_SIZE - 1) / IMAGE_TILE_SIZE;
+  SetNum(Tiles.Data, Tiles.NumTilesX * Tiles.NumTilesY * TileSize);
+
+  if(Width == 0 || Height == 0)
+    return true;
+
+  uint8 const* SourceSlice = ImageData(Image).Ptr
+                           + ImageDataOffSet(Image, MipLevel, Face, ArrayIndex)
+                           + Z * ImageDepthPitch(Image, MipLevel);
+  size_t const SourcePitch = ImageRowPitch(Image, MipLevel);
+
+  // The tiles to the left of these need no padding.
+  uint32 const NumFullTilesX = Width / IMAGE_TILE_SIZE;
+  uint32 const NumRemainingX = Width % IMAGE_TILE_SIZE;
+
+  uint8* Target = Tiles.Data.Ptr;
+  for(uint32 TileY = 0; TileY < Tiles.NumTilesY; ++TileY)
+  {
+    for(uint32 Row = 0; Row < IMAGE_TILE_SIZE; ++Row)
+    {
+      // Rows below the image repeat the last one.
+      uint32 const Y = Min(TileY * IMAGE_TILE_SIZE + Row, Height - 1);
+      uint8 const* Source = SourceSlice + Y * SourcePitch;
+      uint8* TargetRow = Target + Row * TileRowSize;
+
+      for(uint32 TileX = 0; TileX < NumFullTilesX; ++TileX)
+      {
+        MemCopyBytes(Bytes(TileRowSize), TargetRow, Source);
+        Source += TileRowSize;
+        TargetRow += TileSize;
+      }
+
+      // Columns to the right of the image repeat the last one.
+      if(NumRemainingX > 0)
+      {
+        MemCopyBytes(Bytes(NumRemainingX * PixelSize), TargetRow, Source);
+        uint8 const* LastPixel = Source + (NumRemainingX - 1) * PixelSize;
+        for(uint32 X = NumRemainingX; X < IMAGE_TILE_SIZE; ++X)
+          MemCopyBytes(Bytes(PixelSize), TargetRow + X * PixelSize, LastPixel);
+      }
+    }
+
+    Target += Tiles.NumTilesX * TileSize;
+  }
+
+  return true;
+}
+
+auto
+::ImageFromTiles(image& Image, image_tiles const& Tiles,
+                 uint32 MipLevel, uint32 Face, uint32 ArrayIndex, uint32 Z)
+  -> bool
+{
+  if(Image.Format != Tiles.Format ||
+     ImageWidth(Image, MipLevel) != Tiles.Width ||
+     ImageHeight(Image, MipLevel) != Tiles.Height)
+  {
+    LogError("The tiles don't match the sub-image: %ux%u %s vs. %ux%u %s.",
+             Tiles.Width, Tiles.Height, ImageFormatName(Tiles.Format),
+             ImageWidth(Image, MipLevel), ImageHeight(Image, MipLevel), ImageFormatName(Image.Format));
+    return false;
+  }
+
+  if(ImageFormatBitsPerPixel(Image.Format) % 8 != 0)
+  {
+    LogError("Only images with whole bytes per pixel can be tiled, not %s.", ImageFormatName(Image.Format));
+    return false;
+  }
+
+  size_t const PixelSize = ImageFormatBitsPerPixel(Image.Format) / 8;
+  size_t const TileRowSize = IMAGE_TILE_SIZE * PixelSize;
+  size_t const TileSize = IMAGE_TILE_SIZE * TileRowSize;
+
+  ImageEnsureUniqueData(Image);
+  uint8* TargetSlice = ImageData(Image).Ptr
+                     + ImageDataOffSet(Image, MipLevel, Face, ArrayIndex)
+                     + Z * ImageDepthPitch(Image, MipLevel);
+  size_t const TargetPitch = ImageRowPitch(Image, MipLevel);
+
+  for(uint32 Y = 0; Y < Tiles.Height; ++Y)
+  {
+    uint8 const* Source = Tiles.Data.Ptr
+                        + (Y / IMAGE_TILE_SIZE) * Tiles.NumTilesX * TileSize
+                        + (Y % IMAGE_TILE_SIZE) * TileRowSize;
+    uint8* Target = TargetSlice + Y * TargetPitch;
+
+    // Copy the visible part of each tile row, leaving out the padding.
+    for(uint32 X = 0; X < Tiles.Width; X += IMAGE_TILE_SIZE)
+    {
+      size_t const NumBytes = Min<uint32>(IMAGE_TILE_SIZE, Tiles.Width - X) * PixelSize;
+      MemCopyBytes(Bytes(NumBytes), Target, Source);
+      Target += NumBytes;
+      Source += TileSize;
+    }
+  }
+
+  return true;
+}
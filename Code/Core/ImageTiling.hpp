@@ -0,0 +1,207 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+#include "Image.hpp"
+
+#include <Backbone.hpp>
+
+
+//
+// Views
+//
+
+/// One depth slice of a sub-image of a linear format, with pixels of type \a T.
+///
+/// Everything that depends on the sub-image is computed once when the view is
+/// created, so kernels can walk the pixels with pointer bumps only:
+///
+///   auto View = ImageView<uint32 const>(Image, MipLevel);
+///   for(uint32 Y = 0; Y < View.Height; ++Y)
+///   {
+///     uint32 const* Row = ImageViewRow(View, Y);
+///     for(uint32 X = 0; X < View.Width; ++X)
+///       Sum += Row[X];
+///   }
+template<typename T>
+struct image_view
+{
+  /// The pixel at (0, 0).
+  T* Data;
+
+  uint32 Width;
+  uint32 Height;
+
+  /// The offset in bytes between two subsequent rows.
+  size_t RowPitch;
+};
+
+/// \brief A view of one depth slice of a sub-image.
+///
+/// The size of \a T must match the size of a pixel of the image format,
+/// e.g. uint32 for R8G8B8A8_UNORM.
+template<typename T>
+image_view<T const>
+ImageView(image const& Image, uint32 MipLevel = 0, uint32 Face = 0, uint32 ArrayIndex = 0, uint32 Z = 0)
+{
+  if(ImageFormatType(Image.Format) != image_format_type::LINEAR)
+  {
+    LogError("Views can only be created for linear formats.");
+    Assert(false);
+  }
+  if(ImageFormatBitsPerPixel(Image.Format) % 8 != 0)
+  {
+    LogError("Views can only be created for formats with whole bytes per pixel.");
+    Assert(false);
+  }
+  Assert(sizeof(T) * 8 == ImageFormatBitsPerPixel(Image.Format));
+  BoundsCheck(Z < ImageDepth(Image, MipLevel));
+
+  image_view<T const> View;
+  View.Data = Reinterpret<T const*>(ImageSubImagePointer<uint8>(Image, MipLevel, Face, ArrayIndex) + Z * ImageDepthPitch(Image, MipLevel));
+  View.Width = ImageWidth(Image, MipLevel);
+  View.Height = ImageHeight(Image, MipLevel);
+  View.RowPitch = ImageRowPitch(Image, MipLevel);
+  return View;
+}
+
+/// \note Copies borrowed or shared data into the image. Use the const version for reading.
+template<typename T>
+image_view<T>
+ImageView(image& Image, uint32 MipLevel = 0, uint32 Face = 0, uint32 ArrayIndex = 0, uint32 Z = 0)
+{
+  ImageEnsureUniqueData(Image);
+  auto View = ImageView<T>(AsConst(Image), MipLevel, Face, ArrayIndex, Z);
+  return { const_cast<T*>(View.Data), View.Width, View.Height, View.RowPitch };
+}
+
+template<typename T>
+T*
+ImageViewRow(image_view<T> const& View, uint32 Y)
+{
+  BoundsCheck(Y < View.Height);
+  auto Row = Reinterpret<uint8 const*>(View.Data) + Y * View.RowPitch;
+  return const_cast<T*>(Reinterpret<T const*>(Row));
+}
+
+template<typename T>
+T&
+ImageViewPixel(image_view<T> const& View, uint32 X, uint32 Y)
+{
+  BoundsCheck(X < View.Width);
+  return ImageViewRow(View, Y)[X];
+}
+
+
+//
+// Tiled Layout
+//
+
+/// The tiled layout stores images in square tiles with this many pixels per side.
+#if !defined(IMAGE_TILE_SIZE)
+  #define IMAGE_TILE_SIZE 8
+#endif
+
+static_assert((IMAGE_TILE_SIZE & (IMAGE_TILE_SIZE - 1)) == 0, "The tile size must be a power of two.");
+
+/// One depth slice of a sub-image of a linear format, stored in tiles.
+///
+/// The tiles are stored row by row, and so are the pixels within each tile.
+/// A pixel and its neighbors are therefore mostly within a few cache lines,
+/// whereas the row-major layout of an image puts vertical neighbors a whole
+/// row apart.
+///
+/// Tiles at the right and bottom edge are padded with copies of the last
+/// column and row of the image.
+struct image_tiles
+{
+  image_format Format;
+
+  /// The size of the image in pixels, without the padding.
+  uint32 Width;
+  uint32 Height;
+
+  uint32 NumTilesX;
+  uint32 NumTilesY;
+
+  array<uint8> Data;
+};
+
+CORE_API
+void
+Init(image_tiles& Tiles, allocator_interface& Allocator);
+
+CORE_API
+void
+Finalize(image_tiles& Tiles);
+
+/// \brief Copies one depth slice of a sub-image into the tiled layout.
+///
+/// \return \c false if the format of \a Image isn't linear or has pixels
+///         that aren't a whole number of bytes.
+CORE_API
+bool
+ImageToTiles(image_tiles& Tiles, image const& Image,
+             uint32 MipLevel = 0, uint32 Face = 0, uint32 ArrayIndex = 0, uint32 Z = 0);
+
+/// \brief Copies \a Tiles back into one depth slice of a sub-image.
+///
+/// \a Image must already have its data and the same format, and the sub-image
+/// must have the same size as \a Tiles.
+CORE_API
+bool
+ImageFromTiles(image& Image, image_tiles const& Tiles,
+               uint32 MipLevel = 0, uint32 Face = 0, uint32 ArrayIndex = 0, uint32 Z = 0);
+
+/// \brief A view of a single tile, including its padding.
+///
+/// Views of tiles work with the same kernels as views of whole images.
+template<typename T>
+image_view<T const>
+ImageTileView(image_tiles const& Tiles, uint32 TileX, uint32 TileY)
+{
+  Assert(sizeof(T) * 8 == ImageFormatBitsPerPixel(Tiles.Format));
+  BoundsCheck(TileX < Tiles.NumTilesX);
+  BoundsCheck(TileY < Tiles.NumTilesY);
+
+  size_t const TileIndex = size_t(TileY) * Tiles.NumTilesX + TileX;
+
+  image_view<T const> View;
+  View.Data = Reinterpret<T const*>(Tiles.Data.Ptr) + TileIndex * IMAGE_TILE_SIZE * IMAGE_TILE_SIZE;
+  View.Width = IMAGE_TILE_SIZE;
+  View.Height = IMAGE_TILE_SIZE;
+  View.RowPitch = IMAGE_TILE_SIZE * sizeof(T);
+  return View;
+}
+
+template<typename T>
+image_view<T>
+ImageTileView(image_tiles& Tiles, uint32 TileX, uint32 TileY)
+{
+  auto View = ImageTileView<T>(AsConst(Tiles), TileX, TileY);
+  return { const_cast<T*>(View.Data), View.Width, View.Height, View.RowPitch };
+}
+
+/// \brief The pixel at \a X and \a Y of the image, which may be in the padding.
+///
+/// For neighborhood access across tile boundaries. Only shifts and masks are
+/// needed to find the tile.
+template<typename T>
+T const&
+ImageTilesPixel(image_tiles const& Tiles, uint32 X, uint32 Y)
+{
+  uint32 const TileX = X / IMAGE_TILE_SIZE;
+  uint32 const TileY = Y / IMAGE_TILE_SIZE;
+  BoundsCheck(TileX < Tiles.NumTilesX);
+  BoundsCheck(TileY < Tiles.NumTilesY);
+
+  size_t const TileIndex = size_t(TileY) * Tiles.NumTilesX + TileX;
+  size_t const PixelIndex = (Y % IMAGE_TILE_SIZE) * IMAGE_TILE_SIZE + X % IMAGE_TILE_SIZE;
+  return Reinterpret<T const*>(Tiles.Data.Ptr)[TileIndex * IMAGE_TILE_SIZE * IMAGE_TILE_SIZE + PixelIndex];
+}
+
+template<typename T>
+T&
+ImageTilesPixel(image_tiles& Tiles, uint32 X, uint32 Y)
+{
+  return const_cast<T&>(ImageTilesPixel<T>(AsConst(Tiles), X, Y));
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+// An array<T> that keeps its first N elements in-place and only uses its
+// allocator once it grows beyond that.
+
+#include "CoreAPI.hpp"
+#include "Allocator.hpp"
+#include "Array.hpp"
+
+#include <Backbone.hpp>
+
+
+/// Serves the inline storage of an inline_array and forwards all other
+/// requests to a fallback allocator.
+template<typename T, size_t N>
+class inline_array_allocator : public allocator_interface
+{
+public:
+  /// If this is \c nullptr, the ArrayDefaultAllocator() is used.
+  allocator_interface* FallbackAllocator{};
+  bool IsStorageInUse{};
+  alignas(T) uint8 Storage[N * sizeof(T)];
+
+  allocator_interface&
+  Fallback()
+  {
+    if(this->FallbackAllocator == nullptr)
+      this->FallbackAllocator = ArrayDefaultAllocator();
+    return *this->FallbackAllocator;
+  }
+
+  virtual void* Allocate(memory_size Size, size_t Alignment) override
+  {
+    if(!this->IsStorageInUse && ToBytes(Size) <= sizeof(this->Storage) && CheckedAlignment(Alignment) <= alignof(T))
+    {
+      this->IsStorageInUse = true;
+      return this->Storage;
+    }
+
+    return Fallback().Allocate(Size, Alignment);
+  }
+
+  virtual void Deallocate(void* Memory) override
+  {
+    if(Memory == this->Storage)
+    {
+      this->IsStorageInUse = false;
+      return;
+    }
+
+    Fallback().Deallocate(Memory);
+  }
+
+  virtual bool Resize(void* Ptr, memory_size NewSize) override
+  {
+    if(Ptr == this->Storage)
+      return ToBytes(NewSize) <= sizeof(this->Storage);
+
+    return Fallback().Resize(Ptr, NewSize);
+  }
+
+  virtual memory_size AllocationSize(void* Ptr) override
+  {
+    if(Ptr == this->Storage)
+      return Bytes(sizeof(this->Storage));
+
+    return Fallback().AllocationSize(Ptr);
+  }
+};
+
+/// Works with all array<T> functions (Slice, Append, ExpandBy, RemoveAt, ...).
+///
+/// The Allocator member of the array always points to the embedded
+/// InlineAllocator. Set \c InlineAllocator.FallbackAllocator to choose where
+/// memory comes from once the inline storage is exhausted.
+///
+/// \note Can neither be copied nor moved since the array may point into its
+///       own inline storage.
+template<typename T, size_t N>
+struct inline_array : public array<T>
+{
+  inline_array_allocator<T, N> InlineAllocator;
+
+  inline_array()
+  {
+    this->Allocator = &this->InlineAllocator;
+    this->Ptr = Reinterpret<T*>(this->InlineAllocator.Storage);
+    this->Capacity = N;
+    this->InlineAllocator.IsStorageInUse = true;
+  }
+
+  inline_array(allocator_interface& FallbackAllocator) : inline_array()
+  {
+    this->InlineAllocator.FallbackAllocator = &FallbackAllocator;
+  }
+
+  inline_array(inline_array const&) = delete;
+  inline_array(inline_array&&) = delete;
+  void operator=(inline_array const&) = delete;
+  void operator=(inline_array&&) = delete;
+
+  ~inline_array()
+  {
+    // Release the memory while the InlineAllocator is still alive.
+    Reset(*this);
+  }
+};
+
+template<typename T, size_t N>
+bool
+IsInline(inline_array<T, N> const& Array)
+{
+  return Array.Ptr == Reinterpret<T const*>(Array.InlineAllocator.Storage);
+}
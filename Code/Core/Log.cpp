@@ -5,10 +5,15 @@
 #endif
 
 #include <stdio.h>
+#include <mutex>
 
 
 CORE_API log_data* GlobalLog = nullptr;
 
+/// Messages may come from worker threads, e.g. the ones of an image_load_queue.
+/// Recursive, in case a sink logs something itself.
+static std::recursive_mutex LogMutex;
+
 auto
 ::LogIndent(log_data* Log, int By)
   -> void
@@ -105,6 +110,8 @@ auto
   if(Log == nullptr)
     return;
 
+  std::lock_guard<std::recursive_mutex> Lock(LogMutex);
+
   va_list Args;
   va_start(Args, Message);
   FormatLogMessage(Log->MessageBuffer, StrPtr(Message), Args);
@@ -121,6 +128,8 @@ auto
   if(Log == nullptr)
     return;
 
+  std::lock_guard<std::recursive_mutex> Lock(LogMutex);
+
   va_list Args;
   va_start(Args, Message);
   FormatLogMessage(Log->MessageBuffer, StrPtr(Message), Args);
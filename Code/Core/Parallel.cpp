@@ -0,0 +1,55 @@
+#include "Parallel.hpp"
+
+#include <atomic>
+#include <thread>
+
+
+#if !defined(PARALLEL_MAX_THREADS)
+  #define PARALLEL_MAX_THREADS 64
+#endif
+
+auto
+::ParallelNumThreads()
+  -> uint32
+{
+  auto const Result = std::thread::hardware_concurrency();
+  return Clamp(Result, 1u, uint32(PARALLEL_MAX_THREADS));
+}
+
+auto
+::ParallelFor(size_t NumItems, delegate<void(size_t)> const& Work, uint32 NumThreads)
+  -> void
+{
+  if(NumItems == 0)
+    return;
+
+  if(NumThreads == 0)
+    NumThreads = ParallelNumThreads();
+
+  NumThreads = Min(NumThreads, uint32(PARALLEL_MAX_THREADS));
+  if(NumItems < NumThreads)
+    NumThreads = uint32(NumItems);
+
+  std::atomic<size_t> NextItem{ 0 };
+  auto WorkerMain = [&]()
+  {
+    while(true)
+    {
+      auto const Item = NextItem.fetch_add(1, std::memory_order_relaxed);
+      if(Item >= NumItems)
+        break;
+
+      Work(Item);
+    }
+  };
+
+  // The calling thread does its share of the work as well.
+  std::thread Threads[PARALLEL_MAX_THREADS - 1];
+  for(uint32 Index = 0; Index < NumThreads - 1; ++Index)
+    Threads[Index] = std::thread(WorkerMain);
+
+  WorkerMain();
+
+  for(uint32 Index = 0; Index < NumThreads - 1; ++Index)
+    Threads[Index].join();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+#include "Event.hpp"
+
+#include <Backbone.hpp>
+
+
+/// The number of threads ParallelFor() uses when asked to pick one itself.
+CORE_API
+uint32
+ParallelNumThreads();
+
+/// \brief Calls \a Work once for every index in [0, NumItems) and returns when all calls are done.
+///
+/// Items are handed out one at a time to up to \a NumThreads threads,
+/// including the calling thread, so expensive and cheap items balance out.
+/// Pass 0 to use ParallelNumThreads().
+///
+/// \note \a Work is called concurrently and in no particular order.
+CORE_API
+void
+ParallelFor(size_t NumItems, delegate<void(size_t)> const& Work, uint32 NumThreads = 0);
@@ -0,0 +1,66 @@
+#pragma once
+
+// Thread-safe reference counting for the copy-on-write types (arc_string,
+// shared_array).
+
+#include "CoreAPI.hpp"
+
+#include <Backbone.hpp>
+
+#include <atomic>
+
+
+struct ref_count
+{
+  std::atomic<int> Value{ 1 };
+};
+
+inline void
+RefCountInit(ref_count& RefCount)
+{
+  RefCount.Value.store(1, std::memory_order_relaxed);
+}
+
+/// Whether the caller holds the only reference.
+///
+/// If so, no other thread can get hold of the object anymore, so the caller
+/// may modify it without copying it first.
+inline bool
+RefCountIsUnique(ref_count const& RefCount)
+{
+  // Acquire to see all writes other owners made before releasing their
+  // references.
+  return RefCount.Value.load(std::memory_order_acquire) == 1;
+}
+
+/// The caller must already hold a reference.
+inline void
+RefCountAddRef(ref_count& RefCount)
+{
+  // A new reference can only be created from an existing one, so there is
+  // nothing to synchronize with here.
+  RefCount.Value.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// \return \c true if this was the last reference, in which case the caller
+///         is responsible for destroying the object.
+inline bool
+RefCountReleaseRef(ref_count& RefCount)
+{
+  // Fast path: When we hold the only reference, the object is effectively
+  // thread-local and nobody else can race us to zero.
+  if(RefCountIsUnique(RefCount))
+  {
+    RefCount.Value.store(0, std::memory_order_relaxed);
+    return true;
+  }
+
+  if(RefCount.Value.fetch_sub(1, std::memory_order_release) == 1)
+  {
+    // Make sure all writes of the other owners are visible before destroying the object.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+  }
+
+  return false;
+}
@@ -6,6 +6,7 @@
 #include "CoreAPI.hpp"
 #include "Allocator.hpp"
 #include "ContainerUtils.hpp"
+#include "RefCount.hpp"
 
 #include <Backbone.hpp>
 
@@ -25,23 +26,33 @@ SharedArraySetDefaultAllocator(allocator_interface* Allocator);
 
 
 /// Dynamically growing copy-on-write array.
+///
+/// Copies may be handed to other threads. The reference count is atomic, but
+/// a single shared_array object must not be accessed by multiple threads at
+/// the same time.
+///
+/// \a Allocator is used whenever this array needs new memory of its own.
+/// Shared data remembers the allocator it came from and is released with that
+/// one, so assigning another array to this one doesn't replace \a Allocator.
 template<typename T>
 struct shared_array
 {
   struct shared
   {
-    int RefCount;
+    ref_count RefCount;
+    allocator_interface* Allocator;
     size_t Capacity;
     size_t Num;
     T* Ptr;
   };
 
-  allocator_interface* Allocator;
-  shared* Shared;
+  allocator_interface* Allocator{};
+  shared* Shared{};
+  container_growth Growth = container_growth::Double;
 
 
   shared_array() = default;
-  shared_array(allocator_interface& Allocator) { *this = {}; this->Allocator = &Allocator; }
+  shared_array(allocator_interface& Allocator) { this->Allocator = &Allocator; }
   shared_array(shared_array const& ToCopy);
   shared_array(shared_array&& ToMove);
   ~shared_array();
@@ -66,13 +77,16 @@ struct shared_array
   // Accessors
   //
   inline size_t&       Capacity()       { EnsureInitialized(*this); return this->Shared->Capacity; }
-  inline size_t const& Capacity() const { EnsureInitialized(*this); return this->Shared->Capacity; }
+  inline size_t        Capacity() const { return this->Shared ? this->Shared->Capacity : 0; }
   inline size_t&       Num()            { EnsureInitialized(*this); return this->Shared->Num; }
-  inline size_t const& Num()      const { EnsureInitialized(*this); return this->Shared->Num; }
+  inline size_t        Num()      const { return this->Shared ? this->Shared->Num : 0; }
   inline T*&           Ptr()            { EnsureInitialized(*this); return this->Shared->Ptr; }
-  inline T* const&     Ptr()      const { EnsureInitialized(*this); return this->Shared->Ptr; }
+  inline T const*      Ptr()      const { return this->Shared ? this->Shared->Ptr : nullptr; }
 };
 
+/// A shared_array only points to its shared data.
+template<typename T> struct impl_is_trivially_relocatable<shared_array<T>> { static constexpr bool Value = true; };
+
 
 //
 // Implementation Details
@@ -85,8 +99,10 @@ ImplSharedArrayCreateShared(allocator_interface* Allocator)
   Assert(Allocator);
   auto Shared = Allocate<typename shared_array<T>::shared>(*Allocator);
   Assert(Shared);
+  MemConstruct(1, Shared);
   // Note: Do not initialize Shared->InitialMemory.
-  Shared->RefCount = 1;
+  RefCountInit(Shared->RefCount);
+  Shared->Allocator = Allocator;
   Shared->Capacity = 0;
   Shared->Num = 0;
   Shared->Ptr = nullptr;
@@ -95,9 +111,11 @@ ImplSharedArrayCreateShared(allocator_interface* Allocator)
 
 template<typename T>
 void
-ImplSharedArrayDestroyShared(allocator_interface* Allocator, typename shared_array<T>::shared* Shared)
+ImplSharedArrayDestroyShared(typename shared_array<T>::shared* Shared)
 {
+  auto Allocator = Shared->Allocator;
   Assert(Allocator);
+  MemDestruct(1, Shared);
   Deallocate(*Allocator, Shared);
 }
 
@@ -108,28 +126,21 @@ ImplSharedArrayAddRef(typename shared_array<T>::shared* Shared)
   if(Shared == nullptr)
     return;
 
-  // TODO: Make thread-safe?
-  ++Shared->RefCount;
+  RefCountAddRef(Shared->RefCount);
 }
 
 template<typename T>
 void
-ImplSharedArrayReleaseRef(typename shared_array<T>::shared* Shared, allocator_interface* Allocator)
+ImplSharedArrayReleaseRef(typename shared_array<T>::shared* Shared)
 {
   if(Shared == nullptr)
     return;
 
-  // If Shared is a valid pointer, there _must_ be an Allocator;
-  Assert(Allocator);
-
-  // TODO: Make thread-safe?
-  --Shared->RefCount;
-
-  if(Shared->RefCount <= 0)
+  if(RefCountReleaseRef(Shared->RefCount))
   {
     SliceDestruct(Slice(Shared->Num, Shared->Ptr));
-    SliceDeallocate(*Allocator, Slice(Shared->Capacity, Shared->Ptr));
-    ImplSharedArrayDestroyShared<T>(Allocator, Shared);
+    SliceDeallocate(*Shared->Allocator, Slice(Shared->Capacity, Shared->Ptr));
+    ImplSharedArrayDestroyShared<T>(Shared);
   }
 }
 
@@ -138,10 +149,14 @@ ImplSharedArrayReleaseRef(typename shared_array<T>::shared* Shared, allocator_in
 // Array operations
 //
 
+/// \note Copies the data first if other arrays share it, so writing through
+///       the slice doesn't change them.
 template<typename T>
 slice<T>
 Slice(shared_array<T>& Array)
 {
+  if(!IsUnique(Array))
+    EnsureUnique(Array);
   return Slice(Array.Num(), Array.Ptr());
 }
 
@@ -160,7 +175,7 @@ AllocatedMemory(shared_array<T>& Array)
 }
 
 template<typename T>
-constexpr slice<T>
+slice<T const>
 AllocatedMemory(shared_array<T> const& Array)
 {
   return Slice(Array.Capacity(), AsPtrToConst(Array.Ptr()));
@@ -182,14 +197,17 @@ void
 Reserve(shared_array<T>& Array, size_t MinBytesToReserve)
 {
   EnsureInitialized(Array);
-  bool const IsUnique = Array.Shared->RefCount <= 1;
+  bool const IsUnique = RefCountIsUnique(Array.Shared->RefCount);
   if(IsUnique)
   {
-    auto NewAllocatedMemory = ContainerReserve(*Array.Allocator,
+    // The memory may have come from another array, so it is grown with the
+    // allocator it was allocated with.
+    auto NewAllocatedMemory = ContainerReserve(*Array.Shared->Allocator,
                                                Array.Ptr(), Array.Num(),
                                                Array.Capacity(),
                                                MinBytesToReserve,
-                                               SHARED_ARRAY_MINIMUM_CAPACITY);
+                                               SHARED_ARRAY_MINIMUM_CAPACITY,
+                                               Array.Growth);
 
     // Update array members.
     Array.Ptr() = NewAllocatedMemory.Ptr;
@@ -204,17 +222,17 @@ Reserve(shared_array<T>& Array, size_t MinBytesToReserve)
 
     // Gather current array data.
     auto OldAllocatedMemory = AllocatedMemory(Array);
-    auto OldUsedMemory = Slice(Array);
+    auto OldUsedMemory = Slice(AsConst(Array));
 
     // Prepare new array data.
     auto NewAllocatedMemory = SliceAllocate<T>(Allocator, Max(MinBytesToReserve, OldAllocatedMemory.Num));
     auto NewUsedMemory = Slice(NewAllocatedMemory, 0, OldUsedMemory.Num);
 
     // Copy the old data over (if any).
-    SliceCopy(NewUsedMemory, AsConst(OldUsedMemory));
+    SliceCopy(NewUsedMemory, OldUsedMemory);
 
     // Let go of the old Shared reference.
-    ImplSharedArrayReleaseRef<T>(Array.Shared, &Allocator);
+    ImplSharedArrayReleaseRef<T>(Array.Shared);
 
     // Create a new Shared reference and initialize it.
     Array.Shared = ImplSharedArrayCreateShared<T>(&Allocator);
@@ -224,6 +242,14 @@ Reserve(shared_array<T>& Array, size_t MinBytesToReserve)
   }
 }
 
+/// Whether no other shared_array refers to the same data.
+template<typename T>
+bool
+IsUnique(shared_array<T> const& Array)
+{
+  return Array.Shared == nullptr || RefCountIsUnique(Array.Shared->RefCount);
+}
+
 template<typename T>
 void
 EnsureUnique(shared_array<T>& Array)
@@ -313,7 +339,7 @@ Reset(shared_array<T>& Array)
 {
   if(Array.Shared)
   {
-    ImplSharedArrayReleaseRef<T>(Array.Shared, Array.Allocator);
+    ImplSharedArrayReleaseRef<T>(Array.Shared);
     Array.Shared = nullptr;
   }
 }
@@ -333,7 +359,7 @@ template<typename T>
 bool
 RemoveFirst(shared_array<T>& Array, const T& Needle)
 {
-  auto Index = SliceCountUntil(AsConst(Slice(Array)), Needle);
+  auto Index = SliceCountUntil(Slice(AsConst(Array)), Needle);
   if(Index == INVALID_INDEX)
     return false;
 
@@ -349,6 +375,7 @@ template<typename T>
 shared_array<T>::shared_array(shared_array<T> const& ToCopy)
 {
   this->Allocator = ToCopy.Allocator;
+  this->Growth = ToCopy.Growth;
   this->Shared = ToCopy.Shared;
   ImplSharedArrayAddRef<T>(this->Shared);
 }
@@ -357,10 +384,11 @@ template<typename T>
 shared_array<T>::shared_array(shared_array<T>&& ToMove)
 {
   this->Allocator = ToMove.Allocator;
+  this->Growth = ToMove.Growth;
   this->Shared = ToMove.Shared;
 
   // Steal ToMove's Shared
-  ToMove->Shared = nullptr;
+  ToMove.Shared = nullptr;
 }
 
 template<typename T>
@@ -374,21 +402,31 @@ void shared_array<T>::operator=(shared_array const& ToCopy)
 {
   if(this->Shared != ToCopy.Shared)
   {
-    ImplSharedArrayReleaseRef<T>(this->Shared, this->Allocator);
+    ImplSharedArrayAddRef<T>(ToCopy.Shared);
+    ImplSharedArrayReleaseRef<T>(this->Shared);
     this->Shared = ToCopy.Shared;
-    ImplSharedArrayAddRef<T>(this->Shared);
   }
+
+  // Keep the allocator this array was initialized with.
+  if(this->Allocator == nullptr)
+    this->Allocator = ToCopy.Allocator;
+  this->Growth = ToCopy.Growth;
 }
 
 template<typename T>
 void shared_array<T>::operator=(shared_array&& ToMove)
 {
-  if(this->Shared != ToCopy.Shared)
+  if(this->Shared != ToMove.Shared)
   {
-    ImplSharedArrayReleaseRef<T>(this->Shared, this->Allocator);
-    this->Shared = ToCopy.Shared;
-    ToCopy.Shared = nullptr;
+    ImplSharedArrayReleaseRef<T>(this->Shared);
+    this->Shared = ToMove.Shared;
+    ToMove.Shared = nullptr;
   }
+
+  // Keep the allocator this array was initialized with.
+  if(this->Allocator == nullptr)
+    this->Allocator = ToMove.Allocator;
+  this->Growth = ToMove.Growth;
 }
 
 template<typename T>
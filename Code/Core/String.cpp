@@ -1,20 +1,32 @@
 
 #include "String.hpp"
+#include "Dictionary.hpp"
 
 #include <stdio.h>
+#include <atomic>
 
 static char MutableEmptyString[] = { '\0' };
 
 #define STR_LOG(...) NoOp
 // #define STR_LOG(...) printf(__VA_ARGS__)
 
+/// Serves arc_string internals and small string data from fixed sets of
+/// buckets.
+///
+/// Free buckets are kept in lock-free stacks of bucket indices so acquiring
+/// and releasing a bucket is O(1) and safe to do from multiple threads. Once
+/// all buckets of a kind are in use, the base allocator is used instead,
+/// which is expected to be thread-safe as well.
 class string_allocator : public allocator_interface
 {
   static_assert(alignof(arc_string::internal) != alignof(char),
                 "Basic assumptions for this allocator are wrong?!");
 
+  enum : uint32 { INVALID_BUCKET_INDEX = 0xFFFFFFFF };
+
   struct string_internal_bucket
   {
+    std::atomic<uint32> NextFree{ INVALID_BUCKET_INDEX };
     bool IsFree = true;
     arc_string::internal Data;
   };
@@ -22,34 +34,49 @@ class string_allocator : public allocator_interface
   enum { STRING_DATA_BUCKET_SIZE = 1024 };
   struct string_data_bucket
   {
+    std::atomic<uint32> NextFree{ INVALID_BUCKET_INDEX };
     slice<char> AllocatedData{};
     fixed_block<STRING_DATA_BUCKET_SIZE, char> Data;
   };
 
+  /// The lower 32 bits hold the index of the first free bucket, the upper 32
+  /// bits are a tag that changes with every modification to prevent ABA.
+  using free_list_head = std::atomic<uint64>;
+
 
   allocator_interface* BaseAllocator;
 
-  array<string_internal_bucket> StringInternalBuckets;
-  array<string_data_bucket>     StringDataBuckets;
+  slice<string_internal_bucket> StringInternalBuckets;
+  slice<string_data_bucket>     StringDataBuckets;
+
+  free_list_head FreeInternalBuckets{ INVALID_BUCKET_INDEX };
+  free_list_head FreeDataBuckets{ INVALID_BUCKET_INDEX };
 
 public:
   string_allocator(allocator_interface& BaseAllocator)
     : BaseAllocator(&BaseAllocator)
-    , StringInternalBuckets(BaseAllocator)
-    , StringDataBuckets(BaseAllocator)
   {
-    Reserve(this->StringInternalBuckets, 100); // Around 5KiB
-    this->StringInternalBuckets.CanGrow = false;
-
-    Reserve(this->StringDataBuckets, 100); // Around 100 KiB (a bit more)
-    this->StringDataBuckets.CanGrow = false;
+    this->StringInternalBuckets = SliceAllocate<string_internal_bucket>(BaseAllocator, 100); // Around 5KiB
+    MemConstruct(this->StringInternalBuckets.Num, this->StringInternalBuckets.Ptr);
+    for(auto& Bucket : this->StringInternalBuckets)
+      PushFreeBucket(this->FreeInternalBuckets, this->StringInternalBuckets, &Bucket);
+
+    this->StringDataBuckets = SliceAllocate<string_data_bucket>(BaseAllocator, 100); // Around 100 KiB (a bit more)
+    MemConstruct(this->StringDataBuckets.Num, this->StringDataBuckets.Ptr);
+    for(auto& Bucket : this->StringDataBuckets)
+      PushFreeBucket(this->FreeDataBuckets, this->StringDataBuckets, &Bucket);
   }
 
   ~string_allocator()
   {
+    SliceDestruct(this->StringDataBuckets);
+    SliceDeallocate(*this->BaseAllocator, this->StringDataBuckets);
+
+    SliceDestruct(this->StringInternalBuckets);
+    SliceDeallocate(*this->BaseAllocator, this->StringInternalBuckets);
   }
 
-  virtual void* Allocate(memory_size Size, size_t Alignment)
+  virtual void* Allocate(memory_size Size, size_t Alignment) override
   {
     Assert(Size > 0);
     STR_LOG("string_allocator: ");
@@ -73,7 +100,7 @@ public:
         return Result;
       }
 
-      auto NewBucket = GetFreeDataBucket();
+      auto NewBucket = PopFreeBucket(this->FreeDataBuckets, this->StringDataBuckets);
       if(NewBucket)
       {
         STR_LOG("using bucket. ");
@@ -98,7 +125,7 @@ public:
       Assert(Size == SizeOf<arc_string::internal>());
       STR_LOG("Allocating internal ");
 
-      auto NewBucket = GetFreeInternalBucket();
+      auto NewBucket = PopFreeBucket(this->FreeInternalBuckets, this->StringInternalBuckets);
       if(NewBucket)
       {
         STR_LOG("using bucket. ");
@@ -119,7 +146,7 @@ public:
     return Result;
   }
 
-  virtual void Deallocate(void* Ptr)
+  virtual void Deallocate(void* Ptr) override
   {
     STR_LOG("string_allocator: Deallocation: 0x%zx ", Reinterpret<size_t>(Ptr));
 
@@ -137,6 +164,7 @@ public:
       Assert(!InternalBucket->IsFree);
 
       InternalBucket->IsFree = true;
+      PushFreeBucket(this->FreeInternalBuckets, this->StringInternalBuckets, InternalBucket);
       return;
     }
 
@@ -152,6 +180,7 @@ public:
       Assert(!!DataBucket->AllocatedData);
 
       DataBucket->AllocatedData = {};
+      PushFreeBucket(this->FreeDataBuckets, this->StringDataBuckets, DataBucket);
       return;
     }
 
@@ -162,7 +191,7 @@ public:
     this->BaseAllocator->Deallocate(Ptr);
   }
 
-  virtual bool Resize(void* Ptr, memory_size NewSize)
+  virtual bool Resize(void* Ptr, memory_size NewSize) override
   {
     if(Ptr == nullptr)
       return false;
@@ -182,14 +211,14 @@ public:
         return false;
       }
 
-      DataBucket->AllocatedData = Slice(DataBucket->Data, 0, NewSize);
+      DataBucket->AllocatedData = Slice(DataBucket->Data, 0, ToBytes(NewSize));
       return true;
     }
 
     return this->BaseAllocator->Resize(Ptr, NewSize);
   }
 
-  virtual memory_size AllocatationSize(void* Ptr)
+  virtual memory_size AllocationSize(void* Ptr) override
   {
     if(Ptr == nullptr)
       return Bytes(0);
@@ -199,7 +228,7 @@ public:
     //
     auto InternalBucket = MapToInternalBucket(Ptr);
     if(InternalBucket)
-      return SizeOf<string_internal_bucket>();
+      return SizeOf<arc_string::internal>();
 
     //
     // Handle deallocation of data that fits in the bucket size
@@ -218,17 +247,11 @@ private:
   string_internal_bucket*
   MapToInternalBucket(void* Ptr)
   {
-    auto Location = Reinterpret<size_t>(Ptr);
-    Location -= offsetof(string_internal_bucket, Data);
-
-    auto const BucketsSlice = Slice(this->StringInternalBuckets);
-    auto const FirstPossibleLocation = Reinterpret<size_t>(First(BucketsSlice));
-    auto const FirstImpossibleLocation = Reinterpret<size_t>(OnePastLast(BucketsSlice));
-    if(Location >= FirstPossibleLocation && Location < FirstImpossibleLocation)
-    {
-      auto Bucket = Reinterpret<string_internal_bucket*>(Location);
-      return Bucket;
-    }
+    auto const Buckets = this->StringInternalBuckets;
+    auto const Offset = Reinterpret<size_t>(Ptr) - Reinterpret<size_t>(Buckets.Ptr);
+    auto const Index = Offset / sizeof(string_internal_bucket);
+    if(Index < Buckets.Num && &Buckets[Index].Data == Ptr)
+      return &Buckets[Index];
 
     return nullptr;
   }
@@ -236,53 +259,47 @@ private:
   string_data_bucket*
   MapToDataBucket(void* Ptr)
   {
-    auto Location = Reinterpret<size_t>(Ptr);
-    Location -= offsetof(string_data_bucket, Data);
-
-    auto const BucketsSlice = Slice(this->StringDataBuckets);
-    auto const FirstPossibleLocation = Reinterpret<size_t>(First(BucketsSlice));
-    auto const FirstImpossibleLocation = Reinterpret<size_t>(OnePastLast(BucketsSlice));
-    if(Location >= FirstPossibleLocation && Location < FirstImpossibleLocation)
-    {
-      auto Bucket = Reinterpret<string_data_bucket*>(Location);
-      return Bucket;
-    }
+    auto const Buckets = this->StringDataBuckets;
+    auto const Offset = Reinterpret<size_t>(Ptr) - Reinterpret<size_t>(Buckets.Ptr);
+    auto const Index = Offset / sizeof(string_data_bucket);
+    if(Index < Buckets.Num && First(Buckets[Index].Data) == Ptr)
+      return &Buckets[Index];
 
     return nullptr;
   }
 
-  string_internal_bucket*
-  GetFreeInternalBucket()
+  template<typename BucketType>
+  static BucketType*
+  PopFreeBucket(free_list_head& Head, slice<BucketType> Buckets)
   {
-    for(auto& Bucket : Slice(this->StringInternalBuckets))
+    auto OldHead = Head.load(std::memory_order_acquire);
+    while(true)
     {
-      if(Bucket.IsFree)
-        return &Bucket;
+      auto const Index = uint32(OldHead);
+      if(Index == INVALID_BUCKET_INDEX)
+        return nullptr;
+
+      // If another thread pops this bucket first, NextFree may be stale but
+      // then the tag in the head will have changed and the exchange fails.
+      auto const Next = Buckets[Index].NextFree.load(std::memory_order_relaxed);
+      auto const NewHead = (((OldHead >> 32) + 1) << 32) | Next;
+      if(Head.compare_exchange_weak(OldHead, NewHead, std::memory_order_acquire, std::memory_order_acquire))
+        return &Buckets[Index];
     }
-
-    if(this->StringInternalBuckets.Num == this->StringInternalBuckets.Capacity)
-    {
-      return nullptr;
-    }
-
-    return &Expand(this->StringInternalBuckets);
   }
 
-  string_data_bucket*
-  GetFreeDataBucket()
+  template<typename BucketType>
+  static void
+  PushFreeBucket(free_list_head& Head, slice<BucketType> Buckets, BucketType* Bucket)
   {
-    for(auto& Bucket : Slice(this->StringDataBuckets))
+    auto const Index = uint32(Bucket - Buckets.Ptr);
+    auto OldHead = Head.load(std::memory_order_relaxed);
+    uint64 NewHead;
+    do
     {
-      if(!Bucket.AllocatedData)
-        return &Bucket;
-    }
-
-    if(this->StringDataBuckets.Num == this->StringDataBuckets.Capacity)
-    {
-      return nullptr;
-    }
-
-    return &Expand(this->StringDataBuckets);
+      Bucket->NextFree.store(uint32(OldHead), std::memory_order_relaxed);
+      NewHead = (((OldHead >> 32) + 1) << 32) | Index;
+    } while(!Head.compare_exchange_weak(OldHead, NewHead, std::memory_order_release, std::memory_order_relaxed));
   }
 };
 
@@ -292,23 +309,20 @@ auto
 ::StringDefaultAllocator()
   -> allocator_interface*
 {
-  if(GlobalStringDefaultAllocator == nullptr)
-  {
-    static mallocator BaseAllocator{};
+  if(GlobalStringDefaultAllocator)
+    return GlobalStringDefaultAllocator;
 
-    #if 0
-      static string_allocator* TheAllocator{};
-      if(TheAllocator == nullptr)
-      {
-        TheAllocator = ::Allocate<string_allocator>(BaseAllocator);
-        MemConstruct(1, TheAllocator, BaseAllocator);
-      }
-      GlobalStringDefaultAllocator = TheAllocator;
-    #else
-      GlobalStringDefaultAllocator = &BaseAllocator;
-    #endif
-  }
-  return GlobalStringDefaultAllocator;
+  // Note: Intentionally leaked so strings that are destroyed during static
+  // destruction can still be deallocated. This includes the base allocator,
+  // which is constructed in static storage so its destructor never runs.
+  alignas(mallocator) static uint8 BaseAllocatorMemory[sizeof(mallocator)];
+  static string_allocator* TheAllocator = []()
+  {
+    auto BaseAllocator = Reinterpret<mallocator*>(BaseAllocatorMemory);
+    MemConstruct(1, BaseAllocator);
+    return New<string_allocator>(*BaseAllocator, *BaseAllocator);
+  }();
+  return TheAllocator;
 }
 
 auto
@@ -325,7 +339,7 @@ CreateInternal(allocator_interface& Allocator)
   Assert(Internal);
   MemConstruct(1, Internal);
   Internal->Data.Allocator = &Allocator;
-  Internal->RefCount = 1;
+  RefCountInit(Internal->RefCount);
 
   return Internal;
 }
@@ -352,8 +366,7 @@ StrAddRef(arc_string::internal* Internal)
   if(Internal == nullptr)
     return;
 
-  // TODO: Make thread-safe?
-  ++Internal->RefCount;
+  RefCountAddRef(Internal->RefCount);
 }
 
 static void
@@ -365,10 +378,7 @@ StrReleaseRef(allocator_interface* Allocator, arc_string::internal* Internal)
   // If there's an Internal pointer, there _must_ be an Allocator;
   Assert(Allocator);
 
-  // TODO: Make thread-safe?
-  --Internal->RefCount;
-
-  if(Internal->RefCount <= 0)
+  if(RefCountReleaseRef(Internal->RefCount))
   {
     DestroyInternal(*Allocator, Internal);
   }
@@ -499,12 +509,11 @@ auto
   -> void
 {
   StrEnsureInitialized(String);
-  if(String.Internal->RefCount > 1)
+  if(!RefCountIsUnique(String.Internal->RefCount))
   {
     Assert(String.Allocator);
     auto Allocator = String.Allocator;
     auto OldInternal = String.Internal;
-    StrReleaseRef(Allocator, OldInternal);
 
     auto NewInternal = CreateInternal(*Allocator);
 
@@ -512,6 +521,10 @@ auto
     SliceCopy(ExpandBy(NewInternal->Data, OldInternal->Data.Num),
               AsConst(Slice(OldInternal->Data)));
 
+    // Only let go of the old data once we're done reading it. Other threads
+    // may release their references in the meantime.
+    StrReleaseRef(Allocator, OldInternal);
+
     // Apply the new Internal instance.
     String.Internal = NewInternal;
   }
@@ -715,3 +728,24 @@ auto
 {
   return Slice(A) == Slice(B);
 }
+
+auto
+::StrAreEqual(arc_string const& A, slice<char const> B)
+  -> bool
+{
+  return Slice(A) == B;
+}
+
+auto
+::StrAreEqual(slice<char const> A, arc_string const& B)
+  -> bool
+{
+  return A == Slice(B);
+}
+
+auto
+::DictionaryHash(arc_string const& String)
+  -> uint32
+{
+  return DictionaryHash(AsConst(Slice(String)));
+}
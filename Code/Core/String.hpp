@@ -2,6 +2,7 @@
 
 #include "CoreAPI.hpp"
 #include "Array.hpp"
+#include "RefCount.hpp"
 
 RESERVE_PREFIX(Str);
 
@@ -28,7 +29,7 @@ public:
   struct internal
   {
     array<char> Data;
-    int RefCount;
+    ref_count RefCount;
   };
 
   allocator_interface* Allocator{};
@@ -75,6 +76,9 @@ public:
   void operator=(slice<char> Content);
 };
 
+/// The internal data lives outside of the string object.
+template<> struct impl_is_trivially_relocatable<arc_string> { static constexpr bool Value = true; };
+
 /// \note Usually you don't have to call this.
 CORE_API
 void
@@ -0,0 +1,275 @@
+#include "TrackingAllocator.hpp"
+#include "Log.hpp"
+
+#include <mutex>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+  #define TRACKING_RETURN_ADDRESS() _ReturnAddress()
+#else
+  #define TRACKING_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+
+/// Lives right in front of each allocation.
+struct allocation_header
+{
+  /// Distance from the beginning of the block obtained from the base allocator to the user pointer.
+  size_t Offset;
+  size_t Size;
+  void const* CallSite;
+};
+
+static tracking_allocator* GlobalTrackingAllocatorList{};
+
+/// Guards the list and the stats and call sites of all tracking allocators.
+/// The base allocators are called without holding it.
+static std::mutex TrackingMutex;
+
+static allocation_header*
+GetHeader(void* Ptr)
+{
+  return Reinterpret<allocation_header*>(Ptr) - 1;
+}
+
+static size_t
+HistogramBin(size_t Size)
+{
+  size_t Bin = 0;
+  while(Size > 1 && Bin < ALLOCATION_HISTOGRAM_NUM_BINS - 1)
+  {
+    Size >>= 1;
+    ++Bin;
+  }
+  return Bin;
+}
+
+static allocation_call_site*
+FindOrAddCallSite(tracking_allocator& Allocator, void const* Address)
+{
+  auto const NumCallSites = size_t(TRACKING_ALLOCATOR_MAX_CALL_SITES);
+  auto Index = (Reinterpret<size_t>(Address) >> 4) % NumCallSites;
+  for(size_t Probe = 0; Probe < NumCallSites; ++Probe)
+  {
+    auto& CallSite = Allocator.CallSites[Index];
+    if(CallSite.Address == Address)
+      return &CallSite;
+
+    if(CallSite.Address == nullptr)
+    {
+      CallSite.Address = Address;
+      return &CallSite;
+    }
+
+    Index = (Index + 1) % NumCallSites;
+  }
+
+  // Table is full.
+  return nullptr;
+}
+
+static void
+TrackLiveBytes(tracking_allocator& Allocator, allocation_header* Header, ptrdiff_t Delta)
+{
+  auto& Stats = Allocator.Stats;
+  Stats.LiveBytes += Delta;
+  Stats.PeakBytes = Max(Stats.PeakBytes, Stats.LiveBytes);
+
+  if(Header->CallSite)
+  {
+    auto CallSite = FindOrAddCallSite(Allocator, Header->CallSite);
+    if(CallSite)
+      CallSite->LiveBytes += Delta;
+  }
+}
+
+tracking_allocator::tracking_allocator(allocator_interface& BaseAllocator, char const* Tag)
+  : BaseAllocator(&BaseAllocator)
+  , Tag(Tag)
+{
+  std::lock_guard<std::mutex> Lock(TrackingMutex);
+  this->Next = GlobalTrackingAllocatorList;
+  if(this->Next)
+    this->Next->Previous = this;
+  GlobalTrackingAllocatorList = this;
+}
+
+tracking_allocator::~tracking_allocator()
+{
+  std::lock_guard<std::mutex> Lock(TrackingMutex);
+  if(this->Previous) this->Previous->Next = this->Next;
+  else               GlobalTrackingAllocatorList = this->Next;
+
+  if(this->Next)
+    this->Next->Previous = this->Previous;
+}
+
+void*
+tracking_allocator::Allocate(memory_size Size, size_t Alignment)
+{
+  Alignment = CheckedAlignment(Alignment);
+
+  // Reserve enough space in front of the user pointer for the header while
+  // keeping the user pointer aligned.
+  auto const HeaderSpace = ((sizeof(allocation_header) + Alignment - 1) / Alignment) * Alignment;
+  auto const NumBytes = ToBytes(Size);
+
+  auto Block = Reinterpret<uint8*>(this->BaseAllocator->Allocate(Bytes(HeaderSpace + NumBytes), Alignment));
+  if(Block == nullptr)
+    return nullptr;
+
+  auto Ptr = Block + HeaderSpace;
+  auto Header = GetHeader(Ptr);
+  Header->Offset = HeaderSpace;
+  Header->Size = NumBytes;
+  Header->CallSite = this->CaptureCallSites ? TRACKING_RETURN_ADDRESS() : nullptr;
+
+  std::lock_guard<std::mutex> Lock(TrackingMutex);
+  auto& Stats = this->Stats;
+  ++Stats.NumAllocations;
+  ++Stats.NumLiveAllocations;
+  Stats.TotalBytes += NumBytes;
+  ++Stats.SizeHistogram[HistogramBin(NumBytes)];
+
+  if(Header->CallSite)
+  {
+    auto CallSite = FindOrAddCallSite(*this, Header->CallSite);
+    if(CallSite)
+      ++CallSite->NumAllocations;
+  }
+
+  TrackLiveBytes(*this, Header, ptrdiff_t(NumBytes));
+
+  return Ptr;
+}
+
+void
+tracking_allocator::Deallocate(void* Ptr)
+{
+  if(Ptr == nullptr)
+    return;
+
+  auto Header = GetHeader(Ptr);
+  {
+    std::lock_guard<std::mutex> Lock(TrackingMutex);
+    TrackLiveBytes(*this, Header, -ptrdiff_t(Header->Size));
+
+    auto& Stats = this->Stats;
+    Assert(Stats.NumLiveAllocations > 0);
+    ++Stats.NumDeallocations;
+    --Stats.NumLiveAllocations;
+  }
+
+  this->BaseAllocator->Deallocate(Reinterpret<uint8*>(Ptr) - Header->Offset);
+}
+
+bool
+tracking_allocator::Resize(void* Ptr, memory_size NewSize)
+{
+  if(Ptr == nullptr)
+    return false;
+
+  auto Header = GetHeader(Ptr);
+  auto Block = Reinterpret<uint8*>(Ptr) - Header->Offset;
+  if(!this->BaseAllocator->Resize(Block, Bytes(Header->Offset) + NewSize))
+    return false;
+
+  auto const NewNumBytes = ToBytes(NewSize);
+  std::lock_guard<std::mutex> Lock(TrackingMutex);
+  TrackLiveBytes(*this, Header, ptrdiff_t(NewNumBytes) - ptrdiff_t(Header->Size));
+  Header->Size = NewNumBytes;
+  return true;
+}
+
+memory_size
+tracking_allocator::AllocationSize(void* Ptr)
+{
+  if(Ptr == nullptr)
+    return Bytes(0);
+
+  return Bytes(GetHeader(Ptr)->Size);
+}
+
+auto
+::TrackingAllocatorList()
+  -> tracking_allocator*
+{
+  std::lock_guard<std::mutex> Lock(TrackingMutex);
+  return GlobalTrackingAllocatorList;
+}
+
+auto
+::TrackingResetStats(tracking_allocator& Allocator)
+  -> void
+{
+  std::lock_guard<std::mutex> Lock(TrackingMutex);
+
+  // Live allocations are still around, so keep them.
+  auto const NumLiveAllocations = Allocator.Stats.NumLiveAllocations;
+  auto const LiveBytes = Allocator.Stats.LiveBytes;
+
+  Allocator.Stats = {};
+  Allocator.Stats.NumLiveAllocations = NumLiveAllocations;
+  Allocator.Stats.LiveBytes = LiveBytes;
+  Allocator.Stats.PeakBytes = LiveBytes;
+
+  for(auto& CallSite : Allocator.CallSites)
+    CallSite.NumAllocations = 0;
+}
+
+auto
+::TrackingLogReport(tracking_allocator const& Allocator, log_data* Log)
+  -> void
+{
+  // Take a snapshot, so logging doesn't happen while the lock is held.
+  allocation_stats Stats;
+  allocation_call_site CallSites[TRACKING_ALLOCATOR_MAX_CALL_SITES];
+  {
+    std::lock_guard<std::mutex> Lock(TrackingMutex);
+    Stats = Allocator.Stats;
+    MemCopy(TRACKING_ALLOCATOR_MAX_CALL_SITES, CallSites, Allocator.CallSites);
+  }
+
+  LogBeginScope(Log, "Allocations of %s", Allocator.Tag);
+  Defer [=](){ LogEndScope(Log, ""); };
+
+  LogInfo(Log, "Live:  %zu allocations, %.3fKiB", Stats.NumLiveAllocations, ToKiB(Bytes(Stats.LiveBytes)));
+  LogInfo(Log, "Peak:  %.3fKiB", ToKiB(Bytes(Stats.PeakBytes)));
+  LogInfo(Log, "Total: %zu allocations, %zu deallocations, %.3fKiB", Stats.NumAllocations, Stats.NumDeallocations, ToKiB(Bytes(Stats.TotalBytes)));
+
+  if(Stats.NumAllocations > 0)
+  {
+    LogBeginScope(Log, "Size histogram");
+    for(size_t Bin = 0; Bin < ALLOCATION_HISTOGRAM_NUM_BINS; ++Bin)
+    {
+      if(Stats.SizeHistogram[Bin] == 0)
+        continue;
+
+      LogInfo(Log, "%10zu B and up: %zu", size_t(1) << Bin, Stats.SizeHistogram[Bin]);
+    }
+    LogEndScope(Log, "");
+  }
+
+  if(Allocator.CaptureCallSites)
+  {
+    LogBeginScope(Log, "Call sites");
+    for(auto& CallSite : CallSites)
+    {
+      if(CallSite.Address == nullptr)
+        continue;
+
+      LogInfo(Log, "0x%zx: %zu allocations, %.3fKiB live", Reinterpret<size_t>(CallSite.Address), CallSite.NumAllocations, ToKiB(Bytes(CallSite.LiveBytes)));
+    }
+    LogEndScope(Log, "");
+  }
+}
+
+auto
+::TrackingLogReportAll(log_data* Log)
+  -> void
+{
+  for(auto Allocator = GlobalTrackingAllocatorList; Allocator; Allocator = Allocator->Next)
+  {
+    TrackingLogReport(*Allocator, Log);
+  }
+}
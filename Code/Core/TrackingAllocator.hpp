@@ -0,0 +1,100 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+#include "Allocator.hpp"
+
+#include <Backbone.hpp>
+
+struct log_data;
+
+enum
+{
+  /// Bin N counts allocations with a size in [2^N, 2^(N+1)). The last bin
+  /// also counts everything bigger than that.
+  ALLOCATION_HISTOGRAM_NUM_BINS = 32,
+
+  TRACKING_ALLOCATOR_MAX_CALL_SITES = 64,
+};
+
+struct allocation_stats
+{
+  size_t NumAllocations;
+  size_t NumDeallocations;
+  size_t NumLiveAllocations;
+  size_t LiveBytes;
+  size_t PeakBytes;
+  size_t TotalBytes;
+  size_t SizeHistogram[ALLOCATION_HISTOGRAM_NUM_BINS];
+};
+
+struct allocation_call_site
+{
+  void const* Address;
+  size_t NumAllocations;
+  size_t LiveBytes;
+};
+
+/// Decorates another allocator and keeps statistics about all allocations
+/// made through it.
+///
+/// Each tracking allocator represents one user tag, e.g. "Cfg" or "Image".
+/// All tracking allocators that are alive are linked together so a report of
+/// all of them can be produced with TrackingLogReportAll().
+///
+/// Every allocation is prefixed with a small header that stores its size,
+/// so allocations from this allocator must not be passed to the base
+/// allocator directly and vice versa.
+///
+/// Allocate(), Deallocate() and Resize() may be called from several threads
+/// at once, as long as the base allocator supports that. Reading \a Stats
+/// directly while other threads allocate gives approximate values;
+/// TrackingLogReport() reads a consistent snapshot.
+///
+/// \note Creating or destroying tracking allocators while
+///       TrackingLogReportAll() runs is not supported.
+class CORE_API tracking_allocator : public allocator_interface
+{
+public:
+  allocator_interface* BaseAllocator{};
+  char const* Tag = "Untagged";
+
+  allocation_stats Stats{};
+
+  /// Whether to record the return address of each call to Allocate().
+  bool CaptureCallSites{};
+
+  /// Open-addressing table of call sites. Call sites that don't fit in here
+  /// anymore are not recorded.
+  allocation_call_site CallSites[TRACKING_ALLOCATOR_MAX_CALL_SITES]{};
+
+  tracking_allocator* Previous{};
+  tracking_allocator* Next{};
+
+  tracking_allocator(allocator_interface& BaseAllocator, char const* Tag);
+  tracking_allocator(tracking_allocator const&) = delete; // No copy
+  virtual ~tracking_allocator();
+
+  virtual void* Allocate(memory_size Size, size_t Alignment) override;
+  virtual void Deallocate(void* Memory) override;
+  virtual bool Resize(void* Ptr, memory_size NewSize) override;
+  virtual memory_size AllocationSize(void* Ptr) override;
+};
+
+/// The first element in the list of all tracking allocators that are alive.
+CORE_API
+tracking_allocator*
+TrackingAllocatorList();
+
+CORE_API
+void
+TrackingResetStats(tracking_allocator& Allocator);
+
+/// Logs the stats of \a Allocator as info messages.
+CORE_API
+void
+TrackingLogReport(tracking_allocator const& Allocator, log_data* Log);
+
+/// Logs the stats of all tracking allocators that are alive.
+CORE_API
+void
+TrackingLogReportAll(log_data* Log);
@@ -0,0 +1,1135 @@
+#include "ZstdDecompression.hpp"
+#include "Hash.hpp"
+#include "Allocator.hpp"
+#include "Log.hpp"
+
+
+static uint32 const ZstdMagicNumber = 0xFD2FB528;
+
+/// Skippable frames use the magic numbers 0x184D2A50 to 0x184D2A5F.
+static uint32 const ZstdSkippableMagicNumber = 0x184D2A50;
+static uint32 const ZstdSkippableMagicMask = 0xFFFFFFF0;
+
+static size_t const ZstdMaxBlockSize = 128 * 1024;
+
+static uint32 const ZstdMaxHuffmanBits = 11;
+
+static uint32 const LiteralLengthMaxAccuracyLog = 9;
+static uint32 const MatchLengthMaxAccuracyLog = 9;
+static uint32 const OffsetMaxAccuracyLog = 8;
+static uint32 const HuffmanWeightMaxAccuracyLog = 6;
+
+static uint32 const LiteralLengthMaxCode = 35;
+static uint32 const MatchLengthMaxCode = 52;
+static uint32 const OffsetMaxCode = 31;
+static uint32 const HuffmanWeightMaxSymbol = 12;
+
+// The distributions that are used in the "predefined" compression mode.
+static int16 const DefaultLiteralLengthCounts[LiteralLengthMaxCode + 1] = {
+  4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+  2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+  -1, -1, -1, -1,
+};
+static int16 const DefaultMatchLengthCounts[MatchLengthMaxCode + 1] = {
+  1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+  -1, -1, -1, -1, -1,
+};
+static int16 const DefaultOffsetCounts[29] = {
+  1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1,
+};
+static uint32 const DefaultLiteralLengthAccuracyLog = 6;
+static uint32 const DefaultMatchLengthAccuracyLog = 6;
+static uint32 const DefaultOffsetAccuracyLog = 5;
+
+static uint32 const LiteralLengthBaselines[LiteralLengthMaxCode + 1] = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+  16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096,
+  8192, 16384, 32768, 65536,
+};
+static uint8 const LiteralLengthExtraBits[LiteralLengthMaxCode + 1] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+  13, 14, 15, 16,
+};
+static uint32 const MatchLengthBaselines[MatchLengthMaxCode + 1] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+  19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+  35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051,
+  4099, 8195, 16387, 32771, 65539,
+};
+static uint8 const MatchLengthExtraBits[MatchLengthMaxCode + 1] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+  12, 13, 14, 15, 16,
+};
+
+namespace
+{
+  struct fse_entry
+  {
+    uint16 Base;
+    uint8 Symbol;
+    uint8 NumBits;
+  };
+
+  struct fse_table
+  {
+    uint32 AccuracyLog;
+    fse_entry Entries[1 << LiteralLengthMaxAccuracyLog];
+  };
+
+  struct huffman_entry
+  {
+    uint8 Symbol;
+    uint8 NumBits;
+  };
+
+  struct huffman_table
+  {
+    uint32 MaxBits;
+    huffman_entry Entries[1 << ZstdMaxHuffmanBits];
+  };
+
+  /// Reads a bitstream from its end towards its beginning.
+  struct backward_bit_reader
+  {
+    uint8 const* Data;
+    size_t Size;
+
+    /// The number of bits that haven't been read yet. Negative if more bits
+    /// were read than the stream has; those read as zeros.
+    int64 NumBitsLeft;
+  };
+
+  /// The state that is carried over from one block to the next within a frame.
+  struct zstd_frame_context
+  {
+    uint8* FrameBegin;
+    uint8* Out;
+    uint8* OutEnd;
+
+    uint32 RepeatedOffsets[3];
+
+    bool HasHuffmanTable;
+    bool HasLiteralLengthTable;
+    bool HasOffsetTable;
+    bool HasMatchLengthTable;
+
+    huffman_table HuffmanTable;
+    fse_table LiteralLengthTable;
+    fse_table OffsetTable;
+    fse_table MatchLengthTable;
+
+    /// Decoded literals of the current block.
+    uint8 Literals[ZstdMaxBlockSize];
+  };
+}
+
+
+//
+// Bit Access
+//
+
+static uint32
+HighestBitIndex(uint32 Value)
+{
+  uint32 Result = 0;
+  while(Value >>= 1)
+    ++Result;
+  return Result;
+}
+
+static uint32
+ReadLittleEndian(uint8 const* Data, uint32 NumBytes)
+{
+  uint32 Result = 0;
+  for(uint32 Index = 0; Index < NumBytes; ++Index)
+    Result |= uint32(Data[Index]) << (8 * Index);
+  return Result;
+}
+
+static uint64
+ReadLittleEndian64(uint8 const* Data)
+{
+  return uint64(ReadLittleEndian(Data, 4)) | uint64(ReadLittleEndian(Data + 4, 4)) << 32;
+}
+
+/// Reads \a NumBits bits (at most 56) starting at bit \a BitOffset of \a Data.
+///
+/// Bits outside of the data are read as zeros.
+static uint64
+ReadBitsAt(uint8 const* Data, size_t Size, int64 BitOffset, uint32 NumBits)
+{
+  if(NumBits == 0)
+    return 0;
+
+  if(BitOffset < 0)
+  {
+    if(BitOffset + NumBits <= 0)
+      return 0;
+
+    uint32 const NumMissingBits = uint32(-BitOffset);
+    return ReadBitsAt(Data, Size, 0, NumBits - NumMissingBits) << NumMissingBits;
+  }
+
+  size_t const ByteIndex = size_t(BitOffset >> 3);
+  uint64 Word = 0;
+  if(ByteIndex + 8 <= Size)
+  {
+    Word = ReadLittleEndian64(Data + ByteIndex);
+  }
+  else
+  {
+    for(size_t Index = ByteIndex; Index < Size; ++Index)
+      Word |= uint64(Data[Index]) << (8 * (Index - ByteIndex));
+  }
+
+  return (Word >> (BitOffset & 7)) & ((uint64(1) << NumBits) - 1);
+}
+
+static bool
+InitBackwardBitReader(backward_bit_reader& Bits, uint8 const* Data, size_t Size)
+{
+  // The highest set bit of the last byte marks the beginning of the stream.
+  if(Size == 0 || Data[Size - 1] == 0)
+    return false;
+
+  Bits.Data = Data;
+  Bits.Size = Size;
+  Bits.NumBitsLeft = int64(Size - 1) * 8 + HighestBitIndex(Data[Size - 1]);
+  return true;
+}
+
+static uint32
+ReadBits(backward_bit_reader& Bits, uint32 NumBits)
+{
+  Bits.NumBitsLeft -= NumBits;
+  return uint32(ReadBitsAt(Bits.Data, Bits.Size, Bits.NumBitsLeft, NumBits));
+}
+
+static uint32
+PeekBits(backward_bit_reader const& Bits, uint32 NumBits)
+{
+  return uint32(ReadBitsAt(Bits.Data, Bits.Size, Bits.NumBitsLeft - NumBits, NumBits));
+}
+
+
+//
+// FSE
+//
+
+static bool
+BuildFseTable(int16 const* Counts, uint32 NumSymbols, uint32 AccuracyLog, fse_table& Table)
+{
+  uint32 const TableSize = 1u << AccuracyLog;
+  uint32 HighPosition = TableSize - 1;
+  uint16 NextState[256];
+
+  Table.AccuracyLog = AccuracyLog;
+
+  // Symbols with a "less than 1" probability go to the end of the table.
+  for(uint32 Symbol = 0; Symbol < NumSymbols; ++Symbol)
+  {
+    if(Counts[Symbol] == -1)
+    {
+      Table.Entries[HighPosition--].Symbol = uint8(Symbol);
+      NextState[Symbol] = 1;
+    }
+    else
+    {
+      NextState[Symbol] = uint16(Counts[Symbol]);
+    }
+  }
+
+  uint32 const Step = (TableSize >> 1) + (TableSize >> 3) + 3;
+  uint32 const Mask = TableSize - 1;
+  uint32 Position = 0;
+  for(uint32 Symbol = 0; Symbol < NumSymbols; ++Symbol)
+  {
+    for(int32 Index = 0; Index < Counts[Symbol]; ++Index)
+    {
+      Table.Entries[Position].Symbol = uint8(Symbol);
+      do
+      {
+        Position = (Position + Step) & Mask;
+      } while(Position > HighPosition);
+    }
+  }
+
+  if(Position != 0)
+    return false;
+
+  for(uint32 State = 0; State < TableSize; ++State)
+  {
+    auto& Entry = Table.Entries[State];
+    uint32 const Next = NextState[Entry.Symbol]++;
+    Entry.NumBits = uint8(AccuracyLog - HighestBitIndex(Next));
+    Entry.Base = uint16((Next << Entry.NumBits) - TableSize);
+  }
+
+  return true;
+}
+
+static void
+BuildRleFseTable(uint8 Symbol, fse_table& Table)
+{
+  Table.AccuracyLog = 0;
+  Table.Entries[0].Symbol = Symbol;
+  Table.Entries[0].NumBits = 0;
+  Table.Entries[0].Base = 0;
+}
+
+/// Reads the normalized distribution at the beginning of \a Data and builds the decoding table from it.
+static bool
+ReadFseTable(uint8 const* Data, size_t Size, uint32 MaxAccuracyLog, uint32 MaxSymbol,
+             fse_table& Table, size_t& NumBytesRead)
+{
+  if(Size == 0)
+    return false;
+
+  uint32 const AccuracyLog = uint32(ReadBitsAt(Data, Size, 0, 4)) + 5;
+  if(AccuracyLog > MaxAccuracyLog)
+    return false;
+
+  int64 BitOffset = 4;
+  int32 Remaining = (1 << AccuracyLog) + 1;
+  int32 Threshold = 1 << AccuracyLog;
+  uint32 NumBits = AccuracyLog + 1;
+
+  int16 Counts[256];
+  uint32 NumSymbols = 0;
+  bool PreviousWasZero = false;
+
+  while(Remaining > 1 && NumSymbols <= MaxSymbol)
+  {
+    if(PreviousWasZero)
+    {
+      // Runs of zero probabilities are stored as 2 bit repeat counts.
+      uint32 Repeat;
+      do
+      {
+        Repeat = uint32(ReadBitsAt(Data, Size, BitOffset, 2));
+        BitOffset += 2;
+        for(uint32 Index = 0; Index < Repeat; ++Index)
+        {
+          if(NumSymbols > MaxSymbol)
+            return false;
+          Counts[NumSymbols++] = 0;
+        }
+      } while(Repeat == 3);
+
+      PreviousWasZero = false;
+      if(NumSymbols > MaxSymbol)
+        break;
+    }
+
+    int32 const Max = (2 * Threshold - 1) - Remaining;
+    int32 Count = int32(ReadBitsAt(Data, Size, BitOffset, NumBits - 1));
+    if(Count < Max)
+    {
+      BitOffset += NumBits - 1;
+    }
+    else
+    {
+      Count = int32(ReadBitsAt(Data, Size, BitOffset, NumBits));
+      if(Count >= Threshold)
+        Count -= Max;
+      BitOffset += NumBits;
+    }
+
+    --Count;
+    Remaining -= Count < 0 ? -Count : Count;
+    if(Remaining < 1)
+      return false;
+
+    Counts[NumSymbols++] = int16(Count);
+    PreviousWasZero = Count == 0;
+
+    while(Remaining < Threshold)
+    {
+      --NumBits;
+      Threshold >>= 1;
+    }
+  }
+
+  if(Remaining != 1 || BitOffset > int64(Size) * 8)
+    return false;
+
+  NumBytesRead = size_t((BitOffset + 7) / 8);
+  return BuildFseTable(Counts, NumSymbols, AccuracyLog, Table);
+}
+
+static uint8
+DecodeFseSymbol(fse_table const& Table, uint32& State, backward_bit_reader& Bits)
+{
+  auto const& Entry = Table.Entries[State];
+  State = Entry.Base + ReadBits(Bits, Entry.NumBits);
+  return Entry.Symbol;
+}
+
+
+//
+// Huffman
+//
+
+static bool
+BuildHuffmanTable(uint8* Weights, uint32 NumWeights, huffman_table& Table)
+{
+  uint32 WeightSum = 0;
+  for(uint32 Index = 0; Index < NumWeights; ++Index)
+  {
+    if(Weights[Index] > ZstdMaxHuffmanBits)
+      return false;
+    if(Weights[Index] > 0)
+      WeightSum += 1u << (Weights[Index] - 1);
+  }
+
+  if(WeightSum == 0)
+    return false;
+
+  uint32 const MaxBits = HighestBitIndex(WeightSum) + 1;
+  if(MaxBits > ZstdMaxHuffmanBits)
+    return false;
+
+  // The weight of the last symbol is implied by filling up the table.
+  uint32 const Leftover = (1u << MaxBits) - WeightSum;
+  if((Leftover & (Leftover - 1)) != 0)
+    return false;
+  Weights[NumWeights++] = uint8(HighestBitIndex(Leftover) + 1);
+
+  uint32 RankCounts[ZstdMaxHuffmanBits + 1]{};
+  for(uint32 Index = 0; Index < NumWeights; ++Index)
+    ++RankCounts[Weights[Index]];
+
+  // Symbols with small weights get the lowest codes.
+  uint32 RankStart[ZstdMaxHuffmanBits + 1]{};
+  uint32 NextStart = 0;
+  for(uint32 Weight = 1; Weight <= MaxBits; ++Weight)
+  {
+    RankStart[Weight] = NextStart;
+    NextStart += RankCounts[Weight] << (Weight - 1);
+  }
+
+  Table.MaxBits = MaxBits;
+  for(uint32 Symbol = 0; Symbol < NumWeights; ++Symbol)
+  {
+    uint32 const Weight = Weights[Symbol];
+    if(Weight == 0)
+      continue;
+
+    huffman_entry const Entry{ uint8(Symbol), uint8(MaxBits + 1 - Weight) };
+    uint32 const Length = 1u << (Weight - 1);
+    for(uint32 Index = 0; Index < Length; ++Index)
+      Table.Entries[RankStart[Weight] + Index] = Entry;
+    RankStart[Weight] += Length;
+  }
+
+  return true;
+}
+
+static bool
+ReadHuffmanTable(uint8 const* Data, size_t Size, huffman_table& Table, size_t& NumBytesRead)
+{
+  if(Size == 0)
+    return false;
+
+  // One more than the maximum number of stored weights for the implied last one.
+  uint8 Weights[256];
+  uint32 NumWeights = 0;
+
+  uint32 const Header = Data[0];
+  if(Header >= 128)
+  {
+    // The weights are stored directly, 4 bits each.
+    NumWeights = Header - 127;
+    size_t const NumBytes = (NumWeights + 1) / 2;
+    if(1 + NumBytes > Size)
+      return false;
+
+    for(uint32 Index = 0; Index < NumWeights; ++Index)
+    {
+      uint8 const Byte = Data[1 + Index / 2];
+      Weights[Index] = (Index % 2 == 0) ? uint8(Byte >> 4) : uint8(Byte & 0xF);
+    }
+
+    NumBytesRead = 1 + NumBytes;
+  }
+  else
+  {
+    // The weights are compressed with FSE, using two interleaved states.
+    size_t const CompressedSize = Header;
+    if(1 + CompressedSize > Size)
+      return false;
+
+    fse_table WeightTable;
+    size_t TableSize;
+    if(!ReadFseTable(Data + 1, CompressedSize, HuffmanWeightMaxAccuracyLog, HuffmanWeightMaxSymbol, WeightTable, TableSize))
+      return false;
+
+    backward_bit_reader Bits;
+    if(!InitBackwardBitReader(Bits, Data + 1 + TableSize, CompressedSize - TableSize))
+      return false;
+
+    uint32 States[2];
+    States[0] = ReadBits(Bits, WeightTable.AccuracyLog);
+    States[1] = ReadBits(Bits, WeightTable.AccuracyLog);
+
+    // Decode until the stream is exhausted, then take one more symbol from the other state.
+    for(uint32 Current = 0; ; Current ^= 1)
+    {
+      if(NumWeights >= 255)
+        return false;
+
+      Weights[NumWeights++] = DecodeFseSymbol(WeightTable, States[Current], Bits);
+      if(Bits.NumBitsLeft < 0)
+      {
+        if(NumWeights >= 255)
+          return false;
+
+        Weights[NumWeights++] = WeightTable.Entries[States[Current ^ 1]].Symbol;
+        break;
+      }
+    }
+
+    NumBytesRead = 1 + CompressedSize;
+  }
+
+  return BuildHuffmanTable(Weights, NumWeights, Table);
+}
+
+static bool
+DecodeHuffmanStream(huffman_table const& Table, uint8 const* Data, size_t Size, uint8* Out, size_t NumSymbols)
+{
+  backward_bit_reader Bits;
+  if(!InitBackwardBitReader(Bits, Data, Size))
+    return false;
+
+  for(size_t Index = 0; Index < NumSymbols; ++Index)
+  {
+    auto const& Entry = Table.Entries[PeekBits(Bits, Table.MaxBits)];
+    Out[Index] = Entry.Symbol;
+    Bits.NumBitsLeft -= Entry.NumBits;
+  }
+
+  // The stream has to be consumed exactly.
+  return Bits.NumBitsLeft == 0;
+}
+
+
+//
+// Blocks
+//
+
+/// Decodes the literals section at the beginning of a compressed block.
+///
+/// Raw literals are not copied, so \a Literals may point into \a Data.
+static bool
+DecodeLiterals(zstd_frame_context& Context, uint8 const* Data, size_t Size,
+               uint8 const*& Literals, size_t& NumLiterals, size_t& NumBytesRead)
+{
+  if(Size == 0)
+    return false;
+
+  uint32 const BlockType = Data[0] & 3;
+  uint32 const SizeFormat = (Data[0] >> 2) & 3;
+
+  if(BlockType == 0 || BlockType == 1)
+  {
+    // Raw or RLE literals.
+    size_t HeaderSize;
+    switch(SizeFormat)
+    {
+      case 0:
+      case 2: HeaderSize = 1; break;
+      case 1: HeaderSize = 2; break;
+      default: HeaderSize = 3; break;
+    }
+    if(HeaderSize > Size)
+      return false;
+
+    uint32 const Header = ReadLittleEndian(Data, uint32(HeaderSize));
+    NumLiterals = HeaderSize == 1 ? Header >> 3 : Header >> 4;
+    if(NumLiterals > ZstdMaxBlockSize)
+      return false;
+
+    if(BlockType == 0)
+    {
+      if(HeaderSize + NumLiterals > Size)
+        return false;
+
+      Literals = Data + HeaderSize;
+      NumBytesRead = HeaderSize + NumLiterals;
+    }
+    else
+    {
+      if(HeaderSize + 1 > Size)
+        return false;
+
+      MemSet(NumLiterals, Context.Literals, Data[HeaderSize]);
+      Literals = Context.Literals;
+      NumBytesRead = HeaderSize + 1;
+    }
+
+    return true;
+  }
+
+  // Huffman compressed literals, possibly reusing the table of the previous block.
+  uint32 NumStreams = 4;
+  size_t HeaderSize;
+  uint32 SizeBits;
+  switch(SizeFormat)
+  {
+    case 0: NumStreams = 1; HeaderSize = 3; SizeBits = 10; break;
+    case 1: HeaderSize = 3; SizeBits = 10; break;
+    case 2: HeaderSize = 4; SizeBits = 14; break;
+    default: HeaderSize = 5; SizeBits = 18; break;
+  }
+  if(HeaderSize > Size)
+    return false;
+
+  uint64 Header = 0;
+  for(size_t Index = 0; Index < HeaderSize; ++Index)
+    Header |= uint64(Data[Index]) << (8 * Index);
+
+  uint32 const SizeMask = (1u << SizeBits) - 1;
+  NumLiterals = size_t(Header >> 4) & SizeMask;
+  size_t const CompressedSize = size_t(Header >> (4 + SizeBits)) & SizeMask;
+  if(NumLiterals > ZstdMaxBlockSize || HeaderSize + CompressedSize > Size)
+    return false;
+
+  uint8 const* Payload = Data + HeaderSize;
+  size_t PayloadSize = CompressedSize;
+
+  if(BlockType == 2)
+  {
+    size_t TableSize;
+    if(!ReadHuffmanTable(Payload, PayloadSize, Context.HuffmanTable, TableSize))
+      return false;
+
+    Context.HasHuffmanTable = true;
+    Payload += TableSize;
+    PayloadSize -= TableSize;
+  }
+  else if(!Context.HasHuffmanTable)
+  {
+    return false;
+  }
+
+  if(NumStreams == 1)
+  {
+    if(!DecodeHuffmanStream(Context.HuffmanTable, Payload, PayloadSize, Context.Literals, NumLiterals))
+      return false;
+  }
+  else
+  {
+    // A jump table with the sizes of the first three streams precedes them.
+    if(PayloadSize < 6)
+      return false;
+
+    size_t StreamSizes[4];
+    StreamSizes[0] = ReadLittleEndian(Payload + 0, 2);
+    StreamSizes[1] = ReadLittleEndian(Payload + 2, 2);
+    StreamSizes[2] = ReadLittleEndian(Payload + 4, 2);
+    size_t const FirstStreamsSize = StreamSizes[0] + StreamSizes[1] + StreamSizes[2];
+    if(6 + FirstStreamsSize > PayloadSize)
+      return false;
+    StreamSizes[3] = PayloadSize - 6 - FirstStreamsSize;
+
+    size_t const SegmentSize = (NumLiterals + 3) / 4;
+    if(3 * SegmentSize > NumLiterals)
+      return false;
+
+    uint8 const* Stream = Payload + 6;
+    for(uint32 Index = 0; Index < 4; ++Index)
+    {
+      size_t const NumSymbols = Index < 3 ? SegmentSize : NumLiterals - 3 * SegmentSize;
+      if(!DecodeHuffmanStream(Context.HuffmanTable, Stream, StreamSizes[Index], Context.Literals + Index * SegmentSize, NumSymbols))
+        return false;
+      Stream += StreamSizes[Index];
+    }
+  }
+
+  Literals = Context.Literals;
+  NumBytesRead = HeaderSize + CompressedSize;
+  return true;
+}
+
+static bool
+ReadSequenceTable(fse_table& Table, bool& HasTable, uint32 Mode,
+                  uint8 const* Data, size_t Size, size_t& Position,
+                  uint32 MaxAccuracyLog, uint32 MaxSymbol,
+                  int16 const* DefaultCounts, uint32 NumDefaultCounts, uint32 DefaultAccuracyLog)
+{
+  switch(Mode)
+  {
+    case 0:
+    {
+      if(!BuildFseTable(DefaultCounts, NumDefaultCounts, DefaultAccuracyLog, Table))
+        return false;
+    } break;
+
+    case 1:
+    {
+      if(Position >= Size || Data[Position] > MaxSymbol)
+        return false;
+      BuildRleFseTable(Data[Position++], Table);
+    } break;
+
+    case 2:
+    {
+      size_t NumBytesRead;
+      if(!ReadFseTable(Data + Position, Size - Position, MaxAccuracyLog, MaxSymbol, Table, NumBytesRead))
+        return false;
+      Position += NumBytesRead;
+    } break;
+
+    default:
+    {
+      // Repeat the table of the previous block.
+      if(!HasTable)
+        return false;
+    } break;
+  }
+
+  HasTable = true;
+  return true;
+}
+
+static void
+CopyMatch(uint8* Out, size_t Offset, size_t Length)
+{
+  uint8 const* Match = Out - Offset;
+  if(Offset >= Length)
+  {
+    MemCopy(Length, Out, Match);
+  }
+  else
+  {
+    // The match overlaps the bytes it produces.
+    for(size_t Index = 0; Index < Length; ++Index)
+      Out[Index] = Match[Index];
+  }
+}
+
+/// Decodes the sequences section of a compressed block and executes the sequences.
+static bool
+DecodeSequences(zstd_frame_context& Context, uint8 const* Data, size_t Size,
+                uint8 const* Literals, size_t NumLiterals)
+{
+  if(Size == 0)
+    return false;
+
+  size_t Position;
+  uint32 NumSequences;
+  if(Data[0] < 128)
+  {
+    NumSequences = Data[0];
+    Position = 1;
+  }
+  else if(Data[0] < 255)
+  {
+    if(Size < 2)
+      return false;
+    NumSequences = ((Data[0] - 128u) << 8) + Data[1];
+    Position = 2;
+  }
+  else
+  {
+    if(Size < 3)
+      return false;
+    NumSequences = Data[1] + (uint32(Data[2]) << 8) + 0x7F00;
+    Position = 3;
+  }
+
+  uint8 const* LiteralsEnd = Literals + NumLiterals;
+
+  if(NumSequences > 0)
+  {
+    if(Position >= Size)
+      return false;
+
+    uint32 const Modes = Data[Position++];
+    if((Modes & 3) != 0)
+      return false;
+
+    if(!ReadSequenceTable(Context.LiteralLengthTable, Context.HasLiteralLengthTable, Modes >> 6,
+                          Data, Size, Position,
+                          LiteralLengthMaxAccuracyLog, LiteralLengthMaxCode,
+                          DefaultLiteralLengthCounts, uint32(ArrayCount(DefaultLiteralLengthCounts)), DefaultLiteralLengthAccuracyLog) ||
+       !ReadSequenceTable(Context.OffsetTable, Context.HasOffsetTable, (Modes >> 4) & 3,
+                          Data, Size, Position,
+                          OffsetMaxAccuracyLog, OffsetMaxCode,
+                          DefaultOffsetCounts, uint32(ArrayCount(DefaultOffsetCounts)), DefaultOffsetAccuracyLog) ||
+       !ReadSequenceTable(Context.MatchLengthTable, Context.HasMatchLengthTable, (Modes >> 2) & 3,
+                          Data, Size, Position,
+                          MatchLengthMaxAccuracyLog, MatchLengthMaxCode,
+                          DefaultMatchLengthCounts, uint32(ArrayCount(DefaultMatchLengthCounts)), DefaultMatchLengthAccuracyLog))
+    {
+      return false;
+    }
+
+    backward_bit_reader Bits;
+    if(!InitBackwardBitReader(Bits, Data + Position, Size - Position))
+      return false;
+
+    uint32 LiteralLengthState = ReadBits(Bits, Context.LiteralLengthTable.AccuracyLog);
+    uint32 OffsetState = ReadBits(Bits, Context.OffsetTable.AccuracyLog);
+    uint32 MatchLengthState = ReadBits(Bits, Context.MatchLengthTable.AccuracyLog);
+
+    auto& Repeated = Context.RepeatedOffsets;
+
+    for(uint32 SequenceIndex = 0; SequenceIndex < NumSequences; ++SequenceIndex)
+    {
+      auto const& LiteralLengthEntry = Context.LiteralLengthTable.Entries[LiteralLengthState];
+      auto const& OffsetEntry = Context.OffsetTable.Entries[OffsetState];
+      auto const& MatchLengthEntry = Context.MatchLengthTable.Entries[MatchLengthState];
+
+      uint32 const OffsetCode = OffsetEntry.Symbol;
+      uint32 const MatchLengthCode = MatchLengthEntry.Symbol;
+      uint32 const LiteralLengthCode = LiteralLengthEntry.Symbol;
+
+      // The extra bits come in the order offset, match length, literal length.
+      uint32 const OffsetValue = (1u << OffsetCode) + ReadBits(Bits, OffsetCode);
+      size_t const MatchLength = MatchLengthBaselines[MatchLengthCode] + ReadBits(Bits, MatchLengthExtraBits[MatchLengthCode]);
+      size_t const LiteralLength = LiteralLengthBaselines[LiteralLengthCode] + ReadBits(Bits, LiteralLengthExtraBits[LiteralLengthCode]);
+
+      size_t Offset;
+      if(OffsetValue > 3)
+      {
+        Offset = OffsetValue - 3;
+        Repeated[2] = Repeated[1];
+        Repeated[1] = Repeated[0];
+        Repeated[0] = uint32(Offset);
+      }
+      else
+      {
+        // Without literals, the repeated offsets are shifted by one.
+        uint32 const RepeatIndex = OffsetValue - 1 + (LiteralLength == 0 ? 1 : 0);
+        if(RepeatIndex == 0)
+        {
+          Offset = Repeated[0];
+        }
+        else
+        {
+          Offset = RepeatIndex == 3 ? Repeated[0] - 1 : Repeated[RepeatIndex];
+          if(Offset == 0)
+            return false;
+
+          if(RepeatIndex != 1)
+            Repeated[2] = Repeated[1];
+          Repeated[1] = Repeated[0];
+          Repeated[0] = uint32(Offset);
+        }
+      }
+
+      // The states are updated in the order literal length, match length, offset.
+      if(SequenceIndex + 1 < NumSequences)
+      {
+        DecodeFseSymbol(Context.LiteralLengthTable, LiteralLengthState, Bits);
+        DecodeFseSymbol(Context.MatchLengthTable, MatchLengthState, Bits);
+        DecodeFseSymbol(Context.OffsetTable, OffsetState, Bits);
+      }
+
+      if(Bits.NumBitsLeft < 0)
+        return false;
+
+      //
+      // Execute the sequence.
+      //
+      if(LiteralLength > size_t(LiteralsEnd - Literals) ||
+         LiteralLength + MatchLength > size_t(Context.OutEnd - Context.Out))
+      {
+        return false;
+      }
+
+      MemCopy(LiteralLength, Context.Out, Literals);
+      Literals += LiteralLength;
+      Context.Out += LiteralLength;
+
+      if(Offset > size_t(Context.Out - Context.FrameBegin))
+        return false;
+
+      CopyMatch(Context.Out, Offset, MatchLength);
+      Context.Out += MatchLength;
+    }
+
+    if(Bits.NumBitsLeft != 0)
+      return false;
+  }
+
+  // Whatever literals are left go at the end.
+  size_t const NumRemainingLiterals = size_t(LiteralsEnd - Literals);
+  if(NumRemainingLiterals > size_t(Context.OutEnd - Context.Out))
+    return false;
+
+  MemCopy(NumRemainingLiterals, Context.Out, Literals);
+  Context.Out += NumRemainingLiterals;
+  return true;
+}
+
+static bool
+DecodeCompressedBlock(zstd_frame_context& Context, uint8 const* Data, size_t Size)
+{
+  uint8 const* Literals;
+  size_t NumLiterals;
+  size_t LiteralsSectionSize;
+  if(!DecodeLiterals(Context, Data, Size, Literals, NumLiterals, LiteralsSectionSize))
+    return false;
+
+  return DecodeSequences(Context, Data + LiteralsSectionSize, Size - LiteralsSectionSize, Literals, NumLiterals);
+}
+
+
+//
+// Frames
+//
+
+namespace
+{
+  struct zstd_frame_header
+  {
+    size_t HeaderSize;
+    bool HasContentSize;
+    uint64 ContentSize;
+    bool HasChecksum;
+    uint32 DictionaryId;
+  };
+}
+
+/// Parses the header that follows the magic number of a frame.
+static bool
+ReadFrameHeader(uint8 const* Data, size_t Size, zstd_frame_header& Header)
+{
+  if(Size < 1)
+    return false;
+
+  uint32 const Descriptor = Data[0];
+  uint32 const ContentSizeFlag = Descriptor >> 6;
+  bool const IsSingleSegment = (Descriptor & 0x20) != 0;
+  if((Descriptor & 0x08) != 0)
+    return false;
+
+  Header.HasChecksum = (Descriptor & 0x04) != 0;
+
+  static uint32 const DictionaryIdSizes[4] = { 0, 1, 2, 4 };
+  static uint32 const ContentSizeSizes[4] = { 0, 2, 4, 8 };
+  uint32 const DictionaryIdSize = DictionaryIdSizes[Descriptor & 3];
+  uint32 ContentSizeSize = ContentSizeSizes[ContentSizeFlag];
+  if(ContentSizeFlag == 0 && IsSingleSegment)
+    ContentSizeSize = 1;
+
+  size_t Position = 1;
+  if(!IsSingleSegment)
+    ++Position; // Window descriptor
+
+  if(Position + DictionaryIdSize + ContentSizeSize > Size)
+    return false;
+
+  Header.DictionaryId = ReadLittleEndian(Data + Position, DictionaryIdSize);
+  Position += DictionaryIdSize;
+
+  Header.HasContentSize = ContentSizeSize > 0;
+  if(ContentSizeSize == 8)
+    Header.ContentSize = ReadLittleEndian64(Data + Position);
+  else
+    Header.ContentSize = ReadLittleEndian(Data + Position, ContentSizeSize);
+  if(ContentSizeSize == 2)
+    Header.ContentSize += 256;
+  Position += ContentSizeSize;
+
+  Header.HeaderSize = Position;
+  return true;
+}
+
+static bool
+DecodeFrame(zstd_frame_context& Context, uint8 const* Data, size_t Size, size_t& NumBytesRead)
+{
+  zstd_frame_header Header;
+  if(!ReadFrameHeader(Data, Size, Header))
+  {
+    LogError("Invalid Zstandard frame header.");
+    return false;
+  }
+
+  if(Header.DictionaryId != 0)
+  {
+    LogError("Zstandard frames that need a dictionary are not supported.");
+    return false;
+  }
+
+  size_t Position = Header.HeaderSize;
+
+  Context.FrameBegin = Context.Out;
+  Context.RepeatedOffsets[0] = 1;
+  Context.RepeatedOffsets[1] = 4;
+  Context.RepeatedOffsets[2] = 8;
+  Context.HasHuffmanTable = false;
+  Context.HasLiteralLengthTable = false;
+  Context.HasOffsetTable = false;
+  Context.HasMatchLengthTable = false;
+
+  bool IsLastBlock = false;
+  while(!IsLastBlock)
+  {
+    if(Position + 3 > Size)
+      return false;
+
+    uint32 const BlockHeader = ReadLittleEndian(Data + Position, 3);
+    Position += 3;
+
+    IsLastBlock = (BlockHeader & 1) != 0;
+    uint32 const BlockType = (BlockHeader >> 1) & 3;
+    size_t const BlockSize = BlockHeader >> 3;
+    if(BlockSize > ZstdMaxBlockSize)
+      return false;
+
+    switch(BlockType)
+    {
+      case 0: // Raw
+      {
+        if(Position + BlockSize > Size || BlockSize > size_t(Context.OutEnd - Context.Out))
+          return false;
+
+        MemCopy(BlockSize, Context.Out, Data + Position);
+        Context.Out += BlockSize;
+        Position += BlockSize;
+      } break;
+
+      case 1: // RLE
+      {
+        if(Position + 1 > Size || BlockSize > size_t(Context.OutEnd - Context.Out))
+          return false;
+
+        MemSet(BlockSize, Context.Out, Data[Position]);
+        Context.Out += BlockSize;
+        Position += 1;
+      } break;
+
+      case 2: // Compressed
+      {
+        if(Position + BlockSize > Size)
+          return false;
+
+        if(!DecodeCompressedBlock(Context, Data + Position, BlockSize))
+          return false;
+        Position += BlockSize;
+      } break;
+
+      default:
+        return false;
+    }
+  }
+
+  size_t const ContentSize = size_t(Context.Out - Context.FrameBegin);
+  if(Header.HasContentSize && Header.ContentSize != ContentSize)
+    return false;
+
+  if(Header.HasChecksum)
+  {
+    if(Position + 4 > Size)
+      return false;
+
+    uint32 const Checksum = ReadLittleEndian(Data + Position, 4);
+    if(Checksum != uint32(HashXxh64(Slice<void const>(ContentSize, Context.FrameBegin))))
+    {
+      LogError("Zstandard checksum mismatch.");
+      return false;
+    }
+    Position += 4;
+  }
+
+  NumBytesRead = Position;
+  return true;
+}
+
+
+//
+// Public API
+//
+
+auto
+::ZstdFrameContentSize(slice<void const> Compressed, size_t& ContentSize)
+  -> bool
+{
+  auto const Data = Reinterpret<uint8 const*>(Compressed.Ptr);
+  if(Compressed.Num < 4 || ReadLittleEndian(Data, 4) != ZstdMagicNumber)
+    return false;
+
+  zstd_frame_header Header;
+  if(!ReadFrameHeader(Data + 4, Compressed.Num - 4, Header) || !Header.HasContentSize)
+    return false;
+
+  ContentSize = size_t(Header.ContentSize);
+  return true;
+}
+
+auto
+::ZstdDecompress(slice<void const> Compressed, slice<uint8> Target, size_t* NumWritten)
+  -> bool
+{
+  temp_allocator Allocator{};
+  auto Context = New<zstd_frame_context>(Allocator);
+  Defer [&](){ Delete(Allocator, Context); };
+
+  Context->Out = Target.Ptr;
+  Context->OutEnd = Target.Ptr + Target.Num;
+
+  auto const Data = Reinterpret<uint8 const*>(Compressed.Ptr);
+  size_t Position = 0;
+  bool Success = true;
+
+  while(Position < Compressed.Num)
+  {
+    if(Position + 4 > Compressed.Num)
+    {
+      Success = false;
+      break;
+    }
+
+    uint32 const Magic = ReadLittleEndian(Data + Position, 4);
+    Position += 4;
+
+    if((Magic & ZstdSkippableMagicMask) == ZstdSkippableMagicNumber)
+    {
+      if(Position + 4 > Compressed.Num)
+      {
+        Success = false;
+        break;
+      }
+
+      size_t const SkipSize = ReadLittleEndian(Data + Position, 4);
+      Position += 4;
+      if(SkipSize > Compressed.Num - Position)
+      {
+        Success = false;
+        break;
+      }
+      Position += SkipSize;
+      continue;
+    }
+
+    if(Magic != ZstdMagicNumber)
+    {
+      LogError("Not a Zstandard frame.");
+      Success = false;
+      break;
+    }
+
+    size_t FrameSize;
+    if(!DecodeFrame(*Context, Data + Position, Compressed.Num - Position, FrameSize))
+    {
+      Success = false;
+      break;
+    }
+    Position += FrameSize;
+  }
+
+  if(NumWritten)
+    *NumWritten = size_t(Context->Out - Target.Ptr);
+
+  return Success;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CoreAPI.hpp"
+
+#include <Backbone.hpp>
+
+
+/// \brief Reads the decompressed size from the header of the first Zstandard frame in \a Compressed.
+///
+/// \return \c false if \a Compressed doesn't start with a valid frame header
+///         or the frame doesn't store its size.
+CORE_API
+bool
+ZstdFrameContentSize(slice<void const> Compressed, size_t& ContentSize);
+
+/// \brief Decompresses all Zstandard frames in \a Compressed into \a Target.
+///
+/// Implements the format of RFC 8878, except for dictionaries. Skippable
+/// frames are ignored and content checksums are verified if present.
+///
+/// Can be called from several threads at once.
+///
+/// \param NumWritten Receives the number of bytes written to \a Target.
+///
+/// \return \c false if the data is malformed or doesn't fit into \a Target.
+CORE_API
+bool
+ZstdDecompress(slice<void const> Compressed, slice<uint8> Target, size_t* NumWritten = nullptr);
@@ -1,5 +1,6 @@
 #include <Backbone.hpp>
 #include <Core/Array.hpp>
+#include <Core/FileMapping.hpp>
 #include <Core/Log.hpp>
 
 #include <Cfg/Cfg.hpp>
@@ -10,42 +11,6 @@
 #include <stdio.h>
 
 
-static bool
-ReadFileContentIntoArray(arc_string FileName, array<uint8>& Array)
-{
-  Clear(Array);
-
-  auto File = std::fopen(StrPtr(FileName), "rb");
-  if(File == nullptr)
-    return false;
-
-  Defer [File](){ std::fclose(File); };
-
-  size_t const ChunkSize = KiB(4);
-
-  while(true)
-  {
-    auto NewSlice = ExpandBy(Array, ChunkSize);
-    auto const NumBytesRead = std::fread(NewSlice.Ptr, 1, ChunkSize, File);
-    auto const Delta = ChunkSize - NumBytesRead;
-
-    if(std::feof(File))
-    {
-      // Correct the internal array value in case we didn't exactly read a
-      // ChunkSize worth of bytes last time.
-      Array.Num -= Delta;
-
-      return true;
-    }
-
-    if(Delta > 0)
-    {
-      LogError("Didn't reach the end of file but failed to read any more bytes: %s", StrPtr(FileName));
-      return false;
-    }
-  }
-}
-
 template<typename T>
 bool
 WriteArrayContentToFile(slice<T> Content, arc_string FileName, size_t* NumBytesWritten = nullptr)
@@ -225,14 +190,16 @@ main(int NumArgs, char const* Args[])
 
   auto const InputFilePath = Options.InputFilePath;
 
-  array<uint8> Content{ Allocator };
-  if(!ReadFileContentIntoArray(InputFilePath, Content))
+  file_mapping Content{};
+  if(!FileMappingOpen(Content, InputFilePath))
   {
     LogError("Failed to read file: %*s", Convert<int>(InputFilePath.Num), InputFilePath.Ptr);
     LogUsage(GlobalLog);
     return 2;
   }
 
+  Defer [&](){ FileMappingClose(Content); };
+
   cfg_document Document{};
   Init(Document, Allocator);
   Defer [&](){ Finalize(Document); };
@@ -242,7 +209,7 @@ main(int NumArgs, char const* Args[])
     // robust and doesn't produce as many warnings.
     cfg_parsing_context Context{ InputFilePath, nullptr };
 
-    if(!CfgDocumentParseFromString(Document, SliceReinterpret<char const>(Slice(Content)), &Context))
+    if(!CfgDocumentParseFromString(Document, SliceReinterpret<char const>(Content.Data), &Context))
     {
       LogError("Failed to parse cfg.");
       return 3;
@@ -31,6 +31,7 @@ Init(spirv_shader& SpirvShader, allocator_interface& Allocator)
   -> void
 {
   SpirvShader.Code.Allocator = &Allocator;
+  SpirvShader.Code.Growth = container_growth::Exact;
 }
 
 auto
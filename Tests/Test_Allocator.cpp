@@ -0,0 +1,372 @@
+#include "TestHeader.hpp"
+#include <Core/Array.hpp>
+#include <Core/TrackingAllocator.hpp>
+#include <Core/Log.hpp>
+
+#include <thread>
+
+
+TEST_CASE("Mallocator", "[allocator]")
+{
+  mallocator Allocator;
+
+  SECTION("Small allocations")
+  {
+    auto Ptr = Allocator.Allocate(Bytes(100), 64);
+    REQUIRE( Ptr != nullptr );
+    REQUIRE( Reinterpret<size_t>(Ptr) % 64 == 0 );
+    REQUIRE( Allocator.AllocationSize(Ptr) >= Bytes(100) );
+    MemSetBytes(Bytes(100), Ptr, 0xAB);
+    Allocator.Deallocate(Ptr);
+  }
+
+  SECTION("Large allocations")
+  {
+    auto const Size = MALLOCATOR_MMAP_THRESHOLD + KiB(1);
+    auto Ptr = Allocator.Allocate(Size, 0);
+    REQUIRE( Ptr != nullptr );
+    REQUIRE( Reinterpret<size_t>(Ptr) % 4096 == 0 );
+    REQUIRE( Allocator.AllocationSize(Ptr) >= Size );
+    MemSetBytes(Size, Ptr, 0xAB);
+    Allocator.Deallocate(Ptr);
+  }
+
+  SECTION("Large allocations with an alignment above the page size")
+  {
+    auto const Size = MALLOCATOR_MMAP_THRESHOLD + KiB(1);
+    auto Ptr = Allocator.Allocate(Size, ToBytes(KiB(64)));
+    REQUIRE( Ptr != nullptr );
+    REQUIRE( Reinterpret<size_t>(Ptr) % ToBytes(KiB(64)) == 0 );
+    MemSetBytes(Size, Ptr, 0xAB);
+    Allocator.Deallocate(Ptr);
+  }
+
+  #if !defined(BB_Platform_Windows)
+    SECTION("Huge page candidates are aligned to huge pages")
+    {
+      auto const Size = MALLOCATOR_HUGE_PAGE_THRESHOLD;
+      auto Ptr = Allocator.Allocate(Size, 0);
+      REQUIRE( Ptr != nullptr );
+      REQUIRE( Reinterpret<size_t>(Ptr) % ToBytes(MiB(2)) == 0 );
+      MemSetBytes(Size, Ptr, 0xAB);
+      Allocator.Deallocate(Ptr);
+    }
+
+    SECTION("Resize")
+    {
+      auto Ptr = Allocator.Allocate(MALLOCATOR_MMAP_THRESHOLD, 0);
+      REQUIRE( Allocator.Resize(Ptr, Bytes(16)) );
+      REQUIRE( Allocator.AllocationSize(Ptr) == Bytes(16) );
+
+      // Growing back into the existing mapping always works.
+      REQUIRE( Allocator.Resize(Ptr, MALLOCATOR_MMAP_THRESHOLD) );
+      REQUIRE( Allocator.AllocationSize(Ptr) == MALLOCATOR_MMAP_THRESHOLD );
+      Allocator.Deallocate(Ptr);
+    }
+  #endif
+}
+
+TEST_CASE("Arena Allocator Basics", "[allocator]")
+{
+  test_allocator BaseAllocator;
+  arena_allocator Arena{ BaseAllocator, KiB(1) };
+
+  SECTION("Allocations are aligned and don't overlap")
+  {
+    auto A = Reinterpret<uint8*>(Arena.Allocate(Bytes(3), 1));
+    auto B = Reinterpret<uint8*>(Arena.Allocate(Bytes(8), 64));
+    REQUIRE( A != nullptr );
+    REQUIRE( B != nullptr );
+    REQUIRE( Reinterpret<size_t>(B) % 64 == 0 );
+    REQUIRE( B >= A + 3 );
+    REQUIRE( ArenaOwns(Arena, A) );
+    REQUIRE( ArenaOwns(Arena, B) );
+  }
+
+  SECTION("Allocations bigger than a block")
+  {
+    auto Ptr = Arena.Allocate(KiB(4), 0);
+    REQUIRE( Ptr != nullptr );
+    REQUIRE( Reinterpret<size_t>(Ptr) % GlobalDefaultAlignment == 0 );
+    REQUIRE( Arena.AllocationSize(Ptr) == KiB(4) );
+    REQUIRE( Arena.CurrentBlock->Used <= Arena.CurrentBlock->Capacity );
+
+    Ptr = Arena.Allocate(KiB(2), 128);
+    REQUIRE( Ptr != nullptr );
+    REQUIRE( Reinterpret<size_t>(Ptr) % 128 == 0 );
+    REQUIRE( Arena.CurrentBlock->Used <= Arena.CurrentBlock->Capacity );
+  }
+
+  SECTION("Only the last allocation can be resized")
+  {
+    auto A = Arena.Allocate(Bytes(16), 0);
+    auto B = Arena.Allocate(Bytes(16), 0);
+    REQUIRE( !Arena.Resize(A, Bytes(32)) );
+    REQUIRE( Arena.Resize(B, Bytes(32)) );
+    REQUIRE( Arena.AllocationSize(B) == Bytes(32) );
+    REQUIRE( !Arena.Resize(B, KiB(2)) );
+  }
+
+  SECTION("Deallocating the last allocation frees it")
+  {
+    auto A = Arena.Allocate(Bytes(16), 0);
+    Arena.Deallocate(A);
+    auto B = Arena.Allocate(Bytes(16), 0);
+    REQUIRE( A == B );
+  }
+}
+
+TEST_CASE("Arena Allocator Markers", "[allocator]")
+{
+  test_allocator BaseAllocator;
+  arena_allocator Arena{ BaseAllocator, KiB(1) };
+
+  auto A = Arena.Allocate(Bytes(16), 0);
+
+  SECTION("Rewind")
+  {
+    auto Marker = ArenaGetMarker(Arena);
+
+    // Obtaining a marker seals previous allocations.
+    REQUIRE( !Arena.Resize(A, Bytes(32)) );
+
+    auto B = Arena.Allocate(Bytes(16), 0);
+    auto C = Arena.Allocate(KiB(2), 0);
+    REQUIRE( ArenaOwns(Arena, C) );
+
+    ArenaRewind(Arena, Marker);
+    REQUIRE( ArenaOwns(Arena, A) );
+    REQUIRE( !ArenaOwns(Arena, B) );
+    REQUIRE( !ArenaOwns(Arena, C) );
+
+    // Memory after the marker is handed out again.
+    REQUIRE( Arena.Allocate(Bytes(16), 0) == B );
+  }
+
+  SECTION("Scoped marker")
+  {
+    void* B;
+    {
+      scoped_arena_marker Scope{ Arena };
+      B = Arena.Allocate(Bytes(16), 0);
+    }
+    REQUIRE( !ArenaOwns(Arena, B) );
+    REQUIRE( ArenaOwns(Arena, A) );
+  }
+
+  SECTION("Reset")
+  {
+    ArenaReset(Arena);
+    REQUIRE( !ArenaOwns(Arena, A) );
+    REQUIRE( Arena.FreeBlocks != nullptr );
+
+    ArenaReleaseMemory(Arena);
+    REQUIRE( Arena.FreeBlocks == nullptr );
+  }
+}
+
+TEST_CASE("Temp Allocator", "[allocator]")
+{
+  SECTION("Arrays grow in-place")
+  {
+    temp_allocator Allocator;
+    array<int> Arr{ Allocator };
+    Expand(Arr) = 0;
+    auto const FirstPtr = Arr.Ptr;
+    for(int Index = 1; Index < 100; ++Index)
+      Expand(Arr) = Index;
+
+    REQUIRE( Arr.Ptr == FirstPtr );
+    for(int Index = 0; Index < 100; ++Index)
+      REQUIRE( Arr[Index] == Index );
+  }
+
+  SECTION("Nested temp allocators")
+  {
+    temp_allocator Outer;
+    auto A = Outer.Allocate(Bytes(16), 0);
+    REQUIRE( ArenaOwns(*Outer.Arena, A) );
+
+    void* C;
+    {
+      temp_allocator Inner;
+      auto B = Inner.Allocate(Bytes(16), 0);
+      REQUIRE( ArenaOwns(*Inner.Arena, B) );
+
+      // The outer allocator must not use the arena while the inner one is alive.
+      C = Outer.Allocate(Bytes(16), 0);
+      REQUIRE( !ArenaOwns(*Outer.Arena, C) );
+    }
+
+    REQUIRE( ArenaOwns(*Outer.Arena, A) );
+    Outer.Deallocate(C);
+    Outer.Deallocate(A);
+  }
+}
+
+TEST_CASE("Pool Allocator", "[allocator]")
+{
+  test_allocator BaseAllocator;
+  pool_allocator Pool{ BaseAllocator };
+
+  SECTION("Blocks are cache line aligned and reused")
+  {
+    auto A = Pool.Allocate(Bytes(24), 0);
+    auto B = Pool.Allocate(Bytes(24), 0);
+    REQUIRE( A != B );
+    REQUIRE( Reinterpret<size_t>(A) % CACHE_LINE_SIZE == 0 );
+    REQUIRE( Reinterpret<size_t>(B) % CACHE_LINE_SIZE == 0 );
+    REQUIRE( Pool.AllocationSize(A) == Bytes(CACHE_LINE_SIZE) );
+
+    Pool.Deallocate(A);
+    REQUIRE( Pool.Allocate(Bytes(24), 0) == A );
+  }
+
+  SECTION("Size classes")
+  {
+    auto Small = Pool.Allocate(Bytes(CACHE_LINE_SIZE), 0);
+    auto Medium = Pool.Allocate(Bytes(CACHE_LINE_SIZE + 1), 0);
+    REQUIRE( Pool.AllocationSize(Small) == Bytes(CACHE_LINE_SIZE) );
+    REQUIRE( Pool.AllocationSize(Medium) == Bytes(2 * CACHE_LINE_SIZE) );
+
+    REQUIRE( Pool.Resize(Medium, Bytes(2 * CACHE_LINE_SIZE)) );
+    REQUIRE( !Pool.Resize(Medium, Bytes(2 * CACHE_LINE_SIZE + 1)) );
+
+    auto Stats = PoolGetStats(Pool);
+    REQUIRE( Stats.NumSlabs == 2 );
+    REQUIRE( Stats.NumUsedBlocks == 2 );
+  }
+
+  SECTION("Large allocations go to the base allocator")
+  {
+    auto Large = Pool.Allocate(KiB(16), 0);
+    REQUIRE( Large != nullptr );
+    REQUIRE( Pool.NumLargeAllocations == 1 );
+    REQUIRE( PoolGetStats(Pool).NumSlabs == 0 );
+
+    Pool.Deallocate(Large);
+    REQUIRE( Pool.NumLargeAllocations == 0 );
+  }
+
+  SECTION("Occupancy")
+  {
+    void* Blocks[1000];
+    for(auto& Block : Blocks)
+      Block = Pool.Allocate(Bytes(100), 0);
+
+    auto Stats = Pool.Stats[1];
+    REQUIRE( Stats.BlockSize == 2 * CACHE_LINE_SIZE );
+    REQUIRE( Stats.NumUsedBlocks == 1000 );
+    REQUIRE( Stats.NumBlocks >= 1000 );
+    REQUIRE( Stats.NumSlabs == (1000 * 2 * CACHE_LINE_SIZE + ToBytes(Pool.SlabSize) - 1) / ToBytes(Pool.SlabSize) );
+
+    for(auto Block : Blocks)
+      Pool.Deallocate(Block);
+
+    REQUIRE( PoolGetStats(Pool).NumUsedBlocks == 0 );
+
+    PoolReleaseMemory(Pool);
+    REQUIRE( PoolGetStats(Pool).NumSlabs == 0 );
+  }
+}
+
+TEST_CASE("Tracking Allocator", "[allocator]")
+{
+  test_allocator BaseAllocator;
+  tracking_allocator Tracker{ BaseAllocator, "Test" };
+
+  REQUIRE( TrackingAllocatorList() == &Tracker );
+
+  SECTION("Stats")
+  {
+    auto A = Tracker.Allocate(Bytes(100), 0);
+    auto B = Tracker.Allocate(Bytes(3), 64);
+    REQUIRE( Reinterpret<size_t>(B) % 64 == 0 );
+    REQUIRE( Tracker.AllocationSize(A) == Bytes(100) );
+
+    REQUIRE( Tracker.Stats.NumAllocations == 2 );
+    REQUIRE( Tracker.Stats.NumLiveAllocations == 2 );
+    REQUIRE( Tracker.Stats.LiveBytes == 103 );
+    REQUIRE( Tracker.Stats.SizeHistogram[6] == 1 ); // 100 is in [64, 128)
+    REQUIRE( Tracker.Stats.SizeHistogram[1] == 1 ); // 3 is in [2, 4)
+
+    Tracker.Deallocate(A);
+    REQUIRE( Tracker.Stats.NumLiveAllocations == 1 );
+    REQUIRE( Tracker.Stats.LiveBytes == 3 );
+    REQUIRE( Tracker.Stats.PeakBytes == 103 );
+    REQUIRE( Tracker.Stats.TotalBytes == 103 );
+
+    Tracker.Deallocate(B);
+    REQUIRE( Tracker.Stats.LiveBytes == 0 );
+    REQUIRE( Tracker.Stats.NumDeallocations == 2 );
+  }
+
+  SECTION("Resize through an arena")
+  {
+    arena_allocator Arena{ BaseAllocator };
+    tracking_allocator ArenaTracker{ Arena, "Arena" };
+    REQUIRE( TrackingAllocatorList() == &ArenaTracker );
+
+    array<int> Arr{ ArenaTracker };
+    Reserve(Arr, 16);
+    auto const Ptr = Arr.Ptr;
+    Reserve(Arr, 64);
+    REQUIRE( Arr.Ptr == Ptr );
+    REQUIRE( ArenaTracker.Stats.NumAllocations == 1 );
+    REQUIRE( ArenaTracker.Stats.LiveBytes == 64 * sizeof(int) );
+  }
+
+  SECTION("Allocations from several threads")
+  {
+    mallocator ThreadSafeAllocator{};
+    tracking_allocator ThreadTracker{ ThreadSafeAllocator, "Threads" };
+    ThreadTracker.CaptureCallSites = true;
+
+    auto Worker = [&ThreadTracker]()
+    {
+      for(int Iteration = 0; Iteration < 1000; ++Iteration)
+      {
+        auto Ptr = ThreadTracker.Allocate(Bytes(16), 0);
+        ThreadTracker.Resize(Ptr, Bytes(32));
+        ThreadTracker.Deallocate(Ptr);
+      }
+    };
+
+    std::thread Threads[8];
+    for(auto& Thread : Threads)
+      Thread = std::thread(Worker);
+    for(auto& Thread : Threads)
+      Thread.join();
+
+    REQUIRE( ThreadTracker.Stats.NumAllocations == 8000 );
+    REQUIRE( ThreadTracker.Stats.NumDeallocations == 8000 );
+    REQUIRE( ThreadTracker.Stats.NumLiveAllocations == 0 );
+    REQUIRE( ThreadTracker.Stats.LiveBytes == 0 );
+  }
+
+  SECTION("Call sites and report")
+  {
+    Tracker.CaptureCallSites = true;
+    auto A = Tracker.Allocate(Bytes(8), 0);
+
+    size_t NumCallSites = 0;
+    for(auto& CallSite : Tracker.CallSites)
+    {
+      if(CallSite.Address)
+      {
+        ++NumCallSites;
+        REQUIRE( CallSite.NumAllocations == 1 );
+        REQUIRE( CallSite.LiveBytes == 8 );
+      }
+    }
+    REQUIRE( NumCallSites == 1 );
+
+    log_data Log{};
+    int NumMessages = 0;
+    Log.Sinks += [&NumMessages](log_sink_args){ ++NumMessages; };
+    TrackingLogReport(Tracker, &Log);
+    REQUIRE( NumMessages > 0 );
+
+    Tracker.Deallocate(A);
+  }
+}
@@ -1,5 +1,8 @@
 #include "TestHeader.hpp"
 #include <Core/Array.hpp>
+#include <Core/InlineArray.hpp>
+#include <Core/TrackingAllocator.hpp>
+#include <Core/String.hpp>
 
 
 TEST_CASE("Array Basics", "[array]")
@@ -149,3 +152,160 @@ TEST_CASE("Array Remove", "[array]")
     REQUIRE( Arr[2] == 3 );
   }
 }
+
+TEST_CASE("Inline Array", "[array]")
+{
+  test_allocator Allocator;
+  tracking_allocator Tracker{ Allocator, "Inline Array" };
+  inline_array<int, 4> Arr{ Tracker };
+
+  REQUIRE( IsInline(Arr) );
+  REQUIRE( Arr.Capacity == 4 );
+
+  SECTION("Stays inline")
+  {
+    Arr += 1;
+    Arr += 2;
+    Expand(Arr) = 3;
+    Append(Arr, 4);
+    REQUIRE( IsInline(Arr) );
+    REQUIRE( Tracker.Stats.NumAllocations == 0 );
+    REQUIRE( Slice(Arr).Num == 4 );
+
+    RemoveAt(Arr, 0);
+    REQUIRE( Arr.Num == 3 );
+    REQUIRE( Arr[0] == 2 );
+  }
+
+  SECTION("Spills to the allocator")
+  {
+    for(int Index = 0; Index < 5; ++Index)
+      Arr += Index;
+
+    REQUIRE( !IsInline(Arr) );
+    REQUIRE( Tracker.Stats.NumLiveAllocations == 1 );
+    for(int Index = 0; Index < 5; ++Index)
+      REQUIRE( Arr[Index] == Index );
+
+    Reset(Arr);
+    REQUIRE( Tracker.Stats.NumLiveAllocations == 0 );
+  }
+}
+
+TEST_CASE("Array Growth", "[array]")
+{
+  test_allocator Allocator;
+  array<int> Arr{ Allocator };
+
+  SECTION("Double")
+  {
+    Reserve(Arr, ARRAY_MINIMUM_CAPACITY + 1);
+    REQUIRE( Arr.Capacity == 2 * ARRAY_MINIMUM_CAPACITY );
+  }
+
+  SECTION("One and a half")
+  {
+    Arr.Growth = container_growth::OneAndAHalf;
+    Reserve(Arr, ARRAY_MINIMUM_CAPACITY + 1);
+    REQUIRE( Arr.Capacity == ARRAY_MINIMUM_CAPACITY + ARRAY_MINIMUM_CAPACITY / 2 );
+  }
+
+  SECTION("Exact")
+  {
+    Arr.Growth = container_growth::Exact;
+    Reserve(Arr, 3);
+    REQUIRE( Arr.Capacity == 3 );
+    Reserve(Arr, 1000);
+    REQUIRE( Arr.Capacity == 1000 );
+  }
+
+  SECTION("Moving keeps the growth settings")
+  {
+    Arr.CanGrow = false;
+    Arr.Growth = container_growth::Exact;
+
+    array<int> Moved{ Move(Arr) };
+    REQUIRE( !Moved.CanGrow );
+    REQUIRE( Moved.Growth == container_growth::Exact );
+
+    array<int> Assigned{};
+    Assigned = Move(Moved);
+    REQUIRE( !Assigned.CanGrow );
+    REQUIRE( Assigned.Growth == container_growth::Exact );
+  }
+
+  REQUIRE( ContainerGrowCapacity(container_growth::Double, 0, 1, 4) == 4 );
+  REQUIRE( ContainerGrowCapacity(container_growth::Double, 8, 9, 4) == 16 );
+  REQUIRE( ContainerGrowCapacity(container_growth::OneAndAHalf, 1, 2, 1) == 2 );
+  REQUIRE( ContainerGrowCapacity(container_growth::OneAndAHalf, 8, 13, 4) == 18 );
+}
+
+namespace
+{
+  /// Never resizes in-place so that ContainerReserve has to relocate.
+  class no_resize_allocator : public allocator_interface
+  {
+  public:
+    test_allocator Base;
+
+    virtual void* Allocate(memory_size Size, size_t Alignment) override { return Base.Allocate(Size, Alignment); }
+    virtual void Deallocate(void* Memory) override                      { Base.Deallocate(Memory); }
+    virtual bool Resize(void* Ptr, memory_size NewSize) override        { return false; }
+    virtual memory_size AllocationSize(void* Ptr) override              { return Base.AllocationSize(Ptr); }
+  };
+
+  struct counted
+  {
+    static int NumAlive;
+
+    int Value{};
+
+    counted()                                    { ++NumAlive; }
+    counted(counted const& Other) : Value(Other.Value) { ++NumAlive; }
+    counted(counted&& Other)      : Value(Other.Value) { ++NumAlive; }
+    ~counted()                                   { --NumAlive; }
+
+    void operator=(counted const& Other) { this->Value = Other.Value; }
+    void operator=(counted&& Other)      { this->Value = Other.Value; }
+  };
+
+  int counted::NumAlive = 0;
+}
+
+TEST_CASE("Array Relocation", "[array]")
+{
+  no_resize_allocator Allocator;
+
+  SECTION("Non-trivially relocatable elements are destructed once")
+  {
+    REQUIRE( !IsTriviallyRelocatable<counted>() );
+    {
+      array<counted> Arr{ Allocator };
+      for(int Index = 0; Index < 100; ++Index)
+        Expand(Arr).Value = Index;
+
+      REQUIRE( counted::NumAlive == 100 );
+      for(int Index = 0; Index < 100; ++Index)
+        REQUIRE( Arr[Index].Value == Index );
+    }
+    REQUIRE( counted::NumAlive == 0 );
+  }
+
+  SECTION("Arrays of arrays are relocated by copying bytes")
+  {
+    REQUIRE( IsTriviallyRelocatable<array<int>>() );
+    REQUIRE( IsTriviallyRelocatable<arc_string>() );
+
+    array<array<int>> Outer{ Allocator };
+    auto& First = Expand(Outer);
+    First.Allocator = &Allocator;
+    First += 42;
+    auto const FirstPtr = First.Ptr;
+
+    for(int Index = 0; Index < 100; ++Index)
+      Expand(Outer);
+
+    REQUIRE( Outer[0].Ptr == FirstPtr );
+    REQUIRE( Outer[0][0] == 42 );
+  }
+}
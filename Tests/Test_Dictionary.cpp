@@ -0,0 +1,142 @@
+// Note: Core/Time.hpp needs to be included before catch.hpp for some reason.
+// probably because of the word "time".
+#include <Core/Time.hpp>
+
+#include "TestHeader.hpp"
+#include <Core/Dictionary.hpp>
+#include <Core/String.hpp>
+
+#include <stdio.h>
+
+TEST_CASE("Dictionary Basics", "[dictionary]")
+{
+  test_allocator Allocator;
+  scoped_dictionary<int, float> Dict{ &Allocator };
+
+  REQUIRE( Get(&Dict, 42) == nullptr );
+  REQUIRE( !Remove(&Dict, 42) );
+
+  SECTION("GetOrCreate")
+  {
+    *GetOrCreate(&Dict, 42) = 1.5f;
+    *GetOrCreate(&Dict, 1337) = 3.0f;
+    REQUIRE( Dict.Num == 2 );
+    REQUIRE( *Get(&Dict, 42) == 1.5f );
+    REQUIRE( *Get(&Dict, 1337) == 3.0f );
+    REQUIRE( *GetOrCreate(&Dict, 42) == 1.5f );
+    REQUIRE( Dict.Num == 2 );
+
+    REQUIRE( Keys(&Dict).Num == 2 );
+    REQUIRE( Values(&Dict).Num == 2 );
+  }
+
+  SECTION("Many keys")
+  {
+    for(int Key = 0; Key < 1000; ++Key)
+      *GetOrCreate(&Dict, Key * 7) = float(Key);
+
+    REQUIRE( Dict.Num == 1000 );
+    for(int Key = 0; Key < 1000; ++Key)
+    {
+      auto Value = Get(&Dict, Key * 7);
+      REQUIRE( Value != nullptr );
+      REQUIRE( *Value == float(Key) );
+    }
+    REQUIRE( Get(&Dict, 1) == nullptr );
+  }
+
+  SECTION("Remove")
+  {
+    for(int Key = 0; Key < 100; ++Key)
+      *GetOrCreate(&Dict, Key) = float(Key);
+
+    for(int Key = 0; Key < 100; Key += 2)
+      REQUIRE( Remove(&Dict, Key) );
+
+    REQUIRE( Dict.Num == 50 );
+    for(int Key = 0; Key < 100; ++Key)
+    {
+      auto Value = Get(&Dict, Key);
+      if(Key % 2 == 0)
+      {
+        REQUIRE( Value == nullptr );
+      }
+      else
+      {
+        REQUIRE( Value != nullptr );
+        REQUIRE( *Value == float(Key) );
+      }
+    }
+
+    Clear(&Dict);
+    REQUIRE( Dict.Num == 0 );
+    REQUIRE( Get(&Dict, 1) == nullptr );
+  }
+}
+
+TEST_CASE("Dictionary String Keys", "[dictionary]")
+{
+  test_allocator Allocator;
+  scoped_dictionary<arc_string, int> Dict{ &Allocator };
+
+  *GetOrCreate(&Dict, "Foo"_S) = 1;
+  *GetOrCreate(&Dict, arc_string("Bar")) = 2;
+
+  REQUIRE( DictionaryHash(arc_string("Foo")) == DictionaryHash("Foo"_S) );
+  REQUIRE( *Get(&Dict, "Foo"_S) == 1 );
+  REQUIRE( *Get(&Dict, arc_string("Foo")) == 1 );
+  REQUIRE( *Get(&Dict, "Bar"_S) == 2 );
+  REQUIRE( Get(&Dict, "Baz"_S) == nullptr );
+
+  REQUIRE( Remove(&Dict, "Foo"_S) );
+  REQUIRE( Get(&Dict, "Foo"_S) == nullptr );
+  REQUIRE( *Get(&Dict, "Bar"_S) == 2 );
+}
+
+TEST_CASE("Dictionary Benchmark", "[dictionary][.Benchmark]")
+{
+  test_allocator Allocator;
+  int const NumKeys = 2000;
+
+  // What the dictionary used to do: Linear search in a key array.
+  SECTION("Linear search")
+  {
+    array<int> Keys{ Allocator };
+    array<int> Values{ Allocator };
+
+    stopwatch Stopwatch;
+    StopwatchStart(&Stopwatch);
+    for(int Key = 0; Key < NumKeys; ++Key)
+    {
+      if(SliceCountUntil(AsConst(Slice(Keys)), Key) == INVALID_INDEX)
+      {
+        Keys += Key;
+        Values += Key;
+      }
+    }
+
+    int Sum = 0;
+    for(int Key = 0; Key < NumKeys; ++Key)
+      Sum += Values[SliceCountUntil(AsConst(Slice(Keys)), Key)];
+    StopwatchStop(&Stopwatch);
+
+    printf("Linear search: %f (%d)\n", DurationAsSeconds(StopwatchDuration(&Stopwatch)), Sum);
+  }
+
+  SECTION("Hashed")
+  {
+    scoped_dictionary<int, int> Dict{ &Allocator };
+
+    stopwatch Stopwatch;
+    StopwatchStart(&Stopwatch);
+    for(int Key = 0; Key < NumKeys; ++Key)
+      *GetOrCreate(&Dict, Key) = Key;
+
+    int Sum = 0;
+    for(int Key = 0; Key < NumKeys; ++Key)
+      Sum += *Get(&Dict, Key);
+    StopwatchStop(&Stopwatch);
+
+    printf("Hashed: %f (%d)\n", DurationAsSeconds(StopwatchDuration(&Stopwatch)), Sum);
+  }
+}
@@ -0,0 +1,40 @@
+#include "TestHeader.hpp"
+#include <Core/FileMapping.hpp>
+
+
+TEST_CASE("File Mapping", "[FileMapping]")
+{
+  test_allocator Allocator{};
+
+  SECTION("Existing file")
+  {
+    auto FileName = "../Tests/TestData/Full.cfg";
+
+    array<uint8> FileContent{ Allocator };
+    if(!ReadFileContentIntoArray(FileContent, FileName))
+    {
+      FAIL( FileName << ": Unable to find file. Wrong working directory?" );
+    }
+
+    file_mapping Mapping{};
+    REQUIRE( FileMappingOpen(Mapping, SliceFromString(FileName)) );
+    REQUIRE( FileMappingIsOpen(Mapping) );
+    REQUIRE( Mapping.Data.Num == FileContent.Num );
+    REQUIRE( SliceReinterpret<uint8 const>(Mapping.Data) == AsConst(Slice(FileContent)) );
+
+    FileMappingClose(Mapping);
+    REQUIRE( !FileMappingIsOpen(Mapping) );
+    REQUIRE( !Mapping.Data );
+
+    // Closing twice is fine.
+    FileMappingClose(Mapping);
+  }
+
+  SECTION("Missing file")
+  {
+    file_mapping Mapping{};
+    REQUIRE( !FileMappingOpen(Mapping, "../Tests/TestData/DoesNotExist.cfg"_S) );
+    REQUIRE( !FileMappingIsOpen(Mapping) );
+    REQUIRE( !Mapping.Data );
+  }
+}
@@ -0,0 +1,22 @@
+#include "TestHeader.hpp"
+#include <Core/Hash.hpp>
+
+
+TEST_CASE("Hash XXH64", "[Hash]")
+{
+  auto Hash = [](char const* String, uint64 Seed = 0)
+  {
+    auto Data = SliceFromString(String);
+    return HashXxh64(Slice<void const>(Data.Num, Data.Ptr), Seed);
+  };
+
+  // Reference values of the xxHash library.
+  REQUIRE( Hash("") == 0xEF46DB3751D8E999ull );
+  REQUIRE( Hash("abc") == 0x44BC2CF5AD770999ull );
+
+  char const* Long = "Nobody inspects the spammish repetition of the long input that spans several stripes.";
+  REQUIRE( Hash(Long) == Hash(Long) );
+  REQUIRE( Hash(Long) != Hash(Long, 1) );
+  REQUIRE( Hash("abc", 1) != Hash("abc") );
+  REQUIRE( Hash("abd") != Hash("abc") );
+}
@@ -0,0 +1,319 @@
+#include "TestHeader.hpp"
+#include <Core/Image.hpp>
+#include <Core/ImageDataFormat_DDS.hpp>
+
+
+namespace
+{
+  struct test_storage
+  {
+    image_external_storage Storage;
+    int NumReleases;
+  };
+
+  void
+  ReleaseTestStorage(image_external_storage* Storage)
+  {
+    ++Reinterpret<test_storage*>(Storage)->NumReleases;
+  }
+}
+
+TEST_CASE("Image Borrowed Data", "[Image]")
+{
+  test_allocator Allocator{};
+
+  test_storage Storage{};
+  Storage.Storage.Release = &ReleaseTestStorage;
+
+  // 4x4 RGBA8 pixels.
+  uint8 Memory[64];
+  for(int Index = 0; Index < 64; ++Index)
+    Memory[Index] = uint8(Index);
+
+  image Image{};
+  Init(Image, Allocator);
+  Image.Format = image_format::R8G8B8A8_UNORM;
+  Image.Width = 4;
+  Image.Height = 4;
+
+  REQUIRE( !ImageBorrowData(Image, Slice<void const>(32, Memory), &Storage.Storage) );
+  REQUIRE( ImageBorrowData(Image, Slice<void const>(64, Memory), &Storage.Storage) );
+  REQUIRE( ImageIsBorrowed(Image) );
+  REQUIRE( ImageDataSize(Image) == 64 );
+  REQUIRE( ImageDataPointer<uint8>(AsConst(Image)) == &Memory[0] );
+  REQUIRE( ImageRowPitch(Image) == 16 );
+  REQUIRE( *ImagePixelPointer<uint8>(AsConst(Image), 0, 0, 0, 1, 2, 0) == 2 * 16 + 4 );
+
+  SECTION("Copies borrow from the same storage")
+  {
+    image Other{};
+    Init(Other, Allocator);
+    Copy(Other, Image);
+    REQUIRE( ImageIsBorrowed(Other) );
+    REQUIRE( ImageDataPointer<uint8>(AsConst(Other)) == &Memory[0] );
+
+    Finalize(Image);
+    REQUIRE( Storage.NumReleases == 0 );
+    Finalize(Other);
+    REQUIRE( Storage.NumReleases == 0 );
+  }
+
+  SECTION("Writing copies the data into the image")
+  {
+    auto Pixel = ImagePixelPointer<uint8>(Image, 0, 0, 0, 1, 2, 0);
+    REQUIRE( !ImageIsBorrowed(Image) );
+    REQUIRE( *Pixel == 2 * 16 + 4 );
+
+    *Pixel = 42;
+    REQUIRE( Memory[2 * 16 + 4] == 2 * 16 + 4 );
+    REQUIRE( ImageDataSize(Image) == 64 );
+    Finalize(Image);
+  }
+
+  // The provider lets go of its reference last.
+  REQUIRE( Storage.NumReleases == 0 );
+  ImageExternalStorageReleaseRef(&Storage.Storage);
+  REQUIRE( Storage.NumReleases == 1 );
+}
+
+TEST_CASE("Image DDS Borrowed Data", "[Image]")
+{
+  test_allocator Allocator{};
+
+  // A 4x4 RGBA8 DDS file.
+  uint32 File[32 + 16]{};
+  File[0]  = 0x20534444; // Magic
+  File[1]  = 124;        // Size
+  File[2]  = 0x1007;     // CAPS | HEIGHT | WIDTH | PIXELFORMAT
+  File[3]  = 4;          // Height
+  File[4]  = 4;          // Width
+  File[19] = 32;         // Ddspf.Size
+  File[20] = 0x41;       // Ddspf.Flags: RGB | ALPHAPIXELS
+  File[22] = 32;         // Ddspf.RGBBitCount
+  File[23] = 0x000000FF;
+  File[24] = 0x0000FF00;
+  File[25] = 0x00FF0000;
+  File[26] = 0xFF000000;
+  File[27] = 0x1000;     // Caps: TEXTURE
+  for(int Index = 0; Index < 16; ++Index)
+    File[32 + Index] = Index;
+
+  test_storage Storage{};
+  Storage.Storage.Release = &ReleaseTestStorage;
+
+  image_loader_dds Loader{};
+  image Image{};
+  Init(Image, Allocator);
+
+  SECTION("Borrow")
+  {
+    REQUIRE( Loader.BorrowImageFromData(Slice<void const>(sizeof(File), File), &Storage.Storage, Image) );
+    REQUIRE( ImageIsBorrowed(Image) );
+    REQUIRE( ImageDataPointer<uint32>(AsConst(Image)) == &File[32] );
+  }
+
+  SECTION("Copy")
+  {
+    REQUIRE( Loader.LoadImageFromData(Slice<void const>(sizeof(File), File), Image) );
+    REQUIRE( !ImageIsBorrowed(Image) );
+    REQUIRE( ImageDataPointer<uint32>(AsConst(Image))[5] == 5 );
+  }
+
+  REQUIRE( ImageDataSize(Image) == 64 );
+  Finalize(Image);
+
+  ImageExternalStorageReleaseRef(&Storage.Storage);
+  REQUIRE( Storage.NumReleases == 1 );
+}
+
+TEST_CASE("Image Copy-on-Write", "[Image]")
+{
+  test_allocator Allocator{};
+
+  image Original{};
+  Init(Original, Allocator);
+  Defer [&](){ Finalize(Original); };
+  Original.Format = image_format::R8G8B8A8_UNORM;
+  Original.Width = 4;
+  Original.Height = 4;
+  ImageAllocateData(Original);
+  *ImagePixelPointer<uint8>(Original, 0, 0, 0, 1, 1, 0) = 42;
+
+  image Copies[3]{};
+  for(auto& Copy : Copies)
+  {
+    Init(Copy, Allocator);
+    ::Copy(Copy, Original);
+    REQUIRE( ImageDataPointer<uint8>(AsConst(Copy)) == ImageDataPointer<uint8>(AsConst(Original)) );
+    REQUIRE( ImageDataSize(Copy) == 64 );
+  }
+
+  // Writing to one copy detaches it from the others.
+  *ImagePixelPointer<uint8>(Copies[0], 0, 0, 0, 1, 1, 0) = 123;
+  REQUIRE( ImageDataPointer<uint8>(AsConst(Copies[0])) != ImageDataPointer<uint8>(AsConst(Original)) );
+  REQUIRE( *ImagePixelPointer<uint8>(AsConst(Copies[0]), 0, 0, 0, 1, 1, 0) == 123 );
+  REQUIRE( *ImagePixelPointer<uint8>(AsConst(Copies[1]), 0, 0, 0, 1, 1, 0) == 42 );
+  REQUIRE( *ImagePixelPointer<uint8>(AsConst(Original), 0, 0, 0, 1, 1, 0) == 42 );
+
+  // Re-allocating the data of a shared image doesn't affect the others.
+  ImageAllocateData(Copies[1]);
+  REQUIRE( ImageDataPointer<uint8>(AsConst(Copies[1])) != ImageDataPointer<uint8>(AsConst(Original)) );
+  REQUIRE( ImageDataPointer<uint8>(AsConst(Copies[2])) == ImageDataPointer<uint8>(AsConst(Original)) );
+
+  for(auto& Copy : Copies)
+    Finalize(Copy);
+
+  REQUIRE( IsUnique(Original.Data) );
+}
+
+namespace
+{
+  void
+  FillWithPattern(image& Image)
+  {
+    auto Data = ImageData(Image);
+    for(size_t Index = 0; Index < Data.Num; ++Index)
+      Data[Index] = uint8(Index * 7);
+  }
+
+  bool
+  HaveSameContent(image const& A, image const& B)
+  {
+    if(A.Format          != B.Format          ||
+       A.Width           != B.Width           ||
+       A.Height          != B.Height          ||
+       A.Depth           != B.Depth           ||
+       A.NumMipLevels    != B.NumMipLevels    ||
+       A.NumFaces        != B.NumFaces        ||
+       A.NumArrayIndices != B.NumArrayIndices)
+      return false;
+
+    for(uint32 ArrayIndex = 0; ArrayIndex < A.NumArrayIndices; ++ArrayIndex)
+    {
+      for(uint32 Face = 0; Face < A.NumFaces; ++Face)
+      {
+        for(uint32 MipLevel = 0; MipLevel < A.NumMipLevels; ++MipLevel)
+        {
+          auto const Size = ImageDepthPitch(A, MipLevel) * ImageDepth(A, MipLevel);
+          auto const SubA = ImageData(A).Ptr + ImageDataOffSet(A, MipLevel, Face, ArrayIndex);
+          auto const SubB = ImageData(B).Ptr + ImageDataOffSet(B, MipLevel, Face, ArrayIndex);
+          if(!MemEqualBytes(Bytes(Size), SubA, SubB))
+            return false;
+        }
+      }
+    }
+
+    return true;
+  }
+}
+
+TEST_CASE("Image DDS Write", "[Image]")
+{
+  test_allocator Allocator{};
+
+  image_loader_dds Loader{};
+
+  image Source{};
+  Init(Source, Allocator);
+  Defer [&](){ Finalize(Source); };
+  Source.Format = image_format::R8G8B8A8_UNORM;
+  Source.Width = 8;
+  Source.Height = 4;
+
+  bool ExpectDxt10 = false;
+
+  SECTION("Mip chain")
+  {
+    Source.NumMipLevels = 4;
+  }
+
+  SECTION("Cubemap")
+  {
+    Source.Width = 4;
+    Source.NumFaces = 6;
+    Source.NumMipLevels = 3;
+  }
+
+  SECTION("Volume")
+  {
+    Source.Depth = 3;
+    Source.NumMipLevels = 2;
+  }
+
+  SECTION("Array")
+  {
+    Source.NumArrayIndices = 3;
+    Source.NumMipLevels = 2;
+    ExpectDxt10 = true;
+  }
+
+  SECTION("Cubemap array")
+  {
+    Source.Width = 4;
+    Source.NumFaces = 6;
+    Source.NumArrayIndices = 2;
+    ExpectDxt10 = true;
+  }
+
+  SECTION("Format without pixel mask")
+  {
+    // Has the same masks as R8G8B8A8_UNORM.
+    Source.Format = image_format::R8G8B8A8_UNORM_SRGB;
+    ExpectDxt10 = true;
+  }
+
+  SECTION("Block compressed")
+  {
+    Source.Format = image_format::BC1_UNORM;
+    Source.NumMipLevels = 2;
+  }
+
+  ImageAllocateData(Source);
+  FillWithPattern(Source);
+
+  array<uint8> File{ Allocator };
+
+  auto const FileSize = DdsFileSize(Source);
+  REQUIRE( Loader.WriteImageToArray(Source, File) );
+  REQUIRE( File.Num == FileSize );
+  // Pre-sized exactly, so no reallocation took place.
+  REQUIRE( File.Capacity == FileSize );
+  REQUIRE( File.Growth == container_growth::Double );
+
+  auto const HeaderSize = 128 + (ExpectDxt10 ? 20 : 0);
+  REQUIRE( File.Num == HeaderSize + ImageDataSize(Source) );
+  REQUIRE( (Reinterpret<uint32 const*>(File.Ptr)[21] == 0x30315844) == ExpectDxt10 );
+
+  image Loaded{};
+  Init(Loaded, Allocator);
+  Defer [&](){ Finalize(Loaded); };
+  REQUIRE( Loader.LoadImageFromData(Slice<void const>(File.Num, File.Ptr), Loaded) );
+  REQUIRE( HaveSameContent(Source, Loaded) );
+}
+
+TEST_CASE("Image DDS Write To File", "[Image]")
+{
+  test_allocator Allocator{};
+
+  image_loader_dds Loader{};
+
+  image Source{};
+  Init(Source, Allocator);
+  Defer [&](){ Finalize(Source); };
+  Source.Format = image_format::B8G8R8A8_UNORM;
+  Source.Width = 16;
+  Source.Height = 16;
+  Source.NumMipLevels = 5;
+  ImageAllocateData(Source);
+  FillWithPattern(Source);
+
+  auto const FileName = SliceFromString("Test_Image_DDS_Write_To_File.dds");
+  REQUIRE( WriteImageToFile(Loader, Source, FileName) );
+  Defer [&](){ std::remove("Test_Image_DDS_Write_To_File.dds"); };
+
+  image Loaded{};
+  Init(Loaded, Allocator);
+  Defer [&](){ Finalize(Loaded); };
+  REQUIRE( LoadImageFromFile(Loader, Loaded, FileName) );
+  REQUIRE( HaveSameContent(Source, Loaded) );
+}
@@ -0,0 +1,479 @@
+#include "TestHeader.hpp"
+#include <Core/ImageBlockCompression.hpp>
+#include <Core/ImageDataFormat_DDS.hpp>
+
+#include <cmath>
+
+
+namespace
+{
+  uint32
+  RGBA(uint32 R, uint32 G, uint32 B, uint32 A)
+  {
+    return R | (G << 8) | (B << 16) | (A << 24);
+  }
+
+  void
+  FillWithNoise(image& Image, uint32 Seed)
+  {
+    auto Data = ImageData(Image);
+    for(size_t Index = 0; Index < Data.Num; ++Index)
+    {
+      Seed = Seed * 1664525u + 1013904223u;
+      Data[Index] = uint8(Seed >> 24);
+    }
+  }
+
+  block_decoder const AllDecoders[] = { block_decoder::Scalar, block_decoder::SSE2, block_decoder::AVX2 };
+}
+
+TEST_CASE("Block Decode BC1", "[ImageBlockCompression]")
+{
+  uint32 Pixels[16];
+
+  SECTION("Four colors")
+  {
+    // Red and blue, the first 4 pixels use one palette entry each.
+    uint8 const Block[8] = { 0x00, 0xF8, 0x1F, 0x00, 0xE4, 0x00, 0x00, 0x00 };
+    BlockDecodeBC1(Block, Pixels);
+
+    REQUIRE( Pixels[0] == RGBA(255, 0,   0, 255) );
+    REQUIRE( Pixels[1] == RGBA(  0, 0, 255, 255) );
+    REQUIRE( Pixels[2] == RGBA(170, 0,  85, 255) );
+    REQUIRE( Pixels[3] == RGBA( 85, 0, 170, 255) );
+    REQUIRE( Pixels[15] == RGBA(255, 0, 0, 255) );
+  }
+
+  SECTION("Three colors and transparent black")
+  {
+    uint8 const Block[8] = { 0x1F, 0x00, 0x00, 0xF8, 0xE4, 0x00, 0x00, 0x00 };
+    BlockDecodeBC1(Block, Pixels);
+
+    REQUIRE( Pixels[0] == RGBA(  0, 0, 255, 255) );
+    REQUIRE( Pixels[1] == RGBA(255, 0,   0, 255) );
+    REQUIRE( Pixels[2] == RGBA(128, 0, 128, 255) );
+    REQUIRE( Pixels[3] == RGBA(  0, 0,   0,   0) );
+  }
+}
+
+TEST_CASE("Block Decode BC2 and BC3", "[ImageBlockCompression]")
+{
+  uint32 Pixels[16];
+
+  SECTION("Explicit alpha")
+  {
+    uint8 const Block[16] = {
+      0x10, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE, // Alpha 0, 1, 2, ..., 15
+      0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // White
+    };
+    BlockDecodeBC2(Block, Pixels);
+
+    for(uint32 Index = 0; Index < 16; ++Index)
+      REQUIRE( Pixels[Index] == RGBA(255, 255, 255, Index * 17) );
+  }
+
+  SECTION("Interpolated alpha, 8 values")
+  {
+    uint8 const Block[16] = {
+      0xFF, 0x00, 0x88, 0xC6, 0xFA, 0x00, 0x00, 0x00, // Indices 0, 1, 2, ..., 7
+      0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    BlockDecodeBC3(Block, Pixels);
+
+    uint32 const Expected[8] = { 255, 0, 219, 182, 146, 109, 73, 36 };
+    for(uint32 Index = 0; Index < 8; ++Index)
+      REQUIRE( Pixels[Index] >> 24 == Expected[Index] );
+    REQUIRE( Pixels[8] >> 24 == 255 );
+  }
+
+  SECTION("Interpolated alpha, 6 values")
+  {
+    uint8 const Block[16] = {
+      0x00, 0xFF, 0x88, 0xC6, 0xFA, 0x00, 0x00, 0x00,
+      0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    BlockDecodeBC3(Block, Pixels);
+
+    uint32 const Expected[8] = { 0, 255, 51, 102, 153, 204, 0, 255 };
+    for(uint32 Index = 0; Index < 8; ++Index)
+      REQUIRE( Pixels[Index] >> 24 == Expected[Index] );
+  }
+}
+
+TEST_CASE("Image Decompress", "[ImageBlockCompression]")
+{
+  test_allocator Allocator{};
+
+  image Source{};
+  Init(Source, Allocator);
+  Defer [&](){ Finalize(Source); };
+
+  SECTION("BC1") { Source.Format = image_format::BC1_UNORM; }
+  SECTION("BC2") { Source.Format = image_format::BC2_UNORM; }
+  SECTION("BC3") { Source.Format = image_format::BC3_UNORM_SRGB; }
+
+  // Not a multiple of the block size, with more blocks than a single SIMD iteration handles.
+  Source.Width = 45;
+  Source.Height = 22;
+  Source.NumMipLevels = 6;
+  Source.NumArrayIndices = 2;
+  ImageAllocateData(Source);
+  FillWithNoise(Source, 1234);
+
+  image Reference{};
+  Init(Reference, Allocator);
+  Defer [&](){ Finalize(Reference); };
+  REQUIRE( ImageDecompress(Reference, Source, block_decoder::Scalar) );
+  REQUIRE( Reference.Format == ImageDecompressedFormat(Source.Format) );
+  REQUIRE( Reference.Width == 45 );
+  REQUIRE( Reference.NumMipLevels == 6 );
+
+  // The top-left block of the first sub-image.
+  uint32 Pixels[16];
+  switch(Source.Format)
+  {
+    case image_format::BC1_UNORM: BlockDecodeBC1(ImageDataPointer<uint8>(AsConst(Source)), Pixels); break;
+    case image_format::BC2_UNORM: BlockDecodeBC2(ImageDataPointer<uint8>(AsConst(Source)), Pixels); break;
+    default:                      BlockDecodeBC3(ImageDataPointer<uint8>(AsConst(Source)), Pixels); break;
+  }
+  for(uint32 Y = 0; Y < 4; ++Y)
+  {
+    for(uint32 X = 0; X < 4; ++X)
+      REQUIRE( *ImagePixelPointer<uint32>(AsConst(Reference), 0, 0, 0, X, Y, 0) == Pixels[4 * Y + X] );
+  }
+
+  for(auto Decoder : AllDecoders)
+  {
+    if(!BlockDecoderIsSupported(Decoder))
+      continue;
+
+    for(uint32 NumThreads : { 1u, 4u })
+    {
+      image Result{};
+      Init(Result, Allocator);
+      Defer [&](){ Finalize(Result); };
+
+      REQUIRE( ImageDecompress(Result, Source, Decoder, NumThreads) );
+      REQUIRE( ImageDataSize(Result) == ImageDataSize(Reference) );
+      REQUIRE( MemEqualBytes(Bytes(ImageDataSize(Result)), ImageDataPointer<uint8>(AsConst(Result)), ImageDataPointer<uint8>(AsConst(Reference))) );
+    }
+  }
+}
+
+TEST_CASE("Image Decompress DDS File", "[ImageBlockCompression]")
+{
+  test_allocator Allocator{};
+
+  image_loader_dds Loader{};
+  image Source{};
+  Init(Source, Allocator);
+  Defer [&](){ Finalize(Source); };
+
+  auto FileName = "../Data/Kitten_DXT1_Mipmaps.dds";
+  if(!LoadImageFromFile(Loader, Source, SliceFromString(FileName)))
+  {
+    FAIL( FileName << ": Unable to load file. Wrong working directory?" );
+  }
+  REQUIRE( Source.Format == image_format::BC1_UNORM );
+
+  image Reference{};
+  Init(Reference, Allocator);
+  Defer [&](){ Finalize(Reference); };
+  REQUIRE( ImageDecompress(Reference, Source, block_decoder::Scalar) );
+
+  image Result{};
+  Init(Result, Allocator);
+  Defer [&](){ Finalize(Result); };
+  REQUIRE( ImageDecompress(Result, Source) );
+
+  REQUIRE( Result.Format == image_format::R8G8B8A8_UNORM );
+  REQUIRE( Result.NumMipLevels == Source.NumMipLevels );
+  REQUIRE( ImageDataSize(Result) == ImageDataSize(Reference) );
+  REQUIRE( MemEqualBytes(Bytes(ImageDataSize(Result)), ImageDataPointer<uint8>(AsConst(Result)), ImageDataPointer<uint8>(AsConst(Reference))) );
+
+  SECTION("Unsupported format")
+  {
+    REQUIRE( !ImageDecompress(Source, Result) );
+  }
+}
+
+namespace
+{
+  /// Decodes BC7 mode 6 blocks, which is all the encoder produces.
+  void
+  DecodeBc7Mode6(uint8 const* Block, uint32* Pixels)
+  {
+    uint32 Position = 0;
+    auto Read = [&](uint32 NumBits)
+    {
+      uint32 Result = 0;
+      for(uint32 Bit = 0; Bit < NumBits; ++Bit, ++Position)
+        Result |= uint32((Block[Position / 8] >> (Position % 8)) & 1) << Bit;
+      return Result;
+    };
+
+    REQUIRE( Read(7) == 0x40 );
+
+    uint32 Endpoints[2][4];
+    for(uint32 Channel = 0; Channel < 4; ++Channel)
+    {
+      Endpoints[0][Channel] = Read(7) << 1;
+      Endpoints[1][Channel] = Read(7) << 1;
+    }
+    uint32 const PBit0 = Read(1);
+    uint32 const PBit1 = Read(1);
+
+    uint32 const Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    for(uint32 Index = 0; Index < 16; ++Index)
+    {
+      uint32 const Weight = Weights[Read(Index == 0 ? 3 : 4)];
+      uint32 Pixel = 0;
+      for(uint32 Channel = 0; Channel < 4; ++Channel)
+      {
+        uint32 const E0 = Endpoints[0][Channel] | PBit0;
+        uint32 const E1 = Endpoints[1][Channel] | PBit1;
+        Pixel |= (((64 - Weight) * E0 + Weight * E1 + 32) >> 6) << (8 * Channel);
+      }
+      Pixels[Index] = Pixel;
+    }
+  }
+
+  /// Root mean square error per channel.
+  double
+  ColorError(uint32 const* A, uint32 const* B, size_t NumPixels, uint32 NumChannels = 4)
+  {
+    double Sum = 0;
+    for(size_t Index = 0; Index < NumPixels; ++Index)
+    {
+      for(uint32 Channel = 0; Channel < NumChannels; ++Channel)
+      {
+        double const Difference = double((A[Index] >> (8 * Channel)) & 0xFF) - double((B[Index] >> (8 * Channel)) & 0xFF);
+        Sum += Difference * Difference;
+      }
+    }
+    return std::sqrt(Sum / double(NumPixels * NumChannels));
+  }
+
+  /// Independent gradients per channel, which no single pair of endpoints fits exactly.
+  void
+  FillWithGradient(image& Image)
+  {
+    for(uint32 Y = 0; Y < Image.Height; ++Y)
+    {
+      for(uint32 X = 0; X < Image.Width; ++X)
+      {
+        auto Pixel = ImagePixelPointer<uint8>(Image, 0, 0, 0, X, Y, 0);
+        Pixel[0] = uint8(X * 255 / Image.Width);
+        Pixel[1] = uint8(Y * 255 / Image.Height);
+        Pixel[2] = uint8(128 + 100 * std::sin(0.1 * (X + Y)));
+        Pixel[3] = uint8(255 - (X + Y) * 2);
+      }
+    }
+  }
+}
+
+TEST_CASE("Block Encode", "[ImageBlockCompression]")
+{
+  uint32 Pixels[16];
+  uint32 Decoded[16];
+  uint8 Block[16];
+
+  SECTION("Solid color")
+  {
+    // Exactly representable in 565.
+    for(auto& Pixel : Pixels)
+      Pixel = RGBA(255, 0, 255, 255);
+
+    for(auto Quality : { block_encoder_quality::Fast, block_encoder_quality::High })
+    {
+      BlockEncodeBC1(Pixels, Block, Quality);
+      BlockDecodeBC1(Block, Decoded);
+      REQUIRE( ColorError(Pixels, Decoded, 16) == 0 );
+
+      BlockEncodeBC3(Pixels, Block, Quality);
+      BlockDecodeBC3(Block, Decoded);
+      REQUIRE( ColorError(Pixels, Decoded, 16) == 0 );
+
+      BlockEncodeBC7(Pixels, Block, Quality);
+      DecodeBc7Mode6(Block, Decoded);
+      REQUIRE( ColorError(Pixels, Decoded, 16) < 1 );
+    }
+  }
+
+  SECTION("Two colors")
+  {
+    for(uint32 Index = 0; Index < 16; ++Index)
+      Pixels[Index] = Index % 3 ? RGBA(0, 0, 0, 255) : RGBA(255, 255, 255, 0);
+
+    BlockEncodeBC3(Pixels, Block, block_encoder_quality::High);
+    BlockDecodeBC3(Block, Decoded);
+    REQUIRE( ColorError(Pixels, Decoded, 16) == 0 );
+
+    // All channels of an endpoint share a parity bit, so white with zero alpha is off by one.
+    BlockEncodeBC7(Pixels, Block, block_encoder_quality::High);
+    DecodeBc7Mode6(Block, Decoded);
+    REQUIRE( ColorError(Pixels, Decoded, 16) < 1 );
+  }
+
+  SECTION("BC1 transparency")
+  {
+    for(uint32 Index = 0; Index < 16; ++Index)
+      Pixels[Index] = Index < 8 ? RGBA(200, 100, 50, 0) : RGBA(8 * Index, 255 - 8 * Index, 0, 255);
+
+    BlockEncodeBC1(Pixels, Block);
+    BlockDecodeBC1(Block, Decoded);
+
+    for(uint32 Index = 0; Index < 8; ++Index)
+      REQUIRE( Decoded[Index] == 0 );
+
+    // The transparent pixels don't affect the colors of the opaque ones.
+    REQUIRE( ColorError(Pixels + 8, Decoded + 8, 8, 3) < 6 );
+    for(uint32 Index = 8; Index < 16; ++Index)
+      REQUIRE( Decoded[Index] >> 24 == 255 );
+  }
+}
+
+TEST_CASE("Image Compress", "[ImageBlockCompression]")
+{
+  test_allocator Allocator{};
+
+  image Source{};
+  Init(Source, Allocator);
+  Defer [&](){ Finalize(Source); };
+  Source.Format = image_format::R8G8B8A8_UNORM;
+  Source.Width = 37;
+  Source.Height = 21;
+  ImageAllocateData(Source);
+  FillWithGradient(Source);
+
+  auto const NumPixels = Source.Width * Source.Height;
+  auto const SourcePixels = ImageDataPointer<uint32>(AsConst(Source));
+
+  // The decoded pixels of the compressed image.
+  array<uint32> Result{ Allocator };
+  SetNum(Result, NumPixels);
+
+  auto Compress = [&](image_format Format, block_encoder_quality Quality) -> double
+  {
+    image Compressed{};
+    Init(Compressed, Allocator);
+    Defer [&](){ Finalize(Compressed); };
+    REQUIRE( ImageCompress(Compressed, Source, Format, Quality) );
+    REQUIRE( Compressed.Format == Format );
+    REQUIRE( Compressed.Width == Source.Width );
+
+    // Multiple threads produce the same result.
+    image SingleThreaded{};
+    Init(SingleThreaded, Allocator);
+    Defer [&](){ Finalize(SingleThreaded); };
+    REQUIRE( ImageCompress(SingleThreaded, Source, Format, Quality, 1) );
+    REQUIRE( ImageDataSize(SingleThreaded) == ImageDataSize(Compressed) );
+    REQUIRE( MemEqualBytes(Bytes(ImageDataSize(Compressed)), ImageDataPointer<uint8>(AsConst(Compressed)), ImageDataPointer<uint8>(AsConst(SingleThreaded))) );
+
+    if(Format == image_format::BC7_UNORM)
+    {
+      auto const NumBlocksX = ImageNumBlocksX(Compressed);
+      for(uint32 BlockY = 0; BlockY < ImageNumBlocksY(Compressed); ++BlockY)
+      {
+        for(uint32 BlockX = 0; BlockX < NumBlocksX; ++BlockX)
+        {
+          uint32 Pixels[16];
+          DecodeBc7Mode6(ImageDataPointer<uint8>(AsConst(Compressed)) + 16 * (BlockY * NumBlocksX + BlockX), Pixels);
+          for(uint32 Y = 0; Y < 4; ++Y)
+          {
+            for(uint32 X = 0; X < 4; ++X)
+            {
+              if(4 * BlockX + X < Source.Width && 4 * BlockY + Y < Source.Height)
+                Result[(4 * BlockY + Y) * Source.Width + 4 * BlockX + X] = Pixels[4 * Y + X];
+            }
+          }
+        }
+      }
+    }
+    else
+    {
+      image Decompressed{};
+      Init(Decompressed, Allocator);
+      Defer [&](){ Finalize(Decompressed); };
+      REQUIRE( ImageDecompress(Decompressed, Compressed) );
+      MemCopyBytes(Bytes(4 * NumPixels), Result.Ptr, ImageDataPointer<uint32>(AsConst(Decompressed)));
+    }
+
+    // BC1 has only 1 bit of alpha.
+    return ColorError(SourcePixels, Result.Ptr, NumPixels, Format == image_format::BC1_UNORM ? 3 : 4);
+  };
+
+  SECTION("BC1")
+  {
+    // Make everything opaque for BC1.
+    for(uint32 Y = 0; Y < Source.Height; ++Y)
+    {
+      for(uint32 X = 0; X < Source.Width; ++X)
+        ImagePixelPointer<uint8>(Source, 0, 0, 0, X, Y, 0)[3] = 255;
+    }
+
+    auto const Fast = Compress(image_format::BC1_UNORM, block_encoder_quality::Fast);
+    auto const High = Compress(image_format::BC1_UNORM, block_encoder_quality::High);
+    REQUIRE( Fast < 7.5 );
+    REQUIRE( High < 6.5 );
+    REQUIRE( High <= Fast );
+  }
+
+  SECTION("BC3")
+  {
+    auto const Fast = Compress(image_format::BC3_UNORM, block_encoder_quality::Fast);
+    auto const High = Compress(image_format::BC3_UNORM, block_encoder_quality::High);
+    REQUIRE( Fast < 6.5 );
+    REQUIRE( High < 6 );
+    REQUIRE( High <= Fast );
+  }
+
+  SECTION("BC7")
+  {
+    auto const Fast = Compress(image_format::BC7_UNORM, block_encoder_quality::Fast);
+    auto const High = Compress(image_format::BC7_UNORM, block_encoder_quality::High);
+    REQUIRE( Fast < 5.5 );
+    REQUIRE( High < 5 );
+    REQUIRE( High <= Fast );
+  }
+
+  SECTION("Float source")
+  {
+    image FloatSource{};
+    Init(FloatSource, Allocator);
+    Defer [&](){ Finalize(FloatSource); };
+    FloatSource.Format = image_format::R32G32B32A32_FLOAT;
+    FloatSource.Width = 8;
+    FloatSource.Height = 8;
+    ImageAllocateData(FloatSource);
+    for(uint32 Y = 0; Y < 8; ++Y)
+    {
+      for(uint32 X = 0; X < 8; ++X)
+      {
+        auto Pixel = ImagePixelPointer<float>(FloatSource, 0, 0, 0, X, Y, 0);
+        Pixel[0] = 1.0f;
+        Pixel[1] = 0.0f;
+        Pixel[2] = 2.0f; // Clamped
+        Pixel[3] = 1.0f;
+      }
+    }
+
+    image Compressed{};
+    Init(Compressed, Allocator);
+    Defer [&](){ Finalize(Compressed); };
+    REQUIRE( ImageCompress(Compressed, FloatSource, image_format::BC1_UNORM) );
+
+    uint32 Pixels[16];
+    BlockDecodeBC1(ImageDataPointer<uint8>(AsConst(Compressed)), Pixels);
+    REQUIRE( Pixels[5] == RGBA(255, 0, 255, 255) );
+  }
+
+  SECTION("Unsupported formats")
+  {
+    image Compressed{};
+    Init(Compressed, Allocator);
+    Defer [&](){ Finalize(Compressed); };
+    REQUIRE( !ImageCompress(Compressed, Source, image_format::BC2_UNORM) );
+    REQUIRE( !ImageCompress(Compressed, Source, image_format::R8G8B8A8_UNORM) );
+  }
+}
@@ -0,0 +1,186 @@
+#include "TestHeader.hpp"
+#include <Core/ImageCache.hpp>
+#include <Core/ImageDataFormat_DDS.hpp>
+
+#include <cstdio>
+
+
+namespace
+{
+  char const* const SourceFileName = "Test_ImageCache_Source.dds";
+  char const* const CacheDirectory = "Test_ImageCache";
+
+  /// Writes a RGBA8 image whose pixels are all \a Value.
+  void
+  WriteSourceImage(allocator_interface& Allocator, uint32 Width, uint32 Height, uint8 Value,
+                   char const* FileName = SourceFileName)
+  {
+    image Image{};
+    Init(Image, Allocator);
+    Defer [&](){ Finalize(Image); };
+
+    Image.Format = image_format::R8G8B8A8_UNORM;
+    Image.Width = Width;
+    Image.Height = Height;
+    ImageAllocateData(Image);
+    auto Data = ImageData(Image);
+    for(size_t Index = 0; Index < Data.Num; ++Index)
+      Data[Index] = Value;
+
+    image_loader_dds Loader{};
+    REQUIRE( WriteImageToFile(Loader, Image, SliceFromString(FileName)) );
+  }
+}
+
+TEST_CASE("Image Cache", "[ImageCache]")
+{
+  test_allocator Allocator{};
+
+  WriteSourceImage(Allocator, 16, 8, 42);
+  Defer [&](){ std::remove(SourceFileName); };
+
+  auto Cache = CreateImageCache(Allocator, SliceFromString(CacheDirectory));
+  REQUIRE( Cache != nullptr );
+  Defer [&]()
+  {
+    ImageCacheClear(*Cache);
+    DestroyImageCache(Allocator, Cache);
+    std::remove(CacheDirectory);
+  };
+
+  image Image{};
+  Init(Image, Allocator);
+  Defer [&](){ Finalize(Image); };
+
+  image_load_options Options{};
+  Options.GenerateMipmaps = true;
+
+  // Stands in for the processing of the image load queue.
+  image Processed{};
+  Init(Processed, Allocator);
+  Defer [&](){ Finalize(Processed); };
+  Processed.Format = image_format::R8G8B8A8_UNORM;
+  Processed.Width = 16;
+  Processed.Height = 8;
+  Processed.NumMipLevels = 5;
+  ImageAllocateData(Processed);
+  ImageData(Processed)[7] = 123;
+
+  image_cache_key Key{};
+  REQUIRE( !ImageCacheLookup(*Cache, SliceFromString(SourceFileName), Options, Image, Key) );
+  REQUIRE( Key.Value != 0 );
+  REQUIRE( ImageCacheStore(*Cache, Key, Processed) );
+
+  SECTION("Hit")
+  {
+    image_cache_key HitKey{};
+    REQUIRE( ImageCacheLookup(*Cache, SliceFromString(SourceFileName), Options, Image, HitKey) );
+    REQUIRE( HitKey.Value == Key.Value );
+    REQUIRE( ImageIsBorrowed(Image) );
+    REQUIRE( Image.Format == image_format::R8G8B8A8_UNORM );
+    REQUIRE( Image.Width == 16 );
+    REQUIRE( Image.Height == 8 );
+    REQUIRE( Image.NumMipLevels == 5 );
+    REQUIRE( ImageDataSize(Image) == ImageDataSize(Processed) );
+    REQUIRE( ImageData(AsConst(Image)) == Slice(ImageData(AsConst(Processed)), 0, ImageDataSize(Processed)) );
+  }
+
+  SECTION("The index survives the cache")
+  {
+    DestroyImageCache(Allocator, Cache);
+    Cache = CreateImageCache(Allocator, SliceFromString(CacheDirectory));
+    REQUIRE( Cache != nullptr );
+
+    image_cache_key HitKey{};
+    REQUIRE( ImageCacheLookup(*Cache, SliceFromString(SourceFileName), Options, Image, HitKey) );
+    REQUIRE( HitKey.Value == Key.Value );
+    REQUIRE( ImageData(AsConst(Image))[7] == 123 );
+  }
+
+  SECTION("Different options")
+  {
+    Options.ConvertTo = image_format::B8G8R8A8_UNORM;
+
+    image_cache_key OtherKey{};
+    REQUIRE( !ImageCacheLookup(*Cache, SliceFromString(SourceFileName), Options, Image, OtherKey) );
+    REQUIRE( OtherKey.Value != Key.Value );
+  }
+
+  SECTION("Changed source")
+  {
+    WriteSourceImage(Allocator, 16, 16, 42);
+
+    image_cache_key OtherKey{};
+    REQUIRE( !ImageCacheLookup(*Cache, SliceFromString(SourceFileName), Options, Image, OtherKey) );
+    REQUIRE( OtherKey.Value != Key.Value );
+  }
+
+  SECTION("Sources with the same content share an entry")
+  {
+    char const* const CopyFileName = "Test_ImageCache_Copy.dds";
+    WriteSourceImage(Allocator, 16, 8, 42, CopyFileName);
+    Defer [&](){ std::remove(CopyFileName); };
+
+    image_cache_key CopyKey{};
+    REQUIRE( ImageCacheLookup(*Cache, SliceFromString(CopyFileName), Options, Image, CopyKey) );
+    REQUIRE( CopyKey.Value == Key.Value );
+
+    // The entry stays as long as the copy still uses it.
+    WriteSourceImage(Allocator, 16, 16, 42);
+    image_cache_key OtherKey{};
+    REQUIRE( !ImageCacheLookup(*Cache, SliceFromString(SourceFileName), Options, Image, OtherKey) );
+    REQUIRE( ImageCacheLookup(*Cache, SliceFromString(CopyFileName), Options, Image, CopyKey) );
+    REQUIRE( CopyKey.Value == Key.Value );
+  }
+
+  SECTION("Missing source")
+  {
+    image_cache_key OtherKey{};
+    REQUIRE( !ImageCacheLookup(*Cache, SliceFromString("Test_ImageCache_DoesNotExist.dds"), Options, Image, OtherKey) );
+    REQUIRE( OtherKey.Value == 0 );
+  }
+}
+
+TEST_CASE("Image Cache In Load Queue", "[ImageCache][ImageLoadQueue]")
+{
+  test_allocator Allocator{};
+
+  WriteSourceImage(Allocator, 16, 8, 30);
+  Defer [&](){ std::remove(SourceFileName); };
+
+  auto Cache = CreateImageCache(Allocator, SliceFromString(CacheDirectory));
+  REQUIRE( Cache != nullptr );
+  Defer [&]()
+  {
+    ImageCacheClear(*Cache);
+    DestroyImageCache(Allocator, Cache);
+    std::remove(CacheDirectory);
+  };
+
+  auto Queue = CreateImageLoadQueue(Allocator, 2);
+  Defer [&](){ DestroyImageLoadQueue(Allocator, Queue); };
+
+  image_load_result Result{};
+  Init(Result.Image, Allocator);
+  Defer [&](){ Finalize(Result.Image); };
+
+  image_loader_dds Loader{};
+  image_load_options Options{};
+  Options.ConvertTo = image_format::B8G8R8A8_UNORM_SRGB;
+  Options.GenerateMipmaps = true;
+  Options.Cache = Cache;
+
+  // The first request processes the image, the second one finds it in the cache.
+  for(uint32 Run = 0; Run < 2; ++Run)
+  {
+    ImageLoadQueueSubmit(*Queue, SliceFromString(SourceFileName), Loader, Options);
+    REQUIRE( ImageLoadQueueWait(*Queue, Result) );
+    REQUIRE( Result.Success );
+    REQUIRE( Result.Image.Format == image_format::B8G8R8A8_UNORM_SRGB );
+    REQUIRE( Result.Image.NumMipLevels == 5 );
+    REQUIRE( ImagePixelPointer<uint8>(AsConst(Result.Image), 4, 0, 0, 0, 0, 0)[0] == 96 );
+  }
+
+  // Only a borrowed image comes from the cache; processing allocates.
+  REQUIRE( ImageIsBorrowed(Result.Image) );
+}
@@ -0,0 +1,462 @@
+#include "TestHeader.hpp"
+#include <Core/ImageConversion.hpp>
+#include <Core/Color.hpp>
+
+#include <cmath>
+
+
+namespace
+{
+  image_format const ConvertibleFormats[] = {
+    image_format::R32G32B32A32_FLOAT, image_format::R32G32B32_FLOAT, image_format::R32G32_FLOAT, image_format::R32_FLOAT,
+    image_format::R16G16B16A16_FLOAT, image_format::R16G16B16A16_UNORM, image_format::R16G16B16A16_SNORM,
+    image_format::R16G16_FLOAT, image_format::R16G16_UNORM, image_format::R16G16_SNORM,
+    image_format::R16_FLOAT, image_format::R16_UNORM, image_format::R16_SNORM,
+    image_format::R8G8B8A8_UNORM, image_format::R8G8B8A8_UNORM_SRGB, image_format::R8G8B8A8_SNORM,
+    image_format::B8G8R8A8_UNORM, image_format::B8G8R8A8_UNORM_SRGB,
+    image_format::B8G8R8X8_UNORM, image_format::B8G8R8X8_UNORM_SRGB, image_format::B8G8R8_UNORM,
+    image_format::R8G8_UNORM, image_format::R8G8_SNORM, image_format::R8_UNORM, image_format::R8_SNORM, image_format::A8_UNORM,
+    image_format::R10G10B10A2_UNORM, image_format::R11G11B10_FLOAT, image_format::R9G9B9E5_SHAREDEXP,
+    image_format::B5G6R5_UNORM, image_format::B5G5R5A1_UNORM, image_format::B4G4R4A4_UNORM,
+  };
+
+  image_format const Formats8888[] = {
+    image_format::R8G8B8A8_UNORM, image_format::R8G8B8A8_UNORM_SRGB,
+    image_format::B8G8R8A8_UNORM, image_format::B8G8R8A8_UNORM_SRGB,
+    image_format::B8G8R8X8_UNORM, image_format::B8G8R8X8_UNORM_SRGB,
+  };
+
+  float
+  DecodeOne(image_format Format, void const* Pixel, uint32 Channel)
+  {
+    float Pixels[4];
+    REQUIRE( ImageDecodeRow(Format, Pixel, 1, Pixels) );
+    return Pixels[Channel];
+  }
+
+  void
+  FillWithPattern(image& Image)
+  {
+    auto Data = ImageData(Image);
+    for(size_t Index = 0; Index < Data.Num; ++Index)
+      Data[Index] = uint8((Index * 7 + Index / 5) % 256);
+  }
+}
+
+TEST_CASE("Image Decode and Encode Rows", "[ImageConversion]")
+{
+  SECTION("Missing channels")
+  {
+    uint8 const Red = 51;
+    float Pixels[4];
+    REQUIRE( ImageDecodeRow(image_format::R8_UNORM, &Red, 1, Pixels) );
+    REQUIRE( Pixels[0] == 0.2f );
+    REQUIRE( Pixels[1] == 0.0f );
+    REQUIRE( Pixels[2] == 0.0f );
+    REQUIRE( Pixels[3] == 1.0f );
+
+    REQUIRE( ImageDecodeRow(image_format::A8_UNORM, &Red, 1, Pixels) );
+    REQUIRE( Pixels[0] == 0.0f );
+    REQUIRE( Pixels[3] == 0.2f );
+
+    uint8 const BGRX[4] = { 0, 0, 255, 0 };
+    REQUIRE( DecodeOne(image_format::B8G8R8X8_UNORM, BGRX, 0) == 1.0f );
+    REQUIRE( DecodeOne(image_format::B8G8R8X8_UNORM, BGRX, 3) == 1.0f );
+
+    float const Color[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    uint8 Encoded[4];
+    REQUIRE( ImageEncodeRow(image_format::B8G8R8X8_UNORM, Color, 1, Encoded) );
+    REQUIRE( Encoded[2] == 255 );
+    REQUIRE( Encoded[3] == 255 );
+  }
+
+  SECTION("SNORM")
+  {
+    int8 const Values[2] = { -128, -127 };
+    REQUIRE( DecodeOne(image_format::R8G8_SNORM, Values, 0) == -1.0f );
+    REQUIRE( DecodeOne(image_format::R8G8_SNORM, Values, 1) == -1.0f );
+
+    float const Pixels[8] = { -2.0f, 0.5f, 0, 0, 1.0f, -0.5f, 0, 0 };
+    int16 Encoded[4];
+    REQUIRE( ImageEncodeRow(image_format::R16G16_SNORM, Pixels, 2, Encoded) );
+    REQUIRE( Encoded[0] == -32767 );
+    REQUIRE( Encoded[1] == 16384 );
+    REQUIRE( Encoded[2] == 32767 );
+    REQUIRE( Encoded[3] == -16384 );
+  }
+
+  SECTION("Half floats")
+  {
+    uint16 const Halfs[4] = { 0x3C00, 0xC000, 0x0001, 0x7BFF };
+    float Pixels[4];
+    REQUIRE( ImageDecodeRow(image_format::R16G16B16A16_FLOAT, Halfs, 1, Pixels) );
+    REQUIRE( Pixels[0] == 1.0f );
+    REQUIRE( Pixels[1] == -2.0f );
+    REQUIRE( Pixels[2] == std::ldexp(1.0f, -24) );
+    REQUIRE( Pixels[3] == 65504.0f );
+
+    uint16 const Special[2] = { 0x7C00, 0x7E00 };
+    REQUIRE( std::isinf(DecodeOne(image_format::R16G16_FLOAT, Special, 0)) );
+    REQUIRE( std::isnan(DecodeOne(image_format::R16G16_FLOAT, Special, 1)) );
+
+    float const Values[4] = { 1.0f + std::ldexp(1.0f, -11), 70000.0f, -0.0f, std::ldexp(1.0f, -25) * 1.5f };
+    uint16 Encoded[4];
+    REQUIRE( ImageEncodeRow(image_format::R16G16B16A16_FLOAT, Values, 1, Encoded) );
+    REQUIRE( Encoded[0] == 0x3C00 ); // Ties round to even.
+    REQUIRE( Encoded[1] == 0x7C00 );
+    REQUIRE( Encoded[2] == 0x8000 );
+    REQUIRE( Encoded[3] == 0x0001 );
+  }
+
+  SECTION("Packed formats")
+  {
+    uint32 const R10G10B10A2 = 1023u | (0u << 10) | (512u << 20) | (1u << 30);
+    float Pixels[4];
+    REQUIRE( ImageDecodeRow(image_format::R10G10B10A2_UNORM, &R10G10B10A2, 1, Pixels) );
+    REQUIRE( Pixels[0] == 1.0f );
+    REQUIRE( Pixels[1] == 0.0f );
+    REQUIRE( Pixels[2] == Approx(512.0f / 1023.0f) );
+    REQUIRE( Pixels[3] == Approx(1.0f / 3.0f) );
+
+    float const Red[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+    uint16 B5G6R5;
+    REQUIRE( ImageEncodeRow(image_format::B5G6R5_UNORM, Red, 1, &B5G6R5) );
+    REQUIRE( B5G6R5 == 0xF800 );
+    uint16 B4G4R4A4;
+    REQUIRE( ImageEncodeRow(image_format::B4G4R4A4_UNORM, Red, 1, &B4G4R4A4) );
+    REQUIRE( B4G4R4A4 == 0xFF00 );
+
+    // 1.0 in every channel of R11G11B10: exponent 15, no mantissa.
+    float const One[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    uint32 R11G11B10;
+    REQUIRE( ImageEncodeRow(image_format::R11G11B10_FLOAT, One, 1, &R11G11B10) );
+    REQUIRE( R11G11B10 == ((15u << 6) | (15u << 17) | (15u << 27)) );
+
+    float const Negative[4] = { -1.0f, 0.25f, 3.0f, 1.0f };
+    REQUIRE( ImageEncodeRow(image_format::R11G11B10_FLOAT, Negative, 1, &R11G11B10) );
+    REQUIRE( ImageDecodeRow(image_format::R11G11B10_FLOAT, &R11G11B10, 1, Pixels) );
+    REQUIRE( Pixels[0] == 0.0f );
+    REQUIRE( Pixels[1] == 0.25f );
+    REQUIRE( Pixels[2] == 3.0f );
+
+    float const Hdr[4] = { 100.0f, 0.5f, 0.0f, 1.0f };
+    uint32 R9G9B9E5;
+    REQUIRE( ImageEncodeRow(image_format::R9G9B9E5_SHAREDEXP, Hdr, 1, &R9G9B9E5) );
+    REQUIRE( ImageDecodeRow(image_format::R9G9B9E5_SHAREDEXP, &R9G9B9E5, 1, Pixels) );
+    REQUIRE( Pixels[0] == 100.0f );
+    REQUIRE( Pixels[1] == 0.5f );
+    REQUIRE( Pixels[2] == 0.0f );
+  }
+
+  SECTION("SRGB")
+  {
+    // Linear 0.5 is 188 in sRGB.
+    float const Gray[8] = { 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f };
+    uint8 Encoded[8];
+    REQUIRE( ImageEncodeRow(image_format::B8G8R8A8_UNORM_SRGB, Gray, 2, Encoded) );
+    REQUIRE( Encoded[0] == 188 );
+    REQUIRE( Encoded[2] == 188 );
+    REQUIRE( Encoded[3] == 128 );
+
+    // Every value survives the round trip.
+    uint8 Values[256 * 4];
+    for(uint32 Index = 0; Index < 256 * 4; ++Index)
+      Values[Index] = uint8(Index / 4);
+
+    float Pixels[256 * 4];
+    uint8 RoundTrip[256 * 4];
+    REQUIRE( ImageDecodeRow(image_format::R8G8B8A8_UNORM_SRGB, Values, 256, Pixels) );
+    REQUIRE( ImageEncodeRow(image_format::R8G8B8A8_UNORM_SRGB, Pixels, 256, RoundTrip) );
+    REQUIRE( MemEqualBytes(Bytes(sizeof(Values)), Values, RoundTrip) );
+  }
+
+  SECTION("The SIMD paths match the scalar ones")
+  {
+    // Wide enough for the vectorized loops, with a few pixels left over.
+    uint8 Values[11 * 4];
+    for(uint32 Index = 0; Index < 11 * 4; ++Index)
+      Values[Index] = uint8(Index * 23);
+
+    float Wide[11 * 4];
+    REQUIRE( ImageDecodeRow(image_format::B8G8R8A8_UNORM, Values, 11, Wide) );
+    for(uint32 X = 0; X < 11; ++X)
+    {
+      float Narrow[4];
+      REQUIRE( ImageDecodeRow(image_format::B8G8R8A8_UNORM, Values + 4 * X, 1, Narrow) );
+      REQUIRE( MemEqualBytes(Bytes(sizeof(Narrow)), Narrow, Wide + 4 * X) );
+    }
+
+    // Include values outside of [0, 1].
+    Wide[5] = 1.5f;
+    Wide[6] = -0.2f;
+    Wide[7] = NAN;
+    uint8 Encoded[11 * 4];
+    REQUIRE( ImageEncodeRow(image_format::R8G8B8A8_UNORM, Wide, 11, Encoded) );
+    for(uint32 X = 0; X < 11; ++X)
+    {
+      uint8 Narrow[4];
+      REQUIRE( ImageEncodeRow(image_format::R8G8B8A8_UNORM, Wide + 4 * X, 1, Narrow) );
+      REQUIRE( MemEqualBytes(Bytes(sizeof(Narrow)), Narrow, Encoded + 4 * X) );
+    }
+    REQUIRE( Encoded[5] == 255 );
+    REQUIRE( Encoded[6] == 0 );
+    REQUIRE( Encoded[7] == 0 );
+
+    // R16_FLOAT always takes the scalar path, R16G16B16A16_FLOAT the vectorized one.
+    static uint16 Halfs[65536];
+    static float Floats[65536];
+    for(uint32 Index = 0; Index < 65536; ++Index)
+      Halfs[Index] = uint16(Index);
+
+    REQUIRE( ImageDecodeRow(image_format::R16G16B16A16_FLOAT, Halfs, 65536 / 4, Floats) );
+    for(uint32 Index = 0; Index < 65536; ++Index)
+    {
+      // Compare the bits, so NaNs are equal too.
+      float Pixel[4];
+      REQUIRE( ImageDecodeRow(image_format::R16_FLOAT, &Halfs[Index], 1, Pixel) );
+      if(!MemEqualBytes(Bytes(sizeof(float)), &Pixel[0], &Floats[Index]))
+        FAIL( "Half " << Index );
+    }
+
+    // Floats all over the range, including the ones half way between two halfs.
+    uint32 const LowBits[] = { 0x0000, 0x1000, 0x0FFF, 0x1001, 0x3000, 0xFFFF };
+    for(uint32 Index = 0; Index < 65536; ++Index)
+    {
+      uint32 const Bits = (Index << 16) | LowBits[Index % 6];
+      MemCopyBytes(Bytes(sizeof(float)), &Floats[Index], &Bits);
+    }
+
+    REQUIRE( ImageEncodeRow(image_format::R16G16B16A16_FLOAT, Floats, 65536 / 4, Halfs) );
+    for(uint32 Index = 0; Index < 65536; ++Index)
+    {
+      float const Pixel[4] = { Floats[Index], 0.0f, 0.0f, 1.0f };
+      uint16 Half;
+      REQUIRE( ImageEncodeRow(image_format::R16_FLOAT, Pixel, 1, &Half) );
+      if(Half != Halfs[Index])
+        FAIL( "Float " << Floats[Index] << ": " << Half << " != " << Halfs[Index] );
+    }
+  }
+
+  SECTION("Unsupported formats")
+  {
+    uint8 Block[8]{};
+    float Pixels[16];
+    REQUIRE( !ImageFormatIsConvertible(image_format::BC1_UNORM) );
+    REQUIRE( !ImageFormatIsConvertible(image_format::R8G8B8A8_UINT) );
+    REQUIRE( !ImageDecodeRow(image_format::BC1_UNORM, Block, 4, Pixels) );
+    REQUIRE( !ImageEncodeRow(image_format::R8G8B8A8_UINT, Pixels, 2, Block) );
+  }
+}
+
+TEST_CASE("Image Convert", "[ImageConversion]")
+{
+  test_allocator Allocator{};
+
+  image Source{};
+  Init(Source, Allocator);
+  Defer [&](){ Finalize(Source); };
+
+  image Target{};
+  Init(Target, Allocator);
+  Defer [&](){ Finalize(Target); };
+
+  image RoundTrip{};
+  Init(RoundTrip, Allocator);
+  Defer [&](){ Finalize(RoundTrip); };
+
+  SECTION("Every format survives a round trip from 8 bit values")
+  {
+    Source.Format = image_format::R8G8B8A8_UNORM;
+    Source.Width = 37;
+    Source.Height = 5;
+    ImageAllocateData(Source);
+    FillWithPattern(Source);
+
+    for(auto Format : ConvertibleFormats)
+    {
+      REQUIRE( ImageFormatIsConvertible(Format) );
+      REQUIRE( ImageConvert(Target, Source, Format) );
+      REQUIRE( Target.Format == Format );
+      REQUIRE( ImageRowPitch(Target) == Source.Width * ImageFormatBitsPerPixel(Format) / 8 );
+      REQUIRE( ImageConvert(RoundTrip, Target, image_format::R8G8B8A8_UNORM) );
+
+      // Find out which channels the format has.
+      float const Gray[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
+      uint8 Probe[16];
+      float Probed[4];
+      REQUIRE( ImageEncodeRow(Format, Gray, 1, Probe) );
+      REQUIRE( ImageDecodeRow(Format, Probe, 1, Probed) );
+
+      int MaxError = 1;
+      switch(Format)
+      {
+        case image_format::B4G4R4A4_UNORM: MaxError = 9; break;
+        case image_format::B5G6R5_UNORM:
+        case image_format::B5G5R5A1_UNORM: MaxError = 128; break; // A1
+        case image_format::R10G10B10A2_UNORM: MaxError = 43; break; // A2
+        case image_format::R11G11B10_FLOAT: MaxError = 2; break;
+        case image_format::R9G9B9E5_SHAREDEXP: MaxError = 2; break;
+        case image_format::R8G8B8A8_SNORM:
+        case image_format::R8G8_SNORM:
+        case image_format::R8_SNORM: MaxError = 1; break;
+        default: break;
+      }
+
+      auto In = ImageDataPointer<uint8>(AsConst(Source));
+      auto Out = ImageDataPointer<uint8>(AsConst(RoundTrip));
+      for(uint32 Index = 0; Index < Source.Width * Source.Height * 4; ++Index)
+      {
+        uint32 const Component = Index % 4;
+
+        // Channels the format doesn't have come back as 0, or 1 for alpha.
+        if(Probed[Component] == (Component == 3 ? 1.0f : 0.0f))
+          continue;
+
+        // SRGB formats lose precision in the bright colors.
+        int Tolerance = MaxError;
+        if(Component < 3 && (Format == image_format::R8G8B8A8_UNORM_SRGB || Format == image_format::B8G8R8A8_UNORM_SRGB ||
+                             Format == image_format::B8G8R8X8_UNORM_SRGB))
+        {
+          Tolerance = 1;
+        }
+        if(Format == image_format::R9G9B9E5_SHAREDEXP && Component < 3)
+        {
+          // The shared exponent costs the smaller channels their precision.
+          Tolerance = 2 + In[Index - Component + 0] / 64 + In[Index - Component + 1] / 64 + In[Index - Component + 2] / 64;
+        }
+
+        INFO( ImageFormatName(Format) << " index " << Index );
+        REQUIRE( Abs(int(In[Index]) - int(Out[Index])) <= Tolerance );
+      }
+    }
+  }
+
+  SECTION("Direct conversions match the conversions through floats")
+  {
+    Source.Width = 19;
+    Source.Height = 3;
+
+    for(auto SourceFormat : Formats8888)
+    {
+      Source.Format = SourceFormat;
+      ImageAllocateData(Source);
+      FillWithPattern(Source);
+
+      for(auto TargetFormat : Formats8888)
+      {
+        REQUIRE( ImageConvert(Target, Source, TargetFormat) );
+
+        // The same format is copied as it is, padding included.
+        if(SourceFormat == TargetFormat)
+        {
+          REQUIRE( MemEqualBytes(Bytes(ImageDataSize(Source)), ImageDataPointer<uint8>(AsConst(Source)), ImageDataPointer<uint8>(AsConst(Target))) );
+          continue;
+        }
+
+        // Decode and encode each row by hand.
+        for(uint32 Y = 0; Y < Source.Height; ++Y)
+        {
+          float Pixels[19 * 4];
+          uint8 Expected[19 * 4];
+          REQUIRE( ImageDecodeRow(SourceFormat, ImagePixelPointer<uint8>(AsConst(Source), 0, 0, 0, 0, Y, 0), Source.Width, Pixels) );
+          REQUIRE( ImageEncodeRow(TargetFormat, Pixels, Source.Width, Expected) );
+
+          INFO( ImageFormatName(SourceFormat) << " => " << ImageFormatName(TargetFormat) << " row " << Y );
+          REQUIRE( MemEqualBytes(Bytes(sizeof(Expected)), Expected, ImagePixelPointer<uint8>(AsConst(Target), 0, 0, 0, 0, Y, 0)) );
+        }
+      }
+    }
+  }
+
+  SECTION("All sub-images are converted")
+  {
+    Source.Format = image_format::R16G16B16A16_FLOAT;
+    Source.Width = 33;
+    Source.Height = 130;
+    Source.NumMipLevels = 4;
+    Source.NumFaces = 6;
+    Source.NumArrayIndices = 2;
+    ImageAllocateData(Source);
+
+    // 1.0 in every channel.
+    auto Halfs = ImageDataPointer<uint16>(Source);
+    for(size_t Index = 0; Index < ImageDataSize(Source) / 2; ++Index)
+      Halfs[Index] = 0x3C00;
+
+    REQUIRE( ImageConvert(Target, Source, image_format::B8G8R8A8_UNORM, 1) );
+    REQUIRE( Target.NumMipLevels == 4 );
+    REQUIRE( Target.NumFaces == 6 );
+    REQUIRE( Target.NumArrayIndices == 2 );
+    REQUIRE( ImageDataSize(Target) == ImageDataSize(Source) / 2 );
+
+    auto Data = ImageDataPointer<uint8>(AsConst(Target));
+    for(size_t Index = 0; Index < ImageDataSize(Target); ++Index)
+      REQUIRE( Data[Index] == 255 );
+
+    // More threads produce the same result.
+    FillWithPattern(Source);
+    REQUIRE( ImageConvert(Target, Source, image_format::R8G8B8A8_UNORM_SRGB, 1) );
+    REQUIRE( ImageConvert(RoundTrip, Source, image_format::R8G8B8A8_UNORM_SRGB, 4) );
+    REQUIRE( MemEqualBytes(Bytes(ImageDataSize(Target)), ImageDataPointer<uint8>(AsConst(Target)), ImageDataPointer<uint8>(AsConst(RoundTrip))) );
+  }
+
+  SECTION("Volumes")
+  {
+    Source.Format = image_format::R32_FLOAT;
+    Source.Width = 3;
+    Source.Height = 2;
+    Source.Depth = 4;
+    ImageAllocateData(Source);
+
+    auto Floats = ImageDataPointer<float>(Source);
+    for(uint32 Index = 0; Index < 3 * 2 * 4; ++Index)
+      Floats[Index] = Index / 23.0f;
+
+    REQUIRE( ImageConvert(Target, Source, image_format::R16_UNORM) );
+    auto Values = ImageDataPointer<uint16>(AsConst(Target));
+    for(uint32 Index = 0; Index < 3 * 2 * 4; ++Index)
+      REQUIRE( Values[Index] == uint16(Index / 23.0f * 65535.0f + 0.5f) );
+  }
+
+  SECTION("Unsupported formats")
+  {
+    Source.Format = image_format::BC1_UNORM;
+    Source.Width = 4;
+    Source.Height = 4;
+    ImageAllocateData(Source);
+    REQUIRE( !ImageCanConvert(Source.Format, image_format::R8G8B8A8_UNORM) );
+    REQUIRE( !ImageConvert(Target, Source, image_format::R8G8B8A8_UNORM) );
+
+    Source.Format = image_format::R8G8B8A8_UNORM;
+    ImageAllocateData(Source);
+    REQUIRE( !ImageCanConvert(Source.Format, image_format::BC1_UNORM) );
+    REQUIRE( !ImageConvert(Target, Source, image_format::BC1_UNORM) );
+  }
+}
+
+TEST_CASE("Image Set As Solid Color", "[ImageConversion]")
+{
+  test_allocator Allocator{};
+
+  image Image{};
+  Init(Image, Allocator);
+  Defer [&](){ Finalize(Image); };
+
+  color_linear Color;
+  Color.Data[0] = 1.0f;
+  Color.Data[1] = 0.5f;
+  Color.Data[2] = 0.0f;
+  Color.Data[3] = 1.0f;
+
+  REQUIRE( ImageSetAsSolidColor(Image, Color, image_format::B8G8R8A8_UNORM) );
+  auto Pixel = ImagePixelPointer<uint8>(AsConst(Image), 0, 0, 0, 1, 1, 0);
+  REQUIRE( Pixel[0] == 0 );
+  REQUIRE( Pixel[1] == 128 );
+  REQUIRE( Pixel[2] == 255 );
+  REQUIRE( Pixel[3] == 255 );
+
+  REQUIRE( ImageSetAsSolidColor(Image, Color, image_format::R32G32B32A32_FLOAT) );
+  REQUIRE( ImagePixelPointer<float>(AsConst(Image), 0, 0, 0, 1, 0, 0)[1] == 0.5f );
+
+  REQUIRE( !ImageSetAsSolidColor(Image, Color, image_format::BC3_UNORM) );
+}
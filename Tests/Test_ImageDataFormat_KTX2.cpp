@@ -0,0 +1,232 @@
+#include "TestHeader.hpp"
+#include <Core/Image.hpp>
+#include <Core/ImageDataFormat_KTX2.hpp>
+#include <Core/ImageMipmaps.hpp>
+
+
+namespace
+{
+  struct test_storage
+  {
+    image_external_storage Storage;
+    int NumReleases;
+  };
+
+  void
+  ReleaseTestStorage(image_external_storage* Storage)
+  {
+    ++Reinterpret<test_storage*>(Storage)->NumReleases;
+  }
+
+  /// The content of a level in the test files, with all layers next to each other.
+  uint8
+  TestLevelByte(uint32 Level, size_t Index)
+  {
+    return uint8(Level * 31 + Index * 7 + (Index >> 5));
+  }
+
+  void
+  CheckLevels(image const& Image)
+  {
+    for(uint32 Level = 0; Level < Image.NumMipLevels; ++Level)
+    {
+      auto const ChunkSize = ImageMipLevelSize(Image, Level);
+      for(uint32 ArrayIndex = 0; ArrayIndex < Image.NumArrayIndices; ++ArrayIndex)
+      {
+        auto const SubImage = ImageSubImagePointer<uint8>(Image, Level, 0, ArrayIndex);
+        for(size_t Index = 0; Index < ChunkSize; ++Index)
+        {
+          if(SubImage[Index] != TestLevelByte(Level, ArrayIndex * ChunkSize + Index))
+          {
+            FAIL( "Mismatch in mip level " << Level << ", array index " << ArrayIndex << " at byte " << Index );
+          }
+        }
+      }
+    }
+  }
+
+  void
+  PutUInt32(array<uint8>& File, size_t Offset, uint32 Value)
+  {
+    MemCopy(4, File.Ptr + Offset, Reinterpret<uint8 const*>(&Value));
+  }
+
+  void
+  PutUInt64(array<uint8>& File, size_t Offset, uint64 Value)
+  {
+    MemCopy(8, File.Ptr + Offset, Reinterpret<uint8 const*>(&Value));
+  }
+}
+
+TEST_CASE("Image KTX2 Zstd", "[Image][KTX2]")
+{
+  test_allocator Allocator{};
+
+  array<uint8> File{ Allocator };
+  image Image{};
+  Init(Image, Allocator);
+  Defer [&](){ Finalize(Image); };
+
+  image_loader_ktx2 Loader{};
+
+  SECTION("Array with several levels")
+  {
+    auto FileName = "../Tests/TestData/RGBA8_32x16_2Layers_6Levels_Zstd.ktx2";
+    if(!ReadFileContentIntoArray(File, FileName))
+    {
+      FAIL( FileName << ": Unable to find file. Wrong working directory?" );
+    }
+
+    REQUIRE( Loader.LoadImageFromData(Slice<void const>(File.Num, File.Ptr), Image) );
+    REQUIRE( Image.Format == image_format::R8G8B8A8_UNORM );
+    REQUIRE( Image.Width == 32 );
+    REQUIRE( Image.Height == 16 );
+    REQUIRE( Image.Depth == 1 );
+    REQUIRE( Image.NumArrayIndices == 2 );
+    REQUIRE( Image.NumFaces == 1 );
+    REQUIRE( Image.NumMipLevels == 6 );
+    CheckLevels(Image);
+  }
+
+  SECTION("Block compressed, single threaded")
+  {
+    auto FileName = "../Tests/TestData/BC1_32x32_6Levels_Zstd.ktx2";
+    if(!ReadFileContentIntoArray(File, FileName))
+    {
+      FAIL( FileName << ": Unable to find file. Wrong working directory?" );
+    }
+
+    Loader.SetNumThreads(1);
+    REQUIRE( Loader.NumThreads == 1 );
+    REQUIRE( Loader.LoadImageFromData(Slice<void const>(File.Num, File.Ptr), Image) );
+    REQUIRE( Image.Format == image_format::BC1_UNORM );
+    REQUIRE( Image.NumArrayIndices == 1 );
+    REQUIRE( Image.NumMipLevels == 6 );
+    REQUIRE( ImageMipLevelSize(Image, 0) == 512 );
+    CheckLevels(Image);
+  }
+
+  SECTION("Corrupted level")
+  {
+    auto FileName = "../Tests/TestData/RGBA8_32x16_2Layers_6Levels_Zstd.ktx2";
+    if(!ReadFileContentIntoArray(File, FileName))
+    {
+      FAIL( FileName << ": Unable to find file. Wrong working directory?" );
+    }
+
+    // Cut off the end of level 0, which is stored last.
+    SetNum(File, File.Num - 16);
+    REQUIRE( !Loader.LoadImageFromData(Slice<void const>(File.Num, File.Ptr), Image) );
+  }
+
+  SECTION("Header that doesn't match the levels")
+  {
+    auto FileName = "../Tests/TestData/RGBA8_32x16_2Layers_6Levels_Zstd.ktx2";
+    if(!ReadFileContentIntoArray(File, FileName))
+    {
+      FAIL( FileName << ": Unable to find file. Wrong working directory?" );
+    }
+
+    SECTION("Too many layers")
+    {
+      PutUInt32(File, 32, 0x08000000); // layerCount
+    }
+
+    SECTION("More layers than the uncompressed sizes cover")
+    {
+      PutUInt32(File, 32, 4); // layerCount
+    }
+
+    REQUIRE( !Loader.LoadImageFromData(Slice<void const>(File.Num, File.Ptr), Image) );
+    REQUIRE( ImageDataSize(Image) == 0 );
+  }
+}
+
+TEST_CASE("Image KTX2 Uncompressed", "[Image][KTX2]")
+{
+  test_allocator Allocator{};
+
+  // A 4x4 R8 image with a 2x2 and a 1x1 mip level, smallest level first.
+  array<uint8> File{ Allocator };
+  SetNum(File, 80 + 3 * 24 + 1 + 4 + 16);
+  MemSet(File.Num, File.Ptr);
+
+  uint8 const Identifier[] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+  MemCopy(12, File.Ptr, Identifier);
+  PutUInt32(File, 12, 9);  // vkFormat: VK_FORMAT_R8_UNORM
+  PutUInt32(File, 16, 1);  // typeSize
+  PutUInt32(File, 20, 4);  // pixelWidth
+  PutUInt32(File, 24, 4);  // pixelHeight
+  PutUInt32(File, 36, 1);  // faceCount
+  PutUInt32(File, 40, 3);  // levelCount
+
+  size_t const Offsets[] = { 157, 153, 152 };
+  size_t const Sizes[] = { 16, 4, 1 };
+  for(uint32 Level = 0; Level < 3; ++Level)
+  {
+    PutUInt64(File, 80 + Level * 24 + 0, Offsets[Level]);
+    PutUInt64(File, 80 + Level * 24 + 8, Sizes[Level]);
+    PutUInt64(File, 80 + Level * 24 + 16, Sizes[Level]);
+    for(size_t Index = 0; Index < Sizes[Level]; ++Index)
+      File[Offsets[Level] + Index] = TestLevelByte(Level, Index);
+  }
+
+  image_loader_ktx2 Loader{};
+  image Image{};
+  Init(Image, Allocator);
+
+  SECTION("Copy")
+  {
+    REQUIRE( Loader.LoadImageFromData(Slice<void const>(File.Num, File.Ptr), Image) );
+    REQUIRE( Image.Format == image_format::R8_UNORM );
+    REQUIRE( Image.NumMipLevels == 3 );
+    REQUIRE( !ImageIsBorrowed(Image) );
+    CheckLevels(Image);
+  }
+
+  SECTION("Borrow a single level")
+  {
+    PutUInt32(File, 40, 1); // levelCount
+
+    test_storage Storage{};
+    Storage.Storage.Release = &ReleaseTestStorage;
+
+    REQUIRE( Loader.BorrowImageFromData(Slice<void const>(File.Num, File.Ptr), &Storage.Storage, Image) );
+    REQUIRE( ImageIsBorrowed(Image) );
+    REQUIRE( ImageDataPointer<uint8>(AsConst(Image)) == File.Ptr + 157 );
+    CheckLevels(Image);
+
+    Finalize(Image);
+    Init(Image, Allocator);
+    ImageExternalStorageReleaseRef(&Storage.Storage);
+    REQUIRE( Storage.NumReleases == 1 );
+  }
+
+  SECTION("Unsupported supercompression")
+  {
+    PutUInt32(File, 44, 1); // BasisLZ
+    REQUIRE( !Loader.LoadImageFromData(Slice<void const>(File.Num, File.Ptr), Image) );
+  }
+
+  SECTION("Sizes that overflow")
+  {
+    PutUInt32(File, 20, 0xFFFFFFFF); // pixelWidth
+    PutUInt32(File, 24, 0xFFFFFFFF); // pixelHeight
+    PutUInt32(File, 32, 0xFFFFFFFF); // layerCount
+    REQUIRE( !Loader.LoadImageFromData(Slice<void const>(File.Num, File.Ptr), Image) );
+  }
+
+  SECTION("Level outside of the file")
+  {
+    PutUInt64(File, 80 + 8, 17);
+    REQUIRE( !Loader.LoadImageFromData(Slice<void const>(File.Num, File.Ptr), Image) );
+  }
+
+  SECTION("Writing is not supported")
+  {
+    array<uint8> Written{ Allocator };
+    REQUIRE( !Loader.WriteImageToArray(Image, Written) );
+  }
+
+  Finalize(Image);
+}
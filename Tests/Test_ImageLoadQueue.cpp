@@ -0,0 +1,151 @@
+#include "TestHeader.hpp"
+#include <Core/ImageLoadQueue.hpp>
+#include <Core/ImageDataFormat_DDS.hpp>
+
+#include <cstdio>
+#include <cstring>
+
+
+namespace
+{
+  char const* const FileNames[] = {
+    "Test_ImageLoadQueue_0.dds",
+    "Test_ImageLoadQueue_1.dds",
+    "Test_ImageLoadQueue_2.dds",
+    "Test_ImageLoadQueue_3.dds",
+  };
+
+  slice<char const>
+  FileNameSlice(char const* FileName)
+  {
+    return Slice<char const>(std::strlen(FileName), FileName);
+  }
+
+  /// Writes a 16x8 RGBA8 image whose pixels are all \a Value.
+  void
+  WriteTestImage(image_loader_dds& Loader, allocator_interface& Allocator, char const* FileName, uint8 Value)
+  {
+    image Image{};
+    Init(Image, Allocator);
+    Defer [&](){ Finalize(Image); };
+
+    Image.Format = image_format::R8G8B8A8_UNORM;
+    Image.Width = 16;
+    Image.Height = 8;
+    ImageAllocateData(Image);
+    auto Data = ImageData(Image);
+    for(size_t Index = 0; Index < Data.Num; ++Index)
+      Data[Index] = Value;
+
+    REQUIRE( WriteImageToFile(Loader, Image, FileNameSlice(FileName)) );
+  }
+}
+
+TEST_CASE("Image Load Queue", "[ImageLoadQueue]")
+{
+  test_allocator Allocator{};
+  image_loader_dds Loader{};
+
+  for(uint32 Index = 0; Index < 4; ++Index)
+    WriteTestImage(Loader, Allocator, FileNames[Index], uint8(10 * Index));
+  Defer [&](){ for(auto FileName : FileNames) std::remove(FileName); };
+
+  auto Queue = CreateImageLoadQueue(Allocator, 3);
+  REQUIRE( Queue != nullptr );
+  Defer [&](){ DestroyImageLoadQueue(Allocator, Queue); };
+
+  image_load_result Result{};
+  Init(Result.Image, Allocator);
+  Defer [&](){ Finalize(Result.Image); };
+
+  SECTION("Every request finishes once")
+  {
+    image_load_id Ids[4];
+    bool Received[4]{};
+    for(uint32 Index = 0; Index < 4; ++Index)
+      Ids[Index] = ImageLoadQueueSubmit(*Queue, FileNameSlice(FileNames[Index]), Loader, {}, &Received[Index]);
+
+    REQUIRE( ImageLoadQueueNumPending(*Queue) == 4 );
+
+    while(ImageLoadQueueWait(*Queue, Result))
+    {
+      REQUIRE( Result.Success );
+      auto const Index = size_t(Reinterpret<bool*>(Result.UserData) - Received);
+      REQUIRE( Index < 4 );
+      REQUIRE( !Received[Index] );
+      Received[Index] = true;
+
+      REQUIRE( Result.Id.Value == Ids[Index].Value );
+      REQUIRE( Slice(Result.FileName) == FileNameSlice(FileNames[Index]) );
+      REQUIRE( Result.Image.Width == 16 );
+      REQUIRE( Result.Image.Height == 8 );
+      REQUIRE( ImageData(AsConst(Result.Image))[5] == 10 * Index );
+    }
+
+    for(auto WasReceived : Received)
+      REQUIRE( WasReceived );
+    REQUIRE( ImageLoadQueueNumPending(*Queue) == 0 );
+    REQUIRE( !ImageLoadQueuePoll(*Queue, Result) );
+  }
+
+  SECTION("Images are processed on the worker threads")
+  {
+    image_load_options Options{};
+    Options.ConvertTo = image_format::B8G8R8A8_UNORM_SRGB;
+    Options.GenerateMipmaps = true;
+    ImageLoadQueueSubmit(*Queue, FileNameSlice(FileNames[3]), Loader, Options);
+
+    REQUIRE( ImageLoadQueueWait(*Queue, Result) );
+    REQUIRE( Result.Success );
+    REQUIRE( Result.Image.Format == image_format::B8G8R8A8_UNORM_SRGB );
+    REQUIRE( Result.Image.NumMipLevels == 5 );
+
+    // Linear 30 is 96 in sRGB, and a solid color stays the same in every mip level.
+    auto Pixel = ImagePixelPointer<uint8>(AsConst(Result.Image), 4, 0, 0, 0, 0, 0);
+    REQUIRE( Pixel[0] == 96 );
+    REQUIRE( Pixel[3] == 30 );
+  }
+
+  SECTION("Failed requests")
+  {
+    ImageLoadQueueSubmit(*Queue, SliceFromString("Test_ImageLoadQueue_DoesNotExist.dds"), Loader);
+
+    image_load_options Options{};
+    Options.ConvertTo = image_format::BC1_UNORM;
+    ImageLoadQueueSubmit(*Queue, FileNameSlice(FileNames[0]), Loader, Options);
+
+    for(uint32 Index = 0; Index < 2; ++Index)
+    {
+      REQUIRE( ImageLoadQueueWait(*Queue, Result) );
+      REQUIRE( !Result.Success );
+      REQUIRE( ImageDataSize(Result.Image) == 0 );
+    }
+  }
+
+  SECTION("Dispatching results")
+  {
+    for(uint32 Index = 0; Index < 4; ++Index)
+      ImageLoadQueueSubmit(*Queue, FileNameSlice(FileNames[Index]), Loader);
+
+    uint32 NumDispatched = 0;
+    while(NumDispatched < 4)
+    {
+      NumDispatched += ImageLoadQueueDispatch(*Queue, [&](image_load_result& Result)
+      {
+        REQUIRE( Result.Success );
+        REQUIRE( Result.Image.Format == image_format::R8G8B8A8_UNORM );
+      });
+    }
+
+    REQUIRE( ImageLoadQueueNumPending(*Queue) == 0 );
+  }
+
+  SECTION("Destroying the queue discards pending requests")
+  {
+    for(uint32 Round = 0; Round < 10; ++Round)
+    {
+      for(uint32 Index = 0; Index < 4; ++Index)
+        ImageLoadQueueSubmit(*Queue, FileNameSlice(FileNames[Index]), Loader);
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#include "TestHeader.hpp"
+#include <Core/Image.hpp>
+#include <Core/ImageLoader.hpp>
+#include <Core/ImageDataFormat_DDS.hpp>
+
+#include <cstdio>
+
+
+TEST_CASE("Built-in Image Loaders", "[ImageLoader]")
+{
+  test_allocator Allocator{};
+
+  auto Registry = CreateImageLoaderRegistry(Allocator);
+  REQUIRE( Registry != nullptr );
+  Defer [&](){ DestroyImageLoaderRegistry(Allocator, Registry); };
+
+  RegisterBuiltinImageLoaders(*Registry);
+
+  auto DDSFactory = GetImageLoaderFactoryByFileExtension(*Registry, ".dds"_S);
+  auto KTX2Factory = GetImageLoaderFactoryByFileExtension(*Registry, ".ktx2"_S);
+  REQUIRE( DDSFactory != nullptr );
+  REQUIRE( KTX2Factory != nullptr );
+  REQUIRE( DDSFactory != KTX2Factory );
+
+  SECTION("Sniff data")
+  {
+    uint8 const DDSData[] = { 'D', 'D', 'S', ' ', 124, 0, 0, 0 };
+    REQUIRE( GetImageLoaderFactoryByData(*Registry, Slice<void const>(ArrayCount(DDSData), DDSData)) == DDSFactory );
+
+    uint8 const KTX2Data[] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n', 0, 0 };
+    REQUIRE( GetImageLoaderFactoryByData(*Registry, Slice<void const>(ArrayCount(KTX2Data), KTX2Data)) == KTX2Factory );
+
+    // KTX version 1 starts with the same byte.
+    uint8 const KTX1Data[] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+    REQUIRE( GetImageLoaderFactoryByData(*Registry, Slice<void const>(ArrayCount(KTX1Data), KTX1Data)) == nullptr );
+
+    // Too short for the magic number.
+    REQUIRE( GetImageLoaderFactoryByData(*Registry, Slice<void const>(3, DDSData)) == nullptr );
+    REQUIRE( GetImageLoaderFactoryByData(*Registry, Slice<void const>(size_t(0), DDSData)) == nullptr );
+  }
+
+  SECTION("Sniff file content")
+  {
+    char const* const FileName = "Test_ImageLoader.bin";
+
+    image Image{};
+    Init(Image, Allocator);
+    Defer [&](){ Finalize(Image); };
+    Image.Format = image_format::R8G8B8A8_UNORM;
+    Image.Width = 4;
+    Image.Height = 4;
+    ImageAllocateData(Image);
+
+    // The file extension doesn't tell what's in the file.
+    image_loader_dds Writer{};
+    REQUIRE( WriteImageToFile(Writer, Image, SliceFromString(FileName)) );
+    Defer [&](){ std::remove(FileName); };
+
+    REQUIRE( GetImageLoaderFactoryByFileContent(*Registry, SliceFromString(FileName)) == DDSFactory );
+    REQUIRE( GetImageLoaderFactoryByFileContent(*Registry, "../Tests/TestData/BC1_32x32_6Levels_Zstd.ktx2"_S) == KTX2Factory );
+    REQUIRE( GetImageLoaderFactoryByFileContent(*Registry, "../Tests/TestData/Full.cfg"_S) == nullptr );
+    REQUIRE( GetImageLoaderFactoryByFileContent(*Registry, "Test_ImageLoader_DoesNotExist.dds"_S) == nullptr );
+  }
+
+  SECTION("Create loaders")
+  {
+    image Image{};
+    Init(Image, Allocator);
+    Defer [&](){ Finalize(Image); };
+
+    auto Loader = CreateImageLoader(*KTX2Factory);
+    REQUIRE( Loader != nullptr );
+    Defer [&](){ DestroyImageLoader(*KTX2Factory, Loader); };
+
+    REQUIRE( LoadImageFromFile(*Loader, Image, "../Tests/TestData/BC1_32x32_6Levels_Zstd.ktx2"_S) );
+    REQUIRE( Image.Width == 32 );
+    REQUIRE( Image.NumMipLevels == 6 );
+  }
+}
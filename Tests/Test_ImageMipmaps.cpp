@@ -0,0 +1,313 @@
+#include "TestHeader.hpp"
+#include <Core/ImageMipmaps.hpp>
+
+
+namespace
+{
+  image_mip_filter const AllFilters[] = { image_mip_filter::Box, image_mip_filter::Triangle, image_mip_filter::Kaiser };
+
+  void
+  FillWithColor(image& Image, uint8 R, uint8 G, uint8 B, uint8 A)
+  {
+    auto Data = ImageData(Image);
+    for(size_t Index = 0; Index + 4 <= Data.Num; Index += 4)
+    {
+      Data[Index + 0] = R;
+      Data[Index + 1] = G;
+      Data[Index + 2] = B;
+      Data[Index + 3] = A;
+    }
+  }
+}
+
+TEST_CASE("Image Full Mip Chain Length", "[ImageMipmaps]")
+{
+  image_header Header{};
+  Header.Width = 1;
+  Header.Height = 1;
+  REQUIRE( ImageFullMipChainLength(Header) == 1 );
+
+  Header.Width = 256;
+  Header.Height = 256;
+  REQUIRE( ImageFullMipChainLength(Header) == 9 );
+
+  Header.Width = 45;
+  Header.Height = 22;
+  REQUIRE( ImageFullMipChainLength(Header) == 6 );
+
+  Header.Width = 1;
+  Header.Height = 300;
+  REQUIRE( ImageFullMipChainLength(Header) == 9 );
+}
+
+TEST_CASE("Image Generate Mipmaps", "[ImageMipmaps]")
+{
+  test_allocator Allocator{};
+
+  image Source{};
+  Init(Source, Allocator);
+  Defer [&](){ Finalize(Source); };
+
+  image Target{};
+  Init(Target, Allocator);
+  Defer [&](){ Finalize(Target); };
+
+  SECTION("Box filter averages 2x2 pixels")
+  {
+    Source.Format = image_format::R8G8B8A8_UNORM;
+    Source.Width = 4;
+    Source.Height = 2;
+    ImageAllocateData(Source);
+
+    uint8 const Pixels[2][4][4] = {
+      { { 0, 10, 20, 30 }, { 4, 10, 20, 30 }, {  0, 0, 0, 0 }, { 255, 255, 255, 255 } },
+      { { 0, 10, 20, 30 }, { 4, 10, 20, 30 }, {  0, 0, 0, 0 }, { 255, 255, 255, 255 } },
+    };
+    MemCopyBytes(Bytes(sizeof(Pixels)), ImageDataPointer<uint8>(Source), Pixels);
+
+    REQUIRE( ImageGenerateMipmaps(Target, Source) );
+    REQUIRE( Target.NumMipLevels == 3 );
+    REQUIRE( Target.Format == Source.Format );
+    REQUIRE( ImageWidth(Target, 1) == 2 );
+    REQUIRE( ImageHeight(Target, 1) == 1 );
+
+    // The base level is copied as it is.
+    REQUIRE( MemEqualBytes(Bytes(sizeof(Pixels)), ImageDataPointer<uint8>(AsConst(Target)), Pixels) );
+
+    auto Mip1 = ImagePixelPointer<uint8>(AsConst(Target), 1, 0, 0, 0, 0, 0);
+    REQUIRE( Mip1[0] == 2 );
+    REQUIRE( Mip1[1] == 10 );
+    REQUIRE( Mip1[2] == 20 );
+    REQUIRE( Mip1[3] == 30 );
+    REQUIRE( Mip1[4] == 128 );
+    REQUIRE( Mip1[7] == 128 );
+
+    auto Mip2 = ImagePixelPointer<uint8>(AsConst(Target), 2, 0, 0, 0, 0, 0);
+    REQUIRE( Mip2[3] == 79 );
+  }
+
+  SECTION("SRGB images are filtered in linear space")
+  {
+    Source.Format = image_format::R8G8B8A8_UNORM_SRGB;
+    Source.Width = 2;
+    Source.Height = 2;
+    ImageAllocateData(Source);
+
+    // A checkerboard of black and white, alpha the other way around.
+    auto Data = ImageDataPointer<uint8>(Source);
+    for(uint32 Index = 0; Index < 4; ++Index)
+    {
+      uint8 const Value = (Index == 0 || Index == 3) ? 255 : 0;
+      Data[4 * Index + 0] = Value;
+      Data[4 * Index + 1] = Value;
+      Data[4 * Index + 2] = Value;
+      Data[4 * Index + 3] = 255 - Value;
+    }
+
+    REQUIRE( ImageGenerateMipmaps(Target, Source) );
+    auto Mip1 = ImagePixelPointer<uint8>(AsConst(Target), 1, 0, 0, 0, 0, 0);
+
+    // Linear 0.5 is 188 in sRGB, not 128.
+    REQUIRE( Mip1[0] == 188 );
+    REQUIRE( Mip1[1] == 188 );
+    REQUIRE( Mip1[2] == 188 );
+
+    // Alpha is linear.
+    REQUIRE( Mip1[3] == 128 );
+
+    SECTION("Every value survives the conversion")
+    {
+      // Blocks of 2x2 pixels with the same value.
+      Source.Width = 512;
+      Source.Height = 2;
+      ImageAllocateData(Source);
+      for(uint32 Y = 0; Y < 2; ++Y)
+      {
+        for(uint32 X = 0; X < 512; ++X)
+        {
+          auto Pixel = ImagePixelPointer<uint8>(Source, 0, 0, 0, X, Y, 0);
+          for(uint32 Channel = 0; Channel < 4; ++Channel)
+            Pixel[Channel] = uint8(X / 2);
+        }
+      }
+
+      REQUIRE( ImageGenerateMipmaps(Target, Source, image_mip_filter::Box, 2) );
+      for(uint32 X = 0; X < 256; ++X)
+      {
+        auto Pixel = ImagePixelPointer<uint8>(AsConst(Target), 1, 0, 0, X, 0, 0);
+        for(uint32 Channel = 0; Channel < 4; ++Channel)
+          REQUIRE( Pixel[Channel] == X );
+      }
+    }
+
+    SECTION("The same data as UNORM")
+    {
+      Source.Format = image_format::R8G8B8A8_UNORM;
+      REQUIRE( ImageGenerateMipmaps(Target, Source) );
+      REQUIRE( ImagePixelPointer<uint8>(AsConst(Target), 1, 0, 0, 0, 0, 0)[0] == 128 );
+    }
+  }
+
+  SECTION("Sizes that aren't a power of two")
+  {
+    Source.Format = image_format::R32_FLOAT;
+    Source.Width = 5;
+    Source.Height = 1;
+    ImageAllocateData(Source);
+    for(uint32 X = 0; X < 5; ++X)
+      *ImagePixelPointer<float>(Source, 0, 0, 0, X, 0, 0) = float(X);
+
+    REQUIRE( ImageGenerateMipmaps(Target, Source, image_mip_filter::Box, 2) );
+    REQUIRE( Target.NumMipLevels == 2 );
+    REQUIRE( ImageWidth(Target, 1) == 2 );
+
+    // Each pixel covers 2.5 pixels of the level above, splitting the one in the middle.
+    auto Mip1 = ImagePixelPointer<float>(AsConst(Target), 1, 0, 0, 0, 0, 0);
+    REQUIRE( Mip1[0] == Approx(0.8f) );
+    REQUIRE( Mip1[1] == Approx(3.2f) );
+  }
+
+  SECTION("All filters keep a solid color")
+  {
+    Source.Format = image_format::B8G8R8A8_UNORM_SRGB;
+    Source.Width = 45;
+    Source.Height = 22;
+    ImageAllocateData(Source);
+    FillWithColor(Source, 10, 100, 200, 50);
+
+    for(auto Filter : AllFilters)
+    {
+      REQUIRE( ImageGenerateMipmaps(Target, Source, Filter) );
+      REQUIRE( Target.NumMipLevels == 6 );
+
+      for(uint32 MipLevel = 0; MipLevel < Target.NumMipLevels; ++MipLevel)
+      {
+        for(uint32 Y = 0; Y < ImageHeight(Target, MipLevel); ++Y)
+        {
+          for(uint32 X = 0; X < ImageWidth(Target, MipLevel); ++X)
+          {
+            auto Pixel = ImagePixelPointer<uint8>(AsConst(Target), MipLevel, 0, 0, X, Y, 0);
+            REQUIRE( Pixel[0] == 10 );
+            REQUIRE( Pixel[1] == 100 );
+            REQUIRE( Pixel[2] == 200 );
+            REQUIRE( Pixel[3] == 50 );
+          }
+        }
+      }
+    }
+  }
+
+  SECTION("Faces and array indices get their own chain")
+  {
+    Source.Format = image_format::R8G8B8A8_UNORM;
+    Source.Width = 64;
+    Source.Height = 64;
+    Source.NumFaces = 6;
+    Source.NumArrayIndices = 2;
+    ImageAllocateData(Source);
+
+    for(uint32 ArrayIndex = 0; ArrayIndex < 2; ++ArrayIndex)
+    {
+      for(uint32 Face = 0; Face < 6; ++Face)
+      {
+        auto Data = ImageSubImagePointer<uint8>(Source, 0, Face, ArrayIndex);
+        for(uint32 Index = 0; Index < 64 * 64 * 4; ++Index)
+          Data[Index] = uint8(10 * Face + 100 * ArrayIndex + (Index % 7));
+      }
+    }
+
+    for(auto Filter : AllFilters)
+    {
+      REQUIRE( ImageGenerateMipmaps(Target, Source, Filter, 0, 1) );
+      REQUIRE( Target.NumMipLevels == 7 );
+      REQUIRE( Target.NumFaces == 6 );
+      REQUIRE( Target.NumArrayIndices == 2 );
+
+      for(uint32 ArrayIndex = 0; ArrayIndex < 2; ++ArrayIndex)
+      {
+        for(uint32 Face = 0; Face < 6; ++Face)
+        {
+          // The pattern averages to 3 in every channel.
+          auto Pixel = ImageSubImagePointer<uint8>(AsConst(Target), 6, Face, ArrayIndex);
+          uint8 const Expected = uint8(10 * Face + 100 * ArrayIndex + 3);
+          for(uint32 Channel = 0; Channel < 4; ++Channel)
+            REQUIRE( Abs(int(Pixel[Channel]) - int(Expected)) <= 1 );
+        }
+      }
+
+      // More threads produce the same result.
+      image MultiThreaded{};
+      Init(MultiThreaded, Allocator);
+      Defer [&](){ Finalize(MultiThreaded); };
+      REQUIRE( ImageGenerateMipmaps(MultiThreaded, Source, Filter, 0, 4) );
+      REQUIRE( ImageDataSize(MultiThreaded) == ImageDataSize(Target) );
+      REQUIRE( MemEqualBytes(Bytes(ImageDataSize(Target)), ImageDataPointer<uint8>(AsConst(Target)), ImageDataPointer<uint8>(AsConst(MultiThreaded))) );
+    }
+  }
+
+  SECTION("Unsupported images")
+  {
+    Source.Format = image_format::BC1_UNORM;
+    Source.Width = 4;
+    Source.Height = 4;
+    ImageAllocateData(Source);
+    REQUIRE( !ImageCanGenerateMipmaps(Source.Format) );
+    REQUIRE( !ImageGenerateMipmaps(Target, Source) );
+
+    Source.Format = image_format::R8G8B8A8_UNORM;
+    Source.Depth = 4;
+    ImageAllocateData(Source);
+    REQUIRE( ImageCanGenerateMipmaps(Source.Format) );
+    REQUIRE( !ImageGenerateMipmaps(Target, Source) );
+  }
+}
+
+TEST_CASE("Image Mip Streaming", "[ImageMipmaps]")
+{
+  test_allocator Allocator{};
+
+  image Image{};
+  Init(Image, Allocator);
+  Defer [&](){ Finalize(Image); };
+
+  // Levels: 16384, 4096, 1024, 256, 64, 16 and 4 bytes.
+  Image.Format = image_format::R8G8B8A8_UNORM;
+  Image.Width = 64;
+  Image.Height = 64;
+  Image.NumMipLevels = 7;
+  ImageAllocateData(Image);
+
+  REQUIRE( ImageMipLevelSize(Image, 0) == 16384 );
+  REQUIRE( ImageMipLevelSize(Image, 6) == 4 );
+
+  SECTION("Mip tail")
+  {
+    REQUIRE( ImageMipTailLevel(Image, 1400) == 2 );
+    REQUIRE( ImageMipTailLevel(Image, 1364) == 2 );
+    REQUIRE( ImageMipTailLevel(Image, 1363) == 3 );
+    REQUIRE( ImageMipTailLevel(Image, 0) == 6 );
+    REQUIRE( ImageMipTailLevel(Image, ImageDataSize(Image)) == 0 );
+  }
+
+  SECTION("Next streamed level")
+  {
+    REQUIRE( ImageNextStreamedMipLevel(Image, 2, 4096) == 1 );
+    REQUIRE( ImageNextStreamedMipLevel(Image, 2, 4096 + 16384) == 0 );
+
+    // Streaming always makes progress.
+    REQUIRE( ImageNextStreamedMipLevel(Image, 2, 100) == 1 );
+    REQUIRE( ImageNextStreamedMipLevel(Image, 1, 0) == 0 );
+
+    REQUIRE( ImageNextStreamedMipLevel(Image, 0, 1 << 20) == 0 );
+  }
+
+  SECTION("Block compressed levels are at least one block")
+  {
+    Image.Format = image_format::BC1_UNORM;
+    ImageAllocateData(Image);
+
+    REQUIRE( ImageMipLevelSize(Image, 0) == 2048 );
+    REQUIRE( ImageMipLevelSize(Image, 5) == 8 );
+    REQUIRE( ImageMipLevelSize(Image, 6) == 8 );
+  }
+}
@@ -0,0 +1,228 @@
+#include "TestHeader.hpp"
+#include <Core/ImageResize.hpp>
+
+
+namespace
+{
+  image_resize_filter const AllFilters[] = { image_resize_filter::Box, image_resize_filter::Bilinear,
+                                             image_resize_filter::Lanczos3, image_resize_filter::Mitchell };
+
+  void
+  FillWithColor(image& Image, uint8 R, uint8 G, uint8 B, uint8 A)
+  {
+    auto Data = ImageData(Image);
+    for(size_t Index = 0; Index + 4 <= ImageDataSize(Image); Index += 4)
+    {
+      Data[Index + 0] = R;
+      Data[Index + 1] = G;
+      Data[Index + 2] = B;
+      Data[Index + 3] = A;
+    }
+  }
+}
+
+TEST_CASE("Image Resize", "[ImageResize]")
+{
+  test_allocator Allocator{};
+
+  image Source{};
+  Init(Source, Allocator);
+  Defer [&](){ Finalize(Source); };
+
+  image Target{};
+  Init(Target, Allocator);
+  Defer [&](){ Finalize(Target); };
+
+  SECTION("Box filter averages 2x2 pixels")
+  {
+    Source.Format = image_format::R8G8B8A8_UNORM;
+    Source.Width = 4;
+    Source.Height = 2;
+    ImageAllocateData(Source);
+
+    uint8 const Pixels[2][4][4] = {
+      { { 0, 10, 20, 255 }, { 4, 10, 20, 255 }, {  0, 0, 0, 255 }, { 255, 255, 255, 255 } },
+      { { 0, 10, 20, 255 }, { 4, 10, 20, 255 }, {  0, 0, 0, 255 }, { 255, 255, 255, 255 } },
+    };
+    MemCopyBytes(Bytes(sizeof(Pixels)), ImageDataPointer<uint8>(Source), Pixels);
+
+    REQUIRE( ImageResize(Target, Source, 2, 1, image_resize_filter::Box) );
+    REQUIRE( Target.Format == Source.Format );
+    REQUIRE( Target.Width == 2 );
+    REQUIRE( Target.Height == 1 );
+    REQUIRE( Target.NumMipLevels == 1 );
+
+    auto Pixel = ImagePixelPointer<uint8>(AsConst(Target), 0, 0, 0, 0, 0, 0);
+    REQUIRE( Pixel[0] == 2 );
+    REQUIRE( Pixel[1] == 10 );
+    REQUIRE( Pixel[2] == 20 );
+    REQUIRE( Pixel[3] == 255 );
+    REQUIRE( Pixel[4] == 128 );
+    REQUIRE( Pixel[7] == 255 );
+  }
+
+  SECTION("All filters keep a solid color")
+  {
+    Source.Format = image_format::B8G8R8A8_UNORM_SRGB;
+    Source.Width = 45;
+    Source.Height = 22;
+    ImageAllocateData(Source);
+    FillWithColor(Source, 10, 100, 200, 50);
+
+    uint32 const Sizes[][2] = { { 7, 3 }, { 45, 22 }, { 100, 61 }, { 1, 1 } };
+    for(auto Filter : AllFilters)
+    {
+      for(auto Size : Sizes)
+      {
+        REQUIRE( ImageResize(Target, Source, Size[0], Size[1], Filter) );
+        for(uint32 Y = 0; Y < Target.Height; ++Y)
+        {
+          for(uint32 X = 0; X < Target.Width; ++X)
+          {
+            auto Pixel = ImagePixelPointer<uint8>(AsConst(Target), 0, 0, 0, X, Y, 0);
+            REQUIRE( Pixel[0] == 10 );
+            REQUIRE( Pixel[1] == 100 );
+            REQUIRE( Pixel[2] == 200 );
+            REQUIRE( Pixel[3] == 50 );
+          }
+        }
+      }
+    }
+  }
+
+  SECTION("Interpolating filters keep the image at the same size")
+  {
+    Source.Format = image_format::R8G8B8A8_UNORM;
+    Source.Width = 9;
+    Source.Height = 5;
+    ImageAllocateData(Source);
+    auto Data = ImageDataPointer<uint8>(Source);
+    for(uint32 Index = 0; Index < ImageDataSize(Source); ++Index)
+      Data[Index] = uint8(Index * 37);
+    for(uint32 Index = 3; Index < ImageDataSize(Source); Index += 4)
+      Data[Index] = 255;
+
+    for(auto Filter : { image_resize_filter::Box, image_resize_filter::Bilinear, image_resize_filter::Lanczos3 })
+    {
+      REQUIRE( ImageResize(Target, Source, Source.Width, Source.Height, Filter) );
+      REQUIRE( MemEqualBytes(Bytes(ImageDataSize(Source)), ImageDataPointer<uint8>(AsConst(Target)), ImageDataPointer<uint8>(AsConst(Source))) );
+    }
+  }
+
+  SECTION("Bilinear magnification interpolates")
+  {
+    Source.Format = image_format::R32G32B32A32_FLOAT;
+    Source.Width = 2;
+    Source.Height = 1;
+    ImageAllocateData(Source);
+    float const Pixels[] = { 0.0f, 0.0f, 0.0f, 1.0f,  1.0f, 2.0f, 4.0f, 1.0f };
+    MemCopyBytes(Bytes(sizeof(Pixels)), ImageDataPointer<uint8>(Source), Pixels);
+
+    REQUIRE( ImageResize(Target, Source, 4, 1, image_resize_filter::Bilinear) );
+
+    // The target pixels are centered at 0.25, 0.75, 1.25 and 1.75 source pixels.
+    float const Expected[] = { 0.0f, 0.25f, 0.75f, 1.0f };
+    for(uint32 X = 0; X < 4; ++X)
+    {
+      auto Pixel = ImagePixelPointer<float>(AsConst(Target), 0, 0, 0, X, 0, 0);
+      REQUIRE( Pixel[0] == Approx(Expected[X]) );
+      REQUIRE( Pixel[1] == Approx(2.0f * Expected[X]) );
+      REQUIRE( Pixel[2] == Approx(4.0f * Expected[X]) );
+      REQUIRE( Pixel[3] == Approx(1.0f) );
+    }
+  }
+
+  SECTION("Transparent pixels don't bleed")
+  {
+    Source.Format = image_format::R8G8B8A8_UNORM;
+    Source.Width = 2;
+    Source.Height = 1;
+    ImageAllocateData(Source);
+
+    // Opaque red next to fully transparent green.
+    uint8 const Pixels[] = { 255, 0, 0, 255,  0, 255, 0, 0 };
+    MemCopyBytes(Bytes(sizeof(Pixels)), ImageDataPointer<uint8>(Source), Pixels);
+
+    REQUIRE( ImageResize(Target, Source, 1, 1, image_resize_filter::Box, image_alpha_mode::Straight) );
+    auto Pixel = ImagePixelPointer<uint8>(AsConst(Target), 0, 0, 0, 0, 0, 0);
+    REQUIRE( Pixel[0] == 255 );
+    REQUIRE( Pixel[1] == 0 );
+    REQUIRE( Pixel[2] == 0 );
+    REQUIRE( Pixel[3] == 128 );
+
+    REQUIRE( ImageResize(Target, Source, 1, 1, image_resize_filter::Box, image_alpha_mode::Premultiplied) );
+    Pixel = ImagePixelPointer<uint8>(AsConst(Target), 0, 0, 0, 0, 0, 0);
+    REQUIRE( Pixel[0] == 128 );
+    REQUIRE( Pixel[1] == 128 );
+    REQUIRE( Pixel[2] == 0 );
+    REQUIRE( Pixel[3] == 128 );
+  }
+
+  SECTION("Faces and array indices are resized separately")
+  {
+    Source.Format = image_format::R8G8B8A8_UNORM;
+    Source.Width = 64;
+    Source.Height = 48;
+    Source.NumFaces = 6;
+    Source.NumArrayIndices = 2;
+    ImageAllocateData(Source);
+
+    for(uint32 ArrayIndex = 0; ArrayIndex < 2; ++ArrayIndex)
+    {
+      for(uint32 Face = 0; Face < 6; ++Face)
+      {
+        auto Data = ImageSubImagePointer<uint8>(Source, 0, Face, ArrayIndex);
+        for(uint32 Index = 0; Index < 64 * 48 * 4; ++Index)
+          Data[Index] = uint8(10 * Face + 100 * ArrayIndex + (Index % 7));
+      }
+    }
+
+    for(auto Filter : AllFilters)
+    {
+      REQUIRE( ImageResize(Target, Source, 1, 1, Filter, image_alpha_mode::Premultiplied, 1) );
+      REQUIRE( Target.NumFaces == 6 );
+      REQUIRE( Target.NumArrayIndices == 2 );
+
+      for(uint32 ArrayIndex = 0; ArrayIndex < 2; ++ArrayIndex)
+      {
+        for(uint32 Face = 0; Face < 6; ++Face)
+        {
+          // The pattern averages to 3 in every channel.
+          auto Pixel = ImageSubImagePointer<uint8>(AsConst(Target), 0, Face, ArrayIndex);
+          uint8 const Expected = uint8(10 * Face + 100 * ArrayIndex + 3);
+          for(uint32 Channel = 0; Channel < 4; ++Channel)
+            REQUIRE( Abs(int(Pixel[Channel]) - int(Expected)) <= 1 );
+        }
+      }
+
+      // More threads produce the same result.
+      REQUIRE( ImageResize(Target, Source, 37, 100, Filter, image_alpha_mode::Straight, 1) );
+
+      image MultiThreaded{};
+      Init(MultiThreaded, Allocator);
+      Defer [&](){ Finalize(MultiThreaded); };
+      REQUIRE( ImageResize(MultiThreaded, Source, 37, 100, Filter, image_alpha_mode::Straight, 4) );
+      REQUIRE( ImageDataSize(MultiThreaded) == ImageDataSize(Target) );
+      REQUIRE( MemEqualBytes(Bytes(ImageDataSize(Target)), ImageDataPointer<uint8>(AsConst(Target)), ImageDataPointer<uint8>(AsConst(MultiThreaded))) );
+    }
+  }
+
+  SECTION("Unsupported images")
+  {
+    Source.Format = image_format::BC1_UNORM;
+    Source.Width = 4;
+    Source.Height = 4;
+    ImageAllocateData(Source);
+    REQUIRE( !ImageCanResize(Source.Format) );
+    REQUIRE( !ImageResize(Target, Source, 2, 2) );
+
+    Source.Format = image_format::R8G8B8A8_UNORM;
+    ImageAllocateData(Source);
+    REQUIRE( ImageCanResize(Source.Format) );
+    REQUIRE( !ImageResize(Target, Source, 0, 2) );
+
+    Source.Depth = 4;
+    ImageAllocateData(Source);
+    REQUIRE( !ImageResize(Target, Source, 2, 2) );
+  }
+}
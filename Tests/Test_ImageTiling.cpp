@@ -0,0 +1,324 @@
+#include <Core/Time.hpp>
+
+#include "TestHeader.hpp"
+#include <Core/ImageTiling.hpp>
+
+
+namespace
+{
+  /// Every pixel gets a value that tells where it is.
+  void
+  MakeImage(image& Image, uint32 Width, uint32 Height)
+  {
+    Image.Format = image_format::R8G8B8A8_UNORM;
+    Image.Width = Width;
+    Image.Height = Height;
+    ImageAllocateData(Image);
+
+    for(uint32 Y = 0; Y < Height; ++Y)
+    {
+      for(uint32 X = 0; X < Width; ++X)
+        *ImagePixelPointer<uint32>(Image, 0, 0, 0, X, Y, 0) = (Y << 16) | X;
+    }
+  }
+
+  /// Sums the 3x3 neighborhood of each pixel with clamped coordinates.
+  uint64
+  BoxSumPixelPointer(image const& Image)
+  {
+    uint64 Sum = 0;
+    for(uint32 Y = 0; Y < Image.Height; ++Y)
+    {
+      for(uint32 X = 0; X < Image.Width; ++X)
+      {
+        for(int DY = -1; DY <= 1; ++DY)
+        {
+          for(int DX = -1; DX <= 1; ++DX)
+          {
+            uint32 const NX = Clamp<int>(X + DX, 0, Image.Width - 1);
+            uint32 const NY = Clamp<int>(Y + DY, 0, Image.Height - 1);
+            Sum += *ImagePixelPointer<uint32>(Image, 0, 0, 0, NX, NY, 0) & 0xFF;
+          }
+        }
+      }
+    }
+    return Sum;
+  }
+
+  uint64
+  BoxSumView(image_view<uint32 const> const& View)
+  {
+    uint64 Sum = 0;
+    for(uint32 Y = 0; Y < View.Height; ++Y)
+    {
+      uint32 const* Rows[3] = {
+        ImageViewRow(View, Y > 0 ? Y - 1 : 0),
+        ImageViewRow(View, Y),
+        ImageViewRow(View, Y + 1 < View.Height ? Y + 1 : Y),
+      };
+
+      for(uint32 X = 0; X < View.Width; ++X)
+      {
+        uint32 const Left = X > 0 ? X - 1 : 0;
+        uint32 const Right = X + 1 < View.Width ? X + 1 : X;
+        for(auto Row : Rows)
+          Sum += (Row[Left] & 0xFF) + (Row[X] & 0xFF) + (Row[Right] & 0xFF);
+      }
+    }
+    return Sum;
+  }
+
+  uint64
+  BoxSumTiles(image_tiles const& Tiles)
+  {
+    uint64 Sum = 0;
+    for(uint32 Y = 0; Y < Tiles.Height; ++Y)
+    {
+      for(uint32 X = 0; X < Tiles.Width; ++X)
+      {
+        uint32 const Left = X > 0 ? X - 1 : 0;
+        uint32 const Right = X + 1 < Tiles.Width ? X + 1 : X;
+        uint32 const Top = Y > 0 ? Y - 1 : 0;
+        uint32 const Bottom = Y + 1 < Tiles.Height ? Y + 1 : Y;
+        for(uint32 NY : { Top, Y, Bottom })
+        {
+          Sum += (ImageTilesPixel<uint32>(Tiles, Left, NY) & 0xFF) +
+                 (ImageTilesPixel<uint32>(Tiles, X, NY) & 0xFF) +
+                 (ImageTilesPixel<uint32>(Tiles, Right, NY) & 0xFF);
+        }
+      }
+    }
+    return Sum;
+  }
+
+  /// Walks each column from top to bottom.
+  uint64
+  ColumnSumView(image_view<uint32 const> const& View)
+  {
+    uint64 Sum = 0;
+    for(uint32 X = 0; X < View.Width; ++X)
+    {
+      auto Pixel = Reinterpret<uint8 const*>(View.Data) + X * sizeof(uint32);
+      for(uint32 Y = 0; Y < View.Height; ++Y)
+      {
+        Sum += *Reinterpret<uint32 const*>(Pixel) & 0xFF;
+        Pixel += View.RowPitch;
+      }
+    }
+    return Sum;
+  }
+
+  /// Walks each column of tiles from top to bottom, one tile at a time.
+  uint64
+  ColumnSumTiles(image_tiles const& Tiles)
+  {
+    uint64 Sum = 0;
+    for(uint32 TileX = 0; TileX < Tiles.NumTilesX; ++TileX)
+    {
+      for(uint32 TileY = 0; TileY < Tiles.NumTilesY; ++TileY)
+      {
+        auto Tile = ImageTileView<uint32>(Tiles, TileX, TileY);
+        for(uint32 X = 0; X < Tile.Width; ++X)
+        {
+          for(uint32 Y = 0; Y < Tile.Height; ++Y)
+            Sum += Tile.Data[Y * IMAGE_TILE_SIZE + X] & 0xFF;
+        }
+      }
+    }
+    return Sum;
+  }
+}
+
+TEST_CASE("Image View", "[ImageTiling]")
+{
+  test_allocator Allocator{};
+
+  image Image{};
+  Init(Image, Allocator);
+  Defer [&](){ Finalize(Image); };
+  MakeImage(Image, 13, 10);
+
+  auto View = ImageView<uint32>(AsConst(Image));
+  REQUIRE( View.Width == 13 );
+  REQUIRE( View.Height == 10 );
+  REQUIRE( View.RowPitch == ImageRowPitch(Image) );
+  for(uint32 Y = 0; Y < Image.Height; ++Y)
+  {
+    REQUIRE( ImageViewRow(View, Y) == ImagePixelPointer<uint32>(AsConst(Image), 0, 0, 0, 0, Y, 0) );
+    for(uint32 X = 0; X < Image.Width; ++X)
+      REQUIRE( ImageViewPixel(View, X, Y) == ((Y << 16) | X) );
+  }
+
+  auto MutableView = ImageView<uint32>(Image);
+  ImageViewPixel(MutableView, 3, 4) = 42;
+  REQUIRE( *ImagePixelPointer<uint32>(AsConst(Image), 0, 0, 0, 3, 4, 0) == 42 );
+}
+
+TEST_CASE("Image Tiles", "[ImageTiling]")
+{
+  test_allocator Allocator{};
+
+  image Image{};
+  Init(Image, Allocator);
+  Defer [&](){ Finalize(Image); };
+
+  image_tiles Tiles{};
+  Init(Tiles, Allocator);
+  Defer [&](){ Finalize(Tiles); };
+
+  SECTION("Round trip")
+  {
+    MakeImage(Image, 13, 10);
+    REQUIRE( ImageToTiles(Tiles, Image) );
+    REQUIRE( Tiles.Width == 13 );
+    REQUIRE( Tiles.Height == 10 );
+    REQUIRE( Tiles.NumTilesX == 2 );
+    REQUIRE( Tiles.NumTilesY == 2 );
+    REQUIRE( Tiles.Data.Num == 4 * IMAGE_TILE_SIZE * IMAGE_TILE_SIZE * sizeof(uint32) );
+
+    for(uint32 Y = 0; Y < Image.Height; ++Y)
+    {
+      for(uint32 X = 0; X < Image.Width; ++X)
+        REQUIRE( ImageTilesPixel<uint32>(Tiles, X, Y) == ((Y << 16) | X) );
+    }
+
+    image Result{};
+    Init(Result, Allocator);
+    Defer [&](){ Finalize(Result); };
+    Result.Format = Image.Format;
+    Result.Width = Image.Width;
+    Result.Height = Image.Height;
+    ImageAllocateData(Result);
+
+    REQUIRE( ImageFromTiles(Result, Tiles) );
+    REQUIRE( ImageDataSize(Result) == ImageDataSize(Image) );
+    REQUIRE( MemEqualBytes(Bytes(ImageDataSize(Image)), ImageData(Result).Ptr, ImageData(Image).Ptr) );
+  }
+
+  SECTION("Padding repeats the edges")
+  {
+    MakeImage(Image, 13, 10);
+    REQUIRE( ImageToTiles(Tiles, Image) );
+
+    uint32 const PaddedWidth = Tiles.NumTilesX * IMAGE_TILE_SIZE;
+    uint32 const PaddedHeight = Tiles.NumTilesY * IMAGE_TILE_SIZE;
+    for(uint32 Y = 0; Y < PaddedHeight; ++Y)
+    {
+      for(uint32 X = 0; X < PaddedWidth; ++X)
+      {
+        uint32 const SourceX = Min(X, Image.Width - 1);
+        uint32 const SourceY = Min(Y, Image.Height - 1);
+        REQUIRE( ImageTilesPixel<uint32>(Tiles, X, Y) == ((SourceY << 16) | SourceX) );
+      }
+    }
+  }
+
+  SECTION("Tile views")
+  {
+    MakeImage(Image, 13, 10);
+    REQUIRE( ImageToTiles(Tiles, Image) );
+
+    for(uint32 TileY = 0; TileY < Tiles.NumTilesY; ++TileY)
+    {
+      for(uint32 TileX = 0; TileX < Tiles.NumTilesX; ++TileX)
+      {
+        auto Tile = ImageTileView<uint32>(AsConst(Tiles), TileX, TileY);
+        REQUIRE( Tile.Width == IMAGE_TILE_SIZE );
+        REQUIRE( Tile.Height == IMAGE_TILE_SIZE );
+        for(uint32 Y = 0; Y < IMAGE_TILE_SIZE; ++Y)
+        {
+          for(uint32 X = 0; X < IMAGE_TILE_SIZE; ++X)
+          {
+            REQUIRE( &ImageViewPixel(Tile, X, Y) ==
+                     &ImageTilesPixel<uint32>(AsConst(Tiles), TileX * IMAGE_TILE_SIZE + X, TileY * IMAGE_TILE_SIZE + Y) );
+          }
+        }
+      }
+    }
+  }
+
+  SECTION("Kernels agree on both layouts")
+  {
+    MakeImage(Image, 37, 21);
+    REQUIRE( ImageToTiles(Tiles, Image) );
+
+    auto View = ImageView<uint32>(AsConst(Image));
+    uint64 const Expected = BoxSumPixelPointer(Image);
+    REQUIRE( BoxSumView(View) == Expected );
+    REQUIRE( BoxSumTiles(Tiles) == Expected );
+  }
+
+  SECTION("Mismatching sizes")
+  {
+    MakeImage(Image, 13, 10);
+    REQUIRE( ImageToTiles(Tiles, Image) );
+
+    image Other{};
+    Init(Other, Allocator);
+    Defer [&](){ Finalize(Other); };
+    MakeImage(Other, 10, 13);
+    REQUIRE( !ImageFromTiles(Other, Tiles) );
+  }
+
+  SECTION("Only linear formats with whole bytes per pixel")
+  {
+    Image.Format = image_format::BC1_UNORM;
+    Image.Width = 8;
+    Image.Height = 8;
+    ImageAllocateData(Image);
+    REQUIRE( !ImageToTiles(Tiles, Image) );
+
+    // Less than a byte per pixel.
+    Image.Format = image_format::R1_UNORM;
+    ImageAllocateData(Image);
+    REQUIRE( !ImageToTiles(Tiles, Image) );
+  }
+}
+
+TEST_CASE("Image Tiling Benchmark", "[ImageTiling][.Benchmark]")
+{
+  test_allocator Allocator{};
+
+  image Image{};
+  Init(Image, Allocator);
+  Defer [&](){ Finalize(Image); };
+  MakeImage(Image, 2048, 2048);
+
+  image_tiles Tiles{};
+  Init(Tiles, Allocator);
+  Defer [&](){ Finalize(Tiles); };
+  REQUIRE( ImageToTiles(Tiles, Image) );
+
+  auto View = ImageView<uint32>(AsConst(Image));
+
+  stopwatch Stopwatch;
+
+  StopwatchStart(&Stopwatch);
+  uint64 const PixelPointerSum = BoxSumPixelPointer(Image);
+  StopwatchStop(&Stopwatch);
+  printf("3x3 box, ImagePixelPointer: %f (%llu)\n", DurationAsSeconds(StopwatchDuration(&Stopwatch)), (unsigned long long)PixelPointerSum);
+
+  StopwatchStart(&Stopwatch);
+  uint64 const ViewSum = BoxSumView(View);
+  StopwatchStop(&Stopwatch);
+  printf("3x3 box, linear view:       %f (%llu)\n", DurationAsSeconds(StopwatchDuration(&Stopwatch)), (unsigned long long)ViewSum);
+
+  StopwatchStart(&Stopwatch);
+  uint64 const TilesSum = BoxSumTiles(Tiles);
+  StopwatchStop(&Stopwatch);
+  printf("3x3 box, tiles:             %f (%llu)\n", DurationAsSeconds(StopwatchDuration(&Stopwatch)), (unsigned long long)TilesSum);
+
+  StopwatchStart(&Stopwatch);
+  uint64 const ColumnViewSum = ColumnSumView(View);
+  StopwatchStop(&Stopwatch);
+  printf("Columns, linear view:       %f (%llu)\n", DurationAsSeconds(StopwatchDuration(&Stopwatch)), (unsigned long long)ColumnViewSum);
+
+  StopwatchStart(&Stopwatch);
+  uint64 const ColumnTilesSum = ColumnSumTiles(Tiles);
+  StopwatchStop(&Stopwatch);
+  printf("Columns, tiles:             %f (%llu)\n", DurationAsSeconds(StopwatchDuration(&Stopwatch)), (unsigned long long)ColumnTilesSum);
+
+  REQUIRE( ViewSum == PixelPointerSum );
+  REQUIRE( TilesSum == PixelPointerSum );
+  REQUIRE( ColumnTilesSum == ColumnViewSum );
+}
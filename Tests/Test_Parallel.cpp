@@ -0,0 +1,40 @@
+#include "TestHeader.hpp"
+#include <Core/Parallel.hpp>
+
+#include <atomic>
+
+
+TEST_CASE("Parallel For", "[Parallel]")
+{
+  REQUIRE( ParallelNumThreads() >= 1 );
+
+  SECTION("Every item is processed exactly once")
+  {
+    std::atomic<int> Counts[100]{};
+    std::atomic<int> Sum{ 0 };
+
+    ParallelFor(100, [&](size_t Index)
+    {
+      ++Counts[Index];
+      Sum += int(Index);
+    }, 8);
+
+    for(auto& Count : Counts)
+      REQUIRE( Count == 1 );
+    REQUIRE( Sum == 99 * 100 / 2 );
+  }
+
+  SECTION("More threads than items")
+  {
+    std::atomic<int> NumCalls{ 0 };
+    ParallelFor(3, [&](size_t Index){ ++NumCalls; }, 16);
+    REQUIRE( NumCalls == 3 );
+  }
+
+  SECTION("No items")
+  {
+    bool WasCalled = false;
+    ParallelFor(0, [&](size_t Index){ WasCalled = true; });
+    REQUIRE( !WasCalled );
+  }
+}
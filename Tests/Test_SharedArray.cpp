@@ -1,5 +1,8 @@
 #include "TestHeader.hpp"
 #include <Core/SharedArray.hpp>
+#include <Core/TrackingAllocator.hpp>
+
+#include <thread>
 
 
 TEST_CASE("Shared Array Basics", "[shared_array]")
@@ -175,3 +178,107 @@ TEST_CASE("Shared Array Copy-on-Write", "[shared_array]")
   REQUIRE( Bar[0] == 123 );
   REQUIRE( Bar[1] == 1337 );
 }
+
+TEST_CASE("Shared Array Copy-on-Write Through Slices", "[shared_array]")
+{
+  shared_array<int> Foo{};
+  Foo.Growth = container_growth::Exact;
+  Expand(Foo) = 42;
+
+  shared_array<int> Bar{ Foo };
+  REQUIRE( Bar.Growth == container_growth::Exact );
+
+  Slice(Bar)[0] = 123;
+  REQUIRE( AsConst(Bar)[0] == 123 );
+  REQUIRE( AsConst(Foo)[0] == 42 );
+
+  shared_array<int> Baz{};
+  Baz = Move(Bar);
+  REQUIRE( Baz.Growth == container_growth::Exact );
+}
+
+TEST_CASE("Shared Array Assignment Keeps the Allocator", "[shared_array]")
+{
+  test_allocator BaseAllocator;
+  tracking_allocator SourceAllocator{ BaseAllocator, "Source" };
+  tracking_allocator TargetAllocator{ BaseAllocator, "Target" };
+
+  shared_array<int> Source{ SourceAllocator };
+  Expand(Source) = 42;
+
+  shared_array<int> Target{ TargetAllocator };
+  Target = Source;
+  REQUIRE( Target.Allocator == &TargetAllocator );
+  REQUIRE( TargetAllocator.Stats.NumAllocations == 0 );
+
+  SECTION("Detaching allocates from the target's allocator")
+  {
+    Target[0] = 123;
+    REQUIRE( TargetAllocator.Stats.NumLiveAllocations == 2 );
+    REQUIRE( AsConst(Source)[0] == 42 );
+  }
+
+  SECTION("Shared data is released with the allocator it came from")
+  {
+    Reset(Source);
+    REQUIRE( SourceAllocator.Stats.NumLiveAllocations == 2 );
+
+    Reset(Target);
+    REQUIRE( SourceAllocator.Stats.NumLiveAllocations == 0 );
+    REQUIRE( TargetAllocator.Stats.NumAllocations == 0 );
+  }
+
+  SECTION("Moving keeps the allocator too")
+  {
+    shared_array<int> Moved{ TargetAllocator };
+    Moved = Move(Source);
+    REQUIRE( Moved.Allocator == &TargetAllocator );
+    REQUIRE( AsConst(Moved)[0] == 42 );
+  }
+
+  Reset(Source);
+  Reset(Target);
+  REQUIRE( SourceAllocator.Stats.NumLiveAllocations == 0 );
+}
+
+TEST_CASE("Shared Array Across Threads", "[shared_array]")
+{
+  shared_array<int> Original{};
+  for(int Index = 0; Index < 64; ++Index)
+    Expand(Original) = Index;
+
+  auto Worker = [&Original](int ThreadIndex, bool* Success)
+  {
+    for(int Iteration = 0; Iteration < 2000; ++Iteration)
+    {
+      shared_array<int> Copy{ Original };
+      shared_array<int> Another{ Copy };
+
+      // Mutating detaches the copy from the original.
+      Copy[0] = ThreadIndex;
+      Expand(Another) = Iteration;
+
+      auto Data = Slice(Another);
+      if(Copy[0] != ThreadIndex || Copy.Num() != 64 ||
+         Data.Num != 65 || Data[0] != 0 || Data[63] != 63 || Data[64] != Iteration)
+      {
+        *Success = false;
+      }
+    }
+  };
+
+  bool Success[8] = { true, true, true, true, true, true, true, true };
+  std::thread Threads[8];
+  for(int Index = 0; Index < 8; ++Index)
+    Threads[Index] = std::thread(Worker, Index + 1, &Success[Index]);
+
+  for(auto& Thread : Threads)
+    Thread.join();
+
+  for(auto Result : Success)
+    REQUIRE( Result );
+
+  REQUIRE( RefCountIsUnique(Original.Shared->RefCount) );
+  for(int Index = 0; Index < 64; ++Index)
+    REQUIRE( Original[Index] == Index );
+}
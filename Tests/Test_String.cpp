@@ -5,6 +5,8 @@
 #include "TestHeader.hpp"
 #include <Core/String.hpp>
 
+#include <thread>
+
 TEST_CASE("String", "[String]")
 {
   arc_string Foo;
@@ -56,6 +58,73 @@ TEST_CASE("String", "[String]")
   }
 }
 
+TEST_CASE("String Concurrency", "[String]")
+{
+  auto Worker = [](int ThreadIndex, bool* Success)
+  {
+    for(int Iteration = 0; Iteration < 2000; ++Iteration)
+    {
+      arc_string String{ "Thread "_S };
+      String += ThreadIndex == 0 ? "A" : "B";
+
+      auto Copy = String;
+      Copy += " appended";
+
+      if(Slice(String) != (ThreadIndex == 0 ? "Thread A"_S : "Thread B"_S) ||
+         Slice(Copy) != (ThreadIndex == 0 ? "Thread A appended"_S : "Thread B appended"_S))
+      {
+        *Success = false;
+      }
+    }
+  };
+
+  bool Success[4] = { true, true, true, true };
+  std::thread Threads[4];
+  for(int Index = 0; Index < 4; ++Index)
+    Threads[Index] = std::thread(Worker, Index % 2, &Success[Index]);
+
+  for(auto& Thread : Threads)
+    Thread.join();
+
+  for(auto Result : Success)
+    REQUIRE( Result );
+}
+
+TEST_CASE("String Shared Across Threads", "[String]")
+{
+  arc_string Original{ "Shared content"_S };
+
+  auto Worker = [&Original](bool* Success)
+  {
+    for(int Iteration = 0; Iteration < 2000; ++Iteration)
+    {
+      arc_string Copy{ Original };
+      arc_string Another = Copy;
+      if(StrPtr(AsConst(Another)) != StrPtr(Original))
+        *Success = false;
+
+      // Mutating detaches the copy from the original.
+      Copy += " modified";
+      if(Slice(AsConst(Copy)) != "Shared content modified"_S || Slice(AsConst(Another)) != "Shared content"_S)
+        *Success = false;
+    }
+  };
+
+  bool Success[8] = { true, true, true, true, true, true, true, true };
+  std::thread Threads[8];
+  for(int Index = 0; Index < 8; ++Index)
+    Threads[Index] = std::thread(Worker, &Success[Index]);
+
+  for(auto& Thread : Threads)
+    Thread.join();
+
+  for(auto Result : Success)
+    REQUIRE( Result );
+
+  REQUIRE( RefCountIsUnique(Original.Internal->RefCount) );
+  REQUIRE( Original == "Shared content"_S );
+}
+
 static void
 StringBenchmark(arc_string const& String)
 {
@@ -0,0 +1,173 @@
+#include "TestHeader.hpp"
+#include <Application/VulkanTextureRegistry.hpp>
+
+
+namespace
+{
+  /// What the registry asked the device to destroy.
+  struct recorded_calls
+  {
+    size_t NumDestroyedSamplers;
+    size_t NumDestroyedImageViews;
+    size_t NumDestroyedImages;
+    size_t NumFreedMemories;
+  };
+
+  recorded_calls GlobalRecordedCalls{};
+
+  VKAPI_ATTR void VKAPI_CALL
+  RecordDestroySampler(VkDevice, VkSampler, VkAllocationCallbacks const*) { ++GlobalRecordedCalls.NumDestroyedSamplers; }
+
+  VKAPI_ATTR void VKAPI_CALL
+  RecordDestroyImageView(VkDevice, VkImageView, VkAllocationCallbacks const*) { ++GlobalRecordedCalls.NumDestroyedImageViews; }
+
+  VKAPI_ATTR void VKAPI_CALL
+  RecordDestroyImage(VkDevice, VkImage, VkAllocationCallbacks const*) { ++GlobalRecordedCalls.NumDestroyedImages; }
+
+  VKAPI_ATTR void VKAPI_CALL
+  RecordFreeMemory(VkDevice, VkDeviceMemory, VkAllocationCallbacks const*) { ++GlobalRecordedCalls.NumFreedMemories; }
+
+  /// Stands in for a real device, which isn't needed to share textures.
+  vulkan_device
+  RecordingDevice()
+  {
+    GlobalRecordedCalls = {};
+
+    vulkan_device Device{};
+    Device.vkDestroySampler = &RecordDestroySampler;
+    Device.vkDestroyImageView = &RecordDestroyImageView;
+    Device.vkDestroyImage = &RecordDestroyImage;
+    Device.vkFreeMemory = &RecordFreeMemory;
+    return Device;
+  }
+
+  template<typename HandleType>
+  HandleType
+  FakeHandle(uintptr_t Value)
+  {
+    return (HandleType)Value;
+  }
+
+  /// Pretends the texture was uploaded.
+  void
+  FakeUpload(vulkan_texture2d& Texture)
+  {
+    Texture.SamplerHandle = FakeHandle<VkSampler>(1);
+    Texture.ImageViewHandle = FakeHandle<VkImageView>(2);
+    Texture.ImageHandle = FakeHandle<VkImage>(3);
+    Texture.MemoryHandle = FakeHandle<VkDeviceMemory>(4);
+  }
+
+  void
+  MakeImage(image& Image, uint32 Width, uint32 Height, uint8 Value)
+  {
+    Image.Format = image_format::R8G8B8A8_UNORM;
+    Image.Width = Width;
+    Image.Height = Height;
+    ImageAllocateData(Image);
+    auto Data = ImageData(Image);
+    for(size_t Index = 0; Index < Data.Num; ++Index)
+      Data[Index] = Value;
+  }
+}
+
+TEST_CASE("Vulkan Texture Registry", "[VulkanTextureRegistry]")
+{
+  test_allocator Allocator{};
+
+  auto Device = RecordingDevice();
+  auto Registry = VulkanCreateTextureRegistry(Allocator, Device);
+  REQUIRE( Registry != nullptr );
+  Defer [&](){ VulkanDestroyTextureRegistry(Allocator, Registry); };
+
+  image Image{};
+  Init(Image, Allocator);
+  Defer [&](){ Finalize(Image); };
+  MakeImage(Image, 8, 4, 42);
+
+  vulkan_texture_sampling const Sampling{};
+
+  bool IsNew = false;
+  auto Texture = VulkanAcquireTexture(*Registry, Image, Sampling, IsNew);
+  REQUIRE( Texture != nullptr );
+  REQUIRE( IsNew );
+  REQUIRE( Texture->Image.Width == 8 );
+  REQUIRE( Texture->SamplerHandle == VK_NULL_HANDLE );
+  FakeUpload(*Texture);
+
+  SECTION("Same content is shared")
+  {
+    // A separate image, so only the content matches.
+    image Other{};
+    Init(Other, Allocator);
+    Defer [&](){ Finalize(Other); };
+    MakeImage(Other, 8, 4, 42);
+
+    auto Shared = VulkanAcquireTexture(*Registry, Other, Sampling, IsNew);
+    REQUIRE( !IsNew );
+    REQUIRE( Shared == Texture );
+    REQUIRE( VulkanNumTextures(*Registry) == 1 );
+
+    // Nothing is destroyed until the last reference is gone.
+    VulkanReleaseTexture(*Registry, Shared);
+    REQUIRE( GlobalRecordedCalls.NumDestroyedImages == 0 );
+    VulkanReleaseTexture(*Registry, Texture);
+    REQUIRE( GlobalRecordedCalls.NumDestroyedSamplers == 1 );
+    REQUIRE( GlobalRecordedCalls.NumDestroyedImageViews == 1 );
+    REQUIRE( GlobalRecordedCalls.NumDestroyedImages == 1 );
+    REQUIRE( GlobalRecordedCalls.NumFreedMemories == 1 );
+    REQUIRE( VulkanNumTextures(*Registry) == 0 );
+  }
+
+  SECTION("Different content")
+  {
+    image Other{};
+    Init(Other, Allocator);
+    Defer [&](){ Finalize(Other); };
+    MakeImage(Other, 8, 4, 42);
+    ImageData(Other)[5] = 43;
+
+    REQUIRE( VulkanAcquireTexture(*Registry, Other, Sampling, IsNew) != Texture );
+    REQUIRE( IsNew );
+    REQUIRE( VulkanNumTextures(*Registry) == 2 );
+  }
+
+  SECTION("Different size with the same bytes")
+  {
+    image Other{};
+    Init(Other, Allocator);
+    Defer [&](){ Finalize(Other); };
+    MakeImage(Other, 4, 8, 42);
+
+    REQUIRE( VulkanAcquireTexture(*Registry, Other, Sampling, IsNew) != Texture );
+    REQUIRE( IsNew );
+  }
+
+  SECTION("Different sampling")
+  {
+    vulkan_texture_sampling Nearest{};
+    Nearest.Filter = VK_FILTER_NEAREST;
+
+    auto Other = VulkanAcquireTexture(*Registry, Image, Nearest, IsNew);
+    REQUIRE( Other != Texture );
+    REQUIRE( IsNew );
+    REQUIRE( Other->Sampling.Filter == VK_FILTER_NEAREST );
+  }
+
+  SECTION("Additional references")
+  {
+    VulkanAddTextureReference(*Registry, Texture);
+    VulkanReleaseTexture(*Registry, Texture);
+    REQUIRE( VulkanNumTextures(*Registry) == 1 );
+    VulkanReleaseTexture(*Registry, Texture);
+    REQUIRE( VulkanNumTextures(*Registry) == 0 );
+  }
+
+  SECTION("Destroying the registry destroys the remaining textures")
+  {
+    VulkanDestroyTextureRegistry(Allocator, Registry);
+    Registry = nullptr;
+    REQUIRE( GlobalRecordedCalls.NumDestroyedSamplers == 1 );
+    REQUIRE( GlobalRecordedCalls.NumFreedMemories == 1 );
+  }
+}
@@ -0,0 +1,127 @@
+#include "TestHeader.hpp"
+#include <Core/ZstdDecompression.hpp>
+
+
+namespace
+{
+  /// Generates the text the files in TestData/Words_*.zst were compressed from.
+  ///
+  /// Mostly words from a small vocabulary, with occasional runs of dashes and
+  /// random bytes mixed in.
+  void
+  GenerateWords(size_t Size, array<uint8>& Out)
+  {
+    char const* Words[] = { "image", "texture", "vulkan", "mip", "level", "format", "block", "pixel", "loader", "frame",
+                            "buffer", "queue", "the", "of", "and", "a", "to", "in", "zstd", "sequence" };
+
+    uint32 State = 12345;
+    while(Out.Num < Size)
+    {
+      State = State * 1103515245u + 12345u;
+      uint32 const Random = State >> 16;
+      if(Random % 97 == 0)
+      {
+        for(uint32 Index = 0; Index < Random % 300; ++Index)
+          Expand(Out) = '-';
+      }
+      else if(Random % 31 == 0)
+      {
+        Expand(Out) = uint8(State >> 8);
+        Expand(Out) = uint8(State >> 3);
+      }
+      else
+      {
+        for(char const* Char = Words[Random % ArrayCount(Words)]; *Char; ++Char)
+          Expand(Out) = uint8(*Char);
+        Expand(Out) = ' ';
+      }
+    }
+
+    SetNum(Out, Size);
+  }
+
+  void
+  ReadTestFile(char const* FileName, array<uint8>& Content)
+  {
+    if(!ReadFileContentIntoArray(Content, FileName))
+    {
+      FAIL( FileName << ": Unable to find file. Wrong working directory?" );
+    }
+  }
+}
+
+TEST_CASE("Zstd Decompression", "[Zstd]")
+{
+  test_allocator Allocator{};
+
+  array<uint8> Compressed{ Allocator };
+  array<uint8> Expected{ Allocator };
+  array<uint8> Decompressed{ Allocator };
+
+  SECTION("Multiple blocks with checksum")
+  {
+    GenerateWords(200000, Expected);
+
+    // Level 1 and 19 use different literal and sequence encodings.
+    char const* FileNames[] = { "../Tests/TestData/Words_200000_Level1.zst",
+                                "../Tests/TestData/Words_200000_Level19.zst" };
+    for(auto FileName : FileNames)
+    {
+      ReadTestFile(FileName, Compressed);
+
+      size_t ContentSize{};
+      REQUIRE( ZstdFrameContentSize(Slice<void const>(Compressed.Num, Compressed.Ptr), ContentSize) );
+      REQUIRE( ContentSize == 200000 );
+
+      SetNum(Decompressed, ContentSize);
+      MemSet(Decompressed.Num, Decompressed.Ptr);
+      size_t NumWritten{};
+      REQUIRE( ZstdDecompress(Slice<void const>(Compressed.Num, Compressed.Ptr), Slice(Decompressed), &NumWritten) );
+      REQUIRE( NumWritten == ContentSize );
+      REQUIRE( AsConst(Slice(Decompressed)) == AsConst(Slice(Expected)) );
+    }
+  }
+
+  SECTION("Target too small")
+  {
+    ReadTestFile("../Tests/TestData/Words_200000_Level19.zst", Compressed);
+    SetNum(Decompressed, 199999);
+    REQUIRE( !ZstdDecompress(Slice<void const>(Compressed.Num, Compressed.Ptr), Slice(Decompressed)) );
+  }
+
+  SECTION("Corrupted data")
+  {
+    ReadTestFile("../Tests/TestData/Words_200000_Level19.zst", Compressed);
+    Compressed[Compressed.Num / 2] ^= 0x10;
+    SetNum(Decompressed, 200000);
+    REQUIRE( !ZstdDecompress(Slice<void const>(Compressed.Num, Compressed.Ptr), Slice(Decompressed)) );
+  }
+
+  SECTION("Skippable and concatenated frames")
+  {
+    array<uint8> Frame{ Allocator };
+    ReadTestFile("../Tests/TestData/Words_1000_NoChecksum.zst", Frame);
+    GenerateWords(1000, Expected);
+
+    uint8 const SkippableFrame[] = { 0x5A, 0x2A, 0x4D, 0x18, 3, 0, 0, 0, 1, 2, 3 };
+    SliceCopy(ExpandBy(Compressed, ArrayCount(SkippableFrame)), Slice(SkippableFrame));
+    SliceCopy(ExpandBy(Compressed, Frame.Num), AsConst(Slice(Frame)));
+    SliceCopy(ExpandBy(Compressed, Frame.Num), AsConst(Slice(Frame)));
+
+    SetNum(Decompressed, 2000);
+    size_t NumWritten{};
+    REQUIRE( ZstdDecompress(Slice<void const>(Compressed.Num, Compressed.Ptr), Slice(Decompressed), &NumWritten) );
+    REQUIRE( NumWritten == 2000 );
+    REQUIRE( AsConst(Slice(Slice(Decompressed), 0, 1000)) == AsConst(Slice(Expected)) );
+    REQUIRE( AsConst(Slice(Slice(Decompressed), 1000, 2000)) == AsConst(Slice(Expected)) );
+  }
+
+  SECTION("Not a Zstandard frame")
+  {
+    uint8 const Garbage[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8 Target[16];
+    size_t ContentSize;
+    REQUIRE( !ZstdFrameContentSize(Slice<void const>(sizeof(Garbage), Garbage), ContentSize) );
+    REQUIRE( !ZstdDecompress(Slice<void const>(sizeof(Garbage), Garbage), Slice(Target)) );
+  }
+}